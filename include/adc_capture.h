@@ -0,0 +1,151 @@
+/*
+ * ADC Capture Module Header
+ * Continuous AD7495 sampling on the shared HSPI bus. A hardware timer paces
+ * one conversion per tick, completed ping-pong blocks are handed to a
+ * consumer task which calls the registered block consumers.
+ *
+ * The consumer task commits every block to a shared block pool (in PSRAM
+ * when available) and passes consumers a read-only descriptor. A consumer
+ * that needs the samples after its callback returns retains the block and
+ * releases it later, rather than copying it.
+ */
+ 
+ #ifndef ADC_CAPTURE_H
+ #define ADC_CAPTURE_H
+ 
+ #include <Arduino.h>
+ #include <SPI.h>
+ #include "freertos/FreeRTOS.h"
+ #include "freertos/semphr.h"
+ #include "adc_capture_core.h"
+ #include "shared_block_pool.h"
+ 
+ // AD7495 chip select pin (hardware CS of the HSPI peripheral)
+ #define ADC_CS_PIN 5
+ 
+ // AD7495 SPI clock (part maximum is 20 MHz)
+ #define ADC_SPI_CLOCK_HZ 20000000
+ 
+ // Sample rate limits (in Hz)
+ // 50 kSPS is the stated sustained rate: the per-sample ISR costs about 1.5 us,
+ // and consumers get one full block period (10.24 ms) to return each block.
+ #define ADC_CAPTURE_SAMPLE_RATE_HZ     50000
+ #define ADC_CAPTURE_MIN_SAMPLE_RATE_HZ 100
+ #define ADC_CAPTURE_MAX_SAMPLE_RATE_HZ 100000
+ 
+ // Block ring geometry (2 blocks = ping-pong)
+ #define ADC_CAPTURE_BLOCK_SAMPLES 512
+ #define ADC_CAPTURE_NUM_BLOCKS    2
+ 
+ // Shared block pool: 512 blocks (512 KB, 5.2 s at 50 kSPS) in PSRAM, or a
+ // small internal pool when the board has no PSRAM
+ #define ADC_CAPTURE_POOL_BLOCKS          512
+ #define ADC_CAPTURE_POOL_FALLBACK_BLOCKS 8
+ 
+ // Maximum number of registered block consumers
+ #define ADC_CAPTURE_MAX_CONSUMERS 8
+ 
+ // Sample clock: timer group 0, timer 0 at APB / 2 = 40 MHz
+ #define ADC_CAPTURE_TIMER_GROUP   TIMER_GROUP_0
+ #define ADC_CAPTURE_TIMER_INDEX   TIMER_0
+ #define ADC_CAPTURE_TIMER_DIVIDER 2
+ #define ADC_CAPTURE_TIMER_HZ      (APB_CLK_FREQ / ADC_CAPTURE_TIMER_DIVIDER)
+ 
+ // Pool of dispatched blocks
+ typedef SharedBlockPool<uint16_t, ADC_CAPTURE_POOL_BLOCKS> AdcBlockPool_t;
+ 
+ // Block consumer callback - runs in the ADC consumer task, must return quickly.
+ // The block is valid until the callback returns unless the consumer retains it.
+ typedef void (*AdcBlockConsumer_t)(const AdcBlock_t *block, void *context);
+ 
+ // Capture engine status
+ typedef struct {
+   bool running;                // Whether the sample clock is running
+   uint32_t sampleRateHz;       // Achieved sample rate (timer quantized)
+   uint32_t samplesCaptured;    // Samples stored since the last start
+   uint32_t blocksCompleted;    // Blocks handed to consumers since the last start
+   uint32_t droppedSamples;     // Samples lost because consumers were too slow
+   uint32_t overruns;           // Times the producer had no free block
+   uint32_t framingErrors;      // Frames with non-zero leading bits
+   uint32_t lateConversions;    // Ticks where the previous SPI frame had not finished
+   uint16_t poolBlocks;         // Blocks in the shared pool
+   uint16_t poolHeld;           // Blocks currently referenced by consumers
+   uint32_t poolOverruns;       // Blocks dropped because every pool block was held
+   bool poolInPsram;            // Whether the pool lives in PSRAM
+ } AdcCaptureStats_t;
+ 
+ // Shared SPI bus mutex (defined in main.cpp), held by the capture engine for a whole run
+ extern SemaphoreHandle_t sharedSPIMutex;
+ 
+ /**
+  * Initialize the ADC capture module
+  * @param spi Reference to the shared SPI instance (HSPI)
+  * @return true if initialization was successful
+  */
+ bool initAdcCaptureModule(SPIClass &spi);
+ 
+ /**
+  * Create the ADC consumer task
+  * The task waits for completed blocks and passes them to the registered consumers
+  * @return true if task creation was successful
+  */
+ bool createAdcCaptureTask();
+ 
+ /**
+  * Register a block consumer
+  * @param consumer Callback invoked for every completed block
+  * @param context Opaque pointer passed back to the callback
+  * @return true if the consumer was registered
+  */
+ bool registerAdcBlockConsumer(AdcBlockConsumer_t consumer, void *context);
+ 
+ /**
+  * Keep a dispatched block after the consumer callback returns
+  * Call from the callback (or while already holding the block); every
+  * successful call must be paired with releaseAdcBlock()
+  * @param block Block passed to the consumer
+  * @return true if the block is now held (false for blocks not from the pool)
+  */
+ bool retainAdcBlock(const AdcBlock_t *block);
+ 
+ /**
+  * Drop a reference taken with retainAdcBlock() (any task)
+  * @param block Block descriptor as retained
+  */
+ void releaseAdcBlock(const AdcBlock_t *block);
+ 
+ /**
+  * Number of blocks in the shared pool (0 before initialization)
+  * Consumers that hold history by reference size their needs against this
+  * @return Pool size in blocks
+  */
+ uint16_t getAdcBlockPoolSize();
+ 
+ /**
+  * Start continuous sampling
+  * Takes the shared SPI bus until stopAdcCapture() is called
+  * @param sampleRateHz Requested sample rate (100 Hz - 100 kHz)
+  * @return true if sampling started
+  */
+ bool startAdcCapture(uint32_t sampleRateHz = ADC_CAPTURE_SAMPLE_RATE_HZ);
+ 
+ /**
+  * Stop sampling and release the shared SPI bus
+  * @return true if sampling was stopped
+  */
+ bool stopAdcCapture();
+ 
+ /**
+  * Check whether the sample clock is running
+  * @return true while sampling
+  */
+ bool isAdcCaptureRunning();
+ 
+ /**
+  * Read the capture engine status
+  * @param stats Pointer to store the status
+  * @return true if the status was read
+  */
+ bool getAdcCaptureStats(AdcCaptureStats_t *stats);
+ 
+ #endif // ADC_CAPTURE_H
\ No newline at end of file
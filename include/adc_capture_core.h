@@ -0,0 +1,128 @@
+/*
+ * ADC Capture Core Header
+ * Hardware-independent sequencing and ping-pong buffer logic for the AD7495
+ * capture engine. The sampling ISR pushes raw SPI frames in, the consumer
+ * task takes completed blocks out. Plain C++ so it can be driven on a Linux
+ * host by a fake SPI device.
+ */
+ 
+ #ifndef ADC_CAPTURE_CORE_H
+ #define ADC_CAPTURE_CORE_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ #include <atomic>
+ #include "platform_compat.h"
+ 
+ // AD7495 frame layout: 4 leading zeros followed by a 12-bit result, MSB first
+ #define AD7495_DATA_MASK          0x0FFF
+ #define AD7495_LEADING_ZEROS_MASK 0xF000
+ #define AD7495_FULL_SCALE         4095
+ 
+ // Maximum number of blocks in the capture ring (2 = classic ping-pong)
+ #define ADC_CAPTURE_CORE_MAX_BLOCKS 8
+ 
+ // Descriptor for one completed block of samples
+ typedef struct {
+   const uint16_t *samples;     // 12-bit samples, right aligned
+   uint16_t count;              // Number of samples in the block
+   uint16_t index;              // Slot index (capture ring in the core, shared block pool once dispatched)
+   uint32_t sequence;           // Completed-block sequence number (starts at 0)
+   uint64_t firstSample;        // Sample index of samples[0] since start, dropped samples included
+   uint32_t timestampUs;        // Time of samples[0] (filled in by the device layer)
+   uint32_t sampleRateHz;       // Sample rate of the run (filled in by the device layer)
+ } AdcBlock_t;
+ 
+ // Counters maintained by the producer side
+ typedef struct {
+   uint32_t samplesCaptured;    // Samples stored into blocks
+   uint32_t blocksCompleted;    // Blocks handed to the consumer
+   uint32_t droppedSamples;     // Samples discarded because no block was free
+   uint32_t overruns;           // Times the producer found the next block still in use
+   uint32_t framingErrors;      // Frames whose leading zero bits were not zero
+ } AdcCaptureCounters_t;
+ 
+ class AdcCaptureCore {
+   public:
+     AdcCaptureCore();
+ 
+     /**
+      * Attach the sample storage and reset the sequencer
+      * @param storage Buffer of at least blockSamples * numBlocks samples
+      * @param blockSamples Samples per block
+      * @param numBlocks Number of blocks in the ring (2..ADC_CAPTURE_CORE_MAX_BLOCKS)
+      * @return true if the configuration is valid
+      */
+     bool begin(uint16_t *storage, uint16_t blockSamples, uint8_t numBlocks);
+ 
+     /**
+      * Return every block to the free state and restart sequencing at zero
+      * Only call while the producer is stopped
+      */
+     void reset();
+ 
+     /**
+      * Store one raw AD7495 frame (producer side, ISR safe)
+      * @param frame 16-bit frame as shifted in, MSB first
+      * @return true if this frame completed a block
+      */
+     bool pushFrame(uint16_t frame);
+ 
+     /**
+      * Take the oldest completed block (consumer side)
+      * @param block Filled with the block descriptor
+      * @return true if a block was available
+      */
+     bool acquireBlock(AdcBlock_t *block);
+ 
+     /**
+      * Give a block obtained from acquireBlock back to the producer
+      * @param index Slot index from the block descriptor
+      */
+     void releaseBlock(uint8_t index);
+ 
+     /**
+      * Copy the producer counters
+      * @param counters Destination for the counters
+      */
+     void getCounters(AdcCaptureCounters_t *counters) const;
+ 
+     uint16_t blockSamples() const { return _blockSamples; }
+     uint8_t numBlocks() const { return _numBlocks; }
+ 
+   private:
+     enum BlockState : uint8_t {
+       BLOCK_FREE,
+       BLOCK_FILLING,
+       BLOCK_READY,
+       BLOCK_CONSUMING
+     };
+ 
+     void startBlock();
+ 
+     uint16_t *_storage;
+     uint16_t _blockSamples;
+     uint8_t _numBlocks;
+ 
+     // Shared between producer and consumer
+     std::atomic<uint8_t> _state[ADC_CAPTURE_CORE_MAX_BLOCKS];
+     uint32_t _sequence[ADC_CAPTURE_CORE_MAX_BLOCKS];
+     uint64_t _firstSample[ADC_CAPTURE_CORE_MAX_BLOCKS];
+ 
+     // Producer state
+     uint8_t _writeBlock;
+     uint16_t _writePos;
+     bool _dropping;
+     uint32_t _nextSequence;
+     uint64_t _sampleIndex;
+     volatile uint32_t _samplesCaptured;
+     volatile uint32_t _blocksCompleted;
+     volatile uint32_t _droppedSamples;
+     volatile uint32_t _overruns;
+     volatile uint32_t _framingErrors;
+ 
+     // Consumer state
+     uint8_t _readBlock;
+ };
+ 
+ #endif // ADC_CAPTURE_CORE_H
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+ * ADC Filter Module Header
+ * Optional CIC stage followed by a decimating FIR on the ADC stream. The
+ * filtered output is cut into blocks and handed to its own consumers with
+ * the same callback signature as raw ADC blocks.
+ */
+ 
+ #ifndef ADC_FILTER_H
+ #define ADC_FILTER_H
+ 
+ #include <Arduino.h>
+ #include "freertos/FreeRTOS.h"
+ #include "adc_capture.h"
+ #include "decimation_filter.h"
+ 
+ // Filtered samples per output block
+ #define ADC_FILTER_BLOCK_SAMPLES 256
+ 
+ // Maximum number of registered filtered-block consumers
+ #define ADC_FILTER_MAX_CONSUMERS 4
+ 
+ // Default chain: no CIC, 64-tap FIR decimating by 4 with its cutoff at 0.1 fs
+ #define ADC_FILTER_DEFAULT_TAPS       64
+ #define ADC_FILTER_DEFAULT_DECIMATION 4
+ #define ADC_FILTER_DEFAULT_CUTOFF     0.1f
+ 
+ // Filter chain configuration
+ typedef struct {
+   uint8_t cicOrder;            // CIC stages, 0 disables the CIC
+   uint16_t cicRate;            // CIC decimation ratio
+   uint16_t firTaps;            // FIR length (1 - FIR_MAX_TAPS)
+   uint8_t firDecimation;       // FIR decimation ratio
+   float firCutoff;             // FIR cutoff as a fraction of its input rate (0 - 0.5)
+ } AdcFilterConfig_t;
+ 
+ // Filter status
+ typedef struct {
+   bool enabled;                // Whether blocks are being filtered
+   FirKernel_t kernel;          // Kernel in use
+   bool vectorVerified;         // Vector kernel matched the scalar kernel at start-up
+   uint32_t scalarSamplesPerSec; // Start-up benchmark, FIR inputs per second per core
+   uint32_t vectorSamplesPerSec;
+   uint32_t inputSamples;       // Samples filtered since the last start
+   uint32_t outputSamples;      // Filtered samples produced
+   uint32_t cyclesPerKiloSample; // CPU cycles per 1000 input samples for the whole chain
+ } AdcFilterStats_t;
+ 
+ /**
+  * Initialize the filter module, verify and benchmark the FIR kernels,
+  * and register it as an ADC block consumer
+  * Must be called before ADC capture is started
+  * @return true if initialization was successful
+  */
+ bool initAdcFilterModule();
+ 
+ /**
+  * Register a consumer for filtered blocks
+  * @param consumer Callback invoked for every filtered block (in the ADC consumer task)
+  * @param context Opaque pointer passed back to the callback
+  * @return true if the consumer was registered
+  */
+ bool registerFilteredBlockConsumer(AdcBlockConsumer_t consumer, void *context);
+ 
+ /**
+  * Change the filter chain (applied at the next ADC block, history restarts)
+  * @param config New configuration
+  * @return true if the configuration is valid
+  */
+ bool configureAdcFilter(const AdcFilterConfig_t *config);
+ 
+ /**
+  * Enable or disable filtering
+  * @param enable true to filter every ADC block
+  */
+ void setAdcFilterEnabled(bool enable);
+ 
+ /**
+  * Read the filter status
+  * @param stats Pointer to store the status
+  * @return true if the status was read
+  */
+ bool getAdcFilterStats(AdcFilterStats_t *stats);
+ 
+ #endif // ADC_FILTER_H
\ No newline at end of file
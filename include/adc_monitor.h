@@ -0,0 +1,66 @@
+/*
+ * ADC Monitor Module Header
+ * Runs the integer statistics kernel on every ADC block and publishes a
+ * compact summary at a configurable rate, to a queue and optionally as
+ * STATS frames on the sample stream
+ */
+ 
+ #ifndef ADC_MONITOR_H
+ #define ADC_MONITOR_H
+ 
+ #include <Arduino.h>
+ #include "freertos/FreeRTOS.h"
+ #include "adc_stats.h"
+ 
+ // Summary publish rate limits (summaries per second)
+ #define ADC_MONITOR_DEFAULT_RATE_HZ 10
+ #define ADC_MONITOR_MIN_RATE_HZ     1
+ #define ADC_MONITOR_MAX_RATE_HZ     50
+ 
+ // Data structure for one published summary
+ typedef struct {
+   AdcStatsSummary_t stats;     // Statistics of the interval
+   uint32_t sequence;           // Incremented for every summary
+   uint32_t timestampUs;        // Time of the first sample of the interval
+   uint64_t firstSample;        // Sample index of the first sample of the interval
+   uint32_t sampleRateHz;       // Sample rate of the interval
+   uint32_t kernelCycles;       // CPU cycles spent in the statistics kernel
+   uint32_t kernelLoadPpm;      // Share of one core used by the kernel (parts per million)
+ } AdcMonitorSummary_t;
+ 
+ /**
+  * Initialize the ADC monitor and register it as an ADC block consumer
+  * Must be called before ADC capture is started
+  * @return true if initialization was successful
+  */
+ bool initAdcMonitorModule();
+ 
+ /**
+  * Enable or disable statistics
+  * @param enable true to accumulate every block
+  */
+ void setAdcMonitorEnabled(bool enable);
+ 
+ /**
+  * Set the summary publish rate
+  * Intervals are whole blocks, so the achieved rate is rounded to the block period
+  * @param summariesPerSecond Summaries per second (1 - 50)
+  * @return true if the rate is valid
+  */
+ bool setAdcMonitorRate(uint32_t summariesPerSecond);
+ 
+ /**
+  * Enable or disable STATS frames on the sample stream
+  * @param enable true to send every summary as a stream frame
+  */
+ void setAdcMonitorStreaming(bool enable);
+ 
+ /**
+  * Receive the latest summary
+  * @param summary Pointer to store the summary
+  * @param timeout Maximum time to wait
+  * @return true if a summary was received
+  */
+ bool receiveAdcMonitorSummary(AdcMonitorSummary_t *summary, TickType_t timeout);
+ 
+ #endif // ADC_MONITOR_H
\ No newline at end of file
@@ -0,0 +1,122 @@
+/*
+ * ADC Spectrum Module Header
+ * Verifies the pulse generator frequency (pFrequency) and its harmonics
+ * from the analog capture. A low priority task runs a windowed FFT on a
+ * block collected at a configurable interval, and a Goertzel bank in the
+ * ADC consumer task tracks the fundamental and harmonics continuously.
+ */
+  
+  #ifndef ADC_SPECTRUM_H
+  #define ADC_SPECTRUM_H
+  
+  #include <Arduino.h>
+  #include "freertos/FreeRTOS.h"
+  #include "spectrum.h"
+  
+  // Defaults
+  #define ADC_SPECTRUM_DEFAULT_FFT         4096
+  #define ADC_SPECTRUM_DEFAULT_INTERVAL_MS 1000
+  
+  // Fundamental plus harmonics reported (also the Goertzel tones)
+  #define ADC_SPECTRUM_HARMONICS 4
+  
+  // Fundamental search span around pFrequency (+/- percent)
+  #define ADC_SPECTRUM_SEARCH_PCT 10
+  
+  // Lines closer to DC than this many bins overlap their own image and are skipped
+  #define ADC_SPECTRUM_CLEAR_BINS 4
+  
+  // Fundamental amplitude (ADC codes) needed to report a lock
+  #define ADC_SPECTRUM_MIN_LEVEL 2.0f
+  
+  // Goertzel measurement length, rounded up to whole periods of the fundamental
+  #define ADC_SPECTRUM_TONE_BLOCK_MS 100
+  
+  // Task settings
+  #define ADC_SPECTRUM_TASK_STACK    4096
+  #define ADC_SPECTRUM_TASK_PRIORITY 1
+  
+  // Sample source
+  typedef enum {
+    ADC_SPECTRUM_SOURCE_RAW,      // ADC blocks at the capture rate
+    ADC_SPECTRUM_SOURCE_FILTERED  // Decimated blocks from the ADC filter (finer bins for the same FFT size)
+  } AdcSpectrumSource_t;
+  
+  // Analysis configuration
+  typedef struct {
+    AdcSpectrumSource_t source;  // Sample source
+    uint16_t fftSize;            // FFT size (power of two, SPECTRUM_MIN_FFT - SPECTRUM_MAX_FFT)
+    SpectrumWindow_t window;     // FFT window
+    uint16_t intervalMs;         // Pause between analysed blocks
+  } AdcSpectrumConfig_t;
+  
+  // FFT analysis result
+  typedef struct {
+    uint32_t sequence;           // Incremented for every result
+    uint32_t timestampUs;        // Time of the first sample of the analysed block
+    uint32_t sampleRateHz;       // Sample rate of the analysed block
+    uint16_t fftSize;            // FFT size used
+    SpectrumWindow_t window;     // Window used
+    float binHz;                 // Bin spacing
+    uint16_t expectedHz;         // pFrequency while the block was captured
+    bool locked;                 // Fundamental found near expectedHz
+    float errorPct;              // (measured - expected) / expected in percent
+    SpectrumPeak_t harmonics[ADC_SPECTRUM_HARMONICS]; // [0] fundamental, [n] harmonic n + 1
+    SpectrumPeak_t strongest;    // Strongest line in the spectrum
+    uint32_t analysisUs;         // Time spent on the FFT and peak search
+  } AdcSpectrumResult_t;
+  
+  // Goertzel tone result
+  typedef struct {
+    uint32_t sequence;           // Incremented for every result
+    uint32_t timestampUs;        // Time of the first sample of the measurement
+    uint32_t sampleRateHz;       // Sample rate of the measurement
+    uint32_t blockLength;        // Samples in the measurement
+    uint16_t expectedHz;         // pFrequency the bank is tuned to
+    uint8_t count;               // Tones below the Nyquist frequency
+    GoertzelTone_t tones[ADC_SPECTRUM_HARMONICS]; // Fundamental and harmonics
+  } AdcToneResult_t;
+  
+  /**
+   * Initialize the spectrum module and register it as an ADC block consumer
+   * (raw and filtered). Must be called before ADC capture is started
+   * @return true if initialization was successful
+   */
+  bool initAdcSpectrumModule();
+  
+  /**
+   * Create the analysis task
+   * @return true if task creation was successful
+   */
+  bool createAdcSpectrumTask();
+  
+  /**
+   * Change the analysis configuration (applied from the next block)
+   * @param config New configuration
+   * @return true if the configuration is valid
+   */
+  bool configureAdcSpectrum(const AdcSpectrumConfig_t *config);
+  
+  /**
+   * Enable or disable the analysis
+   * @param enable true to collect blocks and track tones
+   */
+  void setAdcSpectrumEnabled(bool enable);
+  
+  /**
+   * Receive the latest FFT analysis
+   * @param result Pointer to store the result
+   * @param timeout Maximum time to wait
+   * @return true if a result was received
+   */
+  bool receiveAdcSpectrum(AdcSpectrumResult_t *result, TickType_t timeout);
+  
+  /**
+   * Receive the latest Goertzel tone measurement
+   * @param result Pointer to store the result
+   * @param timeout Maximum time to wait
+   * @return true if a result was received
+   */
+  bool receiveAdcTones(AdcToneResult_t *result, TickType_t timeout);
+  
+  #endif // ADC_SPECTRUM_H
\ No newline at end of file
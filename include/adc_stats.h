@@ -0,0 +1,65 @@
+/*
+ * ADC Statistics Header
+ * Incremental integer statistics over 12-bit ADC blocks: min, max, mean,
+ * RMS, peak-to-peak and a 64-bin histogram. Blocks are accumulated as they
+ * complete and summarized at the publish interval. Plain C++ so the kernel
+ * can be benchmarked on a Linux host.
+ */
+ 
+ #ifndef ADC_STATS_H
+ #define ADC_STATS_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ 
+ // Histogram geometry: 64 bins of 64 counts over the 12-bit range
+ #define ADC_STATS_HISTOGRAM_BINS  64
+ #define ADC_STATS_HISTOGRAM_SHIFT 6
+ 
+ // Fractional bits of the mean and RMS values in the summary (1/16 count)
+ #define ADC_STATS_FRACTION_BITS 4
+ 
+ // Running sums for one publish interval
+ typedef struct {
+   uint32_t count;
+   uint16_t min;
+   uint16_t max;
+   uint64_t sum;
+   uint64_t sumSquares;
+   uint32_t histogram[ADC_STATS_HISTOGRAM_BINS];
+ } AdcStatsAccumulator_t;
+ 
+ // Published summary of one interval
+ typedef struct {
+   uint32_t sampleCount;        // Samples in the interval
+   uint16_t min;                // Smallest sample
+   uint16_t max;                // Largest sample
+   uint16_t peakToPeak;         // max - min
+   uint16_t meanQ4;             // Mean in 1/16 counts
+   uint16_t rmsQ4;              // RMS including DC in 1/16 counts
+   uint16_t acRmsQ4;            // RMS about the mean (standard deviation) in 1/16 counts
+   uint32_t histogram[ADC_STATS_HISTOGRAM_BINS]; // Sample counts per 64-count bin
+ } AdcStatsSummary_t;
+ 
+ /**
+  * Clear an accumulator for a new interval
+  * @param acc Accumulator
+  */
+ void adcStatsReset(AdcStatsAccumulator_t *acc);
+ 
+ /**
+  * Add a block of 12-bit samples to the interval
+  * @param acc Accumulator
+  * @param samples Samples (values above 4095 are clamped into the last bin)
+  * @param count Number of samples
+  */
+ void adcStatsAccumulate(AdcStatsAccumulator_t *acc, const uint16_t *samples, size_t count);
+ 
+ /**
+  * Turn an accumulator into a summary
+  * @param acc Accumulator
+  * @param summary Filled with the summary (all zero for an empty interval)
+  */
+ void adcStatsSummarize(const AdcStatsAccumulator_t *acc, AdcStatsSummary_t *summary);
+ 
+ #endif // ADC_STATS_H
\ No newline at end of file
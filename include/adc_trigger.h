@@ -0,0 +1,164 @@
+/*
+ * ADC Trigger Header
+ * Oscilloscope-style trigger state machine over the continuous ADC stream.
+ * Samples flow through a circular history buffer; once armed and holding
+ * enough pre-trigger history, a level/slope crossing or an external event
+ * fires the trigger and the buffer freezes after the post-trigger samples.
+ * A holdoff keeps the next trigger point of a re-armed trigger a minimum
+ * distance after the previous one.
+ * Without storage the trigger only tracks sample indices, for callers that
+ * keep the history themselves (by holding references to shared blocks).
+ * Plain C++ so it can be exercised on a Linux host with synthetic signals.
+ */
+ 
+ #ifndef ADC_TRIGGER_H
+ #define ADC_TRIGGER_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ 
+ // Trigger sources
+ typedef enum {
+   TRIGGER_SOURCE_LEVEL,        // Level crossing with the configured slope
+   TRIGGER_SOURCE_EXTERNAL,     // Only external events fire the trigger
+   TRIGGER_SOURCE_IMMEDIATE     // Fire as soon as the pre-trigger history is full
+ } AdcTriggerSource_t;
+ 
+ // Level trigger slopes
+ typedef enum {
+   TRIGGER_SLOPE_RISING,
+   TRIGGER_SLOPE_FALLING,
+   TRIGGER_SLOPE_EITHER
+ } AdcTriggerSlope_t;
+ 
+ // Trigger states
+ typedef enum {
+   TRIGGER_STATE_IDLE,          // Not armed, history is not recorded
+   TRIGGER_STATE_PRETRIGGER,    // Armed, collecting pre-trigger history
+   TRIGGER_STATE_ARMED,         // Waiting for the trigger condition
+   TRIGGER_STATE_POSTTRIGGER,   // Triggered, collecting post-trigger samples
+   TRIGGER_STATE_DONE           // Window complete, history frozen until re-armed
+ } AdcTriggerState_t;
+ 
+ // Trigger configuration
+ typedef struct {
+   AdcTriggerSource_t source;
+   AdcTriggerSlope_t slope;
+   uint16_t level;              // Trigger level in ADC counts
+   uint16_t hysteresis;         // Signal must first go this far past the level the other way
+   uint32_t preSamples;         // Samples kept before the trigger point
+   uint32_t postSamples;        // Samples kept from the trigger point on (at least 1)
+   uint32_t holdoffSamples;     // No trigger point within this many samples after the previous one (0 = none)
+ } AdcTriggerConfig_t;
+ 
+ // Description of a completed capture window
+ typedef struct {
+   uint64_t triggerSample;      // Sample index of the trigger point
+   uint64_t firstSample;        // Sample index of the first sample in the window
+   uint32_t count;              // Samples in the window (pre + post)
+   bool external;               // Fired by an external event rather than the level
+ } AdcTriggerWindow_t;
+ 
+ class AdcTrigger {
+   public:
+     AdcTrigger();
+ 
+     /**
+      * Attach the history storage
+      * @param storage Circular buffer of capacity samples, or NULL if the caller keeps the history
+      * @param capacity Must be at least preSamples + postSamples of any configuration
+      * @return true if the storage is usable
+      */
+     bool begin(uint16_t *storage, uint32_t capacity);
+ 
+     /**
+      * Set the trigger configuration (leaves the trigger idle)
+      * @param config New configuration
+      * @return true if the configuration fits the storage
+      */
+     bool configure(const AdcTriggerConfig_t *config);
+ 
+     /**
+      * Arm the trigger - history restarts and pre-trigger samples are collected first
+      */
+     void arm();
+ 
+     /**
+      * Return to the idle state without producing a window
+      */
+     void disarm();
+ 
+     /**
+      * Report an external event at a given sample index
+      * Ignored unless the trigger is armed; events older than the point where the
+      * pre-trigger history became complete (or within the holdoff) fire at the
+      * first point allowed instead
+      * @param sampleIndex Sample index at which the event happened
+      */
+     void externalEvent(uint64_t sampleIndex);
+ 
+     /**
+      * Feed a block of consecutive samples
+      * A gap in sample indices (dropped samples) restarts pre-trigger collection
+      * @param samples Samples
+      * @param count Number of samples
+      * @param firstSample Sample index of samples[0]
+      * @return true if this block completed the capture window
+      */
+     bool processBlock(const uint16_t *samples, uint32_t count, uint64_t firstSample);
+ 
+     /**
+      * Describe the frozen window
+      * @param window Filled with the window description
+      * @return true if the state is DONE
+      */
+     bool getWindow(AdcTriggerWindow_t *window) const;
+ 
+     /**
+      * Sample index of the oldest sample the trigger still needs: the
+      * pre-trigger history while armed, the window start once fired
+      * @return Sample index (samples before it can be discarded)
+      */
+     uint64_t historyStart() const;
+ 
+     /**
+      * Copy the frozen window in chronological order (needs storage)
+      * @param out Destination
+      * @param maxSamples Size of the destination
+      * @param window Filled with the window description
+      * @return Number of samples copied (0 unless the state is DONE)
+      */
+     uint32_t readWindow(uint16_t *out, uint32_t maxSamples, AdcTriggerWindow_t *window) const;
+ 
+     AdcTriggerState_t state() const { return _state; }
+     const AdcTriggerConfig_t &config() const { return _config; }
+ 
+   private:
+     void append(const uint16_t *samples, uint32_t count);
+     uint32_t findLevelCrossing(const uint16_t *samples, uint32_t start, uint32_t end, uint32_t fireFrom);
+     void fire(uint64_t triggerSample, bool external);
+ 
+     uint16_t *_storage;
+     uint32_t _capacity;
+     uint32_t _writePos;
+ 
+     AdcTriggerConfig_t _config;
+     AdcTriggerState_t _state;
+ 
+     uint64_t _nextSample;        // Index of the next sample expected
+     uint64_t _armedSample;       // Index at which the pre-trigger history became complete
+     uint32_t _preCollected;
+     uint64_t _windowEnd;         // Index one past the last sample of the window
+     uint64_t _triggerSample;
+     bool _triggerExternal;
+     uint64_t _holdoffEnd;        // First sample index the next trigger point may have
+ 
+     // Slope qualification: the signal has been on the far side of the hysteresis band
+     bool _seenBelow;
+     bool _seenAbove;
+ 
+     bool _externalPending;
+     uint64_t _externalSample;
+ };
+ 
+ #endif // ADC_TRIGGER_H
\ No newline at end of file
@@ -36,6 +36,7 @@
    bool isAlert;                  // Alert flag
    ChargingStatus_t chrgStatus;   // Charging status from TP4056
    bool switchState;              // Slide switch state (true = connected)
+   uint64_t timestampUs;          // monotonicUs() when the reading was taken
    bool success;                  // Whether reading was successful
  } BatteryStatus_t;
  
@@ -55,12 +56,20 @@
  
  /**
   * Receive battery status results from the task
+  * Each status is handed out once, so this waits for the next battery task run
   * @param result Pointer to store the battery status
   * @param timeout Maximum time to wait for results
   * @return true if results were received
   */
  bool receiveBatteryResults(BatteryStatus_t *result, TickType_t timeout);
  
+ /**
+  * Copy the latest battery status without waiting, from any task
+  * @param status Pointer to store the battery status
+  * @return false if no status has been published yet
+  */
+ bool getLatestBatteryStatus(BatteryStatus_t *status);
+ 
  /**
   * Get charging status as a string
   * @param status The charging status enum value
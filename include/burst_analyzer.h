@@ -0,0 +1,122 @@
+/*
+ * Burst Analyzer Header
+ * Rebuilds pulse bursts from individual edge timestamps. Edges arrive one
+ * at a time; a gap longer than the configured timeout closes the burst,
+ * which is then measured pulse by pulse: period and high time of every
+ * pulse, drift of the period across the burst, jitter around that drift,
+ * duty cycle, and pulses that are missing or extra for the burst rhythm.
+ * A pulse starts on an edge with the polarity of the burst's first edge.
+ * Plain C++ so recorded edge traces can be replayed on a Linux host.
+ */
+ 
+ #ifndef BURST_ANALYZER_H
+ #define BURST_ANALYZER_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ 
+ // Pulses measured per burst; later pulses are counted but not measured
+ #define BURST_ANALYZER_MAX_PULSES 64
+ 
+ // A period this much longer than the burst median is a gap (missing pulses),
+ // this much shorter is split by an extra pulse; in quarters of the median
+ #define BURST_ANALYZER_GAP_QUARTERS   6
+ #define BURST_ANALYZER_EXTRA_QUARTERS 3
+ 
+ // Edge timestamp
+ typedef struct {
+   uint32_t ticks;              // Timestamp in analyzer ticks (wraps)
+   bool rising;                 // Level after the edge
+ } BurstEdge_t;
+ 
+ // Analyzer configuration
+ typedef struct {
+   uint32_t tickHz;             // Timestamp rate, at least 1 MHz
+   uint32_t gapUs;              // Silence that ends a burst
+   uint16_t expectedPulses;     // Pulses per burst for the count check, 0 = no check
+ } BurstAnalyzerConfig_t;
+ 
+ // Measurements of one burst, integer nanoseconds (convert for display only)
+ typedef struct {
+   uint32_t startTicks;         // First edge
+   uint16_t edgeCount;          // Edges in the burst
+   uint16_t pulseCount;         // Pulses (edges with the polarity of the first)
+   uint16_t measuredPulses;     // Entries in periodNs/highNs (pulses beyond the array are not measured)
+   uint32_t periodNs[BURST_ANALYZER_MAX_PULSES];  // Start of pulse i to start of pulse i+1 (measuredPulses - 1 entries)
+   uint32_t highNs[BURST_ANALYZER_MAX_PULSES];    // Start of pulse i to its opposite edge (0 if none)
+   uint32_t durationNs;         // First to last edge (saturates after 4.29 s)
+   uint32_t meanPeriodNs;       // Over the measured pulses
+   uint32_t medianPeriodNs;     // Reference for gap and extra pulse detection
+   int32_t driftPsPerPulse;     // Slope of a line fitted to the periods, picoseconds per pulse
+   uint32_t jitterRmsNs;        // Period deviation from the fitted line, RMS
+   uint32_t jitterPeakNs;       // ... largest magnitude
+   uint32_t dutyCycleQ16;       // Mean high time over mean period, Q16.16 (65536 = 100%)
+   uint16_t missingPulses;      // Pulses implied by gaps in the rhythm
+   uint16_t extraPulses;        // Periods too short for the rhythm
+   uint16_t polarityErrors;     // Consecutive edges of the same polarity (an edge was lost)
+   int16_t pulseCountError;     // pulseCount - expectedPulses (0 without a check)
+ } BurstAnalysis_t;
+ 
+ class BurstAnalyzer {
+   public:
+     BurstAnalyzer();
+ 
+     /**
+      * Set the configuration and drop any burst in progress
+      * @param config New configuration
+      * @return true if the configuration is valid
+      */
+     bool configure(const BurstAnalyzerConfig_t *config);
+ 
+     /**
+      * Drop the burst in progress and the last result
+      */
+     void reset();
+ 
+     /**
+      * Feed the next edge
+      * An edge after a gap first closes the burst in progress
+      * @param edge Edge timestamp
+      * @return true if a burst was closed and its result is ready
+      */
+     bool addEdge(const BurstEdge_t *edge);
+ 
+     /**
+      * Close the burst in progress, for callers that know the gap has passed
+      * @return true if a burst was closed and its result is ready
+      */
+     bool endBurst();
+ 
+     /**
+      * Whether edges of an unfinished burst are being collected
+      */
+     bool active() const { return _edgeCount > 0; }
+ 
+     /**
+      * Result of the last closed burst
+      * @return Analysis (valid after addEdge() or endBurst() returned true)
+      */
+     const BurstAnalysis_t &result() const { return _result; }
+ 
+   private:
+     void analyze();
+ 
+     BurstAnalyzerConfig_t _config;
+     uint32_t _gapTicks;
+     uint32_t _nsPerTickQ16;
+ 
+     // Burst in progress
+     uint32_t _startTicks;
+     uint32_t _lastTicks;
+     bool _startRising;
+     bool _lastRising;
+     uint16_t _edgeCount;
+     uint16_t _pulseCount;
+     uint16_t _polarityErrors;
+     uint32_t _pulseStart[BURST_ANALYZER_MAX_PULSES];  // Offsets from _startTicks
+     uint32_t _pulseHigh[BURST_ANALYZER_MAX_PULSES];   // 0 until the opposite edge arrives
+ 
+     BurstAnalysis_t _result;
+ };
+ 
+ #endif // BURST_ANALYZER_H
\ No newline at end of file
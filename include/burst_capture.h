@@ -0,0 +1,97 @@
+/*
+ * Burst Capture Module Header
+ * ADC windows locked to the bursts seen by the pulse monitor. Each window
+ * carries the pulse edges of its burst and the matching PulseBurstResult_t,
+ * and windows are averaged coherently to lift small responses out of noise.
+ */
+ 
+ #ifndef BURST_CAPTURE_H
+ #define BURST_CAPTURE_H
+ 
+ #include <Arduino.h>
+ #include "freertos/FreeRTOS.h"
+ #include "burst_sync.h"
+ #include "pulse_tasks.h"
+ 
+ // Window storage limit (samples), history adds room for two blocks of event latency
+ #define BURST_CAPTURE_MAX_WINDOW_SAMPLES 2048
+ 
+ // Edge events buffered between the pulse ISR and the ADC consumer task
+ #define BURST_CAPTURE_EDGE_RING_SIZE 256
+ 
+ // Completed window records buffered for the application
+ #define BURST_CAPTURE_RECORD_QUEUE_LEN 2
+ 
+ // Default window: 64 samples before the burst, 1024 total, 16-window average
+ #define BURST_CAPTURE_DEFAULT_PRE_SAMPLES    64
+ #define BURST_CAPTURE_DEFAULT_WINDOW_SAMPLES 1024
+ #define BURST_CAPTURE_DEFAULT_AVERAGE        16
+ 
+ // Data structure for one burst-aligned window
+ typedef struct {
+   BurstSyncRecord_t window;    // Alignment and pulse edges of the window
+   PulseBurstResult_t burst;    // Pulse monitor result for the same burst
+   bool tagged;                 // Whether burst holds the matching result
+   uint32_t sampleRateHz;       // Sample rate of the window
+   bool averageReady;           // This window completed a coherent average
+   uint32_t missedWindows;      // Windows lost so far (overlap, dropped samples, late events)
+ } BurstCaptureRecord_t;
+ 
+ /**
+  * Initialize the burst capture module and register it as an ADC block consumer
+  * Must be called before ADC capture is started
+  * @return true if initialization was successful
+  */
+ bool initBurstCaptureModule();
+ 
+ /**
+  * Set the window geometry and averaging depth (restarts the average)
+  * @param config New configuration
+  * @return true if the configuration is valid
+  */
+ bool configureBurstCapture(const BurstSyncConfig_t *config);
+ 
+ /**
+  * Enable or disable burst-aligned capture
+  * @param enable true to cut a window for every burst while the ADC runs
+  */
+ void setBurstCaptureEnabled(bool enable);
+ 
+ /**
+  * Report a pulse edge (called from the pulse edge ISR)
+  * @param timeUs micros() timestamp of the edge
+  * @param burstStart true if the edge starts a new burst
+  */
+ void burstCaptureEdge(uint32_t timeUs, bool burstStart);
+ 
+ /**
+  * Hand over the pulse monitor result of a finished burst
+  * @param result Result whose burstStartUs identifies the burst
+  */
+ void burstCaptureTagResult(const PulseBurstResult_t *result);
+ 
+ /**
+  * Wait for the next burst-aligned window
+  * @param record Filled with the window record
+  * @param timeout Maximum time to wait
+  * @return true if a record was received
+  */
+ bool waitForBurstCapture(BurstCaptureRecord_t *record, TickType_t timeout);
+ 
+ /**
+  * Copy the samples of the most recent window
+  * @param out Destination buffer
+  * @param maxSamples Size of the destination
+  * @return Number of samples copied
+  */
+ uint32_t readBurstCaptureWindow(uint16_t *out, uint32_t maxSamples);
+ 
+ /**
+  * Copy the most recent coherent average
+  * @param out Destination buffer (ADC counts)
+  * @param maxSamples Size of the destination
+  * @return Number of samples copied (0 until the first average completes)
+  */
+ uint32_t readBurstCaptureAverage(float *out, uint32_t maxSamples);
+ 
+ #endif // BURST_CAPTURE_H
\ No newline at end of file
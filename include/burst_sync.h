@@ -0,0 +1,147 @@
+/*
+ * Burst Sync Header
+ * Cuts ADC windows aligned to pulse burst starts out of the continuous
+ * sample stream and averages them coherently. Burst starts and pulse edges
+ * arrive as events, samples arrive as blocks; a window is extracted once
+ * all of its samples are in the history buffer. Plain C++ so alignment and
+ * averaging can be checked on a Linux host with synthetic streams.
+ */
+ 
+ #ifndef BURST_SYNC_H
+ #define BURST_SYNC_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ 
+ // Bursts whose windows can be outstanding at the same time
+ #define BURST_SYNC_MAX_PENDING 4
+ 
+ // Pulse edges recorded per window (2 per pulse)
+ #define BURST_SYNC_MAX_EDGES 96
+ 
+ // Window configuration
+ typedef struct {
+   uint32_t preSamples;         // Samples kept before the burst start
+   uint32_t windowSamples;      // Total samples per window (pre included)
+   uint16_t averageCount;       // Windows per coherent average (1 = every window)
+ } BurstSyncConfig_t;
+ 
+ // Storage used by the aligner
+ typedef struct {
+   uint16_t *history;           // Recent samples (window + event latency)
+   uint32_t historySamples;
+   uint16_t *window;            // Last extracted window
+   uint32_t *sums;              // Running sums of the average in progress
+   float *average;              // Last completed average
+   uint32_t maxWindowSamples;   // Size of window, sums and average
+ } BurstSyncBuffers_t;
+ 
+ // Alignment record of one window
+ typedef struct {
+   uint64_t startSample;        // Sample index of the burst start
+   uint32_t startUs;            // Time of the burst start
+   uint32_t windowNumber;       // Incremented for every extracted window
+   uint16_t edgeCount;          // Pulse edges recorded during the burst
+   uint32_t edgeOffsetUs[BURST_SYNC_MAX_EDGES]; // Edge times relative to startUs
+ } BurstSyncRecord_t;
+ 
+ // Sample index of an event at timeUs, placed relative to a block's first sample and
+ // its timestamp and rounded to the nearest sample; false if it falls before sample 0
+ inline bool burstSyncSampleIndex(uint32_t timeUs, uint32_t blockTimestampUs, uint64_t blockFirstSample,
+                                  uint32_t sampleRateHz, uint64_t *sampleIndex) {
+   int64_t scaled = (int64_t)(int32_t)(timeUs - blockTimestampUs) * sampleRateHz;
+   int64_t offset = (scaled >= 0) ? (scaled + 500000) / 1000000 : -((-scaled + 500000) / 1000000);
+   int64_t index = (int64_t)blockFirstSample + offset;
+   if (index < 0) {
+     return false;
+   }
+   *sampleIndex = (uint64_t)index;
+   return true;
+ }
+ 
+ class BurstSync {
+   public:
+     BurstSync();
+ 
+     /**
+      * Attach the storage
+      * @param buffers Storage descriptor (copied)
+      * @return true if the storage is usable
+      */
+     bool begin(const BurstSyncBuffers_t *buffers);
+ 
+     /**
+      * Set the window geometry and restart alignment and averaging
+      * @param config New configuration
+      * @return true if the configuration fits the storage
+      */
+     bool configure(const BurstSyncConfig_t *config);
+ 
+     /**
+      * Drop the history, pending bursts and the average in progress
+      */
+     void reset();
+ 
+     /**
+      * Report the start of a burst
+      * @param sampleIndex Sample index of the first edge
+      * @param timeUs Time of the first edge
+      * @return false if too many windows are already outstanding
+      */
+     bool burstStart(uint64_t sampleIndex, uint32_t timeUs);
+ 
+     /**
+      * Report a pulse edge, recorded against the newest outstanding burst
+      * @param timeUs Time of the edge
+      */
+     void edge(uint32_t timeUs);
+ 
+     /**
+      * Append a block of consecutive samples to the history
+      * A gap in sample indices (dropped samples) drops the outstanding windows
+      * @param samples Samples
+      * @param count Number of samples
+      * @param firstSample Sample index of samples[0]
+      */
+     void processBlock(const uint16_t *samples, uint32_t count, uint64_t firstSample);
+ 
+     /**
+      * Extract the oldest outstanding window if all its samples have arrived
+      * On success window() and lastRecord() describe it, and averageReady()
+      * tells whether it completed a coherent average
+      * @return true if a window was extracted
+      */
+     bool completeWindow();
+ 
+     const BurstSyncRecord_t &lastRecord() const { return _record; }
+     const uint16_t *window() const { return _buffers.window; }
+     const float *average() const { return _buffers.average; }
+     const BurstSyncConfig_t &config() const { return _config; }
+     bool averageReady() const { return _averageReady; }
+     uint16_t windowsInAverage() const { return _windowsInAverage; }
+     uint32_t averagesCompleted() const { return _averagesCompleted; }
+     uint32_t missedWindows() const { return _missedWindows; }
+ 
+   private:
+     BurstSyncBuffers_t _buffers;
+     BurstSyncConfig_t _config;
+ 
+     // History ring, holding samples [_nextSample - _historyCount, _nextSample)
+     uint32_t _writePos;
+     uint32_t _historyCount;
+     uint64_t _nextSample;
+ 
+     // Outstanding bursts, oldest first
+     BurstSyncRecord_t _pending[BURST_SYNC_MAX_PENDING];
+     uint8_t _pendingHead;
+     uint8_t _pendingCount;
+ 
+     BurstSyncRecord_t _record;
+     uint32_t _windowNumber;
+     uint16_t _windowsInAverage;
+     uint32_t _averagesCompleted;
+     uint32_t _missedWindows;
+     bool _averageReady;
+ };
+ 
+ #endif // BURST_SYNC_H
\ No newline at end of file
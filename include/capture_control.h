@@ -0,0 +1,161 @@
+/*
+ * Capture Control Module Header
+ * Command-driven captures on top of the continuous ADC engine. A request
+ * sets the sample rate, the samples per capture, the trigger source and how
+ * many captures run back to back; the control task starts and stops the
+ * engine, re-arms between captures and notifies the requesting task when
+ * each capture completes. Requests come from other tasks through this API
+ * or from the serial command channel ("capture ...").
+ */
+ 
+ #ifndef CAPTURE_CONTROL_H
+ #define CAPTURE_CONTROL_H
+ 
+ #include <Arduino.h>
+ #include "freertos/FreeRTOS.h"
+ #include "freertos/task.h"
+ #include "adc_trigger.h"
+ #include "scope_capture.h"
+ 
+ // Control task
+ #define CAPTURE_CONTROL_TASK_STACK    4096
+ #define CAPTURE_CONTROL_TASK_PRIORITY 2
+ 
+ // Commands waiting for the control task
+ #define CAPTURE_CONTROL_QUEUE_LENGTH 4
+ 
+ // Captures up to this length are windows of the scope and kept on the device;
+ // longer untriggered captures are a counted span of the sample stream
+ #define CAPTURE_MAX_HELD_SAMPLES SCOPE_CAPTURE_MAX_SAMPLES
+ 
+ // Trigger sources
+ typedef enum {
+   CAPTURE_TRIGGER_NONE,        // Start at the next block
+   CAPTURE_TRIGGER_LEVEL,       // Level crossing with the requested slope
+   CAPTURE_TRIGGER_EXTERNAL     // SCOPE_EVENT_* sources in externalEvents
+ } CaptureTriggerSource_t;
+ 
+ // Capture control states
+ typedef enum {
+   CAPTURE_STATE_IDLE,          // No request running, engine stopped by the control task
+   CAPTURE_STATE_CAPTURING,     // Waiting for a trigger or collecting samples
+   CAPTURE_STATE_STREAMING      // Continuous run (sampleCount 0) until stopped
+ } CaptureState_t;
+ 
+ // Capture request
+ typedef struct {
+   uint32_t sampleRateHz;       // Requested sample rate
+   uint32_t sampleCount;        // Samples per capture, 0 = stream until stopped (no trigger)
+   uint32_t preSamples;         // Part of sampleCount before the trigger point
+   CaptureTriggerSource_t trigger;
+   AdcTriggerSlope_t slope;     // Level trigger slope
+   uint16_t level;              // Level trigger threshold in ADC counts
+   uint8_t externalEvents;      // SCOPE_EVENT_* sources for CAPTURE_TRIGGER_EXTERNAL
+   uint32_t holdoffSamples;     // Trigger points of back-to-back captures at least this far apart
+   uint32_t repeat;             // Captures to run back to back, 0 = until stopped
+   TaskHandle_t notifyTask;     // Notified when each capture completes (may be NULL)
+   uint32_t notifyBits;         // Notification value bits set in notifyTask (eSetBits)
+ } CaptureRequest_t;
+ 
+ // Description of a completed capture
+ typedef struct {
+   uint32_t captureNumber;      // Incremented for every completed capture
+   uint32_t runIndex;           // Position within the request's back-to-back run (from 1)
+   bool last;                   // No further captures follow for this request
+   bool held;                   // Samples can be read with readCaptureSamples()
+   bool triggered;              // Started by a level or external trigger
+   uint8_t eventSource;         // SCOPE_EVENT_* that fired an external trigger
+   uint64_t firstSample;        // Sample index of the first sample since engine start
+   uint32_t sampleCount;        // Samples in the capture
+   uint32_t sampleRateHz;       // Achieved sample rate
+   uint64_t triggerSample;      // Sample index of the trigger point (firstSample if untriggered)
+   uint32_t triggerTimeUs;      // micros() of the trigger point
+   uint32_t droppedSamples;     // Samples lost inside the capture (counted captures)
+ } CaptureResult_t;
+ 
+ // Capture control status
+ typedef struct {
+   CaptureState_t state;
+   CaptureRequest_t request;    // Request being run (or last run)
+   uint32_t completed;          // Captures completed for the current request
+   uint32_t captureNumber;      // Number of the last completed capture
+ } CaptureStatus_t;
+ 
+ /**
+  * Initialize the capture control module and register it as an ADC block consumer
+  * Must be called after the scope module and before ADC capture is started
+  * @return true if initialization was successful
+  */
+ bool initCaptureControlModule();
+ 
+ /**
+  * Create the capture control task
+  * @return true if task creation was successful
+  */
+ bool createCaptureControlTask();
+ 
+ /**
+  * Fill a request with the defaults: 50 kSPS, continuous, no trigger, no notification
+  * @param request Request to fill
+  */
+ void getDefaultCaptureRequest(CaptureRequest_t *request);
+ 
+ /**
+  * Notify a task whenever any capture completes, whoever requested it
+  * @param task Task to notify (NULL to stop notifying)
+  * @param bits Notification value bits set in the task (eSetBits)
+  */
+ void setCaptureNotify(TaskHandle_t task, uint32_t bits);
+ 
+ /**
+  * Start a capture request, replacing any request that is running
+  * Returns without waiting; completion is reported through the notification
+  * @param request Capture request
+  * @return true if the request is valid and was queued
+  */
+ bool startCapture(const CaptureRequest_t *request);
+ 
+ /**
+  * Stop the running request and the ADC engine
+  * @return true if the command was queued
+  */
+ bool stopCapture();
+ 
+ /**
+  * Run the last request again
+  * @return true if the command was queued
+  */
+ bool armCapture();
+ 
+ /**
+  * Read the status of the control task
+  * @param status Pointer to store the status
+  * @return true if the status was read
+  */
+ bool getCaptureStatus(CaptureStatus_t *status);
+ 
+ /**
+  * Read the description of the last completed capture
+  * @param result Pointer to store the description
+  * @return true if a capture has completed
+  */
+ bool getCaptureResult(CaptureResult_t *result);
+ 
+ /**
+  * Copy the samples of the last completed held capture
+  * The copy is taken before the next capture is armed, so it stays readable
+  * while back-to-back captures continue
+  * @param out Destination buffer
+  * @param maxSamples Size of the destination
+  * @param result Filled with the description of the copied capture (may be NULL)
+  * @return Number of samples copied (0 if no held capture is available)
+  */
+ uint32_t readCaptureSamples(uint16_t *out, uint32_t maxSamples, CaptureResult_t *result);
+ 
+ /**
+  * Register the "capture" command on the serial command channel
+  * @return true if the command was registered
+  */
+ bool registerCaptureCommands();
+ 
+ #endif // CAPTURE_CONTROL_H
\ No newline at end of file
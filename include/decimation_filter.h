@@ -0,0 +1,154 @@
+/*
+ * Decimation Filter Header
+ * Fixed-point decimating FIR and CIC filters for the 12-bit ADC stream.
+ * Samples are processed as signed values around mid-scale and come out in
+ * the same 12-bit unsigned units they went in with.
+ *
+ * The FIR has a portable scalar kernel and a vector kernel. The vector
+ * kernel keeps eight copies of the coefficients, each shifted by one more
+ * sample, so every load of the input starts on a 16-byte boundary. On the
+ * ESP32-S3 the 8-lane multiply-accumulate runs on the PIE SIMD unit; on
+ * other targets the same layout is evaluated in C so it can be checked
+ * bit-exact against the scalar kernel on a Linux host.
+ */
+ 
+ #ifndef DECIMATION_FILTER_H
+ #define DECIMATION_FILTER_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ #include "platform_compat.h"
+ 
+ #if !PLATFORM_HOST && defined(CONFIG_IDF_TARGET_ESP32S3)
+   #define DECIMATION_FILTER_HAS_PIE 1
+ #else
+   #define DECIMATION_FILTER_HAS_PIE 0
+ #endif
+ 
+ // FIR limits
+ #define FIR_MAX_TAPS        128
+ #define FIR_MAX_DECIMATION  64
+ #define FIR_CHUNK_SAMPLES   512   // Input samples buffered per pass
+ #define FIR_COEFF_BITS      15    // Coefficients are Q15, unity DC gain sums to 32768
+ #define FIR_VECTOR_LANES    8
+ #define FIR_SHIFTED_TAPS    (((FIR_MAX_TAPS + FIR_VECTOR_LANES - 1) + 7) & ~7)
+ 
+ // CIC limits (register growth must stay within 32 bits)
+ #define CIC_MAX_ORDER 4
+ #define CIC_MAX_GAIN  (1UL << 20)
+ 
+ // Mid-scale of the 12-bit input
+ #define FILTER_SAMPLE_OFFSET 2048
+ #define FILTER_SAMPLE_MAX    4095
+ 
+ // FIR kernels
+ typedef enum {
+   FIR_KERNEL_SCALAR,           // Portable reference
+   FIR_KERNEL_VECTOR            // Aligned 8-lane kernel (PIE on the ESP32-S3)
+ } FirKernel_t;
+ 
+ /**
+  * Design a Hamming-windowed sinc low-pass filter in Q15
+  * The taps are adjusted to sum to exactly 32768 (unity DC gain)
+  * @param coeffs Output coefficients
+  * @param taps Number of taps (1 - FIR_MAX_TAPS)
+  * @param cutoff Cutoff as a fraction of the input sample rate (0 - 0.5)
+  * @return true if the filter was designed
+  */
+ bool firDesignLowpass(int16_t *coeffs, uint16_t taps, float cutoff);
+ 
+ class FirDecimator {
+   public:
+     FirDecimator();
+ 
+     /**
+      * Load coefficients and reset the filter history
+      * @param coeffs Q15 coefficients, h[0] applies to the newest sample
+      * @param taps Number of taps (1 - FIR_MAX_TAPS)
+      * @param decimation Output one sample per this many inputs (1 - FIR_MAX_DECIMATION)
+      * @return true if the filter is valid (sum of |h| must keep the accumulator in 32 bits)
+      */
+     bool begin(const int16_t *coeffs, uint16_t taps, uint8_t decimation);
+ 
+     /**
+      * Clear the history (the next outputs see zeros before the first input)
+      */
+     void reset();
+ 
+     /**
+      * Select the kernel used by process()
+      * @param kernel Kernel to use
+      */
+     void setKernel(FirKernel_t kernel) { _kernel = kernel; }
+     FirKernel_t kernel() const { return _kernel; }
+ 
+     /**
+      * Filter and decimate a run of samples
+      * @param in 12-bit input samples
+      * @param count Number of input samples
+      * @param out Output samples (12-bit)
+      * @param maxOut Size of out; at least count / decimation + 1
+      * @return Number of output samples written
+      */
+     size_t process(const uint16_t *in, size_t count, uint16_t *out, size_t maxOut);
+ 
+     uint16_t taps() const { return _taps; }
+     uint8_t decimation() const { return _decimation; }
+ 
+   private:
+     int32_t dotScalar(uint32_t start) const;
+     int32_t dotVector(uint32_t start) const;
+ 
+     alignas(16) int16_t _buffer[FIR_MAX_TAPS + FIR_CHUNK_SAMPLES + 16];
+     alignas(16) int16_t _shifted[FIR_VECTOR_LANES][FIR_SHIFTED_TAPS];
+     int16_t _reversed[FIR_MAX_TAPS];
+ 
+     uint16_t _taps;
+     uint16_t _groups;            // 8-lane groups per vector dot product
+     uint8_t _decimation;
+     uint8_t _phase;              // Inputs since the last output
+     uint16_t _fill;              // Samples held in _buffer
+     FirKernel_t _kernel;
+ };
+ 
+ class CicDecimator {
+   public:
+     CicDecimator();
+ 
+     /**
+      * Configure and reset the filter
+      * @param order Number of integrator/comb stages (1 - CIC_MAX_ORDER)
+      * @param rate Decimation ratio (rate^order must not exceed CIC_MAX_GAIN)
+      * @return true if the configuration is valid
+      */
+     bool begin(uint8_t order, uint16_t rate);
+ 
+     /**
+      * Clear the integrator and comb state
+      */
+     void reset();
+ 
+     /**
+      * Filter and decimate a run of samples (gain is normalized back to unity)
+      * @param in 12-bit input samples
+      * @param count Number of input samples
+      * @param out Output samples (12-bit)
+      * @param maxOut Size of out; at least count / rate + 1
+      * @return Number of output samples written
+      */
+     size_t process(const uint16_t *in, size_t count, uint16_t *out, size_t maxOut);
+ 
+     uint8_t order() const { return _order; }
+     uint16_t rate() const { return _rate; }
+ 
+   private:
+     // Integrators and combs wrap modulo 2^32, which the comb differences cancel
+     uint32_t _integrator[CIC_MAX_ORDER];
+     uint32_t _comb[CIC_MAX_ORDER];
+     uint8_t _order;
+     uint16_t _rate;
+     uint16_t _phase;
+     uint32_t _gain;
+ };
+ 
+ #endif // DECIMATION_FILTER_H
\ No newline at end of file
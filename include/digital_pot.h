@@ -14,6 +14,7 @@
  
  // MCP4151 SPI settings
  #define DIGITAL_POT_CS_PIN 12
+ #define DIGITAL_POT_SPI_TIMEOUT_MS 100  // Longest wait for the shared bus before a transfer is dropped
  
  // MCP4151 commands
  #define DIGITAL_POT_CMD_WRITE  0x00
@@ -30,8 +31,9 @@
  #define STRENGTH_MIN_VALUE 10
  #define STRENGTH_MAX_VALUE 250
  
- // External global variable (defined in main.cpp)
+ // External global variables (defined in main.cpp)
  extern volatile uint8_t strength;
+ extern SemaphoreHandle_t sharedSPIMutex;  // Shared with the ADC capture engine
  
  /**
   * Initialize the digital potentiometer module
@@ -43,7 +45,7 @@
  /**
   * Set the digital potentiometer value directly (0-255)
   * @param value Wiper position value (0-255)
-  * @return true if successful
+  * @return true if successful, false if the shared SPI bus stayed busy (write dropped and counted)
   */
  bool setDigitalPotValue(uint8_t value);
  
@@ -60,6 +62,13 @@
   */
  bool updateDigitalPotFromStrength();
  
+ /**
+  * Number of writes dropped because the shared SPI bus stayed busy
+  * (the ADC capture engine holds it for a whole run)
+  * @return Dropped writes since boot
+  */
+ uint32_t getDigitalPotDroppedWrites();
+ 
  /**
   * Create a digital potentiometer monitoring task
   * This task will monitor the global strength variable and update the potentiometer
@@ -52,7 +52,7 @@
  typedef struct {
      GpioExpanderEventType_t eventType;
      uint8_t buttonMask;       // Which button(s) triggered the event
-     unsigned long timestamp;  // Timestamp of the event
+     uint64_t timestampUs;     // monotonicUs() when the change was read
  } GpioExpanderEvent_t;
  
  // GPIO Expander status data structure
@@ -79,8 +79,9 @@
  
  /**
   * Receive the latest GPIO expander status
+  * Lock-free copy of the last published status, safe from any number of tasks
   * @param status Pointer to store the GPIO expander status
-  * @param timeout Maximum time to wait for results
+  * @param timeout Maximum time to wait for the first status
   * @return true if results were received
   */
  bool receiveGpioExpanderStatus(GpioExpanderStatus_t *status, TickType_t timeout);
@@ -0,0 +1,50 @@
+/*
+ * Monotonic Time Header
+ * One 64-bit microsecond clock for every timestamp the firmware produces:
+ * esp_timer_get_time(), which counts from boot and does not wrap in the
+ * lifetime of a unit. Arduino's micros() is its low 32 bits and wraps every
+ * 71.6 minutes, millis() its value divided by 1000 and truncated (wraps every
+ * 49.7 days). Interrupts that only need intervals can keep storing the 32-bit
+ * low word and have the task extend it to the full clock with a recent
+ * reading, so stored 32-bit micros() values from the capture paths correlate
+ * exactly with the 64-bit ones.
+ */
+ 
+ #ifndef MONOTONIC_TIME_H
+ #define MONOTONIC_TIME_H
+ 
+ #include <stdint.h>
+ #include "platform_compat.h"
+ 
+ #if !PLATFORM_HOST
+   #include "esp_timer.h"
+ 
+ /**
+  * Microseconds since boot (ISR safe: esp_timer_get_time() is in IRAM and takes no lock)
+  */
+ static inline uint64_t monotonicUs() {
+   return (uint64_t)esp_timer_get_time();
+ }
+ #else
+ // Host builds provide the clock, usually a simulated one
+ uint64_t monotonicUs();
+ #endif
+ 
+ /**
+  * Milliseconds since boot
+  */
+ static inline uint64_t monotonicMs() {
+   return monotonicUs() / 1000;
+ }
+ 
+ /**
+  * Extend a 32-bit micros() value to the 64-bit clock
+  * @param lowUs micros() (or the low word of monotonicUs()) of the moment
+  * @param referenceUs monotonicUs() within 35 minutes of that moment, before or after
+  * @return monotonicUs() of the moment
+  */
+ static inline uint64_t monotonicExtendUs(uint32_t lowUs, uint64_t referenceUs) {
+   return referenceUs + (int64_t)(int32_t)(lowUs - (uint32_t)referenceUs);
+ }
+ 
+ #endif // MONOTONIC_TIME_H
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+ * PCA9685 Calibration Header
+ * Oscillator model of the PCA9685: the output frequency is
+ * oscillator / (4096 * (prescale + 1)). The internal oscillator is nominally
+ * 25 MHz but real parts are off by several percent; fitting the model to
+ * frequencies measured at a few prescale values recovers the actual
+ * oscillator, with an uncertainty, so later prescales can be chosen from it.
+ * Prescales are chosen in integer arithmetic from a table of every
+ * prescale's output, generated at compile time and checked there against
+ * the datasheet formula. Plain C++ so the fit can be checked on a Linux host.
+ */
+ 
+ #ifndef PCA9685_CALIBRATION_H
+ #define PCA9685_CALIBRATION_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ 
+ // Internal oscillator as specified, and the prescale range the chip accepts
+ #define PCA9685_NOMINAL_OSC_HZ 25000000.0f
+ #define PCA9685_PRESCALE_MIN 3
+ #define PCA9685_PRESCALE_MAX 255
+ #define PCA9685_PRESCALE_COUNT (PCA9685_PRESCALE_MAX - PCA9685_PRESCALE_MIN + 1)
+ 
+ // Nominal oscillator in whole hertz, for the integer lookup
+ #define PCA9685_NOMINAL_OSC_WHOLE_HZ 25000000UL
+ 
+ // Points implying an oscillator further than this from nominal are measurement faults
+ #define PCA9685_CAL_MAX_DEVIATION 0.10f
+ 
+ // One measured point
+ typedef struct {
+   uint8_t prescale;            // Prescale register value
+   float measuredHz;            // Output frequency measured at that prescale
+   float stdErrHz;              // 1 sigma uncertainty of measuredHz (0 = unknown, points weighted equally)
+ } Pca9685CalPoint_t;
+ 
+ // Fitted oscillator
+ typedef struct {
+   float oscillatorHz;          // Actual internal oscillator
+   float oscillatorErrHz;       // 1 sigma uncertainty
+   float offsetPpm;             // oscillatorHz against the nominal 25 MHz
+   float residualRmsPpm;        // Scatter of the points about the fitted model
+   uint8_t points;              // Points used
+   uint8_t rejected;            // Points dropped as measurement faults
+ } Pca9685CalFit_t;
+ 
+ // Output of every prescale at the nominal oscillator, in millihertz, generated at compile time
+ typedef struct {
+   uint32_t milliHz[PCA9685_PRESCALE_COUNT];  // Index prescale - PCA9685_PRESCALE_MIN, descending
+ } Pca9685PrescaleTable_t;
+ 
+ extern const Pca9685PrescaleTable_t pca9685PrescaleTable;
+ 
+ /**
+  * Output frequency for a prescale value in millihertz, rounded to the nearest
+  * osc / (4096 * (prescale + 1)) (datasheet 7.3.5)
+  * @param oscillatorHz Internal oscillator in whole hertz
+  * @param prescale Prescale register value
+  */
+ constexpr uint32_t pca9685OutputMilliHz(uint32_t oscillatorHz, uint8_t prescale) {
+   return (uint32_t)(((uint64_t)oscillatorHz * 1000 + 2048ULL * (prescale + 1)) / (4096ULL * (prescale + 1)));
+ }
+ 
+ /**
+  * Prescale value whose output is closest to a frequency, by integer lookup in the table
+  * Ties go to the higher frequency (the smaller prescale)
+  * @param oscillatorHz Internal oscillator in whole hertz (nominal or fitted)
+  * @param frequencyMilliHz Wanted output frequency in millihertz
+  * @return Prescale, clamped to the range the chip accepts
+  */
+ uint8_t pca9685PrescaleForMilliHz(uint32_t oscillatorHz, uint32_t frequencyMilliHz);
+ 
+ /**
+  * Output frequency for a prescale value
+  * @param oscillatorHz Internal oscillator
+  * @param prescale Prescale register value
+  * @return Output frequency in Hz
+  */
+ float pca9685OutputHz(float oscillatorHz, uint8_t prescale);
+ 
+ /**
+  * Prescale value whose output is closest to a frequency
+  * @param oscillatorHz Internal oscillator
+  * @param frequencyHz Wanted output frequency
+  * @return Prescale, clamped to the range the chip accepts
+  */
+ uint8_t pca9685PrescaleFor(float oscillatorHz, float frequencyHz);
+ 
+ /**
+  * Fit the oscillator to measured points by weighted least squares
+  * The uncertainty is taken from the point errors, widened when the points
+  * scatter more than their errors explain, or from the scatter alone when
+  * the point errors are unknown
+  * @param points Measured points
+  * @param count Number of points
+  * @param fit Filled with the fitted oscillator
+  * @return true if at least one usable point was left
+  */
+ bool pca9685FitOscillator(const Pca9685CalPoint_t *points, size_t count, Pca9685CalFit_t *fit);
+ 
+ #endif // PCA9685_CALIBRATION_H
\ No newline at end of file
@@ -0,0 +1,200 @@
+/*
+ * PCA9685 Driver Header
+ * Register access for the PCA9685 through a write-through shadow of MODE1,
+ * MODE2, the LED registers and PRESCALE. Reads happen once, at begin();
+ * after that every change is computed from the shadow, writes whose value
+ * the device already holds are skipped, and staged changes to nearby
+ * registers go out as one auto-increment transaction, or as one ALL_LED
+ * write when every output ends up with the same counts. Frames set any
+ * subset of the 16 outputs together. The bus is reached
+ * through callbacks, so the driver runs unchanged against a simulated
+ * device on a Linux host.
+ */
+ 
+ #ifndef PCA9685_DRIVER_H
+ #define PCA9685_DRIVER_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ 
+ // PCA9685 register addresses
+ #define PCA9685_MODE1        0x00
+ #define PCA9685_MODE2        0x01
+ #define PCA9685_SUBADR1      0x02
+ #define PCA9685_SUBADR2      0x03
+ #define PCA9685_SUBADR3      0x04
+ #define PCA9685_PRESCALE     0xFE
+ #define PCA9685_LED0_ON_L    0x06
+ #define PCA9685_LED0_ON_H    0x07
+ #define PCA9685_LED0_OFF_L   0x08
+ #define PCA9685_LED0_OFF_H   0x09
+ #define PCA9685_ALL_LED_ON_L 0xFA
+ #define PCA9685_ALL_LED_ON_H 0xFB
+ #define PCA9685_ALL_LED_OFF_L 0xFC
+ #define PCA9685_ALL_LED_OFF_H 0xFD
+ 
+ // Mode1 register bits
+ #define PCA9685_RESTART      0x80
+ #define PCA9685_EXTCLK       0x40
+ #define PCA9685_AI           0x20
+ #define PCA9685_SLEEP        0x10
+ #define PCA9685_SUB1         0x08
+ #define PCA9685_SUB2         0x04
+ #define PCA9685_SUB3         0x02
+ #define PCA9685_ALLCALL      0x01
+ 
+ // Mode2 register bits
+ #define PCA9685_INVRT        0x10
+ #define PCA9685_OCH          0x08
+ #define PCA9685_OUTDRV       0x04
+ #define PCA9685_OUTNE1       0x02
+ #define PCA9685_OUTNE0       0x01
+ 
+ // PWM outputs, and the registers shadowed contiguously (MODE1 to LED15_OFF_H)
+ #define PCA9685_CHANNELS     16
+ #define PCA9685_SHADOW_SIZE  (PCA9685_LED0_ON_L + 4 * PCA9685_CHANNELS)
+ 
+ // Oscillator start-up after leaving sleep, before RESTART may be written
+ #define PCA9685_OSC_STARTUP_US 500
+ 
+ // Counts per PWM period, and the full on/off bit of the ON_H/OFF_H counts
+ #define PCA9685_COUNTS       4096
+ #define PCA9685_FULL         0x1000
+ 
+ // Unchanged registers between two staged runs that are rewritten to join
+ // them into one transaction (a new transaction costs address and register bytes)
+ #define PCA9685_MERGE_GAP    2
+ 
+ // Bus access, one call per I2C transaction; the callbacks own the bus lock
+ typedef struct {
+   // Send register address and data in one write, true if every byte was acknowledged
+   bool (*write)(void *context, uint8_t address, const uint8_t *data, size_t length);
+   // Send the register address, then read length bytes from it on
+   bool (*read)(void *context, uint8_t address, uint8_t reg, uint8_t *data, size_t length);
+   // Wait without releasing the CPU for long (oscillator start-up)
+   void (*delayUs)(void *context, uint32_t us);
+ } Pca9685Bus_t;
+ 
+ // Counts of a set of outputs, written together by writeFrame()
+ typedef struct {
+   uint16_t mask;                    // Outputs the frame sets (bit n = output n), the others keep theirs
+   uint16_t on[PCA9685_CHANNELS];    // Count at which each output turns on (PCA9685_FULL = full on)
+   uint16_t off[PCA9685_CHANNELS];   // Count at which each output turns off (PCA9685_FULL = full off)
+ } Pca9685Frame_t;
+ 
+ /**
+  * Set one output of a frame from its duty and phase
+  * @param frame Frame to add the output to
+  * @param channel Output (0-15)
+  * @param duty High time in counts (0 = full off, PCA9685_COUNTS = full on)
+  * @param phase Count at which the high time starts (0-4095)
+  * @return false if the channel does not exist or a value is out of range
+  */
+ bool pca9685FrameSet(Pca9685Frame_t *frame, uint8_t channel, uint16_t duty, uint16_t phase);
+ 
+ // Bus traffic since begin()
+ typedef struct {
+   uint32_t transactions;       // Writes and reads issued
+   uint32_t bytes;              // Bytes on the bus, address bytes included
+   uint32_t skippedBytes;       // Register writes dropped because the device already held the value
+   uint32_t allLedWrites;       // Flushes sent as one ALL_LED write
+ } Pca9685BusStats_t;
+ 
+ class Pca9685Driver {
+   public:
+     Pca9685Driver();
+ 
+     /**
+      * Put the device in a known mode and load the shadow from it
+      * Sleeps the oscillator, reads back every shadowed register and PRESCALE,
+      * then writes the modes (auto-increment is always set) and wakes it
+      * @param bus Bus callbacks (kept, must stay valid)
+      * @param context Passed to the callbacks
+      * @param address 7-bit I2C address
+      * @param mode1 MODE1 to run with (SLEEP and RESTART are ignored)
+      * @param mode2 MODE2 to run with
+      * @return true if the device answered every transaction
+      */
+     bool begin(const Pca9685Bus_t *bus, void *context, uint8_t address, uint8_t mode1, uint8_t mode2);
+ 
+     /**
+      * Change the prescale, skipped if the device already has it
+      * Sleep, then PRESCALE and the wake-up MODE1 in one write (auto-increment
+      * rolls over from PRESCALE to MODE1), then RESTART after the oscillator
+      * start-up so the outputs resume with their LED registers unchanged
+      * @param prescale Prescale register value (PCA9685_PRESCALE_MIN to PCA9685_PRESCALE_MAX)
+      * @return true if written (or already set)
+      */
+     bool setPrescale(uint8_t prescale);
+ 
+     /**
+      * Stage the on and off counts of one output, sent by the next flush()
+      * @param channel Output (0-15)
+      * @param on Count at which the output turns on (bit 12 = full on)
+      * @param off Count at which the output turns off (bit 12 = full off)
+      * @return false if the channel does not exist
+      */
+     bool stagePWM(uint8_t channel, uint16_t on, uint16_t off);
+ 
+     /**
+      * Stage the outputs of a frame, sent by the next flush()
+      * @param frame Outputs in the mask and their counts
+      * @return false if frame is NULL
+      */
+     bool stageFrame(const Pca9685Frame_t *frame);
+ 
+     /**
+      * Stage one shadowed register (MODE1, MODE2 or an LED register)
+      * @param reg Register address
+      * @param value New value
+      * @return false if the register is not shadowed
+      */
+     bool stageRegister(uint8_t reg, uint8_t value);
+ 
+     /**
+      * Write the staged registers that differ from the device, nearby ones in one transaction
+      * Staged changes to several outputs that leave all 16 with the same counts
+      * go out as one 5 byte ALL_LED write instead
+      * @return true if every write was acknowledged (failed ones stay staged)
+      */
+     bool flush();
+ 
+     /**
+      * Stage and flush the counts of one output
+      */
+     bool setPWM(uint8_t channel, uint16_t on, uint16_t off) {
+       return stagePWM(channel, on, off) && flush();
+     }
+ 
+     /**
+      * Stage and flush a frame
+      */
+     bool writeFrame(const Pca9685Frame_t *frame) {
+       return stageFrame(frame) && flush();
+     }
+ 
+     // Shadow contents: what the device holds
+     uint8_t shadow(uint8_t reg) const { return (reg < PCA9685_SHADOW_SIZE) ? _shadow[reg] : 0; }
+     uint8_t prescale() const { return _prescale; }
+     bool ready() const { return _bus != NULL; }
+ 
+     const Pca9685BusStats_t &stats() const { return _stats; }
+ 
+   private:
+     bool write(const uint8_t *data, size_t length);
+     bool flushAllLed();
+     bool read(uint8_t reg, uint8_t *data, size_t length);
+ 
+     const Pca9685Bus_t *_bus;
+     void *_context;
+     uint8_t _address;
+ 
+     uint8_t _shadow[PCA9685_SHADOW_SIZE];   // Device contents (MODE1 without RESTART)
+     uint8_t _staged[PCA9685_SHADOW_SIZE];   // Values waiting for flush()
+     bool _dirty[PCA9685_SHADOW_SIZE];
+     uint8_t _prescale;
+ 
+     Pca9685BusStats_t _stats;
+ };
+ 
+ #endif // PCA9685_DRIVER_H
\ No newline at end of file
@@ -0,0 +1,21 @@
+/*
+ * Platform Compatibility Header
+ * Lets the hardware-independent processing modules build on the ESP32-S3
+ * and on a Linux host (for replay and unit testing) from the same source
+ */
+ 
+ #ifndef PLATFORM_COMPAT_H
+ #define PLATFORM_COMPAT_H
+ 
+ #if defined(ARDUINO) || defined(ESP_PLATFORM)
+   #include "esp_attr.h"
+   #define PLATFORM_HOST 0
+ #else
+   // Host build: there is no instruction RAM, so ISR placement attributes vanish
+   #ifndef IRAM_ATTR
+     #define IRAM_ATTR
+   #endif
+   #define PLATFORM_HOST 1
+ #endif
+ 
+ #endif // PLATFORM_COMPAT_H
\ No newline at end of file
@@ -0,0 +1,333 @@
+/*
+ * Pulse Burst Header
+ * Burst detection for one monitored pin as a pure state machine. The edge
+ * tracker is the part the capture interrupts update on every edge; the
+ * monitor turns a tracker whose gap has passed into a PulseBurstResult_t
+ * and keeps the rolling statistics and the first valid reading. Neither
+ * reads a clock: times come with the edges and the checks, so recorded
+ * edge traces can be replayed on a Linux host (PulseBurstReplay) with the
+ * same results the device publishes. Burst detection runs on the 32-bit
+ * micros() word the interrupts read; results carry the 64-bit monotonic
+ * clock. Burst metrics are integer: nanosecond periods and Q16.16 kHz
+ * frequencies, bit-exact on the device and the host.
+ */
+ 
+ #ifndef PULSE_BURST_H
+ #define PULSE_BURST_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ #include "streaming_stats.h"
+ #include "monotonic_time.h"
+ 
+ // Time in microseconds to consider a burst ended (2ms)
+ #define PULSE_BURST_TIMEOUT_US 2000
+ 
+ // Bursts with more pulses are ignored and restart the rolling statistics
+ #define PULSE_MAX_PULSE_COUNT 40
+ 
+ // ... but the first valid reading is kept for at least this long after it was stored
+ #define PULSE_FIRST_READING_MIN_MS 3000
+ 
+ // Largest rolling statistics window (sliding)
+ #define PULSE_STATS_MAX_WINDOW 64
+ 
+ // Data structure for pulse burst results
+ typedef struct {
+   uint32_t burstDurationUs;    // First to last edge of the pulse burst in microseconds
+   uint32_t meanPeriodNs;       // Mean pulse period over the burst in nanoseconds
+   uint32_t firstPulsePeriodNs; // Period of the first pulse (first to third edge) in nanoseconds
+   uint32_t offPeriodUs;        // Off period between the previous burst and this one in microseconds (saturates)
+   uint16_t pulseCount;         // Number of pulses in the burst
+   uint32_t frequencyKHzQ16;    // Frequency within the burst in kHz, Q16.16 (pulseKHz() for display)
+   uint32_t firstPulsePeriodUs; // ... first pulse period rounded to microseconds
+   uint64_t timestampUs;        // monotonicUs() when the result was made
+   uint64_t burstStartUs;       // monotonicUs() of the first edge of the burst
+   uint8_t channel;             // Channel the burst was seen on
+   bool burstActive;            // Whether a burst is currently active
+   bool success;                // Whether reading was successful
+ } PulseBurstResult_t;
+ 
+ // Edge tracking for one capture backend. Times in microseconds are micros()
+ // for burst detection; ticks are the backend's own timestamps, used for
+ // the measurements.
+ typedef struct {
+   uint32_t lastEdgeTimeUs;     // micros() of the last edge
+   uint32_t burstStartTimeUs;   // micros() of the first edge of the burst
+   uint32_t burstStartTicks;    // Timestamp of the first edge
+   uint32_t lastEdgeTicks;      // Timestamp of the last edge
+   uint32_t lastOddEdgeTicks;   // Timestamp of the last edge with the polarity of the first
+   uint32_t firstPeriodTicks;   // First to third edge
+   uint16_t edgeCount;          // Edges of the current or last burst
+   bool burstActive;
+   bool burstStarted;           // Set by the first edge, cleared by the task
+ } PulseEdgeTracker_t;
+ 
+ // What a monitor update did with the burst
+ typedef enum {
+   PULSE_BURST_STARTED,             // A burst began, the result is marked active
+   PULSE_BURST_RECORDED,            // Closed and added to the rolling statistics
+   PULSE_BURST_FIRST_READING,       // ... and stored as the first valid reading
+   PULSE_BURST_OVER_LIMIT,          // Too many pulses: ignored, statistics restarted
+   PULSE_BURST_OVER_LIMIT_KEPT,     // ... first reading kept (stored too recently to drop)
+   PULSE_BURST_OVER_LIMIT_DROPPED   // ... first reading dropped
+ } PulseBurstEvent_t;
+ 
+ // Monitor configuration
+ typedef struct {
+   uint8_t channel;             // Copied into the results
+   uint32_t tickHz;             // Rate of the tracker's ticks, at least 1 MHz (1000000 when they are micros())
+   StreamingWindow_t windowMode;  // Rolling statistics window kind ...
+   uint16_t window;             // ... and length in bursts
+ } PulseBurstConfig_t;
+ 
+ // Backend ticks to microseconds (floating point, for diagnostics off the burst path)
+ inline double pulseTicksToUs(uint32_t ticks, uint32_t tickHz) {
+   return (tickHz == 1000000) ? (double)ticks : (double)ticks * 1000000.0 / tickHz;
+ }
+ 
+ // Mean pulse period over the burst (odd edge to odd edge), 0 with fewer than two periods' worth
+ inline double pulseMeanPeriodUs(const PulseEdgeTracker_t *tracker, uint32_t tickHz) {
+   uint16_t periods = (tracker->edgeCount - 1) / 2;
+   if (periods == 0) {
+     return 0;
+   }
+   return pulseTicksToUs(tracker->lastOddEdgeTicks - tracker->burstStartTicks, tickHz) / periods;
+ }
+ 
+ // Nanoseconds per backend tick, Q16.16 (exact for 1 MHz and 80 MHz), 0 for rates under 1 MHz
+ inline uint32_t pulseNsPerTickQ16(uint32_t tickHz) {
+   if (tickHz < 1000000) {
+     return 0;
+   }
+   return (uint32_t)((1000000000ULL * 65536 + tickHz / 2) / tickHz);
+ }
+ 
+ // Backend ticks to nanoseconds, rounded (saturates after 4.29 s)
+ inline uint32_t pulseTicksToNs(uint32_t ticks, uint32_t nsPerTickQ16) {
+   uint64_t ns = ((uint64_t)ticks * nsPerTickQ16 + 0x8000) >> 16;
+   return (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+ }
+ 
+ // Backend ticks to whole microseconds, rounded (rounding down to whole nanoseconds
+ // first keeps the result exact and the division 32-bit)
+ inline uint32_t pulseTicksToWholeUs(uint32_t ticks, uint32_t nsPerTickQ16) {
+   uint64_t ns = ((uint64_t)ticks * nsPerTickQ16) >> 16;
+   if (ns > UINT32_MAX - 500) {
+     return (uint32_t)((ns + 500) / 1000);
+   }
+   return ((uint32_t)ns + 500) / 1000;
+ }
+ 
+ // Mean pulse period over the burst in nanoseconds, 0 with fewer than two periods' worth
+ inline uint32_t pulseMeanPeriodNs(const PulseEdgeTracker_t *tracker, uint32_t nsPerTickQ16) {
+   uint16_t periods = (tracker->edgeCount - 1) / 2;
+   if (periods == 0) {
+     return 0;
+   }
+   uint64_t span = (uint64_t)(tracker->lastOddEdgeTicks - tracker->burstStartTicks) * nsPerTickQ16;
+   uint64_t ns = (span + ((uint64_t)periods << 15)) / ((uint64_t)periods << 16);
+   return (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+ }
+ 
+ // Frequency within the burst in kHz, Q16.16, rounded from the ticks themselves
+ // (not from a rounded period); 0 with fewer than two periods' worth
+ inline uint32_t pulseFrequencyKHzQ16(const PulseEdgeTracker_t *tracker, uint32_t tickHz) {
+   uint16_t periods = (tracker->edgeCount - 1) / 2;
+   uint32_t span = tracker->lastOddEdgeTicks - tracker->burstStartTicks;
+   if (periods == 0 || span == 0) {
+     return 0;
+   }
+   // periods * tickHz / (span * 1000) scaled by 65536, and 65536 / 1000 = 8192 / 125
+   uint64_t num = ((uint64_t)periods * tickHz) << 13;
+   uint64_t den = (uint64_t)span * 125;
+   uint64_t q16 = (num + den / 2) / den;
+   return (q16 > UINT32_MAX) ? UINT32_MAX : (uint32_t)q16;
+ }
+ 
+ // Q16.16 kHz as a float, for display and the rolling statistics
+ inline float pulseKHz(uint32_t frequencyKHzQ16) {
+   return frequencyKHzQ16 * (1.0f / 65536);
+ }
+ 
+ /**
+  * Account one edge to a tracker (forced inline so it runs from the calling ISR's IRAM)
+  * @param tracker Tracker of the backend that saw the edge
+  * @param timeUs micros() of the edge
+  * @param ticks Backend timestamp of the edge
+  * @return true if the edge started a new burst
+  */
+ __attribute__((always_inline)) inline bool pulseTrackEdge(PulseEdgeTracker_t *tracker, uint32_t timeUs,
+                                                           uint32_t ticks) {
+   bool burstStarted = false;
+ 
+   // A burst is only ended once its gap has passed, so any edge outside one starts a new
+   // burst (comparing with the last edge time would alias after a multiple of the wrap)
+   if (!tracker->burstActive) {
+     burstStarted = true;
+     tracker->burstStartTimeUs = timeUs;
+     tracker->burstStartTicks = ticks;
+     tracker->lastOddEdgeTicks = ticks;
+     tracker->firstPeriodTicks = 0;
+     tracker->edgeCount = 1;
+     tracker->burstActive = true;
+     tracker->burstStarted = true;  // Notify task to start monitoring
+   }
+   // If we're in an active burst
+   else if (tracker->burstActive) {
+     tracker->edgeCount++;
+ 
+     // Odd edges have the polarity of the first one, a full period apart
+     if (tracker->edgeCount & 1) {
+       tracker->lastOddEdgeTicks = ticks;
+       if (tracker->edgeCount == 3) {
+         tracker->firstPeriodTicks = ticks - tracker->burstStartTicks;
+       }
+     }
+   }
+ 
+   // Update last edge time regardless (wraps with micros())
+   tracker->lastEdgeTimeUs = timeUs;
+   tracker->lastEdgeTicks = ticks;
+   return burstStarted;
+ }
+ 
+ /**
+  * Whether the gap after a tracker's burst has passed
+  * @param tracker Tracker to check
+  * @param nowUs micros() now
+  */
+ inline bool pulseBurstEnded(const PulseEdgeTracker_t *tracker, uint32_t nowUs) {
+   return tracker->burstActive && (nowUs - tracker->lastEdgeTimeUs > PULSE_BURST_TIMEOUT_US);
+ }
+ 
+ // Per-burst results and rolling statistics of one channel
+ class PulseBurstMonitor {
+   public:
+     typedef StreamingStats<PULSE_STATS_MAX_WINDOW> Stats;
+     typedef RollingMeanQ16<PULSE_STATS_MAX_WINDOW> MeanQ16;
+ 
+     PulseBurstMonitor();
+ 
+     /**
+      * Set the configuration and drop all results
+      * @param config New configuration
+      * @return true if the configuration is valid
+      */
+     bool configure(const PulseBurstConfig_t *config);
+ 
+     /**
+      * Drop the results, the statistics and the first reading
+      */
+     void reset();
+ 
+     /**
+      * Mark the result active when the tracker reports a new burst
+      * @return true if the result changed and should be published
+      */
+     bool startBurst();
+ 
+     /**
+      * Measure a burst whose gap has passed
+      * @param burst Copy of the tracker, taken when it was ended
+      * @param nowUs monotonicUs() now, within 35 minutes of the burst
+      * @return What was done with the burst; result() holds it either way
+      */
+     PulseBurstEvent_t closeBurst(const PulseEdgeTracker_t *burst, uint64_t nowUs);
+ 
+     // Latest result, the one to publish
+     const PulseBurstResult_t &result() const { return _result; }
+ 
+     // First valid reading, kept for comparison
+     bool haveFirstReading() const { return _haveFirstReading; }
+     const PulseBurstResult_t &firstReading() const { return _firstReading; }
+ 
+     // Rolling statistics of the valid bursts; the frequency keeps only its mean, in kHz Q16.16
+     const Stats &pulseCountStats() const { return _pulseCountStats; }
+     const MeanQ16 &frequencyStats() const { return _frequencyStats; }
+     const Stats &firstPeriodStats() const { return _firstPeriodStats; }
+     const Stats &burstDurationStats() const { return _burstDurationStats; }
+     const Stats &offPeriodStats() const { return _offPeriodStats; }
+ 
+   private:
+     void resetStats();
+ 
+     PulseBurstConfig_t _config;
+     uint32_t _nsPerTickQ16;
+     PulseBurstResult_t _result;
+     uint64_t _previousBurstEndUs;      // monotonicUs() of the last edge of the previous burst
+     bool _havePreviousBurst;
+     bool _active;
+ 
+     PulseBurstResult_t _firstReading;
+     uint64_t _firstReadingUs;
+     bool _haveFirstReading;
+ 
+     Stats _pulseCountStats;
+     MeanQ16 _frequencyStats;
+     Stats _firstPeriodStats;
+     Stats _burstDurationStats;
+     Stats _offPeriodStats;
+ };
+ 
+ // Replays an edge trace through a tracker and a monitor the way the device
+ // does: the burst is started on its first edge and closed as soon as the gap
+ // has passed, that is PULSE_BURST_TIMEOUT_US + 1 after its last edge. The tracker
+ // sees the low 32 bits of the trace times, as the interrupts see micros().
+ class PulseBurstReplay {
+   public:
+     // Receives every result the device would publish
+     typedef void (*Sink_t)(const PulseBurstResult_t &result, PulseBurstEvent_t event, void *context);
+ 
+     PulseBurstReplay();
+ 
+     /**
+      * Set the configuration and start a new trace
+      * @param config Monitor configuration
+      * @param sink Called for each published result (may be NULL)
+      * @param context Passed to the sink
+      * @return true if the configuration is valid
+      */
+     bool configure(const PulseBurstConfig_t *config, Sink_t sink, void *context);
+ 
+     /**
+      * Start a new trace with the same configuration
+      */
+     void reset();
+ 
+     /**
+      * Feed the next trace entry; entries that repeat the previous level are not edges
+      * @param timeUs monotonicUs() of the entry, never decreasing
+      * @param ticks Backend timestamp (the low word of timeUs for micros() traces)
+      * @param level Level after the entry
+      * @return true if it was an edge
+      */
+     bool edge(uint64_t timeUs, uint32_t ticks, bool level);
+ 
+     /**
+      * Close the burst in progress as if the trace went quiet after it
+      */
+     void finish();
+ 
+     const PulseBurstMonitor &monitor() const { return _monitor; }
+ 
+     // Edges fed and bursts closed since the trace started
+     uint32_t edges() const { return _edges; }
+     uint32_t bursts() const { return _bursts; }
+ 
+   private:
+     void publish(PulseBurstEvent_t event);
+ 
+     PulseBurstMonitor _monitor;
+     PulseEdgeTracker_t _tracker;
+     Sink_t _sink;
+     void *_context;
+     uint64_t _clockUs;                 // Time of the latest entry
+     uint64_t _lastEdgeUs;
+     bool _level;
+     bool _haveLevel;
+     uint32_t _edges;
+     uint32_t _bursts;
+ };
+ 
+ #endif // PULSE_BURST_H
\ No newline at end of file
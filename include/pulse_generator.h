@@ -1,7 +1,12 @@
 /*
  * Pulse Generator Module Header
  * Provides functions for controlling a PCA9685 PWM controller
- * for generating pulses at a configurable frequency with 50% duty cycle
+ * for generating pulses at a configurable frequency, 50% duty cycle on
+ * both outputs until a duty and phase is set per output (any of the 16).
+ * Register access goes through Pca9685Driver's shadow, so only changes
+ * reach the bus. Settings are requested from any task and applied by the
+ * generator task as soon as it is notified; requests that arrive before it
+ * runs are merged, the latest value winning.
  */
 
  #ifndef PULSE_GENERATOR_H
@@ -12,43 +17,12 @@
  #include "freertos/FreeRTOS.h"
  #include "freertos/semphr.h"
  #include "freertos/task.h"
+ #include "pca9685_calibration.h"
+ #include "pca9685_driver.h"
  
  // PCA9685 I2C address (default is 0x40)
  #define PCA9685_ADDR 0x40
  
- // PCA9685 register addresses
- #define PCA9685_MODE1        0x00
- #define PCA9685_MODE2        0x01
- #define PCA9685_SUBADR1      0x02
- #define PCA9685_SUBADR2      0x03
- #define PCA9685_SUBADR3      0x04
- #define PCA9685_PRESCALE     0xFE
- #define PCA9685_LED0_ON_L    0x06
- #define PCA9685_LED0_ON_H    0x07
- #define PCA9685_LED0_OFF_L   0x08
- #define PCA9685_LED0_OFF_H   0x09
- #define PCA9685_ALL_LED_ON_L 0xFA
- #define PCA9685_ALL_LED_ON_H 0xFB
- #define PCA9685_ALL_LED_OFF_L 0xFC
- #define PCA9685_ALL_LED_OFF_H 0xFD
- 
- // Mode1 register bits
- #define PCA9685_RESTART      0x80
- #define PCA9685_EXTCLK       0x40
- #define PCA9685_AI           0x20
- #define PCA9685_SLEEP        0x10
- #define PCA9685_SUB1         0x08
- #define PCA9685_SUB2         0x04
- #define PCA9685_SUB3         0x02
- #define PCA9685_ALLCALL      0x01
- 
- // Mode2 register bits
- #define PCA9685_INVRT        0x10
- #define PCA9685_OCH          0x08
- #define PCA9685_OUTDRV       0x04
- #define PCA9685_OUTNE1       0x02
- #define PCA9685_OUTNE0       0x01
- 
  // ESP32 GPIO pin for PCA9685 enable
  #define PULSE_ENABLE_PIN 7
  
@@ -61,7 +35,64 @@
  #define PULSE_MAX_FREQ 1526
  #define PULSE_DEFAULT_FREQ 100
  
- // External global variables (defined in main.cpp)
+ // Oscillator calibration: output frequencies swept (prescales chosen from the
+ // nominal oscillator), settling time after each change and measurement gate
+ #define PULSE_CAL_FREQUENCIES { 50, 100, 200, 400, 800, 1500 }
+ #define PULSE_CAL_MAX_POINTS 8
+ #define PULSE_CAL_SETTLE_MS 100
+ #define PULSE_CAL_GATE_MS 500
+ 
+ // Calibration states
+ typedef enum {
+     PULSE_CAL_NONE,          // Nominal 25 MHz oscillator assumed
+     PULSE_CAL_RUNNING,       // Sweep in progress
+     PULSE_CAL_DONE,          // Fitted oscillator in use
+     PULSE_CAL_FAILED         // Last sweep gave no usable fit, previous oscillator kept
+ } PulseCalState_t;
+ 
+ // Calibration result
+ typedef struct {
+     PulseCalState_t state;
+     uint8_t channel;         // Pulse monitor channel the output was measured on
+     Pca9685CalFit_t fit;     // Fitted oscillator
+     uint8_t prescale;        // Prescale now in use
+     float requestedHz;       // Frequency asked for
+     float achievedHz;        // Frequency the prescale gives with the fitted oscillator
+     float achievedErrHz;     // 95% bound on achievedHz (2 sigma)
+ } PulseCalibration_t;
+ 
+ // Output frequency a request gives: the closest prescale and what it achieves
+ typedef struct {
+     uint16_t requestedHz;    // Frequency asked for
+     uint8_t prescale;        // Prescale closest to it
+     uint32_t achievedMilliHz; // Output with that prescale and the oscillator in use
+     int32_t errorPpm;        // achieved against requested
+ } PulseFrequencySetting_t;
+ 
+ // Settings applied together by the generator task
+ typedef struct {
+     uint16_t frequency;      // Output frequency in Hz (PULSE_MIN_FREQ to PULSE_MAX_FREQ)
+     bool outputsOn;          // Outputs driven (the enable pin is active low)
+ } PulseGeneratorSettings_t;
+ 
+ // Request handling since init
+ typedef struct {
+     PulseGeneratorSettings_t applied;  // Settings on the hardware
+     PulseFrequencySetting_t achieved;  // Output frequency they give
+     uint32_t requests;       // Requests accepted
+     uint32_t updates;        // Task passes that applied requests
+     uint32_t coalesced;      // Requests superseded by a later one before the task ran
+     uint32_t failures;       // Updates with a failed hardware write
+     uint32_t lastLatencyUs;  // Oldest waiting request to outputs updated, last update
+     uint32_t meanLatencyUs;  // ... mean
+     uint32_t maxLatencyUs;   // ... longest
+     uint32_t busTransactions; // PCA9685 bus transactions since init
+     uint32_t busBytes;       // ... bytes
+ } PulseGeneratorStats_t;
+ 
+ // Settings last applied by the generator task (defined in main.cpp): the
+ // frequency, and the enable pin level (true = outputs off). Read-only, change
+ // them with the request functions
  extern volatile uint16_t pFrequency;
  extern volatile bool pulseEn;
  
@@ -73,11 +104,21 @@
  bool initPulseGenerator(TwoWire &wire);
  
  /**
-  * Set the pulse frequency
+  * Set the pulse frequency to the closest the prescale can give
   * @param freq Frequency in Hz (24-1526 Hz)
+  * @param setting Set to the prescale and achieved frequency (may be NULL)
   * @return true if successful
   */
- bool setPulseFrequency(uint16_t freq);
+ bool setPulseFrequency(uint16_t freq, PulseFrequencySetting_t *setting = NULL);
+ 
+ /**
+  * Get the prescale and achieved frequency a frequency would give, without setting it
+  * Integer table lookup, with the calibrated oscillator once a calibration has run
+  * @param freq Frequency in Hz (clamped to 24-1526 Hz)
+  * @param setting Pointer to store the setting
+  * @return true if setting is not NULL
+  */
+ bool getPulseFrequencySetting(uint16_t freq, PulseFrequencySetting_t *setting);
  
  /**
   * Enable or disable the pulse generator
@@ -87,17 +128,87 @@
  bool enablePulseGenerator(bool enable);
  
  /**
-  * Update the pulse generator based on global settings
-  * This should be called periodically to check if settings have changed
-  * @return true if successful
+  * Request the settings held in pFrequency and pulseEn
+  * For code that writes the globals directly; prefer the request functions
+  * @return true if the request was queued
   */
  bool updatePulseGenerator();
  
  /**
-  * Create a pulse generator monitoring task
-  * This task will monitor the global variables and update the pulse generator
+  * Request a new output frequency, the outputs unchanged
+  * @param freq Frequency in Hz (24-1526 Hz)
+  * @return true if the request was queued
+  */
+ bool requestPulseFrequency(uint16_t freq);
+ 
+ /**
+  * Request the outputs on or off, the frequency unchanged
+  * @param on true to drive the outputs
+  * @return true if the request was queued
+  */
+ bool requestPulseOutputs(bool on);
+ 
+ /**
+  * Request frequency and outputs together, applied in one update
+  * @param settings Settings to apply
+  * @return true if the request was queued
+  */
+ bool requestPulseSettings(const PulseGeneratorSettings_t *settings);
+ 
+ /**
+  * Request the duty and phase of the outputs in a frame, written in one bus
+  * transaction; merged with a frame not yet applied, later outputs winning
+  * @param frame Outputs in the mask and their counts (see pca9685FrameSet)
+  * @return true if the request was queued
+  */
+ bool requestPulseFrame(const Pca9685Frame_t *frame);
+ 
+ /**
+  * Request the duty and phase of one output
+  * @param channel PCA9685 output (0-15)
+  * @param duty High time in 1/4096 of the period (0 = off, 4096 = always on)
+  * @param phase Start of the high time in 1/4096 of the period (0-4095)
+  * @return true if the request was queued
+  */
+ bool requestPulseChannel(uint8_t channel, uint16_t duty, uint16_t phase);
+ 
+ /**
+  * Get the applied settings and the request latency statistics
+  * @param stats Pointer to store the statistics
+  * @return true if the module is initialized
+  */
+ bool getPulseGeneratorStats(PulseGeneratorStats_t *stats);
+ 
+ /**
+  * Create the pulse generator task
+  * The task sleeps until a request or a calibration arrives and applies it
   * @return true if task creation was successful
   */
  bool createPulseGeneratorTask();
  
+ /**
+  * Start an oscillator calibration in the pulse generator task
+  * Sweeps the prescale, measures the output with the pulse monitor on the given
+  * channel and fits the actual oscillator, which setPulseFrequency() uses from
+  * then on. The outputs are driven during the sweep and restored afterwards.
+  * @param channel Pulse monitor channel wired to a generator output
+  * @param notifyTask Task notified when the calibration ends (may be NULL)
+  * @param notifyBits Bits set in the notification
+  * @return true if the calibration was queued
+  */
+ bool requestPulseCalibration(uint8_t channel, TaskHandle_t notifyTask, uint32_t notifyBits);
+ 
+ /**
+  * Get the state and result of the last calibration
+  * @param calibration Pointer to store the calibration
+  * @return true if the module is initialized
+  */
+ bool getPulseCalibration(PulseCalibration_t *calibration);
+ 
+ /**
+  * Register the "pulse" command on the serial command channel
+  * @return true if the command was registered
+  */
+ bool registerPulseGeneratorCommands();
+ 
  #endif // PULSE_GENERATOR_H
\ No newline at end of file
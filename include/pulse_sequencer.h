@@ -0,0 +1,90 @@
+/*
+ * Pulse Sequencer Module Header
+ * Alternate pulse output on the ESP32-S3 RMT peripheral: programmable pulse
+ * trains (pulses per burst, pulse width and period, gap between bursts) on
+ * one GPIO with 100 ns resolution, well past the PCA9685's 24-1526 Hz at
+ * 50% duty, and without pausing the output for a change. A pattern is
+ * compiled into symbols (pulse_train.h) in the buffer that is not playing
+ * and queued behind the transmission in progress, so it takes over at a
+ * burst boundary. The sequencer task restarts each transmission as the
+ * previous one ends, which lengthens the gap at that point by the restart
+ * latency (tens of microseconds); short bursts are repeated within one
+ * transmission to keep restarts rare.
+ */
+ 
+ #ifndef PULSE_SEQUENCER_H
+ #define PULSE_SEQUENCER_H
+ 
+ #include <Arduino.h>
+ #include "freertos/FreeRTOS.h"
+ #include "driver/rmt.h"
+ #include "pulse_train.h"
+ 
+ // Configuration
+ // PLACEHOLDER: the board wiring of the RMT output is not known; GPIO 18 was
+ // picked as a free pin and must be checked against the schematic before use
+ #define PULSE_SEQUENCER_PIN 18  // Pulse train output - placeholder
+ #define PULSE_SEQUENCER_RMT_CHANNEL RMT_CHANNEL_0
+ #define PULSE_SEQUENCER_CLK_DIV 8  // 80 MHz APB clock / 8 = 100 ns ticks
+ #define PULSE_SEQUENCER_TICK_NS 100
+ #define PULSE_SEQUENCER_MEM_BLOCKS 2  // RMT RAM blocks of 48 symbols, refilled from the buffer while playing
+ #define PULSE_SEQUENCER_MAX_SYMBOLS 512  // Symbols per buffer, two buffers
+ #define PULSE_SEQUENCER_MIN_WRITE_US 1000  // Bursts are repeated until a transmission lasts this long
+ 
+ // Pulse output backends, chosen at init
+ typedef enum {
+   PULSE_BACKEND_PCA9685,       // PCA9685 over I2C: 24-1526 Hz, duty and phase per output
+   PULSE_BACKEND_RMT            // RMT pulse train sequencer on PULSE_SEQUENCER_PIN
+ } PulseBackend_t;
+ 
+ #define PULSE_DEFAULT_BACKEND PULSE_BACKEND_PCA9685
+ 
+ // Pattern in use and request handling since init
+ typedef struct {
+   PulseTrainPattern_t pattern; // Pattern playing (pulsesPerBurst 0 = stopped)
+   uint32_t requests;           // Patterns accepted
+   uint32_t updates;            // Patterns that reached the output
+   uint32_t coalesced;          // Patterns superseded by a later one before they played
+   uint32_t transmissions;      // RMT transmissions started
+   uint32_t symbols;            // Symbols per transmission of the pattern playing
+   uint16_t burstsPerTransmission; // ... bursts
+   uint32_t lastLatencyUs;      // Request to the first transmission of its pattern, last update
+   uint32_t maxLatencyUs;       // ... longest
+ } PulseSequencerStats_t;
+ 
+ /**
+  * Initialize the RMT channel for the pulse sequencer, output idle low
+  * @param pin GPIO pin to drive
+  * @return true if initialization was successful
+  */
+ bool initPulseSequencer(uint8_t pin = PULSE_SEQUENCER_PIN);
+ 
+ /**
+  * Create the pulse sequencer task
+  * The task keeps the RMT transmitting while a pattern is set
+  * @return true if task creation was successful
+  */
+ bool createPulseSequencerTask();
+ 
+ /**
+  * Request a pulse train, replacing the one playing at the next burst boundary
+  * Requests that arrive before the task picks them up are merged, the latest winning
+  * @param pattern Pattern to play (pulsesPerBurst 0 stops the output after the current burst)
+  * @return true if the pattern compiles and was queued
+  */
+ bool requestPulseTrain(const PulseTrainPattern_t *pattern);
+ 
+ /**
+  * Get the pattern in use and the request statistics
+  * @param stats Pointer to store the statistics
+  * @return true if the module is initialized
+  */
+ bool getPulseSequencerStats(PulseSequencerStats_t *stats);
+ 
+ /**
+  * Register the "train" command on the serial command channel
+  * @return true if registered
+  */
+ bool registerPulseSequencerCommands();
+ 
+ #endif // PULSE_SEQUENCER_H
\ No newline at end of file
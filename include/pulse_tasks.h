@@ -1,6 +1,12 @@
 /*
  * Pulse Burst Monitoring Tasks Module Header
- * Provides functions for monitoring digital pulse bursts on a GPIO pin
+ * Provides functions for monitoring digital pulse bursts on up to three
+ * GPIO pins (channels), served by one task. Edges are timestamped either by
+ * a GPIO interrupt reading micros() or in hardware by the MCPWM capture unit
+ * (12.5 ns resolution), selected at init. Every edge of the result-driving
+ * backend also goes through a lock-free ring to the task, which rebuilds
+ * each burst pulse by pulse. Bursts that start together on two channels are
+ * paired for the skew and phase between the channels.
  */
 
  #ifndef PULSE_TASKS_H
@@ -8,30 +14,126 @@
  
  #include <Arduino.h>
  #include "freertos/FreeRTOS.h"
+ #include "driver/mcpwm.h"
+ #include "burst_analyzer.h"
+ #include "pulse_burst.h"
  
  // Configuration
- #define PULSE_MONITOR_PIN 6  // GPIO pin to monitor
- #define PULSE_BURST_TIMEOUT_US 2000  // Time in microseconds to consider a burst ended (2ms)
+ #define PULSE_MONITOR_PIN 6  // GPIO pin to monitor (channel 0)
+ // PLACEHOLDERS: the board wiring of the next two is not known; these GPIOs were
+ // picked as free pins and must be checked against the schematic before use
+ #define PULSE_MONITOR_PIN_2 16  // Second PCA9685 output (PULSE_CHANNEL_2) - placeholder
+ #define PULSE_RETURN_PIN 17  // Return path of the pulse output - placeholder
+ // Also monitor the two placeholder pins; off until the schematic confirms them,
+ // since unconnected inputs pick up noise edges and report false bursts and skew
+ #ifndef PULSE_MONITOR_EXTRA_CHANNELS
+ #define PULSE_MONITOR_EXTRA_CHANNELS 0
+ #endif
  #define PULSE_REPORT_INTERVAL_MS 1000  // Report rolling average every 1 second
+ #define PULSE_EDGE_RING_SIZE 256  // Edges buffered between the capture interrupt and the task
  
- // Data structure for pulse burst results
+ // Rolling burst statistics: window kind and length in bursts (at most PULSE_STATS_MAX_WINDOW)
+ #define PULSE_STATS_WINDOW_MODE STREAMING_WINDOW_SLIDING
+ #define PULSE_STATS_WINDOW 10
+ 
+ // Channels, one per MCPWM capture channel of the unit, and the channel pairs among them
+ #define PULSE_MAX_CHANNELS 3
+ #define PULSE_MAX_PAIRS (PULSE_MAX_CHANNELS * (PULSE_MAX_CHANNELS - 1) / 2)
+ 
+ // MCPWM capture backend: unit, and the capture channel and input signal of
+ // channel 0 (channel n uses CAPn)
+ #define PULSE_CAPTURE_MCPWM_UNIT    MCPWM_UNIT_0
+ #define PULSE_CAPTURE_MCPWM_CHANNEL MCPWM_SELECT_CAP0
+ #define PULSE_CAPTURE_MCPWM_SIGNAL  MCPWM_CAP_0
+ 
+ // The capture timer counts APB clock cycles, one timer for all channels
+ #define PULSE_CAPTURE_MCPWM_TICK_HZ APB_CLK_FREQ
+ 
+ // Spread of GPIO interrupt timestamps (1 sigma), for frequency measurement error bounds
+ #define PULSE_ISR_TIMESTAMP_ERROR_US 2.0
+ 
+ // Edge timestamping backends
+ typedef enum {
+   PULSE_CAPTURE_GPIO_ISR,      // GPIO interrupt on every edge, micros() timestamps
+   PULSE_CAPTURE_MCPWM,         // MCPWM capture unit latches the edge time in hardware
+   PULSE_CAPTURE_COMPARE        // Both on the same pin, MCPWM drives the results, ISR is measured against it
+ } PulseCaptureMode_t;
+ 
+ // The GPIO ISR stays the default. MCPWM (12.5 ns timestamps) is opt-in until its CPU
+ // cost has been measured against the ISR: run PULSE_CAPTURE_COMPARE on hardware
+ // and read getPulseCaptureStats() (handler bodies only, interrupt dispatch excluded)
+ #define PULSE_CAPTURE_DEFAULT_MODE PULSE_CAPTURE_GPIO_ISR
+ 
+ // Pulse-by-pulse reconstruction of one burst from its edge timestamps
+ typedef struct {
+   uint64_t burstStartUs;       // monotonicUs() of the first edge of the burst
+   uint32_t edgesLost;          // Edges dropped on a full ring since the previous detail
+   BurstAnalysis_t analysis;    // Periods, high times, drift, jitter, duty, missing/extra pulses
+ } PulseBurstDetail_t;
+ 
+ // Skew and phase of channel b against channel a, from bursts that start together
  typedef struct {
-   uint32_t burstDurationUs;    // Total duration of the pulse burst in microseconds
-   uint32_t offPeriodUs;        // Duration of the off period after the burst in microseconds
-   uint16_t pulseCount;         // Number of pulses in the burst
-   float frequencyKHz;          // Frequency in kHz within the burst
-   uint32_t firstPulsePeriodUs; // Period of the first pulse in microseconds  
-   uint32_t timestamp;          // Timestamp when the burst was detected
-   bool burstActive;            // Whether a burst is currently active
-   bool success;                // Whether reading was successful
- } PulseBurstResult_t;
- 
- /**
-  * Initialize the pulse burst monitoring module
+   uint32_t pairedBursts;       // Burst pairs measured since init
+   uint16_t windowBursts;       // Pairs in the statistics window
+   float skewUs;                // Mean first edge of b minus first edge of a
+   float skewStdUs;             // ... standard deviation
+   float skewP50Us;             // ... median
+   float skewP99Us;             // ... 99th percentile
+   float phaseDeg;              // Mean skew as a share of the pulse period, in degrees (-180..180)
+   float phaseStdDeg;           // ... standard deviation
+ } PulsePairStats_t;
+ 
+ // Frequency of a continuous signal counted over a gate time
+ typedef struct {
+   float frequencyHz;           // Whole periods over the time they took
+   float stdErrHz;              // 1 sigma, from the timestamp error at both ends
+   uint32_t periods;            // Rising edge to rising edge periods counted
+   float intervalUs;            // Time the periods took
+ } PulseFrequencyMeasurement_t;
+ 
+ // Edge capture cost, burst end detection cost and, in compare mode, accuracy of the ISR path
+ typedef struct {
+   PulseCaptureMode_t mode;     // Backend in use (GPIO ISR if MCPWM could not be set up)
+   uint32_t isrEdges;           // Edges seen by the GPIO ISR
+   uint32_t hwEdges;            // Edges seen by the MCPWM capture callback
+   uint32_t isrCyclesPerEdge;   // Mean CPU cycles in the GPIO ISR body
+   uint32_t hwCyclesPerEdge;    // Mean CPU cycles in the capture callback body
+   uint32_t isrLoadPpm;         // GPIO ISR body time as parts per million of one core
+   uint32_t hwLoadPpm;          // Capture callback body time as parts per million of one core
+   uint32_t comparedBursts;     // Bursts seen by both backends (compare mode)
+   uint32_t isrMissedEdges;     // Edges the hardware saw and the ISR did not
+   float firstPeriodErrorRmsNs; // ISR first pulse period minus the hardware one, RMS
+   float firstPeriodErrorMaxNs; // ... largest magnitude
+   float meanPeriodErrorRmsNs;  // ISR mean pulse period over the burst minus the hardware one, RMS
+   uint32_t burstEndLatencyUs;  // Mean time from the last edge of a burst to its result
+   uint32_t burstEndLatencyMaxUs; // ... longest
+   uint32_t burstCyclesPerBurst; // Mean CPU cycles to turn an ended burst into its result and statistics
+   uint32_t analyzerCyclesPerBurst; // Mean CPU cycles of the pulse-by-pulse analysis of a closed burst
+   uint32_t taskWakeups;        // Pulse task wakeups since init
+   uint32_t timerRearms;        // Gap timer expiries that found newer edges and waited on
+ } PulseCaptureStats_t;
+ 
+ /**
+  * Initialize the pulse burst monitoring module on a single pin (channel 0)
+  * Falls back to the GPIO ISR if the MCPWM capture unit cannot be set up
   * @param monitorPin GPIO pin to monitor (default is 6)
+  * @param mode Edge timestamping backend
+  * @return true if initialization was successful
+  */
+ bool initPulseBurstModule(uint8_t monitorPin = PULSE_MONITOR_PIN,
+                           PulseCaptureMode_t mode = PULSE_CAPTURE_DEFAULT_MODE);
+ 
+ /**
+  * Initialize the pulse burst monitoring module on several pins
+  * Channel n monitors pins[n]; channel 0 also drives the scope and burst capture.
+  * All channels use the same backend, falling back to the GPIO ISR together
+  * @param pins GPIO pins to monitor
+  * @param count Number of pins (1 to PULSE_MAX_CHANNELS)
+  * @param mode Edge timestamping backend
   * @return true if initialization was successful
   */
- bool initPulseBurstModule(uint8_t monitorPin = PULSE_MONITOR_PIN);
+ bool initPulseBurstChannels(const uint8_t *pins, uint8_t count,
+                             PulseCaptureMode_t mode = PULSE_CAPTURE_DEFAULT_MODE);
  
  /**
   * Create a pulse burst monitoring task
@@ -42,11 +144,56 @@
  
  /**
   * Receive the latest pulse burst results
+  * Lock-free copy of the last published result, safe from any number of tasks
   * @param result Pointer to store the pulse burst results
-  * @param timeout Maximum time to wait for results
+  * @param timeout Maximum time to wait for the first result
+  * @param channel Channel to read
   * @return true if results were received
   */
- bool receivePulseBurstResults(PulseBurstResult_t *result, TickType_t timeout);
+ bool receivePulseBurstResults(PulseBurstResult_t *result, TickType_t timeout, uint8_t channel = 0);
+ 
+ /**
+  * Receive the reconstruction of the next completed burst
+  * Only the latest burst is kept, so a slow reader skips bursts
+  * @param detail Pointer to store the burst detail
+  * @param timeout Maximum time to wait for a burst
+  * @param channel Channel to read
+  * @return true if a detail was received
+  */
+ bool receivePulseBurstDetail(PulseBurstDetail_t *detail, TickType_t timeout, uint8_t channel = 0);
+ 
+ /**
+  * Read the edge capture cost and comparison statistics
+  * Task wakeups and timer re-arms are totals for all channels
+  * @param stats Pointer to store the statistics
+  * @param channel Channel to read
+  * @return true if the statistics were read
+  */
+ bool getPulseCaptureStats(PulseCaptureStats_t *stats, uint8_t channel = 0);
+ 
+ /**
+  * Read the skew and phase between two channels
+  * @param a Reference channel
+  * @param b Measured channel (b != a; swapping them negates the skew)
+  * @param stats Pointer to store the statistics
+  * @return true if the channels exist and at least one burst pair was measured
+  */
+ bool getPulsePairStats(uint8_t a, uint8_t b, PulsePairStats_t *stats);
+ 
+ /**
+  * Measure the frequency of a continuous signal on a channel (blocks for the gate time)
+  * Counts rising edges of the result-driving backend, independent of burst detection
+  * @param channel Channel to measure
+  * @param gateMs Gate time in milliseconds
+  * @param measurement Pointer to store the measurement
+  * @return true if at least one whole period was seen
+  */
+ bool measurePulseFrequency(uint8_t channel, uint32_t gateMs, PulseFrequencyMeasurement_t *measurement);
+ 
+ /**
+  * Number of channels being monitored
+  */
+ uint8_t getPulseChannelCount();
  
  /**
   * Stop the pulse burst monitoring task
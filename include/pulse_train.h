@@ -0,0 +1,67 @@
+/*
+ * Pulse Train Compiler Header
+ * Turns a pulse train pattern (pulses per burst, pulse width, pulse period,
+ * gap between bursts) into RMT symbols: each symbol holds two level and
+ * duration pairs, durations 15 bits of RMT ticks. Durations longer than
+ * that are split over several halves at the same level, so gaps of seconds
+ * need no software timing. Short bursts are repeated within one
+ * transmission, so the sequencer restarts the RMT at most once per
+ * minimum write time. Plain C++ so patterns can be checked on a Linux host.
+ */
+ 
+ #ifndef PULSE_TRAIN_H
+ #define PULSE_TRAIN_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ 
+ // Longest duration of one symbol half, in ticks
+ #define PULSE_TRAIN_MAX_HALF_TICKS 0x7FFF
+ 
+ // A pulse train: bursts of equal pulses, a low gap after each
+ typedef struct {
+   uint16_t pulsesPerBurst;     // Pulses in each burst (0 = output stopped)
+   uint32_t pulseWidthNs;       // High time of each pulse
+   uint32_t pulsePeriodNs;      // Rising edge to rising edge within a burst (> pulseWidthNs if more than one pulse)
+   uint32_t burstGapNs;         // Low time from the last falling edge of a burst to the next burst
+ } PulseTrainPattern_t;
+ 
+ // One RMT symbol, laid out as the driver's rmt_item32_t
+ typedef union {
+   struct {
+     uint32_t duration0 : 15;
+     uint32_t level0 : 1;
+     uint32_t duration1 : 15;
+     uint32_t level1 : 1;
+   };
+   uint32_t val;
+ } PulseTrainSymbol_t;
+ 
+ /**
+  * Convert a duration to ticks, rounded to the nearest and at least one
+  * @param ns Duration in nanoseconds
+  * @param tickNs Tick length in nanoseconds
+  */
+ uint32_t pulseTrainTicks(uint32_t ns, uint32_t tickNs);
+ 
+ /**
+  * Compile a pattern into RMT symbols
+  * Whole bursts are repeated until the symbols last at least minTicks or the
+  * next burst would not fit; pass symbols as NULL to only count them
+  * @param pattern Pattern to compile (pulsesPerBurst >= 1)
+  * @param tickNs RMT tick length in nanoseconds
+  * @param minTicks Shortest transmission wanted, in ticks (0 = one burst)
+  * @param symbols Symbols to fill, or NULL
+  * @param capacity Number of symbols available
+  * @param bursts Set to the number of bursts compiled (may be NULL)
+  * @return Number of symbols, 0 if the pattern is invalid or one burst does not fit
+  */
+ size_t pulseTrainCompile(const PulseTrainPattern_t *pattern, uint32_t tickNs, uint64_t minTicks,
+                          PulseTrainSymbol_t *symbols, size_t capacity, uint16_t *bursts);
+ 
+ /**
+  * Total duration of compiled symbols, in ticks
+  */
+ uint64_t pulseTrainDurationTicks(const PulseTrainSymbol_t *symbols, size_t count);
+ 
+ #endif // PULSE_TRAIN_H
\ No newline at end of file
@@ -0,0 +1,54 @@
+/*
+ * Sample Codec Header
+ * Lossless compression for blocks of 12-bit AD7495 samples.
+ *
+ * Samples are delta coded, zig-zag mapped to unsigned values and Rice coded
+ * in partitions of SAMPLE_CODEC_PARTITION values. Each partition starts with
+ * a 4-bit mode: a Rice parameter (0-12), an all-zero run (a flat baseline
+ * costs 4 bits per partition) or verbatim 13-bit values for noise bursts.
+ */
+ 
+ #ifndef SAMPLE_CODEC_H
+ #define SAMPLE_CODEC_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ 
+ // Number of deltas sharing one mode nibble
+ #define SAMPLE_CODEC_PARTITION 16
+ 
+ // Partition modes (values 0..SAMPLE_CODEC_MAX_RICE_K are Rice parameters)
+ #define SAMPLE_CODEC_MAX_RICE_K    12
+ #define SAMPLE_CODEC_MODE_VERBATIM 14
+ #define SAMPLE_CODEC_MODE_ZERO_RUN 15
+ 
+ // Sample width and zig-zag delta width
+ #define SAMPLE_CODEC_SAMPLE_BITS 12
+ #define SAMPLE_CODEC_DELTA_BITS  13
+ 
+ // Worst case encoded size: first sample, every partition verbatim, rounded up to whole bytes
+ #define SAMPLE_CODEC_MAX_BYTES(n) \
+   ((SAMPLE_CODEC_SAMPLE_BITS + (((n) + SAMPLE_CODEC_PARTITION - 1) / SAMPLE_CODEC_PARTITION) * 4 + \
+     (n) * SAMPLE_CODEC_DELTA_BITS + 7) / 8)
+ 
+ /**
+  * Compress a block of 12-bit samples
+  * @param samples Input samples (only the low 12 bits are used)
+  * @param count Number of samples
+  * @param out Output buffer
+  * @param outSize Size of the output buffer
+  * @return Number of bytes written, or 0 if the output does not fit
+  */
+ size_t sampleCodecEncode(const uint16_t *samples, size_t count, uint8_t *out, size_t outSize);
+ 
+ /**
+  * Decompress a block produced by sampleCodecEncode
+  * @param in Encoded bytes
+  * @param len Number of encoded bytes
+  * @param samples Output samples
+  * @param count Number of samples to decode (must match the encoded count)
+  * @return true if the block decoded cleanly
+  */
+ bool sampleCodecDecode(const uint8_t *in, size_t len, uint16_t *samples, size_t count);
+ 
+ #endif // SAMPLE_CODEC_H
\ No newline at end of file
@@ -0,0 +1,80 @@
+/*
+ * Sample Stream Module Header
+ * Streams completed ADC blocks as binary frames over the USB CDC serial link,
+ * replacing the one-line-per-sample serial plotter dump
+ */
+ 
+ #ifndef SAMPLE_STREAM_H
+ #define SAMPLE_STREAM_H
+ 
+ #include <Arduino.h>
+ #include "freertos/FreeRTOS.h"
+ #include "sample_stream_format.h"
+ 
+ // Blocks the writer task may lag behind; each one holds a shared pool block
+ #define SAMPLE_STREAM_QUEUE_BLOCKS 64
+ 
+ // Bytes of encoded STATS frames buffered between the ADC consumer and the writer task
+ #define SAMPLE_STREAM_BUFFER_BYTES 2048
+ 
+ // Data structure for stream statistics
+ typedef struct {
+   bool enabled;                // Whether frames are being produced
+   uint32_t framesSent;         // Frames written to the port
+   uint32_t framesDropped;      // Frames discarded because the port could not keep up
+   uint32_t bytesSent;          // Wire bytes written (after COBS encoding)
+   uint32_t rawBytes;           // Bytes the same samples would take as RAW16 payloads
+ } SampleStreamStats_t;
+ 
+ /**
+  * Initialize the sample stream module and register it as an ADC block consumer
+  * Must be called before ADC capture is started
+  * @param port Output port (Serial is the USB CDC link with ARDUINO_USB_CDC_ON_BOOT)
+  * @return true if initialization was successful
+  */
+ bool initSampleStreamModule(Print &port);
+ 
+ /**
+  * Create the stream writer task
+  * @return true if task creation was successful
+  */
+ bool createSampleStreamTask();
+ 
+ /**
+  * Enable or disable binary streaming (off until enabled, here or with the "stream" command)
+  * @param enable true to emit a frame for every ADC block
+  */
+ void setSampleStreamEnabled(bool enable);
+ 
+ /**
+  * Enable or disable lossless compression of the frame payloads
+  * @param enable true to send RICE12 frames when they are smaller than RAW16
+  */
+ void setSampleStreamCompression(bool enable);
+ 
+ /**
+  * Queue a STATS frame on the stream (call from the ADC consumer task only,
+  * the frame shares the sequence numbering with the block frames)
+  * @param summary Interval summary
+  * @param timestampUs Time of the first sample of the interval
+  * @param firstSample Sample index of the first sample of the interval
+  * @param sampleRateHz Sample rate of the interval
+  * @return true if the frame was queued
+  */
+ bool sampleStreamSendStats(const AdcStatsSummary_t *summary, uint32_t timestampUs,
+                            uint64_t firstSample, uint32_t sampleRateHz);
+ 
+ /**
+  * Read the stream statistics
+  * @param stats Pointer to store the statistics
+  * @return true if the statistics were read
+  */
+ bool getSampleStreamStats(SampleStreamStats_t *stats);
+ 
+ /**
+  * Register the "stream" command on the serial command channel
+  * @return true if registered
+  */
+ bool registerSampleStreamCommands();
+ 
+ #endif // SAMPLE_STREAM_H
\ No newline at end of file
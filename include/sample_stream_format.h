@@ -0,0 +1,188 @@
+/*
+ * Sample Stream Format Header
+ * Wire format for binary ADC sample streaming, shared by the device encoder
+ * and the host-side decoder. Frames are CRC-protected, COBS-encoded and
+ * wrapped in 0x00 delimiters, so a reader can resynchronize on any zero
+ * byte (stray text on the same port is flushed or rejected by the CRC).
+ */
+ 
+ #ifndef SAMPLE_STREAM_FORMAT_H
+ #define SAMPLE_STREAM_FORMAT_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ #include "adc_stats.h"
+ 
+ // Format version carried in every frame
+ #define SAMPLE_STREAM_VERSION 1
+ 
+ // Frame types
+ #define SAMPLE_STREAM_TYPE_RAW16 0x01  // Payload is little-endian uint16 samples
+ #define SAMPLE_STREAM_TYPE_RICE12 0x02 // Payload is a sample_codec block (delta + Rice)
+ #define SAMPLE_STREAM_TYPE_STATS  0x03 // Payload is an interval summary, sampleCount is 0
+ 
+ // Frame delimiter (never appears inside a COBS-encoded frame)
+ #define SAMPLE_STREAM_DELIMITER 0x00
+ 
+ // Size limits
+ #define SAMPLE_STREAM_MAX_SAMPLES 1024
+ #define SAMPLE_STREAM_HEADER_SIZE 24
+ #define SAMPLE_STREAM_CRC_SIZE    2
+ #define SAMPLE_STREAM_MAX_PAYLOAD (SAMPLE_STREAM_MAX_SAMPLES * 2)
+ #define SAMPLE_STREAM_MAX_FRAME   (SAMPLE_STREAM_HEADER_SIZE + SAMPLE_STREAM_MAX_PAYLOAD + SAMPLE_STREAM_CRC_SIZE)
+ 
+ // STATS payload: sample count, six 16-bit values, then the histogram
+ #define SAMPLE_STREAM_STATS_PAYLOAD (4 + 6 * 2 + ADC_STATS_HISTOGRAM_BINS * 4)
+ 
+ // Worst-case COBS output: one overhead byte per 254 data bytes, plus the delimiter
+ #define SAMPLE_STREAM_COBS_SIZE(n) ((n) + ((n) / 254) + 2)
+ // Wire frames also carry a leading delimiter
+ #define SAMPLE_STREAM_MAX_WIRE     (SAMPLE_STREAM_COBS_SIZE(SAMPLE_STREAM_MAX_FRAME) + 1)
+ 
+ // Frame header (serialized little-endian, 24 bytes)
+ typedef struct {
+   uint8_t version;             // SAMPLE_STREAM_VERSION
+   uint8_t type;                // SAMPLE_STREAM_TYPE_*
+   uint16_t sampleCount;        // Number of samples in the payload
+   uint32_t sequence;           // Frame sequence number, gaps mean frames were dropped
+   uint32_t sampleRateHz;       // Sample rate of the payload
+   uint32_t timestampUs;        // Device time of the first sample
+   uint64_t firstSample;        // Sample index of the first sample since capture start
+ } SampleStreamHeader_t;
+ 
+ /**
+  * Compute CRC-16/CCITT-FALSE
+  * @param data Bytes to checksum
+  * @param len Number of bytes
+  * @return CRC value
+  */
+ uint16_t sampleStreamCrc16(const uint8_t *data, size_t len);
+ 
+ /**
+  * COBS-encode a buffer and append the frame delimiter
+  * @param in Raw bytes
+  * @param len Number of raw bytes
+  * @param out Output buffer, at least SAMPLE_STREAM_COBS_SIZE(len) bytes
+  * @return Number of bytes written including the delimiter
+  */
+ size_t cobsEncode(const uint8_t *in, size_t len, uint8_t *out);
+ 
+ /**
+  * Decode one COBS frame (without its delimiter)
+  * @param in Encoded bytes
+  * @param len Number of encoded bytes
+  * @param out Output buffer, at least len bytes
+  * @return Number of decoded bytes, or 0 if the encoding is invalid
+  */
+ size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out);
+ 
+ /**
+  * Build a raw (not yet COBS-encoded) frame: header, payload and CRC
+  * @param header Frame header
+  * @param payload Payload bytes
+  * @param payloadLen Number of payload bytes
+  * @param out Output buffer
+  * @param outSize Size of the output buffer
+  * @return Number of bytes written, or 0 if the frame does not fit
+  */
+ size_t sampleStreamBuildFrame(const SampleStreamHeader_t *header,
+                               const uint8_t *payload, size_t payloadLen,
+                               uint8_t *out, size_t outSize);
+ 
+ /**
+  * Build a wire-ready RAW16 frame (COBS-encoded, delimiter on both sides)
+  * @param header Frame header (type and sampleCount are filled in)
+  * @param samples Samples to send
+  * @param count Number of samples (at most SAMPLE_STREAM_MAX_SAMPLES)
+  * @param scratch Scratch buffer of SAMPLE_STREAM_MAX_FRAME bytes
+  * @param out Output buffer of SAMPLE_STREAM_MAX_WIRE bytes
+  * @return Number of bytes to transmit, or 0 on error
+  */
+ size_t sampleStreamEncodeRaw16(SampleStreamHeader_t *header,
+                                const uint16_t *samples, uint16_t count,
+                                uint8_t *scratch, uint8_t *out);
+ 
+ /**
+  * Build a wire-ready frame, compressed with the sample codec when that is smaller
+  * Falls back to RAW16 when compression does not pay off (e.g. white noise)
+  * @param header Frame header (type and sampleCount are filled in)
+  * @param samples Samples to send (12-bit)
+  * @param count Number of samples (at most SAMPLE_STREAM_MAX_SAMPLES)
+  * @param scratch Scratch buffer of SAMPLE_STREAM_MAX_FRAME bytes
+  * @param out Output buffer of SAMPLE_STREAM_MAX_WIRE bytes
+  * @return Number of bytes to transmit, or 0 on error
+  */
+ size_t sampleStreamEncodeCompressed(SampleStreamHeader_t *header,
+                                     const uint16_t *samples, uint16_t count,
+                                     uint8_t *scratch, uint8_t *out);
+ 
+ /**
+  * Build a wire-ready STATS frame carrying an interval summary
+  * @param header Frame header (type and sampleCount are filled in; firstSample and
+  *               timestampUs describe the start of the interval)
+  * @param summary Interval summary
+  * @param scratch Scratch buffer of SAMPLE_STREAM_MAX_FRAME bytes
+  * @param out Output buffer of SAMPLE_STREAM_MAX_WIRE bytes
+  * @return Number of bytes to transmit, or 0 on error
+  */
+ size_t sampleStreamEncodeStats(SampleStreamHeader_t *header, const AdcStatsSummary_t *summary,
+                                uint8_t *scratch, uint8_t *out);
+ 
+ /**
+  * Unpack the payload of a STATS frame
+  * @param payload Payload bytes
+  * @param len Payload length
+  * @param summary Filled with the summary
+  * @return true if the payload has the expected size
+  */
+ bool sampleStreamParseStats(const uint8_t *payload, size_t len, AdcStatsSummary_t *summary);
+ 
+ /**
+  * Validate a decoded frame and split it into header and payload
+  * @param frame Decoded frame bytes
+  * @param len Number of bytes
+  * @param header Filled with the parsed header
+  * @param payload Set to the start of the payload inside frame
+  * @param payloadLen Set to the payload length
+  * @return true if the CRC and header are valid
+  */
+ bool sampleStreamParseFrame(const uint8_t *frame, size_t len, SampleStreamHeader_t *header,
+                             const uint8_t **payload, size_t *payloadLen);
+ 
+ /**
+  * Incremental stream decoder - feed it bytes as they arrive
+  */
+ class SampleStreamDecoder {
+   public:
+     SampleStreamDecoder();
+ 
+     /**
+      * Feed one byte from the stream
+      * @return true when a complete valid frame is available via header()/payload()
+      */
+     bool feed(uint8_t byte);
+ 
+     const SampleStreamHeader_t &header() const { return _header; }
+     const uint8_t *payload() const { return _payload; }
+     size_t payloadLength() const { return _payloadLen; }
+ 
+     uint32_t framesDecoded() const { return _framesDecoded; }
+     uint32_t framesRejected() const { return _framesRejected; }
+     uint32_t framesLost() const { return _framesLost; }
+ 
+   private:
+     uint8_t _encoded[SAMPLE_STREAM_MAX_WIRE];
+     uint8_t _decoded[SAMPLE_STREAM_MAX_WIRE];
+     size_t _encodedLen;
+     bool _overflow;
+     SampleStreamHeader_t _header;
+     const uint8_t *_payload;
+     size_t _payloadLen;
+     bool _haveSequence;
+     uint32_t _nextSequence;
+     uint32_t _framesDecoded;
+     uint32_t _framesRejected;
+     uint32_t _framesLost;
+ };
+ 
+ #endif // SAMPLE_STREAM_FORMAT_H
\ No newline at end of file
@@ -0,0 +1,106 @@
+/*
+ * Scope Capture Module Header
+ * Triggered ADC capture with pre-trigger history. Runs the trigger state
+ * machine on every ADC block and can be fired by external events such as
+ * the start of a pulse burst or a change of ELEC_SHDN.
+ */
+ 
+ #ifndef SCOPE_CAPTURE_H
+ #define SCOPE_CAPTURE_H
+ 
+ #include <Arduino.h>
+ #include "freertos/FreeRTOS.h"
+ #include "freertos/task.h"
+ #include "adc_trigger.h"
+ #include "adc_capture.h"
+ 
+ // Longest window in samples (pre + post of any configuration)
+ #define SCOPE_CAPTURE_MAX_SAMPLES 8192
+ 
+ // Shared ADC blocks held for the longest window; the scope keeps its history
+ // by reference when the block pool has room for four times this many
+ #define SCOPE_CAPTURE_HELD_BLOCKS (SCOPE_CAPTURE_MAX_SAMPLES / ADC_CAPTURE_BLOCK_SAMPLES + 2)
+ 
+ // External event sources (bitmask)
+ #define SCOPE_EVENT_BURST_START 0x01  // First edge of a pulse burst
+ #define SCOPE_EVENT_ELEC_SHDN   0x02  // ELEC_SHDN output changed
+ #define SCOPE_EVENT_MANUAL      0x04  // scopeExternalEvent() called by the application
+ 
+ // Default trigger: rising edge through mid-scale, 1/4 pre-trigger
+ #define SCOPE_DEFAULT_LEVEL        2048
+ #define SCOPE_DEFAULT_HYSTERESIS   32
+ #define SCOPE_DEFAULT_PRE_SAMPLES  1024
+ #define SCOPE_DEFAULT_POST_SAMPLES 3072
+ 
+ // Scope configuration
+ typedef struct {
+   AdcTriggerConfig_t trigger;  // Level/slope/source and window geometry
+   uint8_t externalEvents;      // SCOPE_EVENT_* sources that fire the trigger
+ } ScopeCaptureConfig_t;
+ 
+ // Description of a completed capture
+ typedef struct {
+   AdcTriggerWindow_t window;   // Sample indices of the window
+   uint32_t triggerTimeUs;      // Time of the trigger sample (micros() base)
+   uint32_t sampleRateHz;       // Sample rate of the window
+   uint8_t eventSource;         // SCOPE_EVENT_* that fired the trigger, 0 for the level
+   uint32_t captureNumber;      // Incremented for every completed capture
+ } ScopeCaptureInfo_t;
+ 
+ /**
+  * Initialize the scope module and register it as an ADC block consumer
+  * Must be called before ADC capture is started
+  * @return true if initialization was successful
+  */
+ bool initScopeCaptureModule();
+ 
+ /**
+  * Set the trigger configuration (disarms the scope)
+  * @param config New configuration
+  * @return true if the configuration is valid
+  */
+ bool configureScopeCapture(const ScopeCaptureConfig_t *config);
+ 
+ /**
+  * Arm a single capture; the ADC must be running for it to complete
+  * The history buffer is reused, so read the previous capture before re-arming
+  * @return true if the scope was armed
+  */
+ bool armScopeCapture();
+ 
+ /**
+  * Cancel a pending capture
+  */
+ void disarmScopeCapture();
+ 
+ /**
+  * Report an external trigger event (callable from ISRs and tasks)
+  * @param source SCOPE_EVENT_* source of the event
+  * @param timeUs micros() timestamp of the event
+  */
+ void scopeExternalEvent(uint8_t source, uint32_t timeUs);
+ 
+ /**
+  * Wait for a capture to complete
+  * @param info Filled with the capture description
+  * @param timeout Maximum time to wait
+  * @return true if a capture completed
+  */
+ bool waitForScopeCapture(ScopeCaptureInfo_t *info, TickType_t timeout);
+ 
+ /**
+  * Notify a task whenever a capture completes, in addition to the result queue
+  * @param task Task to notify (NULL to stop notifying)
+  * @param bits Notification value bits set in the task (eSetBits)
+  */
+ void setScopeCaptureNotify(TaskHandle_t task, uint32_t bits);
+ 
+ /**
+  * Copy the samples of the last completed capture
+  * @param out Destination buffer
+  * @param maxSamples Size of the destination
+  * @return Number of samples copied (0 if no capture is available)
+  */
+ uint32_t readScopeCapture(uint16_t *out, uint32_t maxSamples);
+ 
+ #endif // SCOPE_CAPTURE_H
\ No newline at end of file
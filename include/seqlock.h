@@ -0,0 +1,101 @@
+/*
+ * Seqlock Header
+ * Latest-value publication for one writer and any number of readers, such
+ * as a task's most recent status. Neither side blocks or makes a kernel
+ * call: the writer fills the slot readers are not directed to and then
+ * flips a sequence counter; a reader copies the current slot and retries
+ * only if the writer has since come back round to that slot. With two slots
+ * a reader that preempts the writer mid-update still reads the previous
+ * value at once instead of spinning. Header-only template, plain C++ so it
+ * can be stress-tested on a Linux host.
+ */
+ 
+ #ifndef SEQLOCK_H
+ #define SEQLOCK_H
+ 
+ #include <stdint.h>
+ #include <string.h>
+ #include <atomic>
+ #include <type_traits>
+ 
+ template <typename T>
+ class Seqlock {
+   static_assert(std::is_trivially_copyable<T>::value, "published values are copied bytewise");
+ 
+   public:
+     Seqlock() : _sequence(0) {}
+ 
+     /**
+      * Publish a value (single writer)
+      * @param value Value to copy in
+      */
+     void write(const T &value) {
+       // Odd while writing; the slot being written is the one after the latest
+       uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+       _sequence.store(sequence + 1, std::memory_order_relaxed);
+       std::atomic_thread_fence(std::memory_order_release);
+       memcpy(&_slots[((sequence >> 1) + 1) & 1], &value, sizeof(T));
+       _sequence.store(sequence + 2, std::memory_order_release);
+     }
+ 
+     /**
+      * Copy the latest value (any number of readers, never blocks the writer)
+      * @param value Filled with the latest value
+      * @return false if nothing has been published yet
+      */
+     bool read(T *value) const {
+       uint32_t version;
+       return read(value, &version);
+     }
+ 
+     /**
+      * Copy the latest value and its version
+      * @param value Filled with the latest value
+      * @param version Set to the number of values published up to this one
+      * @return false if nothing has been published yet
+      */
+     bool read(T *value, uint32_t *version) const {
+       while (true) {
+         uint32_t before = _sequence.load(std::memory_order_acquire);
+         uint32_t latest = before >> 1;
+         if (latest == 0) {
+           return false;
+         }
+         memcpy(value, &_slots[latest & 1], sizeof(T));
+         std::atomic_thread_fence(std::memory_order_acquire);
+ 
+         // The slot is reused once the write after next starts, which makes the sequence latest * 2 + 3
+         uint32_t after = _sequence.load(std::memory_order_relaxed);
+         if (after - (latest << 1) < 3) {
+           *version = latest;
+           return true;
+         }
+       }
+     }
+ 
+     /**
+      * Copy the latest value if it is newer than one already seen
+      * @param value Filled with the latest value
+      * @param seen Version last seen by this reader, advanced when a newer value is returned
+      * @return true if a newer value was copied
+      */
+     bool readNewer(T *value, uint32_t *seen) const {
+       if ((_sequence.load(std::memory_order_acquire) >> 1) == *seen) {
+         return false;
+       }
+       return read(value, seen);
+     }
+ 
+     /**
+      * Number of values published so far
+      */
+     uint32_t version() const {
+       return _sequence.load(std::memory_order_acquire) >> 1;
+     }
+ 
+   private:
+     T _slots[2];
+     std::atomic<uint32_t> _sequence;  // Twice the published count, plus one while writing
+ };
+ 
+ #endif // SEQLOCK_H
\ No newline at end of file
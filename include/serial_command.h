@@ -0,0 +1,89 @@
+/*
+ * Serial Command Module Header
+ * Line-based text commands on the USB CDC link, alongside the binary sample
+ * stream going the other way. A line is a command name followed by
+ * whitespace-separated arguments, usually key=value pairs. Modules register
+ * their own commands; replies are single text lines starting with OK or ERR.
+ */
+ 
+ #ifndef SERIAL_COMMAND_H
+ #define SERIAL_COMMAND_H
+ 
+ #include <Arduino.h>
+ #include "freertos/FreeRTOS.h"
+ #include "freertos/task.h"
+ 
+ // Longest accepted command line (longer lines are discarded)
+ #define SERIAL_COMMAND_LINE_LENGTH 160
+ 
+ // Maximum number of arguments after the command name
+ #define SERIAL_COMMAND_MAX_ARGS 12
+ 
+ // Maximum number of registered commands
+ #define SERIAL_COMMAND_MAX_COMMANDS 8
+ 
+ // Command task
+ #define SERIAL_COMMAND_TASK_STACK    4096
+ #define SERIAL_COMMAND_TASK_PRIORITY 1
+ 
+ // Input poll interval; the task also wakes on command event notifications
+ #define SERIAL_COMMAND_POLL_MS 20
+ 
+ // Command handler - runs in the command task, writes its reply to out
+ typedef bool (*SerialCommandHandler_t)(int argc, char *argv[], Print &out);
+ 
+ // Event printer - runs in the command task when the command's event bit is notified
+ typedef void (*SerialCommandEvent_t)(Print &out);
+ 
+ /**
+  * Initialize the serial command module
+  * @param port Command port (Serial is the USB CDC link with ARDUINO_USB_CDC_ON_BOOT)
+  * @return true if initialization was successful
+  */
+ bool initSerialCommandModule(Stream &port);
+ 
+ /**
+  * Register a command
+  * Call before createSerialCommandTask()
+  * @param name Command name (first word of the line)
+  * @param help One-line usage shown by the help command
+  * @param handler Called with the remaining words of the line
+  * @param onEvent Optional printer for asynchronous output, such as completions
+  * @param eventBit Set to the notification bit that runs onEvent (when onEvent is given)
+  * @return true if the command was registered
+  */
+ bool registerSerialCommand(const char *name, const char *help, SerialCommandHandler_t handler,
+                            SerialCommandEvent_t onEvent = NULL, uint32_t *eventBit = NULL);
+ 
+ /**
+  * Create the command task
+  * @return true if task creation was successful
+  */
+ bool createSerialCommandTask();
+ 
+ /**
+  * Handle of the command task, the target for event bit notifications
+  * @return Task handle (NULL before the task is created)
+  */
+ TaskHandle_t getSerialCommandTask();
+ 
+ /**
+  * Find a key=value argument
+  * @param argc Argument count passed to the handler
+  * @param argv Arguments passed to the handler
+  * @param key Key to look for
+  * @return Pointer to the value, or NULL if the key is absent
+  */
+ const char *serialCommandValue(int argc, char *argv[], const char *key);
+ 
+ /**
+  * Parse an unsigned key=value argument
+  * @param argc Argument count passed to the handler
+  * @param argv Arguments passed to the handler
+  * @param key Key to look for
+  * @param value Left unchanged if the key is absent
+  * @return false if the key is present but the value is not a number
+  */
+ bool serialCommandNumber(int argc, char *argv[], const char *key, uint32_t *value);
+ 
+ #endif // SERIAL_COMMAND_H
\ No newline at end of file
@@ -0,0 +1,225 @@
+/*
+ * Shared Block Pool Header
+ * Fixed pool of equally sized sample blocks. A single producer fills each
+ * block once, then any number of holders share it read-only by reference.
+ * Every block carries a reference count and goes back to the pool when the
+ * last holder releases it, so a consumer that needs a block after its
+ * callback returns keeps a reference instead of copying the samples.
+ *
+ * The producer takes free blocks in any order, so a block that is held for
+ * a long time only takes itself out of circulation. Header-only template,
+ * plain C++ so it can be exercised on a Linux host.
+ */
+ 
+ #ifndef SHARED_BLOCK_POOL_H
+ #define SHARED_BLOCK_POOL_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ #include <atomic>
+ 
+ template <typename T, uint16_t MAX_BLOCKS>
+ class SharedBlockPool {
+   public:
+     // Read-only view of a committed block
+     struct Descriptor {
+       const T *data;             // First sample of the block
+       uint16_t count;            // Valid samples in the block
+       uint16_t slot;             // Block number inside the pool
+       uint32_t sequence;         // Commit order, starting at 0
+       uint64_t firstIndex;       // Stream index of data[0] (producer defined)
+     };
+ 
+     SharedBlockPool()
+       : _storage(NULL), _blockLength(0), _numBlocks(0), _cursor(0), _nextSequence(0) {
+       for (uint16_t i = 0; i < MAX_BLOCKS; i++) {
+         _refs[i].store(0, std::memory_order_relaxed);
+       }
+     }
+ 
+     /**
+      * Attach the block storage and mark every block free
+      * Only call while no block is held
+      * @param storage Buffer of at least blockLength * numBlocks elements
+      * @param blockLength Elements per block
+      * @param numBlocks Number of blocks (1 - MAX_BLOCKS)
+      * @return true if the configuration is valid
+      */
+     bool begin(T *storage, uint16_t blockLength, uint16_t numBlocks) {
+       if (storage == NULL || blockLength == 0 || numBlocks == 0 || numBlocks > MAX_BLOCKS) {
+         return false;
+       }
+ 
+       _storage = storage;
+       _blockLength = blockLength;
+       _numBlocks = numBlocks;
+       _cursor = 0;
+       _nextSequence = 0;
+       for (uint16_t i = 0; i < MAX_BLOCKS; i++) {
+         _refs[i].store(0, std::memory_order_relaxed);
+         _count[i] = 0;
+         _sequence[i] = 0;
+         _firstIndex[i] = 0;
+       }
+       return true;
+     }
+ 
+     /**
+      * Take a free block for filling (producer only)
+      * The producer holds the first reference until commit() or abandon()
+      * @param slot Set to the block number
+      * @return Writable block storage, or NULL if every block is held
+      */
+     T *claim(uint16_t *slot) {
+       if (slot == NULL || _storage == NULL) {
+         return NULL;
+       }
+ 
+       // Only the producer moves a block away from zero references, so a
+       // plain store is enough once a free block has been seen
+       for (uint16_t n = 0; n < _numBlocks; n++) {
+         uint16_t s = _cursor;
+         _cursor = (uint16_t)((_cursor + 1) % _numBlocks);
+         if (_refs[s].load(std::memory_order_acquire) == 0) {
+           _refs[s].store(1, std::memory_order_relaxed);
+           *slot = s;
+           return &_storage[(uint32_t)s * _blockLength];
+         }
+       }
+       return NULL;
+     }
+ 
+     /**
+      * Publish a filled block (producer only)
+      * The producer's reference passes to whoever receives the descriptor
+      * @param slot Block number from claim()
+      * @param count Valid elements in the block (at most blockLength)
+      * @param firstIndex Stream index of the first element
+      * @param descriptor Filled with the block description
+      * @return true if the block was published
+      */
+     bool commit(uint16_t slot, uint16_t count, uint64_t firstIndex, Descriptor *descriptor) {
+       if (slot >= _numBlocks || count > _blockLength || descriptor == NULL) {
+         return false;
+       }
+ 
+       _count[slot] = count;
+       _sequence[slot] = _nextSequence++;
+       _firstIndex[slot] = firstIndex;
+       return describe(slot, descriptor);
+     }
+ 
+     /**
+      * Return a claimed block without publishing it (producer only)
+      * @param slot Block number from claim()
+      */
+     void abandon(uint16_t slot) {
+       release(slot);
+     }
+ 
+     /**
+      * Describe a block the caller holds a reference to
+      * @param slot Block number
+      * @param descriptor Filled with the block description
+      * @return true if the block is held
+      */
+     bool describe(uint16_t slot, Descriptor *descriptor) const {
+       if (slot >= _numBlocks || descriptor == NULL ||
+           _refs[slot].load(std::memory_order_relaxed) == 0) {
+         return false;
+       }
+ 
+       descriptor->data = &_storage[(uint32_t)slot * _blockLength];
+       descriptor->count = _count[slot];
+       descriptor->slot = slot;
+       descriptor->sequence = _sequence[slot];
+       descriptor->firstIndex = _firstIndex[slot];
+       return true;
+     }
+ 
+     /**
+      * Add a reference to a block (the caller must already hold one)
+      * @param slot Block number
+      * @return true if the reference was added
+      */
+     bool retain(uint16_t slot) {
+       if (slot >= _numBlocks) {
+         return false;
+       }
+ 
+       uint32_t previous = _refs[slot].load(std::memory_order_relaxed);
+       while (previous != 0) {
+         if (_refs[slot].compare_exchange_weak(previous, previous + 1, std::memory_order_relaxed)) {
+           return true;
+         }
+       }
+       return false;
+     }
+ 
+     /**
+      * Drop a reference to a block
+      * @param slot Block number
+      * @return true if this was the last reference and the block is free again
+      */
+     bool release(uint16_t slot) {
+       if (slot >= _numBlocks) {
+         return false;
+       }
+ 
+       uint32_t previous = _refs[slot].load(std::memory_order_relaxed);
+       while (previous != 0) {
+         if (_refs[slot].compare_exchange_weak(previous, previous - 1, std::memory_order_acq_rel)) {
+           return previous == 1;
+         }
+       }
+       return false;
+     }
+ 
+     /**
+      * Check that a pointer is the start of a given block
+      * @param data Pointer to test
+      * @param slot Block number
+      * @return true if data is the storage of that block
+      */
+     bool owns(const T *data, uint16_t slot) const {
+       return _storage != NULL && slot < _numBlocks && data == &_storage[(uint32_t)slot * _blockLength];
+     }
+ 
+     /**
+      * Current number of references to a block
+      */
+     uint32_t references(uint16_t slot) const {
+       return (slot < _numBlocks) ? _refs[slot].load(std::memory_order_relaxed) : 0;
+     }
+ 
+     /**
+      * Number of blocks with at least one reference (a snapshot, O(numBlocks))
+      */
+     uint16_t heldBlocks() const {
+       uint16_t held = 0;
+       for (uint16_t i = 0; i < _numBlocks; i++) {
+         if (_refs[i].load(std::memory_order_relaxed) != 0) {
+           held++;
+         }
+       }
+       return held;
+     }
+ 
+     uint16_t blockLength() const { return _blockLength; }
+     uint16_t numBlocks() const { return _numBlocks; }
+ 
+   private:
+     T *_storage;
+     uint16_t _blockLength;
+     uint16_t _numBlocks;
+     uint16_t _cursor;            // Next block the producer looks at
+     uint32_t _nextSequence;
+ 
+     // 32-bit counters so the compare-and-swap is native on the Xtensa cores
+     std::atomic<uint32_t> _refs[MAX_BLOCKS];
+     uint16_t _count[MAX_BLOCKS];
+     uint32_t _sequence[MAX_BLOCKS];
+     uint64_t _firstIndex[MAX_BLOCKS];
+ };
+ 
+ #endif // SHARED_BLOCK_POOL_H
@@ -0,0 +1,178 @@
+/*
+ * Spectrum Analysis Header
+ * Windowed real FFT and a Goertzel filter bank for 12-bit ADC samples.
+ *
+ * The FFT packs the real input into a half-length complex transform,
+ * runs radix-4 stages (plus one radix-2 stage when needed) and unpacks the
+ * result. The stages are ordered so the output lands in plain bit-reversed
+ * order. The ESP32-S3 has a single precision FPU, so the transform runs in
+ * float. Mean removal works on integer sums of the raw codes.
+ *
+ * Amplitudes are scaled so that a sinusoid of peak amplitude A (in ADC
+ * codes) reads A at its bin after the window's coherent gain is removed.
+ * Peak interpolation uses the window's own bin shape to recover the
+ * frequency and amplitude between bins.
+ */
+  
+  #ifndef SPECTRUM_H
+  #define SPECTRUM_H
+  
+  #include <stdint.h>
+  #include <stddef.h>
+  #include "platform_compat.h"
+  
+  // FFT size limits (powers of two)
+  #define SPECTRUM_MIN_FFT 64
+  #define SPECTRUM_MAX_FFT 4096
+  
+  // Goertzel bank size
+  #define GOERTZEL_MAX_BINS 8
+  
+  // Analysis windows
+  typedef enum {
+    SPECTRUM_WINDOW_RECT,            // Best resolution, strong leakage
+    SPECTRUM_WINDOW_HANN,            // General purpose
+    SPECTRUM_WINDOW_BLACKMAN_HARRIS, // 4-term, -92 dB sidelobes for harmonic levels
+    SPECTRUM_WINDOW_FLATTOP          // Amplitude accurate to ~0.01 dB anywhere in a bin
+  } SpectrumWindow_t;
+  
+  // Interpolated spectral line
+  typedef struct {
+    float frequencyHz;           // Interpolated frequency
+    float amplitude;             // Interpolated peak amplitude in ADC codes
+    uint16_t bin;                // Bin holding the local maximum (0 if none found)
+  } SpectrumPeak_t;
+  
+  // Goertzel tone measurement
+  typedef struct {
+    float frequencyHz;           // Frequency the filter is tuned to
+    float amplitude;             // Peak amplitude in ADC codes
+    float phase;                 // Phase in radians at the first sample of the block
+  } GoertzelTone_t;
+  
+  /**
+   * Return the name of a window type
+   * @param window Window type
+   * @return Window name
+   */
+  const char *spectrumWindowName(SpectrumWindow_t window);
+  
+  class SpectrumAnalyzer {
+    public:
+      SpectrumAnalyzer();
+  
+      /**
+       * Set the transform size and window and build the tables
+       * @param size FFT size (power of two, SPECTRUM_MIN_FFT - SPECTRUM_MAX_FFT)
+       * @param window Analysis window
+       * @return true if the configuration is valid
+       */
+      bool begin(uint16_t size, SpectrumWindow_t window);
+  
+      /**
+       * Real FFT in place, without windowing or scaling
+       * @param data size real inputs; on return size/2 + 1 complex bins
+       *             stored as interleaved re, im (size + 2 floats)
+       */
+      void transform(float *data);
+  
+      /**
+       * Remove the mean, window and transform a block of samples
+       * @param samples size 12-bit samples
+       * @param amplitude Output of size/2 + 1 bin amplitudes in ADC codes
+       */
+      void analyze(const uint16_t *samples, float *amplitude);
+  
+      /**
+       * Find the strongest line in a frequency range of an analyze() result
+       * @param amplitude Bin amplitudes from analyze()
+       * @param binHz Bin spacing (sample rate / size)
+       * @param minHz Lowest frequency to search
+       * @param maxHz Highest frequency to search
+       * @param peak Pointer to store the interpolated line
+       * @return true if a local maximum was found in the range
+       */
+      bool findPeak(const float *amplitude, float binHz, float minHz, float maxHz, SpectrumPeak_t *peak) const;
+  
+      uint16_t size() const { return _size; }
+      uint16_t bins() const { return _size / 2 + 1; }
+      SpectrumWindow_t window() const { return _window; }
+  
+    private:
+      void complexTransform(float *data);
+      float twiddleCos(uint32_t k) const { return _cos[k & (_size - 1)]; }
+      float twiddleSin(uint32_t k) const { return _cos[(k - (_size >> 2)) & (_size - 1)]; }
+  
+      float _cos[SPECTRUM_MAX_FFT];          // cos(2 pi k / size), sin taken a quarter turn back
+      float _windowHalf[SPECTRUM_MAX_FFT / 2 + 1]; // Symmetric window, first half
+      float _work[SPECTRUM_MAX_FFT + 2];
+      uint16_t _size;
+      uint8_t _log2Half;                     // log2(size / 2)
+      SpectrumWindow_t _window;
+      float _scale;                          // 2 / sum(window)
+  };
+  
+  class GoertzelBank {
+    public:
+      GoertzelBank();
+  
+      /**
+       * Tune the bank and reset it
+       * @param frequenciesHz Tone frequencies
+       * @param count Number of tones (1 - GOERTZEL_MAX_BINS)
+       * @param sampleRateHz Sample rate of the input
+       * @param blockLength Samples per measurement; a whole number of periods
+       *                    of every tone keeps them free of leakage
+       * @return true if the configuration is valid
+       */
+      bool begin(const float *frequenciesHz, uint8_t count, float sampleRateHz, uint32_t blockLength);
+  
+      /**
+       * Restart the current block
+       */
+      void reset();
+  
+      /**
+       * Feed samples up to the end of the current block
+       * Call in a loop until all samples are consumed, reading the tones
+       * whenever ready() turns true
+       * @param samples 12-bit samples
+       * @param count Number of samples available
+       * @return Number of samples consumed
+       */
+      size_t process(const uint16_t *samples, size_t count);
+  
+      /**
+       * Whether a completed block is waiting to be read
+       */
+      bool ready() const { return _ready; }
+  
+      /**
+       * Read the tones of the completed block and start the next one
+       * @param tones Output array of count() entries
+       * @return true if a completed block was read
+       */
+      bool read(GoertzelTone_t *tones);
+  
+      uint8_t count() const { return _count; }
+      uint32_t blockLength() const { return _blockLength; }
+  
+    private:
+      // Reinsch form: the recursion runs on the difference (or sum) of the
+      // last two states and a coefficient that stays small near 0 and pi,
+      // where the textbook 2cos(w) loses the tone frequency to rounding
+      float _omega[GOERTZEL_MAX_BINS];
+      float _lambda[GOERTZEL_MAX_BINS];    // -4sin^2(w/2) below pi/2, 4cos^2(w/2) above
+      float _state[GOERTZEL_MAX_BINS];     // s[n-1]
+      float _delta[GOERTZEL_MAX_BINS];     // s[n-1] - s[n-2] (or + above pi/2)
+      bool _upper[GOERTZEL_MAX_BINS];      // Tone above a quarter of the sample rate
+      float _frequency[GOERTZEL_MAX_BINS];
+      uint8_t _count;
+      uint32_t _blockLength;
+      uint32_t _filled;
+      int64_t _sum;                // Raw sum of the current block, for the next offset
+      float _offset;               // Mean of the previous block, removed from the input
+      bool _ready;
+  };
+  
+  #endif // SPECTRUM_H
\ No newline at end of file
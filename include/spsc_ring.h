@@ -0,0 +1,84 @@
+/*
+ * SPSC Ring Header
+ * Lock-free ring for one producer and one consumer, typically an ISR
+ * handing events to a task. The producer never blocks: a push into a full
+ * ring fails and the caller counts the loss. Methods are forced inline so
+ * the push runs from the calling ISR's IRAM. Header-only template, plain
+ * C++ so it can be exercised on a Linux host.
+ */
+ 
+ #ifndef SPSC_RING_H
+ #define SPSC_RING_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ #include <atomic>
+ 
+ template <typename T, uint16_t SIZE>
+ class SpscRing {
+   static_assert(SIZE >= 2, "ring needs at least two slots");
+ 
+   public:
+     SpscRing() : _head(0), _tail(0) {}
+ 
+     /**
+      * Append an item (producer only)
+      * @param item Item to copy in
+      * @return false if the ring is full and the item was dropped
+      */
+     __attribute__((always_inline)) inline bool push(const T &item) {
+       uint16_t head = _head.load(std::memory_order_relaxed);
+       uint16_t next = (uint16_t)((head + 1) % SIZE);
+       if (next == _tail.load(std::memory_order_acquire)) {
+         return false;
+       }
+       _items[head] = item;
+       _head.store(next, std::memory_order_release);
+       return true;
+     }
+ 
+     /**
+      * Take the oldest item (consumer only)
+      * @param item Filled with the item
+      * @return false if the ring is empty
+      */
+     __attribute__((always_inline)) inline bool pop(T *item) {
+       uint16_t tail = _tail.load(std::memory_order_relaxed);
+       if (tail == _head.load(std::memory_order_acquire)) {
+         return false;
+       }
+       *item = _items[tail];
+       _tail.store((uint16_t)((tail + 1) % SIZE), std::memory_order_release);
+       return true;
+     }
+ 
+     /**
+      * Drop everything pushed so far (consumer only)
+      */
+     void clear() {
+       _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+     }
+ 
+     /**
+      * Items waiting (exact for the consumer, a lower bound for the producer)
+      */
+     uint16_t size() const {
+       uint16_t head = _head.load(std::memory_order_acquire);
+       uint16_t tail = _tail.load(std::memory_order_acquire);
+       return (uint16_t)((head + SIZE - tail) % SIZE);
+     }
+ 
+     /**
+      * Items the ring can hold (one slot stays empty)
+      */
+     static constexpr uint16_t capacity() {
+       return SIZE - 1;
+     }
+ 
+   private:
+     T _items[SIZE];
+     std::atomic<uint16_t> _head;
+     std::atomic<uint16_t> _tail;
+ };
+ 
+ #endif // SPSC_RING_H
\ No newline at end of file
@@ -0,0 +1,377 @@
+/*
+ * Streaming Statistics Header
+ * Constant-cost running statistics for one value per event (a burst, a
+ * capture): mean and variance by Welford's update, and p50/p99 estimates
+ * by the P-square algorithm, over either the last N values (sliding
+ * window) or an exponentially weighted window of equivalent length N.
+ * RollingMeanQ16 keeps just the mean of Q16.16 values, in integers.
+ * Header-only, plain C++ so it can be checked and benchmarked on a host.
+ */
+ 
+ #ifndef STREAMING_STATS_H
+ #define STREAMING_STATS_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ #include <math.h>
+ 
+ // Window kinds
+ typedef enum {
+   STREAMING_WINDOW_SLIDING,      // The last N values, equally weighted
+   STREAMING_WINDOW_EXPONENTIAL   // All values, weight decaying with alpha = 2 / (N + 1)
+ } StreamingWindow_t;
+ 
+ // P-square estimate of one quantile (Jain and Chlamtac): five markers that
+ // move toward their ideal positions with a parabolic fit, O(1) per value
+ class P2Quantile {
+   public:
+     explicit P2Quantile(float p = 0.5f) : _p(p) { reset(); }
+ 
+     void reset() {
+       _count = 0;
+       for (int i = 0; i < 5; i++) {
+         _n[i] = (float)i;
+       }
+       _np[0] = 0;
+       _np[1] = 2 * _p;
+       _np[2] = 4 * _p;
+       _np[3] = 2 + 2 * _p;
+       _np[4] = 4;
+       _dn[0] = 0;
+       _dn[1] = _p / 2;
+       _dn[2] = _p;
+       _dn[3] = (1 + _p) / 2;
+       _dn[4] = 1;
+     }
+ 
+     void add(float x) {
+       // The first five values are the markers, kept sorted
+       if (_count < 5) {
+         int i = (int)_count++;
+         while (i > 0 && _q[i - 1] > x) {
+           _q[i] = _q[i - 1];
+           i--;
+         }
+         _q[i] = x;
+         return;
+       }
+       _count++;
+ 
+       // Cell of the new value, stretching the extremes
+       int k;
+       if (x < _q[0]) {
+         _q[0] = x;
+         k = 0;
+       } else if (x >= _q[4]) {
+         _q[4] = x;
+         k = 3;
+       } else {
+         k = 0;
+         while (x >= _q[k + 1]) {
+           k++;
+         }
+       }
+       for (int i = k + 1; i < 5; i++) {
+         _n[i] += 1;
+       }
+       for (int i = 0; i < 5; i++) {
+         _np[i] += _dn[i];
+       }
+ 
+       // Move the middle markers that drifted a position or more from ideal
+       for (int i = 1; i <= 3; i++) {
+         float d = _np[i] - _n[i];
+         if ((d >= 1 && _n[i + 1] - _n[i] > 1) || (d <= -1 && _n[i - 1] - _n[i] < -1)) {
+           float s = (d > 0) ? 1.0f : -1.0f;
+           float q = parabolic(i, s);
+           if (!(_q[i - 1] < q && q < _q[i + 1])) {
+             q = linear(i, s);
+           }
+           _q[i] = q;
+           _n[i] += s;
+         }
+       }
+     }
+ 
+     // Current estimate (exact nearest rank below five values, 0 when empty)
+     float value() const {
+       if (_count == 0) {
+         return 0;
+       }
+       if (_count < 5) {
+         return _q[(int)lroundf(_p * (_count - 1))];
+       }
+       return _q[2];
+     }
+ 
+     uint32_t count() const { return _count; }
+ 
+   private:
+     float parabolic(int i, float s) const {
+       return _q[i] + s / (_n[i + 1] - _n[i - 1]) *
+              ((_n[i] - _n[i - 1] + s) * (_q[i + 1] - _q[i]) / (_n[i + 1] - _n[i]) +
+               (_n[i + 1] - _n[i] - s) * (_q[i] - _q[i - 1]) / (_n[i] - _n[i - 1]));
+     }
+ 
+     float linear(int i, float s) const {
+       int j = i + (int)s;
+       return _q[i] + s * (_q[j] - _q[i]) / (_n[j] - _n[i]);
+     }
+ 
+     float _p;
+     float _q[5];                 // Marker heights
+     float _n[5];                 // Marker positions
+     float _np[5];                // Ideal positions
+     float _dn[5];                // Ideal position increments
+     uint32_t _count;
+ };
+ 
+ // Running statistics over a window of up to CAPACITY values. Mean and
+ // variance are exact for the window; the quantiles come from two P-square
+ // estimators restarted every N values half a window apart, the older of
+ // which covers between N/2 and N of the latest values. Accumulators are
+ // double: updates run once per event, not per sample.
+ template <uint16_t CAPACITY>
+ class StreamingStats {
+   static_assert(CAPACITY >= 2, "window needs at least two values");
+ 
+   public:
+     StreamingStats() : _mode(STREAMING_WINDOW_SLIDING), _length(CAPACITY), _alpha(0) {
+       for (int i = 0; i < 2; i++) {
+         _p50[i] = P2Quantile(0.5f);
+         _p99[i] = P2Quantile(0.99f);
+       }
+       reset();
+     }
+ 
+     /**
+      * Set the window and drop all values
+      * @param mode Sliding or exponential window
+      * @param length Values in the window (sliding, at most CAPACITY) or equivalent length (exponential)
+      * @return true if the window is valid
+      */
+     bool configure(StreamingWindow_t mode, uint16_t length) {
+       if (length < 2 || (mode == STREAMING_WINDOW_SLIDING && length > CAPACITY)) {
+         return false;
+       }
+       _mode = mode;
+       _length = length;
+       _alpha = 2.0 / (length + 1);
+       reset();
+       return true;
+     }
+ 
+     /**
+      * Drop all values
+      */
+     void reset() {
+       _count = 0;
+       _total = 0;
+       _next = 0;
+       _mean = 0;
+       _m2 = 0;
+       _min = 0;
+       _max = 0;
+       for (int i = 0; i < 2; i++) {
+         _p50[i].reset();
+         _p99[i].reset();
+       }
+     }
+ 
+     /**
+      * Add a value, O(1)
+      */
+     void add(float x) {
+       if (_total == 0) {
+         _min = _max = x;
+       } else {
+         _min = fminf(_min, x);
+         _max = fmaxf(_max, x);
+       }
+       _total++;
+ 
+       if (_mode == STREAMING_WINDOW_EXPONENTIAL) {
+         // West's exponentially weighted mean and variance, the first value seeds the mean
+         if (_count == 0) {
+           _mean = x;
+           _m2 = 0;
+         } else {
+           double delta = x - _mean;
+           _mean += _alpha * delta;
+           _m2 = (1 - _alpha) * (_m2 + _alpha * delta * delta);
+         }
+         if (_count < _length) {
+           _count++;
+         }
+       } else if (_count < _length) {
+         // Window filling: plain Welford
+         _values[_next] = x;
+         _count++;
+         double delta = x - _mean;
+         _mean += delta / _count;
+         _m2 += delta * (x - _mean);
+       } else {
+         // Window full: replace the oldest value
+         float old = _values[_next];
+         _values[_next] = x;
+         double oldMean = _mean;
+         _mean += ((double)x - old) / _count;
+         _m2 += ((double)x - old) * ((double)x - _mean + old - oldMean);
+         if (_m2 < 0) {
+           _m2 = 0;
+         }
+       }
+       _next = (uint16_t)((_next + 1) % _length);
+ 
+       // Restart each estimator pair every window length, the second half a window after the first
+       for (int i = 0; i < 2; i++) {
+         if ((_total + i * (_length / 2)) % _length == 1) {
+           _p50[i].reset();
+           _p99[i].reset();
+         }
+         _p50[i].add(x);
+         _p99[i].add(x);
+       }
+     }
+ 
+     // Values in the window (the equivalent length once an exponential window has filled)
+     uint16_t count() const { return _count; }
+ 
+     // Values added since the last reset
+     uint32_t total() const { return _total; }
+ 
+     float mean() const { return (float)_mean; }
+ 
+     // Sample variance for a sliding window, weighted variance for an exponential one
+     float variance() const {
+       if (_mode == STREAMING_WINDOW_EXPONENTIAL) {
+         return (float)_m2;
+       }
+       return (_count > 1) ? (float)(_m2 / (_count - 1)) : 0.0f;
+     }
+ 
+     float stddev() const { return sqrtf(variance()); }
+ 
+     // Extremes since the last reset
+     float min() const { return _min; }
+     float max() const { return _max; }
+ 
+     float p50() const { return _p50[older()].value(); }
+     float p99() const { return _p99[older()].value(); }
+ 
+   private:
+     // Estimator that has seen more of the latest values
+     int older() const { return (_p50[0].count() >= _p50[1].count()) ? 0 : 1; }
+ 
+     StreamingWindow_t _mode;
+     uint16_t _length;
+     double _alpha;
+     float _values[CAPACITY];     // Sliding window contents
+     uint16_t _next;
+     uint16_t _count;
+     uint32_t _total;
+     double _mean;
+     double _m2;                  // Sum of squared deviations (sliding) or weighted variance (exponential)
+     float _min;
+     float _max;
+     P2Quantile _p50[2];
+     P2Quantile _p99[2];
+ };
+ 
+ // Running mean of Q16.16 values over the same windows, in integer arithmetic
+ // only, for values whose spread is not needed: bit-exact on device and host
+ // and no floating point on the per-event path.
+ template <uint16_t CAPACITY>
+ class RollingMeanQ16 {
+   static_assert(CAPACITY >= 2, "window needs at least two values");
+ 
+   public:
+     RollingMeanQ16() : _mode(STREAMING_WINDOW_SLIDING), _length(CAPACITY) { reset(); }
+ 
+     /**
+      * Set the window and drop all values
+      * @param mode Sliding or exponential window
+      * @param length Values in the window (sliding, at most CAPACITY) or equivalent length (exponential)
+      * @return true if the window is valid
+      */
+     bool configure(StreamingWindow_t mode, uint16_t length) {
+       if (length < 2 || (mode == STREAMING_WINDOW_SLIDING && length > CAPACITY)) {
+         return false;
+       }
+       _mode = mode;
+       _length = length;
+       reset();
+       return true;
+     }
+ 
+     /**
+      * Drop all values
+      */
+     void reset() {
+       _count = 0;
+       _total = 0;
+       _next = 0;
+       _sum = 0;
+       _meanQ32 = 0;
+     }
+ 
+     /**
+      * Add a value, O(1)
+      */
+     void add(uint32_t x) {
+       _total++;
+ 
+       if (_mode == STREAMING_WINDOW_EXPONENTIAL) {
+         // mean += alpha * (x - mean), alpha = 2 / (N + 1), the mean kept with 16 more fraction bits
+         int64_t xQ32 = (int64_t)x << 16;
+         if (_count == 0) {
+           _meanQ32 = xQ32;
+         } else {
+           int64_t step = 2 * (xQ32 - _meanQ32);
+           int64_t half = (_length + 1) / 2;
+           _meanQ32 += (step >= 0) ? (step + half) / (_length + 1) : -((-step + half) / (_length + 1));
+         }
+         if (_count < _length) {
+           _count++;
+         }
+       } else {
+         if (_count < _length) {
+           _count++;
+         } else {
+           _sum -= _values[_next];
+         }
+         _values[_next] = x;
+         _sum += x;
+         _next = (uint16_t)((_next + 1) % _length);
+       }
+     }
+ 
+     // Values in the window (the equivalent length once an exponential window has filled)
+     uint16_t count() const { return _count; }
+ 
+     // Values added since the last reset
+     uint32_t total() const { return _total; }
+ 
+     // Mean of the window, rounded to the nearest Q16.16 step (0 when empty)
+     uint32_t mean() const {
+       if (_count == 0) {
+         return 0;
+       }
+       if (_mode == STREAMING_WINDOW_EXPONENTIAL) {
+         return (uint32_t)((_meanQ32 + 0x8000) >> 16);
+       }
+       return (uint32_t)((_sum + _count / 2) / _count);
+     }
+ 
+   private:
+     StreamingWindow_t _mode;
+     uint16_t _length;
+     uint32_t _values[CAPACITY];  // Sliding window contents
+     uint16_t _next;
+     uint16_t _count;
+     uint32_t _total;
+     uint64_t _sum;               // Sum of the sliding window
+     int64_t _meanQ32;            // Exponential mean, 32 fraction bits
+ };
+ 
+ #endif // STREAMING_STATS_H
\ No newline at end of file
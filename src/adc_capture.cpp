@@ -0,0 +1,373 @@
+/*
+ * ADC Capture Module Implementation
+ *
+ * The AD7495 starts a conversion on every CS falling edge and needs CS to
+ * return high between frames, so each sample is its own 16-bit SPI frame.
+ * A frame that short lives entirely in the SPI FIFO: the timer ISR collects
+ * the previous frame and kicks the next one directly on the peripheral,
+ * which keeps the sample instants locked to the hardware timer.
+ *
+ * The ISR fills a small ping-pong ring in internal RAM. PSRAM is reached
+ * through the cache, which is off during flash writes while this IRAM ISR
+ * keeps running. The consumer task therefore commits each completed block
+ * to the shared pool once, and every consumer reads it from there.
+ */
+ 
+ #include "adc_capture.h"
+ #include "freertos/task.h"
+ #include "simplified_debug.h"
+ #include <driver/timer.h>
+ #include "hal/spi_ll.h"
+ 
+ // Static variables
+ static SPIClass *spiInstance = NULL;
+ static spi_dev_t *adcSpiHw = NULL;
+ static TaskHandle_t adcTaskHandle = NULL;
+ static bool adcInitialized = false;
+ 
+ // Capture state
+ static AdcCaptureCore captureCore;
+ static uint16_t *sampleStorage = NULL;
+ 
+ // Shared block pool (blocks are committed and released from the consumer task,
+ // retained and released from any task)
+ static AdcBlockPool_t blockPool;
+ static uint16_t *poolStorage = NULL;
+ static bool poolInPsram = false;
+ static volatile uint32_t poolOverruns = 0;
+ static volatile bool captureRunning = false;
+ static volatile bool conversionPending = false;
+ static volatile uint32_t lateConversions = 0;
+ static uint32_t alarmTicks = 0;
+ static uint32_t runStartUs = 0;
+ 
+ // Registered consumers
+ static AdcBlockConsumer_t consumers[ADC_CAPTURE_MAX_CONSUMERS];
+ static void *consumerContexts[ADC_CAPTURE_MAX_CONSUMERS];
+ static uint8_t consumerCount = 0;
+ 
+ // Sample clock ISR - collects the previous conversion and starts the next one
+ static bool IRAM_ATTR adcSampleTimerISR(void *arg) {
+   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+ 
+   if (conversionPending) {
+     // A 16-bit frame at 20 MHz takes under 1 us, so this only trips if the bus was stalled
+     if (!spi_ll_usr_is_done(adcSpiHw)) {
+       lateConversions++;
+       return false;
+     }
+ 
+     uint8_t rx[2];
+     spi_ll_read_buffer(adcSpiHw, rx, 16);
+     uint16_t frame = ((uint16_t)rx[0] << 8) | rx[1];
+ 
+     if (captureCore.pushFrame(frame) && adcTaskHandle != NULL) {
+       vTaskNotifyGiveFromISR(adcTaskHandle, &xHigherPriorityTaskWoken);
+     }
+   }
+ 
+   spi_ll_clear_int_stat(adcSpiHw);
+   spi_ll_user_start(adcSpiHw);
+   conversionPending = true;
+ 
+   return (xHigherPriorityTaskWoken == pdTRUE);
+ }
+ 
+ // ADC consumer task - dispatches completed blocks to the registered consumers
+ static void adcCaptureTask(void *pvParameters) {
+   DEBUG_START_TASK("ADC Capture");
+   Serial.println("ADC Capture Task Started");
+ 
+   AdcBlock_t block;
+   AdcBlockPool_t::Descriptor shared;
+ 
+   while (1) {
+     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+ 
+     while (captureCore.acquireBlock(&block)) {
+       // Move the block out of the ISR ring; if consumers still hold every
+       // pool block it is lost and shows up as a gap in sample indices
+       uint16_t slot;
+       uint16_t *dest = blockPool.claim(&slot);
+       if (dest == NULL) {
+         poolOverruns++;
+         captureCore.releaseBlock(block.index);
+         continue;
+       }
+       memcpy(dest, block.samples, block.count * sizeof(uint16_t));
+       captureCore.releaseBlock(block.index);
+       blockPool.commit(slot, block.count, block.firstSample, &shared);
+ 
+       block.samples = shared.data;
+       block.index = shared.slot;
+ 
+       // Sample instants are exact multiples of the timer period after the start
+       block.timestampUs = runStartUs +
+         (uint32_t)((block.firstSample * alarmTicks) / (ADC_CAPTURE_TIMER_HZ / 1000000));
+       block.sampleRateHz = ADC_CAPTURE_TIMER_HZ / alarmTicks;
+ 
+       for (uint8_t i = 0; i < consumerCount; i++) {
+         consumers[i](&block, consumerContexts[i]);
+       }
+ 
+       // Drop the dispatch reference; retained blocks stay out of circulation
+       blockPool.release(slot);
+     }
+   }
+ 
+   // Should never reach here
+   DEBUG_END_TASK("ADC Capture");
+   vTaskDelete(NULL);
+ }
+ 
+ bool initAdcCaptureModule(SPIClass &spi) {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing ADC Capture module on CS pin %d", ADC_CS_PIN);
+ 
+   // Store the SPI reference; Arduino HSPI is the SPI3 peripheral on the ESP32-S3
+   spiInstance = &spi;
+   adcSpiHw = SPI_LL_GET_HW(SPI3_HOST);
+ 
+   // Keep the ADC deselected until a run attaches the hardware CS
+   pinMode(ADC_CS_PIN, OUTPUT);
+   digitalWrite(ADC_CS_PIN, HIGH);
+ 
+   // Allocate the block ring from DMA-capable internal RAM
+   size_t storageBytes = (size_t)ADC_CAPTURE_BLOCK_SAMPLES * ADC_CAPTURE_NUM_BLOCKS * sizeof(uint16_t);
+   sampleStorage = (uint16_t *)heap_caps_malloc(storageBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   if (sampleStorage == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to allocate ADC sample storage - out of memory");
+     return false;
+   }
+ 
+   if (!captureCore.begin(sampleStorage, ADC_CAPTURE_BLOCK_SAMPLES, ADC_CAPTURE_NUM_BLOCKS)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Invalid ADC block ring configuration");
+     heap_caps_free(sampleStorage);
+     sampleStorage = NULL;
+     return false;
+   }
+ 
+   // Shared pool in PSRAM if the board has it, otherwise a few internal blocks
+   uint16_t poolBlocks = ADC_CAPTURE_POOL_BLOCKS;
+   poolStorage = (uint16_t *)heap_caps_malloc((size_t)poolBlocks * ADC_CAPTURE_BLOCK_SAMPLES * sizeof(uint16_t),
+                                              MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+   poolInPsram = (poolStorage != NULL);
+   if (poolStorage == NULL) {
+     poolBlocks = ADC_CAPTURE_POOL_FALLBACK_BLOCKS;
+     poolStorage = (uint16_t *)heap_caps_malloc((size_t)poolBlocks * ADC_CAPTURE_BLOCK_SAMPLES * sizeof(uint16_t),
+                                                MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   }
+   if (poolStorage == NULL || !blockPool.begin(poolStorage, ADC_CAPTURE_BLOCK_SAMPLES, poolBlocks)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to allocate ADC block pool - out of memory");
+     heap_caps_free(poolStorage);
+     heap_caps_free(sampleStorage);
+     poolStorage = NULL;
+     sampleStorage = NULL;
+     return false;
+   }
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC block pool: %u blocks of %u samples in %s", poolBlocks,
+               ADC_CAPTURE_BLOCK_SAMPLES, poolInPsram ? "PSRAM" : "internal RAM");
+ 
+   // Configure the sample clock (paused until a run starts)
+   timer_config_t config = {};
+   config.alarm_en = TIMER_ALARM_EN;
+   config.counter_en = TIMER_PAUSE;
+   config.intr_type = TIMER_INTR_LEVEL;
+   config.counter_dir = TIMER_COUNT_UP;
+   config.auto_reload = TIMER_AUTORELOAD_EN;
+   config.divider = ADC_CAPTURE_TIMER_DIVIDER;
+ 
+   if (timer_init(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX, &config) != ESP_OK) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to initialize ADC sample timer");
+     heap_caps_free(poolStorage);
+     heap_caps_free(sampleStorage);
+     poolStorage = NULL;
+     sampleStorage = NULL;
+     return false;
+   }
+ 
+   timer_set_counter_value(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX, 0);
+   timer_enable_intr(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX);
+ 
+   // The ISR is allocated on the calling core, keeping it away from the consumer task
+   if (timer_isr_callback_add(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX,
+                              adcSampleTimerISR, NULL, ESP_INTR_FLAG_IRAM) != ESP_OK) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to attach ADC sample timer ISR");
+     timer_deinit(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX);
+     heap_caps_free(poolStorage);
+     heap_caps_free(sampleStorage);
+     poolStorage = NULL;
+     sampleStorage = NULL;
+     return false;
+   }
+ 
+   adcInitialized = true;
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC Capture module initialized successfully");
+   return true;
+ }
+ 
+ bool createAdcCaptureTask() {
+   if (!adcInitialized) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot create ADC Capture task - module not initialized");
+     return false;
+   }
+ 
+   // Don't create if already running
+   if (adcTaskHandle != NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN, "ADC Capture task already running");
+     return true;
+   }
+ 
+   // Consumer task on core 0; the sample ISR lives on core 1 with the setup code
+   BaseType_t result = xTaskCreatePinnedToCore(
+     adcCaptureTask,
+     "ADC Capture",
+     4096,
+     NULL,
+     configMAX_PRIORITIES - 3,  // High priority, below battery and digipot one-shots
+     &adcTaskHandle,
+     0
+   );
+ 
+   if (result != pdPASS) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create ADC Capture task - error code: %d", result);
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC Capture task created successfully");
+   return true;
+ }
+ 
+ bool registerAdcBlockConsumer(AdcBlockConsumer_t consumer, void *context) {
+   if (consumer == NULL || consumerCount >= ADC_CAPTURE_MAX_CONSUMERS) {
+     return false;
+   }
+ 
+   // Consumers can only be added while the engine is idle
+   if (captureRunning) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN, "Cannot register ADC consumer while capture is running");
+     return false;
+   }
+ 
+   consumers[consumerCount] = consumer;
+   consumerContexts[consumerCount] = context;
+   consumerCount++;
+   return true;
+ }
+ 
+ bool retainAdcBlock(const AdcBlock_t *block) {
+   if (block == NULL || !blockPool.owns(block->samples, block->index)) {
+     return false;
+   }
+   return blockPool.retain(block->index);
+ }
+ 
+ void releaseAdcBlock(const AdcBlock_t *block) {
+   if (block == NULL || !blockPool.owns(block->samples, block->index)) {
+     return;
+   }
+   blockPool.release(block->index);
+ }
+ 
+ uint16_t getAdcBlockPoolSize() {
+   return blockPool.numBlocks();
+ }
+ 
+ bool startAdcCapture(uint32_t sampleRateHz) {
+   if (!adcInitialized || adcTaskHandle == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot start ADC capture - module not initialized");
+     return false;
+   }
+ 
+   if (captureRunning) {
+     return true;
+   }
+ 
+   // Constrain sample rate to valid range
+   if (sampleRateHz < ADC_CAPTURE_MIN_SAMPLE_RATE_HZ) sampleRateHz = ADC_CAPTURE_MIN_SAMPLE_RATE_HZ;
+   if (sampleRateHz > ADC_CAPTURE_MAX_SAMPLE_RATE_HZ) sampleRateHz = ADC_CAPTURE_MAX_SAMPLE_RATE_HZ;
+ 
+   // Take the shared bus for the whole run so no other device sees our clocks
+   if (sharedSPIMutex == NULL || xSemaphoreTake(sharedSPIMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN, "Shared SPI bus busy - ADC capture not started");
+     return false;
+   }
+ 
+   // Configure the peripheral for 16-bit frames with hardware CS on the ADC pin
+   spiInstance->beginTransaction(SPISettings(ADC_SPI_CLOCK_HZ, MSBFIRST, SPI_MODE3));
+   spi_t *bus = spiInstance->bus();
+   spiAttachSS(bus, 0, ADC_CS_PIN);
+   spiSSEnable(bus);
+ 
+   // One blocking frame primes the frame length; its result is discarded
+   spiTransferShortNL(bus, 0);
+ 
+   captureCore.reset();
+   lateConversions = 0;
+   poolOverruns = 0;
+   conversionPending = false;
+ 
+   alarmTicks = ADC_CAPTURE_TIMER_HZ / sampleRateHz;
+   timer_set_counter_value(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX, 0);
+   timer_set_alarm_value(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX, alarmTicks);
+ 
+   captureRunning = true;
+   runStartUs = micros();
+   timer_start(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX);
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC capture started at %lu Hz",
+               (unsigned long)(ADC_CAPTURE_TIMER_HZ / alarmTicks));
+   return true;
+ }
+ 
+ bool stopAdcCapture() {
+   if (!captureRunning) {
+     return true;
+   }
+ 
+   timer_pause(ADC_CAPTURE_TIMER_GROUP, ADC_CAPTURE_TIMER_INDEX);
+   captureRunning = false;
+ 
+   // Let any frame kicked by the last tick finish before handing the bus back
+   while (conversionPending && !spi_ll_usr_is_done(adcSpiHw)) {
+   }
+   conversionPending = false;
+ 
+   spi_t *bus = spiInstance->bus();
+   spiSSDisable(bus);
+   spiDetachSS(bus, ADC_CS_PIN);
+   pinMode(ADC_CS_PIN, OUTPUT);
+   digitalWrite(ADC_CS_PIN, HIGH);
+   spiInstance->endTransaction();
+ 
+   xSemaphoreGive(sharedSPIMutex);
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC capture stopped");
+   return true;
+ }
+ 
+ bool isAdcCaptureRunning() {
+   return captureRunning;
+ }
+ 
+ bool getAdcCaptureStats(AdcCaptureStats_t *stats) {
+   if (stats == NULL || !adcInitialized) {
+     return false;
+   }
+ 
+   AdcCaptureCounters_t counters;
+   captureCore.getCounters(&counters);
+ 
+   stats->running = captureRunning;
+   stats->sampleRateHz = (alarmTicks > 0) ? (ADC_CAPTURE_TIMER_HZ / alarmTicks) : 0;
+   stats->samplesCaptured = counters.samplesCaptured;
+   stats->blocksCompleted = counters.blocksCompleted;
+   stats->droppedSamples = counters.droppedSamples;
+   stats->overruns = counters.overruns;
+   stats->framingErrors = counters.framingErrors;
+   stats->lateConversions = lateConversions;
+   stats->poolBlocks = blockPool.numBlocks();
+   stats->poolHeld = blockPool.heldBlocks();
+   stats->poolOverruns = poolOverruns;
+   stats->poolInPsram = poolInPsram;
+   return true;
+ }
\ No newline at end of file
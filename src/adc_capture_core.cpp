@@ -0,0 +1,144 @@
+/*
+ * ADC Capture Core Implementation
+ */
+ 
+ #include "adc_capture_core.h"
+ 
+ AdcCaptureCore::AdcCaptureCore()
+   : _storage(NULL), _blockSamples(0), _numBlocks(0),
+     _writeBlock(0), _writePos(0), _dropping(false), _nextSequence(0), _sampleIndex(0),
+     _samplesCaptured(0), _blocksCompleted(0), _droppedSamples(0), _overruns(0), _framingErrors(0),
+     _readBlock(0) {
+   for (int i = 0; i < ADC_CAPTURE_CORE_MAX_BLOCKS; i++) {
+     _state[i].store(BLOCK_FREE, std::memory_order_relaxed);
+     _sequence[i] = 0;
+     _firstSample[i] = 0;
+   }
+ }
+ 
+ bool AdcCaptureCore::begin(uint16_t *storage, uint16_t blockSamples, uint8_t numBlocks) {
+   if (storage == NULL || blockSamples == 0 ||
+       numBlocks < 2 || numBlocks > ADC_CAPTURE_CORE_MAX_BLOCKS) {
+     return false;
+   }
+ 
+   _storage = storage;
+   _blockSamples = blockSamples;
+   _numBlocks = numBlocks;
+   reset();
+   return true;
+ }
+ 
+ void AdcCaptureCore::reset() {
+   for (int i = 0; i < ADC_CAPTURE_CORE_MAX_BLOCKS; i++) {
+     _state[i].store(BLOCK_FREE, std::memory_order_relaxed);
+   }
+ 
+   _writeBlock = 0;
+   _writePos = 0;
+   _dropping = false;
+   _nextSequence = 0;
+   _sampleIndex = 0;
+   _samplesCaptured = 0;
+   _blocksCompleted = 0;
+   _droppedSamples = 0;
+   _overruns = 0;
+   _framingErrors = 0;
+   _readBlock = 0;
+ 
+   startBlock();
+ }
+ 
+ // Claim the current write slot and stamp it with its sequence position
+ void IRAM_ATTR AdcCaptureCore::startBlock() {
+   _state[_writeBlock].store(BLOCK_FILLING, std::memory_order_relaxed);
+   _writePos = 0;
+   _sequence[_writeBlock] = _nextSequence++;
+   _firstSample[_writeBlock] = _sampleIndex;
+ }
+ 
+ bool IRAM_ATTR AdcCaptureCore::pushFrame(uint16_t frame) {
+   // While the consumer still holds the next block, samples are counted and discarded
+   if (_dropping) {
+     if (_state[_writeBlock].load(std::memory_order_acquire) != BLOCK_FREE) {
+       _sampleIndex++;
+       _droppedSamples++;
+       return false;
+     }
+     _dropping = false;
+     startBlock();
+   }
+ 
+   if (frame & AD7495_LEADING_ZEROS_MASK) {
+     _framingErrors++;
+   }
+ 
+   _storage[(uint32_t)_writeBlock * _blockSamples + _writePos] = frame & AD7495_DATA_MASK;
+   _writePos++;
+   _sampleIndex++;
+   _samplesCaptured++;
+ 
+   if (_writePos < _blockSamples) {
+     return false;
+   }
+ 
+   // Block full - publish it and move on to the next slot in the ring
+   _state[_writeBlock].store(BLOCK_READY, std::memory_order_release);
+   _blocksCompleted++;
+ 
+   _writeBlock = (_writeBlock + 1) % _numBlocks;
+   if (_state[_writeBlock].load(std::memory_order_acquire) == BLOCK_FREE) {
+     startBlock();
+   } else {
+     _dropping = true;
+     _overruns++;
+   }
+ 
+   return true;
+ }
+ 
+ bool AdcCaptureCore::acquireBlock(AdcBlock_t *block) {
+   if (block == NULL || _storage == NULL) {
+     return false;
+   }
+ 
+   // Blocks complete in ring order, so the oldest one is always at the read index
+   uint8_t index = _readBlock;
+   if (_state[index].load(std::memory_order_acquire) != BLOCK_READY) {
+     return false;
+   }
+   _state[index].store(BLOCK_CONSUMING, std::memory_order_relaxed);
+ 
+   block->samples = &_storage[(uint32_t)index * _blockSamples];
+   block->count = _blockSamples;
+   block->index = index;
+   block->sequence = _sequence[index];
+   block->firstSample = _firstSample[index];
+   block->timestampUs = 0;
+   block->sampleRateHz = 0;
+ 
+   _readBlock = (index + 1) % _numBlocks;
+   return true;
+ }
+ 
+ void AdcCaptureCore::releaseBlock(uint8_t index) {
+   if (index >= _numBlocks) {
+     return;
+   }
+ 
+   if (_state[index].load(std::memory_order_relaxed) == BLOCK_CONSUMING) {
+     _state[index].store(BLOCK_FREE, std::memory_order_release);
+   }
+ }
+ 
+ void AdcCaptureCore::getCounters(AdcCaptureCounters_t *counters) const {
+   if (counters == NULL) {
+     return;
+   }
+ 
+   counters->samplesCaptured = _samplesCaptured;
+   counters->blocksCompleted = _blocksCompleted;
+   counters->droppedSamples = _droppedSamples;
+   counters->overruns = _overruns;
+   counters->framingErrors = _framingErrors;
+ }
\ No newline at end of file
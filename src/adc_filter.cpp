@@ -0,0 +1,269 @@
+/*
+ * ADC Filter Module Implementation
+ */
+ 
+ #include "adc_filter.h"
+ #include "freertos/task.h"
+ #include "simplified_debug.h"
+ 
+ // Samples used by the start-up kernel check
+ #define ADC_FILTER_SELFTEST_SAMPLES 2048
+ 
+ // Static variables
+ static FirDecimator firFilter;
+ static CicDecimator cicFilter;
+ static bool filterInitialized = false;
+ static volatile bool filterEnabled = false;
+ static portMUX_TYPE filterMux = portMUX_INITIALIZER_UNLOCKED;
+ 
+ // Configuration hand-over (protected by filterMux)
+ static AdcFilterConfig_t pendingConfig;
+ static bool configPending = false;
+ 
+ // Registered consumers
+ static AdcBlockConsumer_t consumers[ADC_FILTER_MAX_CONSUMERS];
+ static void *consumerContexts[ADC_FILTER_MAX_CONSUMERS];
+ static uint8_t consumerCount = 0;
+ 
+ // Chain state (only touched from the ADC consumer task)
+ static bool useCic = false;
+ static uint32_t totalDecimation = 1;
+ static uint64_t expectedSample = 0;
+ static uint64_t inputBase = 0;
+ static uint64_t outputIndex = 0;
+ static uint32_t outputSequence = 0;
+ static uint16_t cicScratch[ADC_CAPTURE_BLOCK_SAMPLES];
+ static uint16_t firScratch[ADC_CAPTURE_BLOCK_SAMPLES];
+ static uint16_t outputBlock[ADC_FILTER_BLOCK_SAMPLES];
+ static uint16_t outputFill = 0;
+ static uint32_t outputTimestampUs = 0;
+ static uint64_t outputFirstSample = 0;
+ 
+ // Status
+ static FirKernel_t verifiedKernel = FIR_KERNEL_SCALAR;
+ static bool vectorVerified = false;
+ static uint32_t scalarRate = 0;
+ static uint32_t vectorRate = 0;
+ static volatile uint32_t inputSamples = 0;
+ static volatile uint32_t outputSamples = 0;
+ static volatile uint32_t chainCycles = 0;
+ 
+ // Build the chain from a configuration (ADC consumer task or init only)
+ static bool applyConfig(const AdcFilterConfig_t *config) {
+   int16_t coeffs[FIR_MAX_TAPS];
+   if (!firDesignLowpass(coeffs, config->firTaps, config->firCutoff) ||
+       !firFilter.begin(coeffs, config->firTaps, config->firDecimation)) {
+     return false;
+   }
+   firFilter.setKernel(verifiedKernel);
+ 
+   useCic = (config->cicOrder > 0);
+   if (useCic && !cicFilter.begin(config->cicOrder, config->cicRate)) {
+     useCic = false;
+     return false;
+   }
+ 
+   totalDecimation = (uint32_t)config->firDecimation * (useCic ? config->cicRate : 1);
+   outputFill = 0;
+   outputIndex = 0;
+   return true;
+ }
+ 
+ // Hand a completed block of filtered samples to the consumers
+ static void dispatchOutput(uint32_t sampleRateHz) {
+   AdcBlock_t block;
+   block.samples = outputBlock;
+   block.count = outputFill;
+   block.index = 0;
+   block.sequence = outputSequence++;
+   block.firstSample = outputFirstSample;
+   block.timestampUs = outputTimestampUs;
+   block.sampleRateHz = sampleRateHz;
+ 
+   for (uint8_t i = 0; i < consumerCount; i++) {
+     consumers[i](&block, consumerContexts[i]);
+   }
+   outputFill = 0;
+ }
+ 
+ // ADC block consumer - runs the chain and re-blocks the output
+ static void adcFilterBlockConsumer(const AdcBlock_t *block, void *context) {
+   AdcFilterConfig_t config;
+   bool newConfig;
+ 
+   portENTER_CRITICAL(&filterMux);
+   newConfig = configPending;
+   config = pendingConfig;
+   configPending = false;
+   portEXIT_CRITICAL(&filterMux);
+ 
+   if (newConfig && !applyConfig(&config)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Invalid ADC filter configuration");
+   }
+ 
+   if (!filterEnabled || block->sampleRateHz == 0) {
+     return;
+   }
+ 
+   // A new run or dropped samples restart the filters
+   if (newConfig || block->firstSample != expectedSample) {
+     firFilter.reset();
+     cicFilter.reset();
+     inputBase = block->firstSample;
+     outputIndex = 0;
+     outputFill = 0;
+   }
+   expectedSample = block->firstSample + block->count;
+ 
+   uint32_t startCycles = ESP.getCycleCount();
+ 
+   const uint16_t *firInput = block->samples;
+   size_t firCount = block->count;
+   if (useCic) {
+     firCount = cicFilter.process(block->samples, block->count, cicScratch, ADC_CAPTURE_BLOCK_SAMPLES);
+     firInput = cicScratch;
+   }
+   size_t produced = firFilter.process(firInput, firCount, firScratch, ADC_CAPTURE_BLOCK_SAMPLES);
+ 
+   chainCycles += ESP.getCycleCount() - startCycles;
+   inputSamples += block->count;
+   outputSamples += produced;
+ 
+   uint32_t outputRate = block->sampleRateHz / totalDecimation;
+   for (size_t i = 0; i < produced; i++) {
+     if (outputFill == 0) {
+       // Stamp the block with the input sample that completed its first output
+       uint64_t inputSample = inputBase + (outputIndex + 1) * totalDecimation - 1;
+       int64_t offset = (int64_t)(inputSample - block->firstSample);
+       outputTimestampUs = block->timestampUs + (int32_t)((offset * 1000000) / block->sampleRateHz);
+       outputFirstSample = outputIndex;
+     }
+ 
+     outputBlock[outputFill++] = firScratch[i];
+     outputIndex++;
+     if (outputFill == ADC_FILTER_BLOCK_SAMPLES) {
+       dispatchOutput(outputRate);
+     }
+   }
+ }
+ 
+ // Run both FIR kernels over the same pseudo-random input and time them
+ static void verifyKernels() {
+   static uint16_t input[ADC_FILTER_SELFTEST_SAMPLES];
+   static uint16_t outScalar[ADC_FILTER_SELFTEST_SAMPLES];
+   static uint16_t outVector[ADC_FILTER_SELFTEST_SAMPLES];
+ 
+   uint32_t lfsr = 0xACE1u;
+   for (int i = 0; i < ADC_FILTER_SELFTEST_SAMPLES; i++) {
+     lfsr = lfsr * 1664525u + 1013904223u;
+     input[i] = (uint16_t)(lfsr >> 20);
+   }
+ 
+   int16_t coeffs[FIR_MAX_TAPS];
+   firDesignLowpass(coeffs, FIR_MAX_TAPS, 0.2f);
+   FirDecimator *test = new FirDecimator();
+   test->begin(coeffs, FIR_MAX_TAPS, 1);
+ 
+   uint32_t start = ESP.getCycleCount();
+   size_t n = test->process(input, ADC_FILTER_SELFTEST_SAMPLES, outScalar, ADC_FILTER_SELFTEST_SAMPLES);
+   uint32_t scalarCycles = ESP.getCycleCount() - start;
+ 
+   test->reset();
+   test->setKernel(FIR_KERNEL_VECTOR);
+   start = ESP.getCycleCount();
+   size_t m = test->process(input, ADC_FILTER_SELFTEST_SAMPLES, outVector, ADC_FILTER_SELFTEST_SAMPLES);
+   uint32_t vectorCycles = ESP.getCycleCount() - start;
+   delete test;
+ 
+   vectorVerified = (n == m) && (memcmp(outScalar, outVector, n * sizeof(uint16_t)) == 0);
+   verifiedKernel = vectorVerified ? FIR_KERNEL_VECTOR : FIR_KERNEL_SCALAR;
+ 
+   uint64_t cpuHz = (uint64_t)getCpuFrequencyMhz() * 1000000ULL;
+   scalarRate = (uint32_t)(cpuHz * ADC_FILTER_SELFTEST_SAMPLES / (scalarCycles ? scalarCycles : 1));
+   vectorRate = (uint32_t)(cpuHz * ADC_FILTER_SELFTEST_SAMPLES / (vectorCycles ? vectorCycles : 1));
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "FIR %u taps: scalar %lu samples/s, vector %lu samples/s (%s, PIE %s)",
+               FIR_MAX_TAPS, scalarRate, vectorRate, vectorVerified ? "bit-exact" : "MISMATCH",
+               DECIMATION_FILTER_HAS_PIE ? "on" : "off");
+   if (!vectorVerified) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Vector FIR kernel disagrees with the reference - using scalar kernel");
+   }
+ }
+ 
+ bool initAdcFilterModule() {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing ADC Filter module");
+ 
+   verifyKernels();
+ 
+   AdcFilterConfig_t config;
+   config.cicOrder = 0;
+   config.cicRate = 1;
+   config.firTaps = ADC_FILTER_DEFAULT_TAPS;
+   config.firDecimation = ADC_FILTER_DEFAULT_DECIMATION;
+   config.firCutoff = ADC_FILTER_DEFAULT_CUTOFF;
+   if (!applyConfig(&config)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to build the default ADC filter");
+     return false;
+   }
+ 
+   if (!registerAdcBlockConsumer(adcFilterBlockConsumer, NULL)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to register ADC filter as ADC consumer");
+     return false;
+   }
+ 
+   filterInitialized = true;
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC Filter module initialized successfully");
+   return true;
+ }
+ 
+ bool registerFilteredBlockConsumer(AdcBlockConsumer_t consumer, void *context) {
+   if (consumer == NULL || consumerCount >= ADC_FILTER_MAX_CONSUMERS) {
+     return false;
+   }
+ 
+   // The consumer list is read without locking by the ADC task, so only change it while idle
+   if (isAdcCaptureRunning()) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot register filtered consumer while capture is running");
+     return false;
+   }
+ 
+   consumers[consumerCount] = consumer;
+   consumerContexts[consumerCount] = context;
+   consumerCount++;
+   return true;
+ }
+ 
+ bool configureAdcFilter(const AdcFilterConfig_t *config) {
+   if (!filterInitialized || config == NULL || config->firTaps == 0 || config->firTaps > FIR_MAX_TAPS ||
+       config->firDecimation == 0 || config->firDecimation > FIR_MAX_DECIMATION ||
+       config->firCutoff <= 0.0f || config->firCutoff > 0.5f ||
+       (config->cicOrder > 0 && (config->cicOrder > CIC_MAX_ORDER || config->cicRate < 2))) {
+     return false;
+   }
+ 
+   portENTER_CRITICAL(&filterMux);
+   pendingConfig = *config;
+   configPending = true;
+   portEXIT_CRITICAL(&filterMux);
+   return true;
+ }
+ 
+ void setAdcFilterEnabled(bool enable) {
+   filterEnabled = enable && filterInitialized;
+ }
+ 
+ bool getAdcFilterStats(AdcFilterStats_t *stats) {
+   if (stats == NULL) {
+     return false;
+   }
+ 
+   stats->enabled = filterEnabled;
+   stats->kernel = verifiedKernel;
+   stats->vectorVerified = vectorVerified;
+   stats->scalarSamplesPerSec = scalarRate;
+   stats->vectorSamplesPerSec = vectorRate;
+   stats->inputSamples = inputSamples;
+   stats->outputSamples = outputSamples;
+   stats->cyclesPerKiloSample = inputSamples ? (uint32_t)((uint64_t)chainCycles * 1000 / inputSamples) : 0;
+   return true;
+ }
\ No newline at end of file
@@ -0,0 +1,124 @@
+/*
+ * ADC Monitor Module Implementation
+ */
+ 
+ #include "adc_monitor.h"
+ #include "adc_capture.h"
+ #include "sample_stream.h"
+ #include "freertos/queue.h"
+ #include "simplified_debug.h"
+ 
+ // Static variables
+ static QueueHandle_t monitorQueue = NULL;
+ static volatile bool monitorEnabled = false;
+ static volatile bool monitorStreaming = false;
+ static volatile uint32_t monitorRateHz = ADC_MONITOR_DEFAULT_RATE_HZ;
+ 
+ // Interval state (only touched from the ADC consumer task)
+ static AdcStatsAccumulator_t accumulator;
+ static bool intervalOpen = false;
+ static uint32_t intervalTimestampUs = 0;
+ static uint64_t intervalFirstSample = 0;
+ static uint64_t intervalCycles = 0;
+ static uint32_t nextSequence = 0;
+ 
+ // ADC block consumer - accumulates the block and publishes at the interval end
+ static void adcMonitorBlockConsumer(const AdcBlock_t *block, void *context) {
+   if (!monitorEnabled || block->sampleRateHz == 0) {
+     intervalOpen = false;
+     return;
+   }
+ 
+   // A restart of the capture (sample index going back) opens a new interval
+   if (intervalOpen && block->firstSample < intervalFirstSample) {
+     intervalOpen = false;
+   }
+ 
+   if (!intervalOpen) {
+     adcStatsReset(&accumulator);
+     intervalTimestampUs = block->timestampUs;
+     intervalFirstSample = block->firstSample;
+     intervalCycles = 0;
+     intervalOpen = true;
+   }
+ 
+   uint32_t startCycles = ESP.getCycleCount();
+   adcStatsAccumulate(&accumulator, block->samples, block->count);
+   intervalCycles += ESP.getCycleCount() - startCycles;
+ 
+   uint32_t intervalSamples = block->sampleRateHz / monitorRateHz;
+   if (accumulator.count < intervalSamples) {
+     return;
+   }
+ 
+   AdcMonitorSummary_t summary;
+   startCycles = ESP.getCycleCount();
+   adcStatsSummarize(&accumulator, &summary.stats);
+   intervalCycles += ESP.getCycleCount() - startCycles;
+ 
+   summary.sequence = nextSequence++;
+   summary.timestampUs = intervalTimestampUs;
+   summary.firstSample = intervalFirstSample;
+   summary.sampleRateHz = block->sampleRateHz;
+   summary.kernelCycles = (uint32_t)intervalCycles;
+ 
+   // Cycles spent / cycles available during the interval
+   uint64_t availableCycles = (uint64_t)getCpuFrequencyMhz() * 1000000ULL * accumulator.count /
+                              block->sampleRateHz;
+   summary.kernelLoadPpm = (uint32_t)((intervalCycles * 1000000ULL) / availableCycles);
+ 
+   xQueueOverwrite(monitorQueue, &summary);
+ 
+   if (monitorStreaming) {
+     sampleStreamSendStats(&summary.stats, summary.timestampUs, summary.firstSample,
+                           summary.sampleRateHz);
+   }
+ 
+   intervalOpen = false;
+ }
+ 
+ bool initAdcMonitorModule() {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing ADC Monitor module");
+ 
+   // Create queue for passing summaries (size 1, we only care about the latest one)
+   monitorQueue = xQueueCreate(1, sizeof(AdcMonitorSummary_t));
+   if (monitorQueue == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create ADC monitor queue - out of memory");
+     return false;
+   }
+ 
+   if (!registerAdcBlockConsumer(adcMonitorBlockConsumer, NULL)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to register ADC monitor as ADC consumer");
+     vQueueDelete(monitorQueue);
+     monitorQueue = NULL;
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC Monitor module initialized successfully");
+   return true;
+ }
+ 
+ void setAdcMonitorEnabled(bool enable) {
+   monitorEnabled = enable && (monitorQueue != NULL);
+ }
+ 
+ bool setAdcMonitorRate(uint32_t summariesPerSecond) {
+   if (summariesPerSecond < ADC_MONITOR_MIN_RATE_HZ || summariesPerSecond > ADC_MONITOR_MAX_RATE_HZ) {
+     return false;
+   }
+ 
+   monitorRateHz = summariesPerSecond;
+   return true;
+ }
+ 
+ void setAdcMonitorStreaming(bool enable) {
+   monitorStreaming = enable;
+ }
+ 
+ bool receiveAdcMonitorSummary(AdcMonitorSummary_t *summary, TickType_t timeout) {
+   if (summary == NULL || monitorQueue == NULL) {
+     return false;
+   }
+ 
+   return xQueueReceive(monitorQueue, summary, timeout) == pdTRUE;
+ }
\ No newline at end of file
@@ -0,0 +1,364 @@
+/*
+ * ADC Spectrum Module Implementation
+ */
+ 
+ #include "adc_spectrum.h"
+ #include <new>
+ #include "adc_capture.h"
+ #include "adc_filter.h"
+ #include "pulse_generator.h"
+ #include "freertos/queue.h"
+ #include "freertos/task.h"
+ #include "esp_heap_caps.h"
+ #include "simplified_debug.h"
+ 
+ // Block collection states
+ typedef enum {
+   SPECTRUM_CAPTURE_IDLE,       // Task is analysing or waiting for the next interval
+   SPECTRUM_CAPTURE_FILLING,    // Consumer is copying samples
+   SPECTRUM_CAPTURE_READY       // Block is complete, task notified
+ } SpectrumCaptureState_t;
+ 
+ // Static variables
+ static SpectrumAnalyzer *analyzer = NULL;
+ static uint16_t *captureBuffer = NULL;
+ static float *amplitude = NULL;
+ static TaskHandle_t spectrumTaskHandle = NULL;
+ static QueueHandle_t spectrumQueue = NULL;
+ static QueueHandle_t toneQueue = NULL;
+ static volatile bool spectrumEnabled = false;
+ static portMUX_TYPE spectrumMux = portMUX_INITIALIZER_UNLOCKED;
+ 
+ // Configuration hand-over (protected by spectrumMux)
+ static AdcSpectrumConfig_t activeConfig;
+ static AdcSpectrumConfig_t pendingConfig;
+ static bool configPending = false;
+ static volatile AdcSpectrumSource_t activeSource = ADC_SPECTRUM_SOURCE_FILTERED;
+ 
+ // Block collection, handed between the consumer and the task through captureState
+ static volatile SpectrumCaptureState_t captureState = SPECTRUM_CAPTURE_IDLE;
+ static uint16_t captureSize = 0;
+ static uint16_t captureFill = 0;
+ static uint64_t captureNextSample = 0;
+ static uint32_t captureTimestampUs = 0;
+ static uint32_t captureRateHz = 0;
+ static uint16_t captureExpectedHz = 0;
+ 
+ // Goertzel tracking (only touched from the ADC consumer task)
+ static GoertzelBank toneBank;
+ static uint16_t toneHz = 0;
+ static uint32_t toneRateHz = 0;
+ static uint64_t toneNextSample = 0;
+ static uint32_t toneTimestampUs = 0;
+ static bool toneTimestampValid = false;
+ static uint32_t toneSequence = 0;
+ 
+ // Retune the Goertzel bank to the fundamental and harmonics of pFrequency
+ static void tuneTones(uint16_t frequencyHz, uint32_t sampleRateHz) {
+   toneHz = frequencyHz;
+   toneRateHz = sampleRateHz;
+   toneTimestampValid = false;
+ 
+   float frequencies[ADC_SPECTRUM_HARMONICS];
+   uint8_t count = 0;
+   while (count < ADC_SPECTRUM_HARMONICS && (count + 1) * frequencyHz * 2u < sampleRateHz) {
+     frequencies[count] = (float)((count + 1) * frequencyHz);
+     count++;
+   }
+ 
+   uint32_t periods = (frequencyHz * ADC_SPECTRUM_TONE_BLOCK_MS + 999) / 1000;
+   uint32_t length = (uint32_t)(((uint64_t)periods * sampleRateHz + frequencyHz / 2) / frequencyHz);
+   if (count == 0 || !toneBank.begin(frequencies, count, (float)sampleRateHz, length)) {
+     toneHz = 0;
+   }
+ }
+ 
+ static void trackTones(const AdcBlock_t *block) {
+   uint16_t expectedHz = pFrequency;
+   if (expectedHz < PULSE_MIN_FREQ || expectedHz > PULSE_MAX_FREQ) {
+     toneHz = 0;
+     return;
+   }
+ 
+   if (expectedHz != toneHz || block->sampleRateHz != toneRateHz) {
+     tuneTones(expectedHz, block->sampleRateHz);
+     if (toneHz == 0) {
+       return;
+     }
+   } else if (block->firstSample != toneNextSample) {
+     toneBank.reset();
+     toneTimestampValid = false;
+   }
+   toneNextSample = block->firstSample + block->count;
+ 
+   const uint16_t *samples = block->samples;
+   size_t remaining = block->count;
+   while (remaining > 0) {
+     if (!toneTimestampValid) {
+       toneTimestampUs = block->timestampUs +
+                         (uint32_t)(((uint64_t)(block->count - remaining) * 1000000ULL) / block->sampleRateHz);
+       toneTimestampValid = true;
+     }
+ 
+     size_t used = toneBank.process(samples, remaining);
+     samples += used;
+     remaining -= used;
+ 
+     if (toneBank.ready()) {
+       AdcToneResult_t result;
+       result.sequence = toneSequence++;
+       result.timestampUs = toneTimestampUs;
+       result.sampleRateHz = toneRateHz;
+       result.blockLength = toneBank.blockLength();
+       result.expectedHz = toneHz;
+       result.count = toneBank.count();
+       toneBank.read(result.tones);
+       xQueueOverwrite(toneQueue, &result);
+       toneTimestampValid = false;
+     }
+   }
+ }
+ 
+ static void collectBlock(const AdcBlock_t *block) {
+   uint16_t expectedHz = pFrequency;
+ 
+   // Only contiguous samples at one rate and one generator setting make a block
+   if (captureFill > 0 && (block->firstSample != captureNextSample || block->sampleRateHz != captureRateHz ||
+                           expectedHz != captureExpectedHz)) {
+     captureFill = 0;
+   }
+ 
+   if (captureFill == 0) {
+     captureTimestampUs = block->timestampUs;
+     captureRateHz = block->sampleRateHz;
+     captureExpectedHz = expectedHz;
+   }
+   captureNextSample = block->firstSample + block->count;
+ 
+   uint32_t n = captureSize - captureFill;
+   if (n > block->count) {
+     n = block->count;
+   }
+   memcpy(&captureBuffer[captureFill], block->samples, n * sizeof(uint16_t));
+   captureFill += n;
+ 
+   if (captureFill == captureSize) {
+     captureState = SPECTRUM_CAPTURE_READY;
+     xTaskNotifyGive(spectrumTaskHandle);
+   }
+ }
+ 
+ // Block consumer for both sources - the context carries the source
+ static void adcSpectrumBlockConsumer(const AdcBlock_t *block, void *context) {
+   AdcSpectrumSource_t source = (AdcSpectrumSource_t)(uintptr_t)context;
+   if (!spectrumEnabled || source != activeSource || block->sampleRateHz == 0) {
+     return;
+   }
+ 
+   trackTones(block);
+ 
+   if (captureState == SPECTRUM_CAPTURE_FILLING && spectrumTaskHandle != NULL) {
+     collectBlock(block);
+   }
+ }
+ 
+ // Search a span around a target frequency, at least two bins wide on each side
+ static bool findLine(float targetHz, float spanPct, float binHz, SpectrumPeak_t *peak) {
+   float span = targetHz * spanPct / 100.0f;
+   if (span < 2.0f * binHz) {
+     span = 2.0f * binHz;
+   }
+   float low = targetHz - span;
+   if (low < ADC_SPECTRUM_CLEAR_BINS * binHz) {
+     low = ADC_SPECTRUM_CLEAR_BINS * binHz;
+   }
+   return analyzer->findPeak(amplitude, binHz, low, targetHz + span, peak);
+ }
+ 
+ static void analyzeBlock(AdcSpectrumResult_t *result) {
+   uint32_t start = micros();
+   analyzer->analyze(captureBuffer, amplitude);
+ 
+   result->timestampUs = captureTimestampUs;
+   result->sampleRateHz = captureRateHz;
+   result->fftSize = analyzer->size();
+   result->window = analyzer->window();
+   result->binHz = (float)captureRateHz / analyzer->size();
+   result->expectedHz = captureExpectedHz;
+ 
+   analyzer->findPeak(amplitude, result->binHz, ADC_SPECTRUM_CLEAR_BINS * result->binHz,
+                      captureRateHz / 2.0f, &result->strongest);
+ 
+   memset(result->harmonics, 0, sizeof(result->harmonics));
+   result->locked = false;
+   result->errorPct = 0.0f;
+   if (captureExpectedHz >= PULSE_MIN_FREQ) {
+     SpectrumPeak_t *fundamental = &result->harmonics[0];
+     result->locked = findLine(captureExpectedHz, ADC_SPECTRUM_SEARCH_PCT, result->binHz, fundamental) &&
+                      fundamental->amplitude >= ADC_SPECTRUM_MIN_LEVEL;
+ 
+     // Harmonics are searched around multiples of the measured fundamental when locked
+     float baseHz = result->locked ? fundamental->frequencyHz : captureExpectedHz;
+     for (uint8_t h = 1; h < ADC_SPECTRUM_HARMONICS; h++) {
+       float targetHz = baseHz * (h + 1);
+       if (targetHz < captureRateHz / 2.0f) {
+         findLine(targetHz, 1.0f, result->binHz, &result->harmonics[h]);
+       }
+     }
+ 
+     if (result->locked) {
+       result->errorPct = (fundamental->frequencyHz - captureExpectedHz) * 100.0f / captureExpectedHz;
+     }
+   }
+ 
+   result->analysisUs = micros() - start;
+ }
+ 
+ // Analysis task - collects a block, analyses it, then waits for the next interval
+ static void adcSpectrumTask(void *parameter) {
+   uint32_t sequence = 0;
+ 
+   while (true) {
+     AdcSpectrumConfig_t config;
+     bool newConfig;
+ 
+     portENTER_CRITICAL(&spectrumMux);
+     newConfig = configPending;
+     config = pendingConfig;
+     configPending = false;
+     portEXIT_CRITICAL(&spectrumMux);
+ 
+     if (newConfig) {
+       if (analyzer->begin(config.fftSize, config.window)) {
+         activeConfig = config;
+         activeSource = config.source;
+       } else {
+         DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Invalid spectrum configuration");
+       }
+     }
+ 
+     // Start a new block; the consumer owns the buffer until it signals READY.
+     // A configuration change waits for the block in progress
+     ulTaskNotifyTake(pdTRUE, 0);
+     captureSize = analyzer->size();
+     captureFill = 0;
+     captureState = SPECTRUM_CAPTURE_FILLING;
+ 
+     while (captureState != SPECTRUM_CAPTURE_READY) {
+       ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+     }
+     captureState = SPECTRUM_CAPTURE_IDLE;
+ 
+     AdcSpectrumResult_t result;
+     analyzeBlock(&result);
+     result.sequence = sequence++;
+     xQueueOverwrite(spectrumQueue, &result);
+ 
+     vTaskDelay(pdMS_TO_TICKS(activeConfig.intervalMs));
+   }
+ }
+ 
+ bool initAdcSpectrumModule() {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing ADC Spectrum module");
+ 
+   void *analyzerMemory = heap_caps_malloc(sizeof(SpectrumAnalyzer), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   captureBuffer = (uint16_t *)heap_caps_malloc(SPECTRUM_MAX_FFT * sizeof(uint16_t),
+                                                MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   amplitude = (float *)heap_caps_malloc((SPECTRUM_MAX_FFT / 2 + 1) * sizeof(float),
+                                         MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   spectrumQueue = xQueueCreate(1, sizeof(AdcSpectrumResult_t));
+   toneQueue = xQueueCreate(1, sizeof(AdcToneResult_t));
+ 
+   if (analyzerMemory == NULL || captureBuffer == NULL || amplitude == NULL ||
+       spectrumQueue == NULL || toneQueue == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to allocate spectrum buffers - out of memory");
+     heap_caps_free(analyzerMemory);
+     heap_caps_free(captureBuffer);
+     heap_caps_free(amplitude);
+     if (spectrumQueue != NULL) vQueueDelete(spectrumQueue);
+     if (toneQueue != NULL) vQueueDelete(toneQueue);
+     captureBuffer = NULL;
+     amplitude = NULL;
+     spectrumQueue = NULL;
+     toneQueue = NULL;
+     return false;
+   }
+   analyzer = new (analyzerMemory) SpectrumAnalyzer();
+ 
+   activeConfig.source = ADC_SPECTRUM_SOURCE_FILTERED;
+   activeConfig.fftSize = ADC_SPECTRUM_DEFAULT_FFT;
+   activeConfig.window = SPECTRUM_WINDOW_HANN;
+   activeConfig.intervalMs = ADC_SPECTRUM_DEFAULT_INTERVAL_MS;
+   analyzer->begin(activeConfig.fftSize, activeConfig.window);
+   activeSource = activeConfig.source;
+ 
+   if (!registerAdcBlockConsumer(adcSpectrumBlockConsumer, (void *)(uintptr_t)ADC_SPECTRUM_SOURCE_RAW) ||
+       !registerFilteredBlockConsumer(adcSpectrumBlockConsumer, (void *)(uintptr_t)ADC_SPECTRUM_SOURCE_FILTERED)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to register spectrum as ADC consumer");
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC Spectrum module initialized successfully");
+   return true;
+ }
+ 
+ bool createAdcSpectrumTask() {
+   if (analyzer == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot create ADC Spectrum task - module not initialized");
+     return false;
+   }
+ 
+   if (spectrumTaskHandle != NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN, "ADC Spectrum task already running");
+     return true;
+   }
+ 
+   BaseType_t result = xTaskCreate(
+     adcSpectrumTask,
+     "ADC Spectrum Task",
+     ADC_SPECTRUM_TASK_STACK,
+     NULL,
+     ADC_SPECTRUM_TASK_PRIORITY,
+     &spectrumTaskHandle
+   );
+ 
+   if (result != pdPASS) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create ADC Spectrum task - error code: %d", result);
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC Spectrum task created successfully");
+   return true;
+ }
+ 
+ bool configureAdcSpectrum(const AdcSpectrumConfig_t *config) {
+   if (analyzer == NULL || config == NULL || config->fftSize < SPECTRUM_MIN_FFT ||
+       config->fftSize > SPECTRUM_MAX_FFT || (config->fftSize & (config->fftSize - 1)) != 0 ||
+       config->window > SPECTRUM_WINDOW_FLATTOP || config->source > ADC_SPECTRUM_SOURCE_FILTERED) {
+     return false;
+   }
+ 
+   portENTER_CRITICAL(&spectrumMux);
+   pendingConfig = *config;
+   configPending = true;
+   portEXIT_CRITICAL(&spectrumMux);
+   return true;
+ }
+ 
+ void setAdcSpectrumEnabled(bool enable) {
+   spectrumEnabled = enable && (analyzer != NULL);
+ }
+ 
+ bool receiveAdcSpectrum(AdcSpectrumResult_t *result, TickType_t timeout) {
+   if (spectrumQueue == NULL || result == NULL) {
+     return false;
+   }
+   return xQueueReceive(spectrumQueue, result, timeout) == pdTRUE;
+ }
+ 
+ bool receiveAdcTones(AdcToneResult_t *result, TickType_t timeout) {
+   if (toneQueue == NULL || result == NULL) {
+     return false;
+   }
+   return xQueueReceive(toneQueue, result, timeout) == pdTRUE;
+ }
\ No newline at end of file
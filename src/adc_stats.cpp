@@ -0,0 +1,119 @@
+/*
+ * ADC Statistics Implementation
+ */
+ 
+ #include "adc_stats.h"
+ #include "platform_compat.h"
+ #include <string.h>
+ 
+ // 256 * 4095^2 still fits in 32 bits, so squares are summed in 32-bit chunks
+ #define ADC_STATS_CHUNK 256
+ 
+ // Integer square root (floor)
+ static uint32_t isqrt64(uint64_t value) {
+   uint64_t result = 0;
+   uint64_t bit = (uint64_t)1 << 62;
+ 
+   while (bit > value) {
+     bit >>= 2;
+   }
+   while (bit != 0) {
+     if (value >= result + bit) {
+       value -= result + bit;
+       result = (result >> 1) + bit;
+     } else {
+       result >>= 1;
+     }
+     bit >>= 2;
+   }
+   return (uint32_t)result;
+ }
+ 
+ void adcStatsReset(AdcStatsAccumulator_t *acc) {
+   if (acc == NULL) {
+     return;
+   }
+ 
+   memset(acc, 0, sizeof(*acc));
+   acc->min = 0xFFFF;
+ }
+ 
+ void IRAM_ATTR adcStatsAccumulate(AdcStatsAccumulator_t *acc, const uint16_t *samples, size_t count) {
+   if (acc == NULL || samples == NULL) {
+     return;
+   }
+ 
+   uint32_t *histogram = acc->histogram;
+   uint32_t lo = acc->min;
+   uint32_t hi = acc->max;
+ 
+   while (count > 0) {
+     size_t n = (count < ADC_STATS_CHUNK) ? count : ADC_STATS_CHUNK;
+     uint32_t sum = 0;
+     uint32_t sumSquares = 0;
+ 
+     for (size_t i = 0; i < n; i++) {
+       uint32_t s = samples[i];
+       if (s > 0x0FFF) {
+         s = 0x0FFF;
+       }
+       if (s < lo) {
+         lo = s;
+       }
+       if (s > hi) {
+         hi = s;
+       }
+       sum += s;
+       sumSquares += s * s;
+       histogram[s >> ADC_STATS_HISTOGRAM_SHIFT]++;
+     }
+ 
+     acc->sum += sum;
+     acc->sumSquares += sumSquares;
+     acc->count += (uint32_t)n;
+     samples += n;
+     count -= n;
+   }
+ 
+   acc->min = (uint16_t)lo;
+   acc->max = (uint16_t)hi;
+ }
+ 
+ void adcStatsSummarize(const AdcStatsAccumulator_t *acc, AdcStatsSummary_t *summary) {
+   if (acc == NULL || summary == NULL) {
+     return;
+   }
+ 
+   memset(summary, 0, sizeof(*summary));
+   if (acc->count == 0) {
+     return;
+   }
+ 
+   const uint32_t scale = 1u << ADC_STATS_FRACTION_BITS;
+   uint64_t n = acc->count;
+ 
+   summary->sampleCount = acc->count;
+   summary->min = acc->min;
+   summary->max = acc->max;
+   summary->peakToPeak = acc->max - acc->min;
+   summary->meanQ4 = (uint16_t)((acc->sum * scale + n / 2) / n);
+ 
+   // Mean square in Q8 so its square root comes out in Q4
+   uint64_t meanSquareQ8 = (acc->sumSquares * scale * scale + n / 2) / n;
+   summary->rmsQ4 = (uint16_t)isqrt64(meanSquareQ8);
+ 
+   // Variance = E[x^2] - E[x]^2, computed as (n*sumSq - sum^2) / n^2 to stay exact
+   // (n*sumSq stays below 2^64 for intervals of up to 2^20 samples)
+   uint64_t varianceQ8 = 0;
+   if (n < (1u << 20)) {
+     uint64_t numerator = n * acc->sumSquares - acc->sum * acc->sum;
+     varianceQ8 = ((numerator / n) * scale * scale + n / 2) / n;
+   } else {
+     uint64_t meanQ8 = (acc->sum * scale * scale) / n;
+     uint64_t meanSqQ8 = (meanQ8 * meanQ8) >> (2 * ADC_STATS_FRACTION_BITS);
+     varianceQ8 = (meanSquareQ8 > meanSqQ8) ? meanSquareQ8 - meanSqQ8 : 0;
+   }
+   summary->acRmsQ4 = (uint16_t)isqrt64(varianceQ8);
+ 
+   memcpy(summary->histogram, acc->histogram, sizeof(summary->histogram));
+ }
\ No newline at end of file
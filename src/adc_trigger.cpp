@@ -0,0 +1,305 @@
+/*
+ * ADC Trigger Implementation
+ */
+ 
+ #include "adc_trigger.h"
+ #include <string.h>
+ 
+ AdcTrigger::AdcTrigger()
+   : _storage(NULL), _capacity(0), _writePos(0), _state(TRIGGER_STATE_IDLE),
+     _nextSample(0), _armedSample(0), _preCollected(0), _windowEnd(0), _triggerSample(0),
+     _triggerExternal(false), _holdoffEnd(0), _seenBelow(false), _seenAbove(false),
+     _externalPending(false), _externalSample(0) {
+   _config.source = TRIGGER_SOURCE_LEVEL;
+   _config.slope = TRIGGER_SLOPE_RISING;
+   _config.level = 2048;
+   _config.hysteresis = 16;
+   _config.preSamples = 0;
+   _config.postSamples = 1;
+   _config.holdoffSamples = 0;
+ }
+ 
+ bool AdcTrigger::begin(uint16_t *storage, uint32_t capacity) {
+   if (capacity == 0) {
+     return false;
+   }
+ 
+   _storage = storage;
+   _capacity = capacity;
+   _writePos = 0;
+   _state = TRIGGER_STATE_IDLE;
+   _holdoffEnd = 0;
+   return true;
+ }
+ 
+ bool AdcTrigger::configure(const AdcTriggerConfig_t *config) {
+   if (config == NULL || config->postSamples == 0 ||
+       (uint64_t)config->preSamples + config->postSamples > _capacity) {
+     return false;
+   }
+ 
+   _config = *config;
+   _state = TRIGGER_STATE_IDLE;
+   _holdoffEnd = 0;
+   return true;
+ }
+ 
+ void AdcTrigger::arm() {
+   _state = TRIGGER_STATE_PRETRIGGER;
+   _preCollected = 0;
+   _externalPending = false;
+   _seenBelow = false;
+   _seenAbove = false;
+   _writePos = 0;
+ 
+   if (_config.preSamples == 0) {
+     _state = TRIGGER_STATE_ARMED;
+     _armedSample = _nextSample;
+   }
+ }
+ 
+ void AdcTrigger::disarm() {
+   _state = TRIGGER_STATE_IDLE;
+   _externalPending = false;
+ }
+ 
+ void AdcTrigger::externalEvent(uint64_t sampleIndex) {
+   if (_state != TRIGGER_STATE_PRETRIGGER && _state != TRIGGER_STATE_ARMED) {
+     return;
+   }
+ 
+   // Keep the earliest pending event
+   if (!_externalPending || sampleIndex < _externalSample) {
+     _externalSample = sampleIndex;
+     _externalPending = true;
+   }
+ }
+ 
+ void AdcTrigger::append(const uint16_t *samples, uint32_t count) {
+   if (_storage == NULL) {
+     return;
+   }
+ 
+   // Only the newest _capacity samples can survive
+   if (count > _capacity) {
+     samples += count - _capacity;
+     count = _capacity;
+   }
+ 
+   uint32_t first = _capacity - _writePos;
+   if (first > count) {
+     first = count;
+   }
+   memcpy(&_storage[_writePos], samples, first * sizeof(uint16_t));
+   if (count > first) {
+     memcpy(_storage, samples + first, (count - first) * sizeof(uint16_t));
+   }
+ 
+   _writePos = (_writePos + count) % _capacity;
+ }
+ 
+ // Scan for a qualified crossing at or after fireFrom, returning its offset or end if none.
+ // Crossings before fireFrom (in the holdoff) are used up and must qualify again
+ uint32_t AdcTrigger::findLevelCrossing(const uint16_t *samples, uint32_t start, uint32_t end, uint32_t fireFrom) {
+   const int32_t level = _config.level;
+   const int32_t low = level - (int32_t)_config.hysteresis;
+   const int32_t high = level + (int32_t)_config.hysteresis;
+   const bool rising = (_config.slope != TRIGGER_SLOPE_FALLING);
+   const bool falling = (_config.slope != TRIGGER_SLOPE_RISING);
+ 
+   bool seenBelow = _seenBelow;
+   bool seenAbove = _seenAbove;
+   uint32_t i = start;
+ 
+   for (; i < end; i++) {
+     int32_t s = samples[i];
+     if (rising) {
+       if (s <= low) {
+         seenBelow = true;
+       } else if (seenBelow && s >= level) {
+         if (i >= fireFrom) {
+           break;
+         }
+         seenBelow = false;
+       }
+     }
+     if (falling) {
+       if (s >= high) {
+         seenAbove = true;
+       } else if (seenAbove && s <= level) {
+         if (i >= fireFrom) {
+           break;
+         }
+         seenAbove = false;
+       }
+     }
+   }
+ 
+   _seenBelow = seenBelow;
+   _seenAbove = seenAbove;
+   return i;
+ }
+ 
+ void AdcTrigger::fire(uint64_t triggerSample, bool external) {
+   _triggerSample = triggerSample;
+   _triggerExternal = external;
+   _windowEnd = triggerSample + _config.postSamples;
+   _holdoffEnd = triggerSample + _config.holdoffSamples;
+   _state = TRIGGER_STATE_POSTTRIGGER;
+ }
+ 
+ bool AdcTrigger::processBlock(const uint16_t *samples, uint32_t count, uint64_t firstSample) {
+   if (samples == NULL || count == 0) {
+     return false;
+   }
+ 
+   // Dropped samples break the history - start collecting it again
+   if (firstSample != _nextSample &&
+       (_state == TRIGGER_STATE_PRETRIGGER || _state == TRIGGER_STATE_ARMED ||
+        _state == TRIGGER_STATE_POSTTRIGGER)) {
+     if (firstSample < _nextSample) {
+       _holdoffEnd = 0;  // Sample indices restarted with a new run
+     }
+     _nextSample = firstSample;
+     arm();
+   }
+   _nextSample = firstSample + count;
+ 
+   uint32_t i = 0;
+   while (i < count) {
+     uint64_t index = firstSample + i;
+ 
+     switch (_state) {
+       case TRIGGER_STATE_PRETRIGGER: {
+         uint32_t n = _config.preSamples - _preCollected;
+         if (n > count - i) {
+           n = count - i;
+         }
+         append(&samples[i], n);
+         _preCollected += n;
+         i += n;
+ 
+         if (_preCollected >= _config.preSamples) {
+           _state = TRIGGER_STATE_ARMED;
+           _armedSample = firstSample + i;
+         }
+         break;
+       }
+ 
+       case TRIGGER_STATE_ARMED: {
+         uint32_t hit = count;
+         bool external = false;
+ 
+         // Offset of the first sample outside the holdoff
+         uint64_t earliest = (_holdoffEnd > _armedSample) ? _holdoffEnd : _armedSample;
+         uint32_t fireFrom = (earliest <= index) ? i :
+                             (earliest - firstSample < count) ? (uint32_t)(earliest - firstSample) : count;
+ 
+         if (_config.source == TRIGGER_SOURCE_IMMEDIATE) {
+           hit = fireFrom;
+         } else if (_config.source == TRIGGER_SOURCE_LEVEL) {
+           hit = findLevelCrossing(samples, i, count, fireFrom);
+         }
+ 
+         if (_externalPending) {
+           // Events from before the history was complete (or within the holdoff) fire at
+           // the earliest allowed point, events too old for the post window fire as late
+           // as the window allows
+           uint64_t eventSample = _externalSample;
+           if (eventSample < earliest) {
+             eventSample = earliest;
+           }
+           if (eventSample < index) {
+             uint64_t oldest = (index > _config.postSamples) ? index - _config.postSamples : 0;
+             if (eventSample < oldest) {
+               eventSample = oldest;
+             }
+             _externalPending = false;
+             fire(eventSample, true);
+             break;
+           }
+           if (eventSample < firstSample + hit) {
+             hit = (uint32_t)(eventSample - firstSample);
+             external = true;
+             _externalPending = false;
+           }
+         }
+ 
+         append(&samples[i], hit - i);
+         i = hit;
+         if (hit < count) {
+           fire(firstSample + hit, external);
+         }
+         break;
+       }
+ 
+       case TRIGGER_STATE_POSTTRIGGER: {
+         uint64_t remaining = (_windowEnd > index) ? _windowEnd - index : 0;
+         uint32_t n = (remaining < count - i) ? (uint32_t)remaining : count - i;
+         append(&samples[i], n);
+         i += n;
+ 
+         if (firstSample + i >= _windowEnd) {
+           _state = TRIGGER_STATE_DONE;
+           return true;
+         }
+         break;
+       }
+ 
+       case TRIGGER_STATE_IDLE:
+       case TRIGGER_STATE_DONE:
+       default:
+         return false;
+     }
+   }
+ 
+   return false;
+ }
+ 
+ uint64_t AdcTrigger::historyStart() const {
+   switch (_state) {
+     case TRIGGER_STATE_PRETRIGGER:
+       return _nextSample - _preCollected;
+     case TRIGGER_STATE_ARMED:
+       return (_nextSample > _config.preSamples) ? _nextSample - _config.preSamples : 0;
+     case TRIGGER_STATE_POSTTRIGGER:
+     case TRIGGER_STATE_DONE:
+       return _windowEnd - _config.preSamples - _config.postSamples;
+     case TRIGGER_STATE_IDLE:
+     default:
+       return _nextSample;
+   }
+ }
+ 
+ uint32_t AdcTrigger::readWindow(uint16_t *out, uint32_t maxSamples, AdcTriggerWindow_t *window) const {
+   if (_state != TRIGGER_STATE_DONE || out == NULL || _storage == NULL) {
+     return 0;
+   }
+ 
+   uint32_t total = _config.preSamples + _config.postSamples;
+   uint32_t n = (total < maxSamples) ? total : maxSamples;
+ 
+   // The window ends at the write position; copy its first n samples
+   uint32_t start = (_writePos + _capacity - total) % _capacity;
+   for (uint32_t i = 0; i < n; i++) {
+     out[i] = _storage[(start + i) % _capacity];
+   }
+ 
+   if (window != NULL) {
+     getWindow(window);
+     window->count = n;
+   }
+   return n;
+ }
+ 
+ bool AdcTrigger::getWindow(AdcTriggerWindow_t *window) const {
+   if (_state != TRIGGER_STATE_DONE || window == NULL) {
+     return false;
+   }
+ 
+   window->triggerSample = _triggerSample;
+   window->count = _config.preSamples + _config.postSamples;
+   window->firstSample = _windowEnd - window->count;
+   window->external = _triggerExternal;
+   return true;
+ }
\ No newline at end of file
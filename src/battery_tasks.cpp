@@ -4,12 +4,18 @@
 
  #include "battery_tasks.h"
  #include "freertos/task.h"
- #include "freertos/queue.h"
+ #include "freertos/semphr.h"
  #include "simplified_debug.h"
+ #include "seqlock.h"
+ #include "monotonic_time.h"
  
  // Static variables
  static MAX17048 *fuelGaugeInstance = NULL;
- static QueueHandle_t batteryQueue = NULL;
+ 
+ // Latest status, read by any task without a kernel call
+ static Seqlock<BatteryStatus_t> publishedStatus;
+ static uint32_t receivedVersion = 0;   // Last status handed out by receiveBatteryResults()
+ static SemaphoreHandle_t statusSignal = NULL;  // Given on every publish, wakes receiveBatteryResults()
  
  // Debug flag - set to true to see detailed alert handling logs
  static const bool DEBUG_ALERTS = true;
@@ -53,6 +59,7 @@
    // Create a local structure for battery status
    BatteryStatus_t battStatus;
    battStatus.success = false;
+   battStatus.timestampUs = monotonicUs();
    
    // Perform battery readings
    battStatus.voltage = fuelGaugeInstance->readVoltage();
@@ -117,11 +124,9 @@
        }
      }
      
-     // Send results to the queue
-     if (xQueueSend(batteryQueue, &battStatus, pdMS_TO_TICKS(100)) != pdPASS) {
-       //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to send battery status to queue!");
-       Serial.println("Failed to send battery status to queue!");
-     }
+     // Publish the results and wake a waiting receiver
+     publishedStatus.write(battStatus);
+     xSemaphoreGive(statusSignal);
    } else {
      //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Error reading battery status! Voltage: %u mV, SOC: %u%%", battStatus.voltage, battStatus.soc);
      Serial.println("Error reading battery status!");
@@ -135,6 +140,12 @@
  bool initBatteryModule(TwoWire &wire) {
    //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Battery module");
    
+   // Wakeup for receivers waiting on the next status
+   statusSignal = xSemaphoreCreateBinary();
+   if (statusSignal == NULL) {
+     return false;
+   }
+   
    // Create fuel gauge instance
    fuelGaugeInstance = new MAX17048(wire);
    if (fuelGaugeInstance == NULL) {
@@ -172,21 +183,12 @@
    fuelGaugeInstance->clearAlert();
    //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initial alerts cleared");
    
-   // Create queue for passing results
-   batteryQueue = xQueueCreate(1, sizeof(BatteryStatus_t));
-   if (batteryQueue == NULL) {
-     //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create battery queue - out of memory");
-     delete fuelGaugeInstance;
-     fuelGaugeInstance = NULL;
-     return false;
-   }
-   
    //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Battery module initialized successfully");
    return true;
  }
  
  bool createBatteryTask() {
-   if (fuelGaugeInstance == NULL || batteryQueue == NULL) {
+   if (fuelGaugeInstance == NULL) {
      //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot create Battery task - module not initialized");
      return false;
    }
@@ -212,23 +214,33 @@
  }
  
  bool receiveBatteryResults(BatteryStatus_t *result, TickType_t timeout) {
-   if (result == NULL || batteryQueue == NULL) {
+   if (result == NULL || fuelGaugeInstance == NULL) {
      //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Invalid Battery results receive request");
      return false;
    }
    
    //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Waiting for Battery results (timeout: %u ms)", timeout);
    
-   // Receive results from the queue
-   BaseType_t received = xQueueReceive(batteryQueue, result, timeout);
+   // Block until a status newer than the last one handed out is published
+   // (a signal left from a status already read just costs one more pass)
+   TickType_t start = xTaskGetTickCount();
+   while (!publishedStatus.readNewer(result, &receivedVersion)) {
+     TickType_t elapsed = xTaskGetTickCount() - start;
+     if (elapsed >= timeout || xSemaphoreTake(statusSignal, timeout - elapsed) != pdTRUE) {
+       //DEBUG_PRINT(DEBUG_LEVEL_WARN, "Timeout waiting for Battery results");
+       return false;
+     }
+   }
    
-   if (received != pdPASS) {
-     //DEBUG_PRINT(DEBUG_LEVEL_WARN, "Timeout waiting for Battery results");
-   } else {
-     //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Battery results received successfully");
+   return true;
+ }
+ 
+ bool getLatestBatteryStatus(BatteryStatus_t *status) {
+   if (status == NULL) {
+     return false;
    }
    
-   return (received == pdPASS);
+   return publishedStatus.read(status);
  }
  
  const char* getChargingStatusString(ChargingStatus_t status) {
@@ -0,0 +1,237 @@
+/*
+ * Burst Analyzer Implementation
+ *
+ * Edges only record offsets from the burst's first edge; all measurements
+ * are made once the burst is closed. Gap and extra pulse periods are left
+ * out of the drift fit and the duty cycle so a single fault does not skew
+ * the rhythm the rest of the burst is judged by. Everything is integer
+ * (64-bit sums of nanosecond periods), as the S3 has no double precision FPU.
+ */
+ 
+ #include "burst_analyzer.h"
+ #include "pulse_burst.h"
+ #include <string.h>
+ 
+ // Integer square root (floor)
+ static uint32_t isqrt64(uint64_t value) {
+   uint64_t result = 0;
+   uint64_t bit = (uint64_t)1 << 62;
+ 
+   while (bit > value) {
+     bit >>= 2;
+   }
+   while (bit != 0) {
+     if (value >= result + bit) {
+       value -= result + bit;
+       result = (result >> 1) + bit;
+     } else {
+       result >>= 1;
+     }
+     bit >>= 2;
+   }
+   return (uint32_t)result;
+ }
+ 
+ // Signed division rounded half away from zero (den > 0)
+ static inline int64_t divRound(int64_t num, int64_t den) {
+   return (num >= 0) ? (num + den / 2) / den : -((-num + den / 2) / den);
+ }
+ 
+ BurstAnalyzer::BurstAnalyzer()
+   : _gapTicks(0), _nsPerTickQ16(0), _startTicks(0), _lastTicks(0), _startRising(true), _lastRising(false),
+     _edgeCount(0), _pulseCount(0), _polarityErrors(0) {
+   memset(&_config, 0, sizeof(_config));
+   memset(&_result, 0, sizeof(_result));
+ }
+ 
+ bool BurstAnalyzer::configure(const BurstAnalyzerConfig_t *config) {
+   if (config == NULL || config->tickHz < 1000000 || config->gapUs == 0 ||
+       (uint64_t)config->gapUs * config->tickHz / 1000000 > 0x7FFFFFFF) {
+     return false;
+   }
+ 
+   _config = *config;
+   _gapTicks = (uint32_t)((uint64_t)config->gapUs * config->tickHz / 1000000);
+   _nsPerTickQ16 = pulseNsPerTickQ16(config->tickHz);
+   reset();
+   return true;
+ }
+ 
+ void BurstAnalyzer::reset() {
+   _edgeCount = 0;
+   _pulseCount = 0;
+   _polarityErrors = 0;
+   memset(&_result, 0, sizeof(_result));
+ }
+ 
+ bool BurstAnalyzer::addEdge(const BurstEdge_t *edge) {
+   bool closed = false;
+   if (_edgeCount > 0 && edge->ticks - _lastTicks > _gapTicks) {
+     closed = endBurst();
+   }
+ 
+   if (_edgeCount == 0) {
+     _startTicks = edge->ticks;
+     _startRising = edge->rising;
+     _lastRising = !edge->rising;
+     _pulseCount = 0;
+     _polarityErrors = 0;
+   }
+ 
+   if (edge->rising == _lastRising) {
+     _polarityErrors++;
+   }
+ 
+   uint32_t offset = edge->ticks - _startTicks;
+   if (edge->rising == _startRising) {
+     if (_pulseCount < BURST_ANALYZER_MAX_PULSES) {
+       _pulseStart[_pulseCount] = offset;
+       _pulseHigh[_pulseCount] = 0;
+     }
+     _pulseCount++;
+   } else if (_pulseCount > 0 && _pulseCount <= BURST_ANALYZER_MAX_PULSES &&
+              _pulseHigh[_pulseCount - 1] == 0) {
+     _pulseHigh[_pulseCount - 1] = offset - _pulseStart[_pulseCount - 1];
+   }
+ 
+   _lastTicks = edge->ticks;
+   _lastRising = edge->rising;
+   _edgeCount++;
+   return closed;
+ }
+ 
+ bool BurstAnalyzer::endBurst() {
+   if (_edgeCount == 0) {
+     return false;
+   }
+ 
+   analyze();
+   _edgeCount = 0;
+   _pulseCount = 0;
+   return true;
+ }
+ 
+ void BurstAnalyzer::analyze() {
+   BurstAnalysis_t *r = &_result;
+ 
+   r->startTicks = _startTicks;
+   r->edgeCount = _edgeCount;
+   r->pulseCount = _pulseCount;
+   r->measuredPulses = (_pulseCount < BURST_ANALYZER_MAX_PULSES) ? _pulseCount : BURST_ANALYZER_MAX_PULSES;
+   r->durationNs = pulseTicksToNs(_lastTicks - _startTicks, _nsPerTickQ16);
+   r->polarityErrors = _polarityErrors;
+   r->pulseCountError = _config.expectedPulses ? (int16_t)(_pulseCount - _config.expectedPulses) : 0;
+ 
+   uint16_t periods = (r->measuredPulses > 0) ? r->measuredPulses - 1 : 0;
+   for (uint16_t i = 0; i < r->measuredPulses; i++) {
+     r->periodNs[i] = (i < periods) ? pulseTicksToNs(_pulseStart[i + 1] - _pulseStart[i], _nsPerTickQ16) : 0;
+     r->highNs[i] = pulseTicksToNs(_pulseHigh[i], _nsPerTickQ16);
+   }
+ 
+   r->meanPeriodNs = 0;
+   if (periods) {
+     uint64_t span = (uint64_t)(_pulseStart[periods] - _pulseStart[0]) * _nsPerTickQ16;
+     uint64_t ns = (span + ((uint64_t)periods << 15)) / ((uint64_t)periods << 16);
+     r->meanPeriodNs = (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+   }
+   r->medianPeriodNs = 0;
+   r->driftPsPerPulse = 0;
+   r->jitterRmsNs = 0;
+   r->jitterPeakNs = 0;
+   r->dutyCycleQ16 = 0;
+   r->missingPulses = 0;
+   r->extraPulses = 0;
+   if (periods == 0) {
+     return;
+   }
+ 
+   // Median period (insertion sort of a copy, at most 63 entries)
+   uint32_t sorted[BURST_ANALYZER_MAX_PULSES];
+   for (uint16_t i = 0; i < periods; i++) {
+     uint32_t value = r->periodNs[i];
+     int j = i - 1;
+     while (j >= 0 && sorted[j] > value) {
+       sorted[j + 1] = sorted[j];
+       j--;
+     }
+     sorted[j + 1] = value;
+   }
+   uint32_t median = (periods & 1) ? sorted[periods / 2] :
+                     sorted[periods / 2 - 1] + (sorted[periods / 2] - sorted[periods / 2 - 1] + 1) / 2;
+   r->medianPeriodNs = median;
+   if (median == 0) {
+     return;
+   }
+ 
+   // Classify periods against the rhythm, fit a line through the normal ones
+   // (x is the period index, y the period in nanoseconds)
+   const uint64_t gapLimit = (uint64_t)BURST_ANALYZER_GAP_QUARTERS * median;
+   const uint64_t extraLimit = (uint64_t)BURST_ANALYZER_EXTRA_QUARTERS * median;
+   bool normal[BURST_ANALYZER_MAX_PULSES];
+   int64_t sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+   uint16_t fitted = 0;
+   for (uint16_t i = 0; i < periods; i++) {
+     uint32_t p = r->periodNs[i];
+     normal[i] = false;
+     if ((uint64_t)p * 4 > gapLimit) {
+       r->missingPulses += (uint16_t)(((uint64_t)p + median / 2) / median - 1);
+     } else if ((uint64_t)p * 4 < extraLimit) {
+       // An extra pulse splits one period in two; take both halves together
+       r->extraPulses++;
+       if (i + 1 < periods && ((uint64_t)p + r->periodNs[i + 1]) * 4 < gapLimit) {
+         normal[++i] = false;
+       }
+     } else {
+       normal[i] = true;
+       sumX += i;
+       sumY += p;
+       sumXX += (int64_t)i * i;
+       sumXY += (int64_t)i * p;
+       fitted++;
+     }
+   }
+   if (fitted == 0) {
+     return;
+   }
+ 
+   // Slope and intercept in 1/1024 ns, so sub-nanosecond drift is kept and the
+   // per-period deviations below round with a shift instead of a division
+   int64_t slopeQ10 = 0;
+   int64_t denominator = fitted * sumXX - sumX * sumX;
+   if (fitted >= 3 && denominator > 0) {
+     slopeQ10 = divRound((fitted * sumXY - sumX * sumY) << 10, denominator);
+   }
+   int64_t interceptQ10 = divRound((sumY << 10) - slopeQ10 * sumX, fitted);
+   int64_t driftPs = divRound(slopeQ10 * 1000, 1024);
+   r->driftPsPerPulse = (driftPs > INT32_MAX) ? INT32_MAX : (driftPs < INT32_MIN) ? INT32_MIN : (int32_t)driftPs;
+ 
+   // Jitter around the fitted period (whole nanoseconds), duty cycle from the normal pulses
+   uint64_t sumSq = 0, sumHigh = 0;
+   uint32_t peak = 0;
+   uint16_t highs = 0;
+   for (uint16_t i = 0; i < periods; i++) {
+     if (!normal[i]) {
+       continue;
+     }
+     int64_t deviationQ10 = ((int64_t)r->periodNs[i] << 10) - (interceptQ10 + slopeQ10 * i);
+     uint32_t magnitude = (uint32_t)((((deviationQ10 < 0) ? -deviationQ10 : deviationQ10) + 512) >> 10);
+     sumSq += (uint64_t)magnitude * magnitude;
+     if (magnitude > peak) {
+       peak = magnitude;
+     }
+     if (_pulseHigh[i] != 0) {
+       sumHigh += r->highNs[i];
+       highs++;
+     }
+   }
+   // Rounded root of the mean square: up to r + 1 once it passes (r + 1/2)^2
+   uint64_t meanSq = (sumSq + fitted / 2) / fitted;
+   uint32_t rms = isqrt64(meanSq);
+   r->jitterRmsNs = (meanSq - (uint64_t)rms * rms > rms) ? rms + 1 : rms;
+   r->jitterPeakNs = peak;
+   if (highs > 0 && sumY > 0) {
+     // (sumHigh / highs) / (sumY / fitted) in Q16.16
+     uint64_t den = (uint64_t)highs * (uint64_t)sumY;
+     r->dutyCycleQ16 = (uint32_t)(((sumHigh * fitted << 16) + den / 2) / den);
+   }
+ }
\ No newline at end of file
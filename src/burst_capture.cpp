@@ -0,0 +1,271 @@
+/*
+ * Burst Capture Module Implementation
+ *
+ * The pulse ISR pushes every edge into a lock-free ring; the ADC consumer
+ * task drains it before each block, converting burst starts onto the sample
+ * clock. Windows are extracted once their last sample has arrived and held
+ * back briefly until the pulse task reports the burst result, which only
+ * comes PULSE_BURST_TIMEOUT_US after the last edge.
+ */
+ 
+ #include "burst_capture.h"
+ #include "adc_capture.h"
+ #include "freertos/queue.h"
+ #include "freertos/semphr.h"
+ #include "simplified_debug.h"
+ #include "spsc_ring.h"
+ 
+ #define BURST_CAPTURE_HISTORY_SAMPLES (BURST_CAPTURE_MAX_WINDOW_SAMPLES + 2 * ADC_CAPTURE_BLOCK_SAMPLES)
+ 
+ // Longest wait for a burst result: 40 pulses at the slowest pulse rate, plus the end timeout
+ #define BURST_CAPTURE_TAG_TIMEOUT_US 2000000
+ 
+ // Edge ring entry
+ typedef struct {
+   uint32_t timeUs;
+   bool burstStart;
+ } BurstEdgeEvent_t;
+ 
+ // Static variables
+ static BurstSync burstSync;
+ static QueueHandle_t recordQueue = NULL;
+ static SemaphoreHandle_t bufferMutex = NULL;
+ static portMUX_TYPE burstCaptureMux = portMUX_INITIALIZER_UNLOCKED;
+ static volatile bool captureEnabled = false;
+ static bool averageAvailable = false;
+ 
+ // Edge ring (single producer: pulse ISR, single consumer: ADC task)
+ static SpscRing<BurstEdgeEvent_t, BURST_CAPTURE_EDGE_RING_SIZE> edgeRing;
+ static volatile uint32_t edgesLost = 0;
+ 
+ // Requests and tags handed to the consumer task (protected by burstCaptureMux)
+ static BurstSyncConfig_t pendingConfig;
+ static bool configPending = false;
+ static PulseBurstResult_t latestTag;
+ static bool tagAvailable = false;
+ 
+ // Window waiting for its burst result (consumer task only)
+ static BurstCaptureRecord_t heldRecord;
+ static bool recordHeld = false;
+ 
+ // Attach the burst result if the pulse task has reported the matching burst
+ static bool tagRecord(BurstCaptureRecord_t *record) {
+   // Windows are stamped with micros(), the low word of the result's clock
+   portENTER_CRITICAL(&burstCaptureMux);
+   if (tagAvailable && (uint32_t)latestTag.burstStartUs == record->window.startUs) {
+     record->burst = latestTag;
+     record->tagged = true;
+     tagAvailable = false;
+   }
+   portEXIT_CRITICAL(&burstCaptureMux);
+ 
+   return record->tagged;
+ }
+ 
+ // ADC block consumer - aligns windows to the bursts reported by the pulse ISR
+ static void burstCaptureBlockConsumer(const AdcBlock_t *block, void *context) {
+   BurstSyncConfig_t config;
+   bool applyConfig;
+ 
+   portENTER_CRITICAL(&burstCaptureMux);
+   applyConfig = configPending;
+   config = pendingConfig;
+   configPending = false;
+   portEXIT_CRITICAL(&burstCaptureMux);
+ 
+   if (!captureEnabled || block->sampleRateHz == 0) {
+     edgeRing.clear();
+     return;
+   }
+ 
+   // Readers copy under the mutex; give up on this block rather than stall the ADC task
+   if (xSemaphoreTake(bufferMutex, pdMS_TO_TICKS(2)) != pdTRUE) {
+     return;
+   }
+ 
+   if (applyConfig) {
+     burstSync.configure(&config);
+     averageAvailable = false;
+   }
+ 
+   // Drain edges - a start maps onto the sample clock of this block
+   BurstEdgeEvent_t event;
+   while (edgeRing.pop(&event)) {
+     uint64_t index;
+     if (event.burstStart &&
+         burstSyncSampleIndex(event.timeUs, block->timestampUs, block->firstSample, block->sampleRateHz, &index)) {
+       burstSync.burstStart(index, event.timeUs);
+     }
+     burstSync.edge(event.timeUs);
+   }
+ 
+   burstSync.processBlock(block->samples, block->count, block->firstSample);
+ 
+   // A held window goes out once tagged, or untagged when the result never comes
+   if (recordHeld && (tagRecord(&heldRecord) ||
+                      block->timestampUs - heldRecord.window.startUs > BURST_CAPTURE_TAG_TIMEOUT_US)) {
+     xQueueSend(recordQueue, &heldRecord, 0);
+     recordHeld = false;
+   }
+ 
+   while (burstSync.completeWindow()) {
+     if (recordHeld) {
+       xQueueSend(recordQueue, &heldRecord, 0);
+       recordHeld = false;
+     }
+ 
+     BurstCaptureRecord_t record;
+     record.window = burstSync.lastRecord();
+     record.tagged = false;
+     record.sampleRateHz = block->sampleRateHz;
+     record.averageReady = burstSync.averageReady();
+     record.missedWindows = burstSync.missedWindows();
+     if (record.averageReady) {
+       averageAvailable = true;
+     }
+ 
+     if (tagRecord(&record)) {
+       xQueueSend(recordQueue, &record, 0);
+     } else {
+       heldRecord = record;
+       recordHeld = true;
+     }
+   }
+ 
+   xSemaphoreGive(bufferMutex);
+ }
+ 
+ bool initBurstCaptureModule() {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Burst Capture module");
+ 
+   BurstSyncBuffers_t buffers;
+   buffers.historySamples = BURST_CAPTURE_HISTORY_SAMPLES;
+   buffers.maxWindowSamples = BURST_CAPTURE_MAX_WINDOW_SAMPLES;
+   buffers.history = (uint16_t *)heap_caps_malloc(BURST_CAPTURE_HISTORY_SAMPLES * sizeof(uint16_t),
+                                                  MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   buffers.window = (uint16_t *)heap_caps_malloc(BURST_CAPTURE_MAX_WINDOW_SAMPLES * sizeof(uint16_t),
+                                                 MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   buffers.sums = (uint32_t *)heap_caps_malloc(BURST_CAPTURE_MAX_WINDOW_SAMPLES * sizeof(uint32_t),
+                                               MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   buffers.average = (float *)heap_caps_malloc(BURST_CAPTURE_MAX_WINDOW_SAMPLES * sizeof(float),
+                                               MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   recordQueue = xQueueCreate(BURST_CAPTURE_RECORD_QUEUE_LEN, sizeof(BurstCaptureRecord_t));
+   bufferMutex = xSemaphoreCreateMutex();
+ 
+   if (buffers.history == NULL || buffers.window == NULL || buffers.sums == NULL ||
+       buffers.average == NULL || recordQueue == NULL || bufferMutex == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to allocate burst capture buffers - out of memory");
+     heap_caps_free(buffers.history);
+     heap_caps_free(buffers.window);
+     heap_caps_free(buffers.sums);
+     heap_caps_free(buffers.average);
+     if (recordQueue != NULL) {
+       vQueueDelete(recordQueue);
+       recordQueue = NULL;
+     }
+     if (bufferMutex != NULL) {
+       vSemaphoreDelete(bufferMutex);
+       bufferMutex = NULL;
+     }
+     return false;
+   }
+ 
+   burstSync.begin(&buffers);
+ 
+   BurstSyncConfig_t config;
+   config.preSamples = BURST_CAPTURE_DEFAULT_PRE_SAMPLES;
+   config.windowSamples = BURST_CAPTURE_DEFAULT_WINDOW_SAMPLES;
+   config.averageCount = BURST_CAPTURE_DEFAULT_AVERAGE;
+   burstSync.configure(&config);
+ 
+   if (!registerAdcBlockConsumer(burstCaptureBlockConsumer, NULL)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to register burst capture as ADC consumer");
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Burst Capture module initialized successfully");
+   return true;
+ }
+ 
+ bool configureBurstCapture(const BurstSyncConfig_t *config) {
+   if (recordQueue == NULL || config == NULL || config->windowSamples == 0 ||
+       config->windowSamples > BURST_CAPTURE_MAX_WINDOW_SAMPLES ||
+       config->preSamples >= config->windowSamples || config->averageCount == 0) {
+     return false;
+   }
+ 
+   portENTER_CRITICAL(&burstCaptureMux);
+   pendingConfig = *config;
+   configPending = true;
+   portEXIT_CRITICAL(&burstCaptureMux);
+   return true;
+ }
+ 
+ void setBurstCaptureEnabled(bool enable) {
+   captureEnabled = enable && (recordQueue != NULL);
+ }
+ 
+ void IRAM_ATTR burstCaptureEdge(uint32_t timeUs, bool burstStart) {
+   if (!captureEnabled) {
+     return;
+   }
+ 
+   BurstEdgeEvent_t event;
+   event.timeUs = timeUs;
+   event.burstStart = burstStart;
+   if (!edgeRing.push(event)) {
+     edgesLost++;
+   }
+ }
+ 
+ void burstCaptureTagResult(const PulseBurstResult_t *result) {
+   if (result == NULL || !captureEnabled) {
+     return;
+   }
+ 
+   portENTER_CRITICAL(&burstCaptureMux);
+   latestTag = *result;
+   tagAvailable = true;
+   portEXIT_CRITICAL(&burstCaptureMux);
+ }
+ 
+ bool waitForBurstCapture(BurstCaptureRecord_t *record, TickType_t timeout) {
+   if (recordQueue == NULL || record == NULL) {
+     return false;
+   }
+ 
+   return xQueueReceive(recordQueue, record, timeout) == pdTRUE;
+ }
+ 
+ uint32_t readBurstCaptureWindow(uint16_t *out, uint32_t maxSamples) {
+   if (bufferMutex == NULL || out == NULL || xSemaphoreTake(bufferMutex, portMAX_DELAY) != pdTRUE) {
+     return 0;
+   }
+ 
+   uint32_t n = burstSync.config().windowSamples;
+   if (burstSync.lastRecord().windowNumber == 0) {
+     n = 0;
+   }
+   if (n > maxSamples) {
+     n = maxSamples;
+   }
+   memcpy(out, burstSync.window(), n * sizeof(uint16_t));
+ 
+   xSemaphoreGive(bufferMutex);
+   return n;
+ }
+ 
+ uint32_t readBurstCaptureAverage(float *out, uint32_t maxSamples) {
+   if (bufferMutex == NULL || out == NULL || xSemaphoreTake(bufferMutex, portMAX_DELAY) != pdTRUE) {
+     return 0;
+   }
+ 
+   uint32_t n = averageAvailable ? burstSync.config().windowSamples : 0;
+   if (n > maxSamples) {
+     n = maxSamples;
+   }
+   memcpy(out, burstSync.average(), n * sizeof(float));
+ 
+   xSemaphoreGive(bufferMutex);
+   return n;
+ }
\ No newline at end of file
@@ -0,0 +1,172 @@
+/*
+ * Burst Sync Implementation
+ */
+ 
+ #include "burst_sync.h"
+ #include <string.h>
+ 
+ BurstSync::BurstSync()
+   : _writePos(0), _historyCount(0), _nextSample(0), _pendingHead(0), _pendingCount(0),
+     _windowNumber(0), _windowsInAverage(0), _averagesCompleted(0), _missedWindows(0),
+     _averageReady(false) {
+   memset(&_buffers, 0, sizeof(_buffers));
+   memset(&_record, 0, sizeof(_record));
+   _config.preSamples = 0;
+   _config.windowSamples = 0;
+   _config.averageCount = 1;
+ }
+ 
+ bool BurstSync::begin(const BurstSyncBuffers_t *buffers) {
+   if (buffers == NULL || buffers->history == NULL || buffers->window == NULL ||
+       buffers->sums == NULL || buffers->average == NULL ||
+       buffers->maxWindowSamples == 0 || buffers->historySamples < buffers->maxWindowSamples) {
+     return false;
+   }
+ 
+   _buffers = *buffers;
+   _config.windowSamples = 0;
+   reset();
+   return true;
+ }
+ 
+ bool BurstSync::configure(const BurstSyncConfig_t *config) {
+   if (_buffers.history == NULL || config == NULL || config->windowSamples == 0 ||
+       config->windowSamples > _buffers.maxWindowSamples ||
+       config->preSamples >= config->windowSamples || config->averageCount == 0) {
+     return false;
+   }
+ 
+   _config = *config;
+   reset();
+   return true;
+ }
+ 
+ void BurstSync::reset() {
+   _writePos = 0;
+   _historyCount = 0;
+   _pendingHead = 0;
+   _pendingCount = 0;
+   _windowsInAverage = 0;
+   _averageReady = false;
+ 
+   if (_buffers.sums != NULL && _config.windowSamples > 0) {
+     memset(_buffers.sums, 0, _config.windowSamples * sizeof(uint32_t));
+   }
+ }
+ 
+ bool BurstSync::burstStart(uint64_t sampleIndex, uint32_t timeUs) {
+   if (_config.windowSamples == 0) {
+     return false;
+   }
+ 
+   if (_pendingCount >= BURST_SYNC_MAX_PENDING) {
+     _missedWindows++;
+     return false;
+   }
+ 
+   BurstSyncRecord_t *record = &_pending[(_pendingHead + _pendingCount) % BURST_SYNC_MAX_PENDING];
+   record->startSample = sampleIndex;
+   record->startUs = timeUs;
+   record->edgeCount = 0;
+   _pendingCount++;
+   return true;
+ }
+ 
+ void BurstSync::edge(uint32_t timeUs) {
+   if (_pendingCount == 0) {
+     return;
+   }
+ 
+   BurstSyncRecord_t *record = &_pending[(_pendingHead + _pendingCount - 1) % BURST_SYNC_MAX_PENDING];
+   if (record->edgeCount < BURST_SYNC_MAX_EDGES) {
+     record->edgeOffsetUs[record->edgeCount++] = timeUs - record->startUs;
+   }
+ }
+ 
+ void BurstSync::processBlock(const uint16_t *samples, uint32_t count, uint64_t firstSample) {
+   if (_buffers.history == NULL || samples == NULL || count == 0) {
+     return;
+   }
+ 
+   // Dropped samples break the history - windows spanning the gap are lost
+   if (firstSample != _nextSample) {
+     _missedWindows += _pendingCount;
+     _pendingCount = 0;
+     _writePos = 0;
+     _historyCount = 0;
+   }
+   _nextSample = firstSample + count;
+ 
+   uint32_t capacity = _buffers.historySamples;
+   if (count > capacity) {
+     samples += count - capacity;
+     count = capacity;
+   }
+ 
+   uint32_t first = capacity - _writePos;
+   if (first > count) {
+     first = count;
+   }
+   memcpy(&_buffers.history[_writePos], samples, first * sizeof(uint16_t));
+   if (count > first) {
+     memcpy(_buffers.history, samples + first, (count - first) * sizeof(uint16_t));
+   }
+ 
+   _writePos = (_writePos + count) % capacity;
+   _historyCount = (_historyCount + count > capacity) ? capacity : _historyCount + count;
+ }
+ 
+ bool BurstSync::completeWindow() {
+   _averageReady = false;
+ 
+   while (_pendingCount > 0) {
+     BurstSyncRecord_t *record = &_pending[_pendingHead];
+     uint64_t oldest = _nextSample - _historyCount;
+ 
+     // Bursts too close to the start of the history can never be completed
+     if (record->startSample < oldest + _config.preSamples) {
+       _pendingHead = (_pendingHead + 1) % BURST_SYNC_MAX_PENDING;
+       _pendingCount--;
+       _missedWindows++;
+       continue;
+     }
+ 
+     uint64_t start = record->startSample - _config.preSamples;
+     if (start + _config.windowSamples > _nextSample) {
+       return false;
+     }
+ 
+     // Copy out of the ring and accumulate in one pass
+     uint32_t capacity = _buffers.historySamples;
+     uint32_t pos = (uint32_t)((_writePos + capacity - (uint32_t)(_nextSample - start)) % capacity);
+     uint16_t *window = _buffers.window;
+     uint32_t *sums = _buffers.sums;
+     for (uint32_t i = 0; i < _config.windowSamples; i++) {
+       uint16_t s = _buffers.history[pos];
+       window[i] = s;
+       sums[i] += s;
+       if (++pos == capacity) {
+         pos = 0;
+       }
+     }
+ 
+     _record = *record;
+     _record.windowNumber = ++_windowNumber;
+     _pendingHead = (_pendingHead + 1) % BURST_SYNC_MAX_PENDING;
+     _pendingCount--;
+ 
+     if (++_windowsInAverage >= _config.averageCount) {
+       float scale = 1.0f / (float)_windowsInAverage;
+       for (uint32_t i = 0; i < _config.windowSamples; i++) {
+         _buffers.average[i] = (float)sums[i] * scale;
+         sums[i] = 0;
+       }
+       _windowsInAverage = 0;
+       _averagesCompleted++;
+       _averageReady = true;
+     }
+     return true;
+   }
+ 
+   return false;
+ }
\ No newline at end of file
@@ -0,0 +1,684 @@
+/*
+ * Capture Control Module Implementation
+ *
+ * The control task owns the ADC engine and the scope while a request runs.
+ * It sleeps on its task notification: command requests, scope completions
+ * and the end of counted captures each set their own bit, so nothing is
+ * polled. Short captures are scope windows (an immediate trigger when the
+ * request has none) copied into the result buffer before the next capture
+ * is armed. Longer untriggered captures are counted by a block consumer.
+ */
+ 
+ #include "capture_control.h"
+ #include "adc_capture.h"
+ #include "serial_command.h"
+ #include "freertos/queue.h"
+ #include "freertos/semphr.h"
+ #include "esp_heap_caps.h"
+ #include "simplified_debug.h"
+ 
+ // Control task notification bits
+ #define CAPTURE_EVENT_COMMAND 0x01  // Command queued
+ #define CAPTURE_EVENT_SCOPE   0x02  // Scope window complete
+ #define CAPTURE_EVENT_COUNT   0x04  // Counted capture complete
+ 
+ // Commands for the control task
+ typedef enum {
+   CAPTURE_COMMAND_START,
+   CAPTURE_COMMAND_STOP,
+   CAPTURE_COMMAND_ARM
+ } CaptureCommandType_t;
+ 
+ typedef struct {
+   CaptureCommandType_t type;
+   CaptureRequest_t request;
+ } CaptureCommand_t;
+ 
+ // Completed counted capture, handed from the consumer to the control task
+ typedef struct {
+   uint64_t firstSample;
+   uint32_t sampleCount;
+   uint32_t sampleRateHz;
+   uint32_t timestampUs;
+   uint32_t droppedSamples;
+ } CaptureCount_t;
+ 
+ // Static variables
+ static TaskHandle_t controlTaskHandle = NULL;
+ static QueueHandle_t commandQueue = NULL;
+ static SemaphoreHandle_t resultMutex = NULL;
+ static uint16_t *heldSamples = NULL;
+ static uint32_t heldCount = 0;
+ static CaptureResult_t heldResult;
+ static uint32_t serialEventBit = 0;
+ static portMUX_TYPE controlMux = portMUX_INITIALIZER_UNLOCKED;
+ 
+ // Shared with other tasks (protected by controlMux)
+ static CaptureStatus_t controlStatus;
+ static CaptureResult_t lastResult;
+ static bool resultValid = false;
+ static TaskHandle_t listenerTask = NULL;
+ static uint32_t listenerBits = 0;
+ 
+ // Counted capture hand-over (protected by controlMux)
+ static bool countStartPending = false;
+ static bool countCancelPending = false;
+ static uint32_t countStartSamples = 0;
+ static CaptureCount_t countDone;
+ 
+ // Consumer task state
+ static bool countActive = false;
+ static uint64_t countNext = 0;
+ static uint32_t countRemaining = 0;
+ static CaptureCount_t countRun;
+ 
+ // Control task state
+ static CaptureRequest_t activeRequest;
+ static CaptureRequest_t lastRequest;
+ static bool haveLastRequest = false;
+ static bool usingScope = false;
+ static uint32_t engineRateHz = 0;
+ 
+ // ADC block consumer - counts the samples of long untriggered captures
+ static void captureBlockConsumer(const AdcBlock_t *block, void *context) {
+   bool start, cancel;
+   uint32_t samples;
+ 
+   portENTER_CRITICAL(&controlMux);
+   start = countStartPending;
+   cancel = countCancelPending;
+   samples = countStartSamples;
+   countStartPending = countCancelPending = false;
+   portEXIT_CRITICAL(&controlMux);
+ 
+   if (cancel) {
+     countActive = false;
+   }
+   if (start) {
+     countActive = true;
+     countNext = block->firstSample;
+     countRemaining = samples;
+     countRun.firstSample = block->firstSample;
+     countRun.sampleCount = samples;
+     countRun.sampleRateHz = block->sampleRateHz;
+     countRun.timestampUs = block->timestampUs;
+     countRun.droppedSamples = 0;
+   }
+   if (!countActive) {
+     return;
+   }
+ 
+   // Samples discarded by the engine show up as a jump in the sample index
+   if (block->firstSample != countNext) {
+     if (block->firstSample < countNext) {
+       countActive = false;  // Engine restarted under the capture
+       return;
+     }
+     uint64_t gap = block->firstSample - countNext;
+     uint32_t lost = (gap < countRemaining) ? (uint32_t)gap : countRemaining;
+     countRun.droppedSamples += lost;
+     countRemaining -= lost;
+   }
+ 
+   uint32_t used = (block->count < countRemaining) ? block->count : countRemaining;
+   countRemaining -= used;
+   countNext = block->firstSample + block->count;
+ 
+   if (countRemaining == 0) {
+     countActive = false;
+     portENTER_CRITICAL(&controlMux);
+     countDone = countRun;
+     portEXIT_CRITICAL(&controlMux);
+     xTaskNotify(controlTaskHandle, CAPTURE_EVENT_COUNT, eSetBits);
+   }
+ }
+ 
+ static void setState(CaptureState_t state) {
+   portENTER_CRITICAL(&controlMux);
+   controlStatus.state = state;
+   portEXIT_CRITICAL(&controlMux);
+ }
+ 
+ // Run the engine at the requested rate, restarting it if the rate differs
+ static bool engineStart(uint32_t sampleRateHz) {
+   if (isAdcCaptureRunning()) {
+     if (engineRateHz == sampleRateHz) {
+       return true;
+     }
+     stopAdcCapture();
+   }
+ 
+   if (!startAdcCapture(sampleRateHz)) {
+     engineRateHz = 0;
+     return false;
+   }
+   engineRateHz = sampleRateHz;
+   return true;
+ }
+ 
+ static void engineStop() {
+   if (isAdcCaptureRunning()) {
+     stopAdcCapture();
+   }
+   engineRateHz = 0;
+ }
+ 
+ // Abandon the capture in progress
+ static void cancelCapture() {
+   if (usingScope) {
+     disarmScopeCapture();
+   }
+   portENTER_CRITICAL(&controlMux);
+   countStartPending = false;
+   countCancelPending = true;
+   portEXIT_CRITICAL(&controlMux);
+ }
+ 
+ // Arm the next capture of the active request
+ static bool armNextCapture() {
+   if (activeRequest.sampleCount == 0) {
+     setState(CAPTURE_STATE_STREAMING);
+     return true;
+   }
+ 
+   if (usingScope) {
+     if (!armScopeCapture()) {
+       return false;
+     }
+   } else {
+     portENTER_CRITICAL(&controlMux);
+     countStartSamples = activeRequest.sampleCount;
+     countStartPending = true;
+     countCancelPending = false;
+     portEXIT_CRITICAL(&controlMux);
+   }
+   setState(CAPTURE_STATE_CAPTURING);
+   return true;
+ }
+ 
+ static void finishRequest() {
+   cancelCapture();
+   engineStop();
+   setState(CAPTURE_STATE_IDLE);
+ }
+ 
+ static void beginRequest(const CaptureRequest_t *request) {
+   cancelCapture();
+ 
+   activeRequest = *request;
+   lastRequest = *request;
+   haveLastRequest = true;
+   usingScope = request->sampleCount > 0 && request->sampleCount <= CAPTURE_MAX_HELD_SAMPLES;
+ 
+   portENTER_CRITICAL(&controlMux);
+   controlStatus.request = *request;
+   controlStatus.completed = 0;
+   portEXIT_CRITICAL(&controlMux);
+ 
+   if (usingScope) {
+     ScopeCaptureConfig_t config;
+     config.trigger.source = (request->trigger == CAPTURE_TRIGGER_LEVEL) ? TRIGGER_SOURCE_LEVEL :
+                             (request->trigger == CAPTURE_TRIGGER_EXTERNAL) ? TRIGGER_SOURCE_EXTERNAL :
+                             TRIGGER_SOURCE_IMMEDIATE;
+     config.trigger.slope = request->slope;
+     config.trigger.level = request->level;
+     config.trigger.hysteresis = SCOPE_DEFAULT_HYSTERESIS;
+     config.trigger.preSamples = (request->trigger == CAPTURE_TRIGGER_NONE) ? 0 : request->preSamples;
+     config.trigger.postSamples = request->sampleCount - config.trigger.preSamples;
+     config.trigger.holdoffSamples = request->holdoffSamples;
+     config.externalEvents = (request->trigger == CAPTURE_TRIGGER_EXTERNAL) ? request->externalEvents : 0;
+     if (!configureScopeCapture(&config)) {
+       DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Capture request rejected by the scope");
+       finishRequest();
+       return;
+     }
+   }
+ 
+   if (!engineStart(request->sampleRateHz)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Capture request failed - ADC did not start at %lu Hz",
+                 request->sampleRateHz);
+     finishRequest();
+     return;
+   }
+ 
+   if (!armNextCapture()) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Capture request failed - could not arm the first capture");
+     finishRequest();
+     return;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Capture request started: %lu Hz, %lu samples, %lu captures",
+               request->sampleRateHz, request->sampleCount, request->repeat);
+ }
+ 
+ // Publish a completed capture, notify, then re-arm or end the request
+ static void completeCapture(CaptureResult_t *result) {
+   uint32_t completed;
+ 
+   portENTER_CRITICAL(&controlMux);
+   completed = ++controlStatus.completed;
+   result->captureNumber = ++controlStatus.captureNumber;
+   portEXIT_CRITICAL(&controlMux);
+ 
+   result->runIndex = completed;
+   result->last = activeRequest.repeat != 0 && completed >= activeRequest.repeat;
+ 
+   // Copy the scope window before the next arm reuses its history
+   if (result->held) {
+     xSemaphoreTake(resultMutex, portMAX_DELAY);
+     heldCount = readScopeCapture(heldSamples, CAPTURE_MAX_HELD_SAMPLES);
+     heldResult = *result;
+     xSemaphoreGive(resultMutex);
+   }
+ 
+   if (result->last) {
+     finishRequest();
+   } else if (!armNextCapture()) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Capture run ended - could not re-arm");
+     result->last = true;
+     finishRequest();
+   }
+ 
+   portENTER_CRITICAL(&controlMux);
+   lastResult = *result;
+   resultValid = true;
+   TaskHandle_t task = listenerTask;
+   uint32_t bits = listenerBits;
+   portEXIT_CRITICAL(&controlMux);
+ 
+   if (activeRequest.notifyTask != NULL) {
+     xTaskNotify(activeRequest.notifyTask, activeRequest.notifyBits, eSetBits);
+   }
+   if (task != NULL) {
+     xTaskNotify(task, bits, eSetBits);
+   }
+ }
+ 
+ static void handleCommand(const CaptureCommand_t *command) {
+   switch (command->type) {
+     case CAPTURE_COMMAND_START:
+       beginRequest(&command->request);
+       break;
+ 
+     case CAPTURE_COMMAND_STOP:
+       finishRequest();
+       DEBUG_PRINT(DEBUG_LEVEL_INFO, "Capture stopped");
+       break;
+ 
+     case CAPTURE_COMMAND_ARM:
+       if (haveLastRequest) {
+         CaptureRequest_t request = lastRequest;
+         beginRequest(&request);
+       }
+       break;
+   }
+ }
+ 
+ static void handleScopeCapture() {
+   ScopeCaptureInfo_t info;
+   if (!waitForScopeCapture(&info, 0)) {
+     return;
+   }
+ 
+   CaptureState_t state;
+   portENTER_CRITICAL(&controlMux);
+   state = controlStatus.state;
+   portEXIT_CRITICAL(&controlMux);
+   if (!usingScope || state != CAPTURE_STATE_CAPTURING) {
+     return;  // Window of a request that has been replaced or stopped
+   }
+ 
+   CaptureResult_t result;
+   result.held = true;
+   result.triggered = activeRequest.trigger != CAPTURE_TRIGGER_NONE;
+   result.eventSource = info.eventSource;
+   result.firstSample = info.window.firstSample;
+   result.sampleCount = info.window.count;
+   result.sampleRateHz = info.sampleRateHz;
+   result.triggerSample = info.window.triggerSample;
+   result.triggerTimeUs = info.triggerTimeUs;
+   result.droppedSamples = 0;
+   completeCapture(&result);
+ }
+ 
+ static void handleCountedCapture() {
+   CaptureCount_t count;
+   portENTER_CRITICAL(&controlMux);
+   count = countDone;
+   CaptureState_t state = controlStatus.state;
+   portEXIT_CRITICAL(&controlMux);
+ 
+   if (usingScope || state != CAPTURE_STATE_CAPTURING) {
+     return;
+   }
+ 
+   CaptureResult_t result;
+   result.held = false;
+   result.triggered = false;
+   result.eventSource = 0;
+   result.firstSample = count.firstSample;
+   result.sampleCount = count.sampleCount;
+   result.sampleRateHz = count.sampleRateHz;
+   result.triggerSample = count.firstSample;
+   result.triggerTimeUs = count.timestampUs;
+   result.droppedSamples = count.droppedSamples;
+   completeCapture(&result);
+ }
+ 
+ // Capture control task - sleeps until a command or a completion is notified
+ static void captureControlTask(void *pvParameters) {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Capture Control task started");
+ 
+   while (1) {
+     uint32_t events = 0;
+     xTaskNotifyWait(0, 0xFFFFFFFF, &events, portMAX_DELAY);
+ 
+     // Completions first, so a capture that finished is reported before a new command replaces it
+     if (events & CAPTURE_EVENT_SCOPE) {
+       handleScopeCapture();
+     }
+     if (events & CAPTURE_EVENT_COUNT) {
+       handleCountedCapture();
+     }
+ 
+     CaptureCommand_t command;
+     while (xQueueReceive(commandQueue, &command, 0) == pdTRUE) {
+       handleCommand(&command);
+     }
+   }
+ }
+ 
+ static bool queueCommand(const CaptureCommand_t *command) {
+   if (commandQueue == NULL || controlTaskHandle == NULL) {
+     return false;
+   }
+ 
+   if (xQueueSend(commandQueue, command, 0) != pdTRUE) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN, "Capture command queue full - command dropped");
+     return false;
+   }
+   xTaskNotify(controlTaskHandle, CAPTURE_EVENT_COMMAND, eSetBits);
+   return true;
+ }
+ 
+ bool initCaptureControlModule() {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Capture Control module");
+ 
+   // The copy of the last window goes to PSRAM when there is some
+   heldSamples = (uint16_t *)heap_caps_malloc(CAPTURE_MAX_HELD_SAMPLES * sizeof(uint16_t),
+                                              MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+   if (heldSamples == NULL) {
+     heldSamples = (uint16_t *)heap_caps_malloc(CAPTURE_MAX_HELD_SAMPLES * sizeof(uint16_t),
+                                                MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+   }
+   commandQueue = xQueueCreate(CAPTURE_CONTROL_QUEUE_LENGTH, sizeof(CaptureCommand_t));
+   resultMutex = xSemaphoreCreateMutex();
+ 
+   if (heldSamples == NULL || commandQueue == NULL || resultMutex == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to allocate capture control buffers - out of memory");
+     heap_caps_free(heldSamples);
+     if (commandQueue != NULL) {
+       vQueueDelete(commandQueue);
+     }
+     if (resultMutex != NULL) {
+       vSemaphoreDelete(resultMutex);
+     }
+     heldSamples = NULL;
+     commandQueue = NULL;
+     resultMutex = NULL;
+     return false;
+   }
+ 
+   controlStatus.state = CAPTURE_STATE_IDLE;
+   getDefaultCaptureRequest(&controlStatus.request);
+   controlStatus.completed = 0;
+   controlStatus.captureNumber = 0;
+ 
+   if (!registerAdcBlockConsumer(captureBlockConsumer, NULL)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to register capture control as ADC consumer");
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Capture Control module initialized successfully");
+   return true;
+ }
+ 
+ bool createCaptureControlTask() {
+   if (commandQueue == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot create Capture Control task - module not initialized");
+     return false;
+   }
+ 
+   if (controlTaskHandle != NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN, "Capture Control task already running");
+     return true;
+   }
+ 
+   BaseType_t result = xTaskCreate(
+     captureControlTask,
+     "Capture Control Task",
+     CAPTURE_CONTROL_TASK_STACK,
+     NULL,
+     CAPTURE_CONTROL_TASK_PRIORITY,
+     &controlTaskHandle
+   );
+ 
+   if (result != pdPASS) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create Capture Control task - error code: %d", result);
+     return false;
+   }
+ 
+   setScopeCaptureNotify(controlTaskHandle, CAPTURE_EVENT_SCOPE);
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Capture Control task created successfully");
+   return true;
+ }
+ 
+ void getDefaultCaptureRequest(CaptureRequest_t *request) {
+   request->sampleRateHz = ADC_CAPTURE_SAMPLE_RATE_HZ;
+   request->sampleCount = 0;
+   request->preSamples = 0;
+   request->trigger = CAPTURE_TRIGGER_NONE;
+   request->slope = TRIGGER_SLOPE_RISING;
+   request->level = SCOPE_DEFAULT_LEVEL;
+   request->externalEvents = 0;
+   request->holdoffSamples = 0;
+   request->repeat = 0;
+   request->notifyTask = NULL;
+   request->notifyBits = 0;
+ }
+ 
+ void setCaptureNotify(TaskHandle_t task, uint32_t bits) {
+   portENTER_CRITICAL(&controlMux);
+   listenerTask = task;
+   listenerBits = bits;
+   portEXIT_CRITICAL(&controlMux);
+ }
+ 
+ bool startCapture(const CaptureRequest_t *request) {
+   if (request == NULL || request->sampleRateHz < ADC_CAPTURE_MIN_SAMPLE_RATE_HZ ||
+       request->sampleRateHz > ADC_CAPTURE_MAX_SAMPLE_RATE_HZ ||
+       request->trigger > CAPTURE_TRIGGER_EXTERNAL || request->slope > TRIGGER_SLOPE_EITHER) {
+     return false;
+   }
+ 
+   // Triggered captures are scope windows
+   if (request->trigger != CAPTURE_TRIGGER_NONE &&
+       (request->sampleCount == 0 || request->sampleCount > CAPTURE_MAX_HELD_SAMPLES ||
+        request->preSamples >= request->sampleCount)) {
+     return false;
+   }
+   if (request->trigger == CAPTURE_TRIGGER_EXTERNAL && request->externalEvents == 0) {
+     return false;
+   }
+ 
+   CaptureCommand_t command;
+   command.type = CAPTURE_COMMAND_START;
+   command.request = *request;
+   return queueCommand(&command);
+ }
+ 
+ bool stopCapture() {
+   CaptureCommand_t command;
+   command.type = CAPTURE_COMMAND_STOP;
+   return queueCommand(&command);
+ }
+ 
+ bool armCapture() {
+   CaptureCommand_t command;
+   command.type = CAPTURE_COMMAND_ARM;
+   return queueCommand(&command);
+ }
+ 
+ bool getCaptureStatus(CaptureStatus_t *status) {
+   if (commandQueue == NULL || status == NULL) {
+     return false;
+   }
+ 
+   portENTER_CRITICAL(&controlMux);
+   *status = controlStatus;
+   portEXIT_CRITICAL(&controlMux);
+   return true;
+ }
+ 
+ bool getCaptureResult(CaptureResult_t *result) {
+   if (result == NULL) {
+     return false;
+   }
+ 
+   portENTER_CRITICAL(&controlMux);
+   bool valid = resultValid;
+   if (valid) {
+     *result = lastResult;
+   }
+   portEXIT_CRITICAL(&controlMux);
+   return valid;
+ }
+ 
+ uint32_t readCaptureSamples(uint16_t *out, uint32_t maxSamples, CaptureResult_t *result) {
+   if (resultMutex == NULL || out == NULL) {
+     return 0;
+   }
+ 
+   xSemaphoreTake(resultMutex, portMAX_DELAY);
+   uint32_t count = (heldCount < maxSamples) ? heldCount : maxSamples;
+   memcpy(out, heldSamples, count * sizeof(uint16_t));
+   if (result != NULL && heldCount > 0) {
+     *result = heldResult;
+   }
+   xSemaphoreGive(resultMutex);
+   return count;
+ }
+ 
+ // ----- Serial command channel -----
+ 
+ static const char *stateName(CaptureState_t state) {
+   switch (state) {
+     case CAPTURE_STATE_CAPTURING: return "capturing";
+     case CAPTURE_STATE_STREAMING: return "streaming";
+     default: return "idle";
+   }
+ }
+ 
+ // capture start [rate=] [count=] [pre=] [repeat=] [trigger=none|level|ext] [level=] [slope=] [events=] [holdoff=]
+ static bool parseStartArgs(int argc, char *argv[], CaptureRequest_t *request) {
+   uint32_t level = request->level;
+   uint32_t events = request->externalEvents;
+   if (!serialCommandNumber(argc, argv, "rate", &request->sampleRateHz) ||
+       !serialCommandNumber(argc, argv, "count", &request->sampleCount) ||
+       !serialCommandNumber(argc, argv, "pre", &request->preSamples) ||
+       !serialCommandNumber(argc, argv, "repeat", &request->repeat) ||
+       !serialCommandNumber(argc, argv, "level", &level) ||
+       !serialCommandNumber(argc, argv, "events", &events) ||
+       !serialCommandNumber(argc, argv, "holdoff", &request->holdoffSamples) ||
+       level > 0xFFF || events > 0xFF) {
+     return false;
+   }
+   request->level = (uint16_t)level;
+   request->externalEvents = (uint8_t)events;
+ 
+   const char *trigger = serialCommandValue(argc, argv, "trigger");
+   if (trigger != NULL) {
+     if (strcmp(trigger, "none") == 0) {
+       request->trigger = CAPTURE_TRIGGER_NONE;
+     } else if (strcmp(trigger, "level") == 0) {
+       request->trigger = CAPTURE_TRIGGER_LEVEL;
+     } else if (strcmp(trigger, "ext") == 0) {
+       request->trigger = CAPTURE_TRIGGER_EXTERNAL;
+       if (request->externalEvents == 0) {
+         request->externalEvents = SCOPE_EVENT_BURST_START;
+       }
+     } else {
+       return false;
+     }
+   }
+ 
+   const char *slope = serialCommandValue(argc, argv, "slope");
+   if (slope != NULL) {
+     if (strcmp(slope, "rising") == 0) {
+       request->slope = TRIGGER_SLOPE_RISING;
+     } else if (strcmp(slope, "falling") == 0) {
+       request->slope = TRIGGER_SLOPE_FALLING;
+     } else if (strcmp(slope, "either") == 0) {
+       request->slope = TRIGGER_SLOPE_EITHER;
+     } else {
+       return false;
+     }
+   }
+   return true;
+ }
+ 
+ static bool captureCommand(int argc, char *argv[], Print &out) {
+   if (argc < 1) {
+     return false;
+   }
+ 
+   if (strcmp(argv[0], "start") == 0) {
+     CaptureRequest_t request;
+     getDefaultCaptureRequest(&request);
+     if (!parseStartArgs(argc - 1, &argv[1], &request)) {
+       return false;
+     }
+     request.notifyTask = getSerialCommandTask();
+     request.notifyBits = serialEventBit;
+     if (!startCapture(&request)) {
+       out.printf("ERR capture request rejected\r\n");
+       return true;
+     }
+     out.printf("OK capture start rate=%lu count=%lu repeat=%lu\r\n",
+                request.sampleRateHz, request.sampleCount, request.repeat);
+   } else if (strcmp(argv[0], "stop") == 0) {
+     out.printf(stopCapture() ? "OK capture stop\r\n" : "ERR capture busy\r\n");
+   } else if (strcmp(argv[0], "arm") == 0) {
+     out.printf(armCapture() ? "OK capture arm\r\n" : "ERR capture busy\r\n");
+   } else if (strcmp(argv[0], "status") == 0) {
+     CaptureStatus_t status;
+     if (!getCaptureStatus(&status)) {
+       out.printf("ERR capture not initialized\r\n");
+       return true;
+     }
+     out.printf("OK capture state=%s completed=%lu last=%lu rate=%lu count=%lu repeat=%lu\r\n",
+                stateName(status.state), status.completed, status.captureNumber,
+                status.request.sampleRateHz, status.request.sampleCount, status.request.repeat);
+   } else {
+     return false;
+   }
+   return true;
+ }
+ 
+ // Completion report for captures started from the command channel
+ static void captureCommandEvent(Print &out) {
+   CaptureResult_t result;
+   if (getCaptureResult(&result)) {
+     out.printf("OK capture #%lu run=%lu first=%llu count=%lu rate=%lu trigger=%llu dropped=%lu%s\r\n",
+                result.captureNumber, result.runIndex, result.firstSample, result.sampleCount,
+                result.sampleRateHz, result.triggerSample, result.droppedSamples,
+                result.last ? " last" : "");
+   }
+ }
+ 
+ bool registerCaptureCommands() {
+   return registerSerialCommand("capture",
+     "capture start [rate=] [count=] [pre=] [repeat=] [trigger=none|level|ext] [level=] [slope=] [events=] [holdoff=] | stop | arm | status",
+     captureCommand, captureCommandEvent, &serialEventBit);
+ }
\ No newline at end of file
@@ -0,0 +1,250 @@
+/*
+ * Decimation Filter Implementation
+ */
+ 
+ #include "decimation_filter.h"
+ #include <string.h>
+ #include <math.h>
+ #include <stdlib.h>
+ 
+ // Round a Q15 accumulator back to a 12-bit unsigned sample
+ static inline uint16_t firOutput(int32_t acc) {
+   int32_t y = ((acc + (1 << (FIR_COEFF_BITS - 1))) >> FIR_COEFF_BITS) + FILTER_SAMPLE_OFFSET;
+   if (y < 0) {
+     y = 0;
+   } else if (y > FILTER_SAMPLE_MAX) {
+     y = FILTER_SAMPLE_MAX;
+   }
+   return (uint16_t)y;
+ }
+ 
+ #if DECIMATION_FILTER_HAS_PIE
+ // 8-lane dot product on the PIE unit; x and h are 16-byte aligned.
+ // The products of 12-bit samples and Q15 taps sum exactly in the 40-bit
+ // ACCX register and the filter bound keeps the result inside 32 bits, so
+ // reading it back unshifted matches the scalar kernel bit for bit.
+ // Only the ADC consumer task uses the Q registers.
+ static inline int32_t IRAM_ATTR pieDot(const int16_t *x, const int16_t *h, uint32_t groups) {
+   int32_t result;
+   uint32_t shift = 0;
+   __asm__ volatile(
+     "ee.zero.accx\n"
+     "loopnez %[groups], 1f\n"
+     "ee.vld.128.ip q0, %[x], 16\n"
+     "ee.vld.128.ip q1, %[h], 16\n"
+     "ee.vmulas.s16.accx q0, q1\n"
+     "1:\n"
+     "ee.srs.accx %[result], %[shift], 0\n"
+     : [result] "=r"(result), [x] "+r"(x), [h] "+r"(h)
+     : [groups] "r"(groups), [shift] "r"(shift)
+     : "memory");
+   return result;
+ }
+ #else
+ // Same data layout evaluated lane by lane
+ static inline int32_t pieDot(const int16_t *x, const int16_t *h, uint32_t groups) {
+   int32_t acc = 0;
+   for (uint32_t i = 0; i < groups * FIR_VECTOR_LANES; i++) {
+     acc += (int32_t)x[i] * h[i];
+   }
+   return acc;
+ }
+ #endif
+ 
+ bool firDesignLowpass(int16_t *coeffs, uint16_t taps, float cutoff) {
+   if (coeffs == NULL || taps == 0 || taps > FIR_MAX_TAPS || cutoff <= 0.0f || cutoff > 0.5f) {
+     return false;
+   }
+ 
+   float h[FIR_MAX_TAPS];
+   float sum = 0.0f;
+   float center = (taps - 1) / 2.0f;
+ 
+   for (uint16_t i = 0; i < taps; i++) {
+     float t = i - center;
+     float sinc = (t == 0.0f) ? 2.0f * cutoff : sinf(2.0f * (float)M_PI * cutoff * t) / ((float)M_PI * t);
+     float window = (taps > 1) ? 0.54f - 0.46f * cosf(2.0f * (float)M_PI * i / (taps - 1)) : 1.0f;
+     h[i] = sinc * window;
+     sum += h[i];
+   }
+ 
+   // Quantize, then put the rounding residue on the center tap for exact unity gain
+   int32_t total = 0;
+   for (uint16_t i = 0; i < taps; i++) {
+     coeffs[i] = (int16_t)lroundf(h[i] / sum * (1 << FIR_COEFF_BITS));
+     total += coeffs[i];
+   }
+   int32_t centerTap = coeffs[taps / 2] + ((1 << FIR_COEFF_BITS) - total);
+   if (centerTap > INT16_MAX) {
+     return false;
+   }
+   coeffs[taps / 2] = (int16_t)centerTap;
+   return true;
+ }
+ 
+ FirDecimator::FirDecimator()
+   : _taps(0), _groups(0), _decimation(1), _phase(0), _fill(0), _kernel(FIR_KERNEL_SCALAR) {
+   memset(_buffer, 0, sizeof(_buffer));
+   memset(_shifted, 0, sizeof(_shifted));
+   memset(_reversed, 0, sizeof(_reversed));
+ }
+ 
+ bool FirDecimator::begin(const int16_t *coeffs, uint16_t taps, uint8_t decimation) {
+   if (coeffs == NULL || taps == 0 || taps > FIR_MAX_TAPS ||
+       decimation == 0 || decimation > FIR_MAX_DECIMATION) {
+     return false;
+   }
+ 
+   // Worst case |x| * sum|h| must fit the 32-bit accumulator
+   uint32_t absSum = 0;
+   for (uint16_t i = 0; i < taps; i++) {
+     absSum += (uint32_t)abs(coeffs[i]);
+   }
+   if ((uint64_t)absSum * FILTER_SAMPLE_OFFSET > (uint64_t)INT32_MAX) {
+     return false;
+   }
+ 
+   _taps = taps;
+   _decimation = decimation;
+ 
+   // Reversed taps line up with the oldest-first sample window
+   for (uint16_t j = 0; j < taps; j++) {
+     _reversed[j] = coeffs[taps - 1 - j];
+   }
+ 
+   // Copy k starts k samples in, matching a window that starts k samples past a 16-byte boundary
+   memset(_shifted, 0, sizeof(_shifted));
+   for (uint8_t k = 0; k < FIR_VECTOR_LANES; k++) {
+     memcpy(&_shifted[k][k], _reversed, taps * sizeof(int16_t));
+   }
+   _groups = (uint16_t)((taps + FIR_VECTOR_LANES - 1 + FIR_VECTOR_LANES - 1) / FIR_VECTOR_LANES);
+ 
+   reset();
+   return true;
+ }
+ 
+ void FirDecimator::reset() {
+   memset(_buffer, 0, sizeof(_buffer));
+   _fill = (_taps > 0) ? _taps - 1 : 0;
+   _phase = 0;
+ }
+ 
+ int32_t FirDecimator::dotScalar(uint32_t start) const {
+   const int16_t *x = &_buffer[start];
+   int32_t acc = 0;
+   for (uint16_t j = 0; j < _taps; j++) {
+     acc += (int32_t)x[j] * _reversed[j];
+   }
+   return acc;
+ }
+ 
+ int32_t IRAM_ATTR FirDecimator::dotVector(uint32_t start) const {
+   uint32_t offset = start & (FIR_VECTOR_LANES - 1);
+   return pieDot(&_buffer[start - offset], _shifted[offset], _groups);
+ }
+ 
+ size_t FirDecimator::process(const uint16_t *in, size_t count, uint16_t *out, size_t maxOut) {
+   if (_taps == 0 || in == NULL || out == NULL) {
+     return 0;
+   }
+ 
+   size_t produced = 0;
+   const uint16_t history = _taps - 1;
+ 
+   while (count > 0) {
+     size_t n = (count < FIR_CHUNK_SAMPLES) ? count : FIR_CHUNK_SAMPLES;
+ 
+     // Append the chunk as signed samples behind the retained history
+     int16_t *dst = &_buffer[_fill];
+     for (size_t i = 0; i < n; i++) {
+       dst[i] = (int16_t)in[i] - FILTER_SAMPLE_OFFSET;
+     }
+ 
+     // Outputs fall on every decimation-th input, ending the window at that input
+     uint32_t end = _fill + (_decimation - 1 - _phase);
+     uint32_t newFill = _fill + (uint32_t)n;
+     for (; end < newFill && produced < maxOut; end += _decimation) {
+       uint32_t start = end - history;
+       int32_t acc = (_kernel == FIR_KERNEL_VECTOR) ? dotVector(start) : dotScalar(start);
+       out[produced++] = firOutput(acc);
+     }
+     _phase = (uint8_t)((_phase + n) % _decimation);
+ 
+     // Keep the last taps-1 samples for the next chunk
+     memmove(_buffer, &_buffer[newFill - history], history * sizeof(int16_t));
+     _fill = history;
+ 
+     in += n;
+     count -= n;
+   }
+ 
+   return produced;
+ }
+ 
+ CicDecimator::CicDecimator() : _order(0), _rate(1), _phase(0), _gain(1) {
+   reset();
+ }
+ 
+ bool CicDecimator::begin(uint8_t order, uint16_t rate) {
+   if (order == 0 || order > CIC_MAX_ORDER || rate < 2) {
+     return false;
+   }
+ 
+   uint64_t gain = 1;
+   for (uint8_t i = 0; i < order; i++) {
+     gain *= rate;
+   }
+   if (gain > CIC_MAX_GAIN) {
+     return false;
+   }
+ 
+   _order = order;
+   _rate = rate;
+   _gain = (uint32_t)gain;
+   reset();
+   return true;
+ }
+ 
+ void CicDecimator::reset() {
+   memset(_integrator, 0, sizeof(_integrator));
+   memset(_comb, 0, sizeof(_comb));
+   _phase = 0;
+ }
+ 
+ size_t CicDecimator::process(const uint16_t *in, size_t count, uint16_t *out, size_t maxOut) {
+   if (_order == 0 || in == NULL || out == NULL) {
+     return 0;
+   }
+ 
+   size_t produced = 0;
+   const int32_t half = (int32_t)(_gain / 2);
+ 
+   for (size_t i = 0; i < count; i++) {
+     uint32_t x = (uint32_t)((int32_t)in[i] - FILTER_SAMPLE_OFFSET);
+     for (uint8_t s = 0; s < _order; s++) {
+       _integrator[s] += x;
+       x = _integrator[s];
+     }
+ 
+     if (++_phase < _rate) {
+       continue;
+     }
+     _phase = 0;
+ 
+     for (uint8_t s = 0; s < _order; s++) {
+       uint32_t y = x - _comb[s];
+       _comb[s] = x;
+       x = y;
+     }
+ 
+     if (produced < maxOut) {
+       // Round to nearest, ties away from zero, then back to 12-bit unsigned
+       int32_t y = (int32_t)x;
+       y = (y >= 0) ? (y + half) / (int32_t)_gain : -((-y + half) / (int32_t)_gain);
+       y += FILTER_SAMPLE_OFFSET;
+       out[produced++] = (uint16_t)((y < 0) ? 0 : (y > FILTER_SAMPLE_MAX ? FILTER_SAMPLE_MAX : y));
+     }
+   }
+ 
+   return produced;
+ }
\ No newline at end of file
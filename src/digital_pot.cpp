@@ -13,42 +13,50 @@
  // Current state tracking
  static uint8_t currentValue = DIGITAL_POT_DEFAULT_VALUE;
  static bool potInitialized = false;
+ static volatile uint32_t droppedWrites = 0;
  
  // Helper function to transfer data to/from MCP4151 with mutex protection
- static uint8_t spiTransfer(uint8_t command, uint8_t data = 0) {
+ // Returns false if the bus could not be taken in time (nothing was sent)
+ static bool spiTransfer(uint8_t command, uint8_t data = 0, uint8_t *response = NULL) {
      if (spiInstance == NULL) {
-         return 0xFF;  // Error value
+         return false;
      }
      
      uint8_t result = 0xFF;
      
-     // Take the SPI mutex with timeout
-     if (xSemaphoreTake(spiMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-         // Select the chip
-         digitalWrite(DIGITAL_POT_CS_PIN, LOW);
-         
-         // Small delay for stability
-         ets_delay_us(1);
-         
-         // Send the command and data and receive response
-         spiInstance->beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
-         
-         // First byte: command
-         spiInstance->transfer(command);
-         
-         // Second byte: data or dummy byte for read operations
-         result = spiInstance->transfer(data);
-         
-         spiInstance->endTransaction();
-         
-         // Deselect the chip
-         digitalWrite(DIGITAL_POT_CS_PIN, HIGH);
-         
-         // Release the mutex
-         xSemaphoreGive(spiMutex);
+     // Take the SPI mutex - the ADC capture engine holds it for a whole run,
+     // so give up after a bounded wait and let the caller retry later
+     if (xSemaphoreTake(spiMutex, pdMS_TO_TICKS(DIGITAL_POT_SPI_TIMEOUT_MS)) != pdTRUE) {
+         return false;
      }
      
-     return result;
+     // Select the chip
+     digitalWrite(DIGITAL_POT_CS_PIN, LOW);
+     
+     // Small delay for stability
+     ets_delay_us(1);
+     
+     // Send the command and data and receive response
+     spiInstance->beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
+     
+     // First byte: command
+     spiInstance->transfer(command);
+     
+     // Second byte: data or dummy byte for read operations
+     result = spiInstance->transfer(data);
+     
+     spiInstance->endTransaction();
+     
+     // Deselect the chip
+     digitalWrite(DIGITAL_POT_CS_PIN, HIGH);
+     
+     // Release the mutex
+     xSemaphoreGive(spiMutex);
+     
+     if (response != NULL) {
+         *response = result;
+     }
+     return true;
  }
  
  // Helper function to check if the MCP4151 is responding
@@ -87,7 +95,7 @@
      spiInstance = &spi;
      
      // Create a mutex for SPI access (or use an existing one)
-     spiMutex = xSemaphoreCreateMutex();
+     spiMutex = (sharedSPIMutex != NULL) ? sharedSPIMutex : xSemaphoreCreateMutex();
      if (spiMutex == NULL) {
          //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create Digital Pot SPI mutex");
          return false;
@@ -129,7 +137,12 @@
      //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Setting Digital Pot to value %d", value);
      
      // Send the command to write the value
-     spiTransfer(DIGITAL_POT_CMD_WRITE, value);
+     if (!spiTransfer(DIGITAL_POT_CMD_WRITE, value)) {
+         droppedWrites++;
+         DEBUG_PRINT(DEBUG_LEVEL_WARN, "SPI bus busy - Digital Pot write of %d dropped (%lu so far)",
+                     value, (unsigned long)droppedWrites);
+         return false;
+     }
      
      // Update the current value
      currentValue = value;
@@ -143,7 +156,8 @@
      }
      
      // Send read command and receive value
-     uint8_t value = spiTransfer(DIGITAL_POT_CMD_READ);
+     uint8_t value = 0xFF;
+     spiTransfer(DIGITAL_POT_CMD_READ, 0, &value);
      
      //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Read Digital Pot value: %d", value);
      
@@ -174,10 +188,11 @@
      
      // Main task loop
      while (1) {
-         // Check if strength has changed
-         if (strength != lastStrength) {
-             lastStrength = strength;
-             updateDigitalPotFromStrength();
+         // Check if strength has changed; a write dropped while the bus
+         // was busy is retried on the next pass
+         uint8_t currentStrength = strength;
+         if (currentStrength != lastStrength && updateDigitalPotFromStrength()) {
+             lastStrength = currentStrength;
          }
          
          // Sleep for a while before checking again
@@ -189,6 +204,10 @@
      vTaskDelete(NULL);
  }
  
+ uint32_t getDigitalPotDroppedWrites() {
+     return droppedWrites;
+ }
+ 
  bool createDigitalPotTask() {
      // Check if initialized
      if (!potInitialized) {
@@ -5,14 +5,19 @@
  #include "gpio_expander_tasks.h"
  #include "simplified_debug.h"
  #include "beeper.h"
+ #include "scope_capture.h"
+ #include "seqlock.h"
+ #include "monotonic_time.h"
  
  // Static variables
  static TwoWire *i2cWire = NULL;
  static SemaphoreHandle_t i2cMutex = NULL;
- static QueueHandle_t gpioExpanderStatusQueue = NULL;
  static QueueHandle_t buttonEventQueue = NULL;
  static TaskHandle_t gpioExpanderTaskHandle = NULL;
  
+ // Latest status, read by any task without a kernel call
+ static Seqlock<GpioExpanderStatus_t> publishedStatus;
+ 
  // Keep track of pin states
  static volatile uint8_t lastInputState = 0;
  static volatile uint8_t currentOutputState = 0;
@@ -102,11 +107,11 @@
          lastInputState = tempInputState;
      }
      
-     // Initialize status and send it to the queue
+     // Initialize status and publish it
      status.inputState = lastInputState;
      status.outputState = currentOutputState;
      status.success = true;
-     xQueueOverwrite(gpioExpanderStatusQueue, &status);
+     publishedStatus.write(status);
      
      //DEBUG_PRINT(DEBUG_LEVEL_INFO, "GPIO Expander initial state - Inputs: 0x%02X, Outputs: 0x%02X", lastInputState, currentOutputState);
      
@@ -138,7 +143,7 @@
                          // Check if this pin changed
                          if (changedInputs & mask) {
                              // Create an event
-                             event.timestamp = millis();
+                             event.timestampUs = monotonicUs();
                              event.buttonMask = mask;
                              
                              // Determine event type (assuming active low buttons)
@@ -168,8 +173,8 @@
                      lastInputState = inputState;
                  }
                  
-                 // Send current status to status queue, replacing any old status
-                 xQueueOverwrite(gpioExpanderStatusQueue, &status);
+                 // Publish current status, replacing any old status
+                 publishedStatus.write(status);
              } else {
                  //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to read GPIO expander input register");
              }
@@ -195,19 +200,10 @@
          return false;
      }
      
-     // Create the status queue (only keeps the latest status)
-     gpioExpanderStatusQueue = xQueueCreate(1, sizeof(GpioExpanderStatus_t));
-     if (gpioExpanderStatusQueue == NULL) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create GPIO Expander status queue");
-         vSemaphoreDelete(i2cMutex);
-         return false;
-     }
-     
      // Create the event queue (can hold multiple events)
      buttonEventQueue = xQueueCreate(10, sizeof(GpioExpanderEvent_t));
      if (buttonEventQueue == NULL) {
          //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create button event queue");
-         vQueueDelete(gpioExpanderStatusQueue);
          vSemaphoreDelete(i2cMutex);
          return false;
      }
@@ -273,11 +269,19 @@
  }
  
  bool receiveGpioExpanderStatus(GpioExpanderStatus_t *status, TickType_t timeout) {
-     if (status == NULL || gpioExpanderStatusQueue == NULL) {
+     if (status == NULL || i2cMutex == NULL) {
          return false;
      }
      
-     return (xQueuePeek(gpioExpanderStatusQueue, status, timeout) == pdPASS);
+     // Latest published status; only waits (polling) until the first one exists
+     TickType_t start = xTaskGetTickCount();
+     while (!publishedStatus.read(status)) {
+         if (xTaskGetTickCount() - start >= timeout) {
+             return false;
+         }
+         vTaskDelay(1);
+     }
+     return true;
  }
  
  bool waitForButtonEvent(GpioExpanderEvent_t *event, uint8_t buttonMask, TickType_t timeout) {
@@ -317,6 +321,9 @@
      // Only write if changed
      if (newState != currentOutputState) {
          if (writeTCA9534ARegister(TCA9534A_REG_OUTPUT, newState)) {
+             if ((newState ^ currentOutputState) & GPIO_EXPANDER_ELEC_SHDN) {
+                 scopeExternalEvent(SCOPE_EVENT_ELEC_SHDN, micros());
+             }
              currentOutputState = newState;
              //DEBUG_PRINT(DEBUG_LEVEL_INFO, "GPIO Expander output set - Pin: 0x%02X, State: %d", pin, state);
              return true;
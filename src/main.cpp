@@ -12,17 +12,25 @@
 #include "gpio_expander_tasks.h"
 #include "beeper.h"
 #include "pulse_generator.h"
+#include "pulse_sequencer.h"
 #include "digital_pot.h"
 #include "simplified_debug.h"
 #include "pulse_tasks.h"
-#include <driver/timer.h>  // For timer-based DMA sampling
+#include "adc_capture.h"
+#include "sample_stream.h"
+#include "scope_capture.h"
+#include "burst_capture.h"
+#include "adc_monitor.h"
+#include "adc_filter.h"
+#include "adc_spectrum.h"
+#include "capture_control.h"
+#include "serial_command.h"
 
 // Pin definitions
 // SPI pins
 #define MISO_PIN MISO
 #define MOSI_PIN MOSI // Not used for ADC
 #define SCLK_PIN SCK
-#define CS_PIN_ADC 5
 
 // I2C pins
 #define SDA_PIN SDA
@@ -31,6 +39,7 @@
 // Global peripheral instances - use HSPI for ESP32-S3
 SPIClass sharedSPI = SPIClass(HSPI);
 TwoWire &sharedI2C = Wire;
+SemaphoreHandle_t sharedSPIMutex = NULL; // Serializes the ADC and digital pot on the shared SPI bus
 
 // Flags for battery status - volatile since accessed from multiple tasks
 volatile bool lowBatteryFlag = false;       // Can be read by other tasks
@@ -47,12 +56,16 @@ volatile bool gpioExpanderBattAlertActive = false;
 
 // ADC status flags
 volatile bool adcSamplingActive = false;
-volatile bool adcLastSampleComplete = false;
-volatile bool adcButtonTrigger = false;
+
+// Control task notification bits
+#define CONTROL_NOTIFY_CAPTURE 0x01 // A capture completed
+
+// Pulse output backend
+static const PulseBackend_t pulseBackend = PULSE_DEFAULT_BACKEND;
 
 // Global variables
-volatile uint16_t pFrequency = PULSE_DEFAULT_FREQ; // Default 100Hz
-volatile bool pulseEn = true;                     // Initially disabled
+volatile uint16_t pFrequency = PULSE_DEFAULT_FREQ; // Applied frequency, default 100Hz
+volatile bool pulseEn = true;                     // Applied enable pin level, initially disabled
 volatile uint8_t strength = 128;                   // Default to mid-range (mapped to 10-250)
 
 // Task handle for control task
@@ -78,6 +91,19 @@ void debugMonitorTask(void *pvParameters)
   }
 }
 
+// Log the last completed capture - called when the capture control notifies the control task
+void logCaptureResult()
+{
+  CaptureResult_t capture;
+  if (getCaptureResult(&capture))
+  {
+    DEBUG_PRINT(DEBUG_LEVEL_INFO, "Capture #%lu (%lu of run%s): %lu samples at %lu Hz from sample %llu, trigger at %lu us%s",
+                capture.captureNumber, capture.runIndex, capture.last ? ", last" : "",
+                capture.sampleCount, capture.sampleRateHz, capture.firstSample,
+                capture.triggerTimeUs, capture.triggered ? (capture.eventSource ? " (external)" : " (level)") : "");
+  }
+}
+
 // Battery switch change event handler - called from main task context
 void handleSwitchChange()
 {
@@ -179,7 +205,13 @@ void controlTask(void *pvParameters)
     }
 
     // ----- Check Pulse Generator Status -----
-    DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse Generator status:, Frequency: %d Hz, Enabled %s", pFrequency, pulseEn ? "NO" : "YES");
+    PulseGeneratorStats_t generatorStats;
+    if (getPulseGeneratorStats(&generatorStats))
+    {
+      DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse Generator status:, Frequency: %d Hz (achieved %lu.%03lu Hz, %+ld ppm), Enabled %s",
+                  pFrequency, generatorStats.achieved.achievedMilliHz / 1000, generatorStats.achieved.achievedMilliHz % 1000,
+                  generatorStats.achieved.errorPpm, pulseEn ? "NO" : "YES");
+    }
 
     // ----- Check Digital Pot Status -----
     DEBUG_PRINT(DEBUG_LEVEL_INFO, "Digital Potentiometer status: Strength: %d (constrained to range 10-250)", strength);
@@ -225,11 +257,40 @@ void controlTask(void *pvParameters)
       {
         DEBUG_PRINT(DEBUG_LEVEL_INFO, "Button 2 ");
         button2Pressed = (buttonEvent.eventType == BUTTON_PRESSED);
+        if (button2Pressed)
+        {
+          // Single triggered capture with the default scope window
+          CaptureRequest_t request;
+          getDefaultCaptureRequest(&request);
+          request.trigger = CAPTURE_TRIGGER_LEVEL;
+          request.preSamples = SCOPE_DEFAULT_PRE_SAMPLES;
+          request.sampleCount = SCOPE_DEFAULT_PRE_SAMPLES + SCOPE_DEFAULT_POST_SAMPLES;
+          request.repeat = 1;
+          if (startCapture(&request))
+          {
+            DEBUG_PRINT(DEBUG_LEVEL_INFO, "Triggered capture armed");
+          }
+        }
       }
       else if (buttonEvent.buttonMask == GPIO_EXPANDER_BTN3)
       {
         DEBUG_PRINT(DEBUG_LEVEL_INFO, "Button 3 ");
         button3Pressed = (buttonEvent.eventType == BUTTON_PRESSED);
+        if (button3Pressed)
+        {
+          // Toggle continuous sampling
+          CaptureStatus_t captureStatus;
+          if (getCaptureStatus(&captureStatus) && captureStatus.state != CAPTURE_STATE_IDLE)
+          {
+            stopCapture();
+          }
+          else
+          {
+            CaptureRequest_t request;
+            getDefaultCaptureRequest(&request);
+            startCapture(&request);
+          }
+        }
       }
       else if (buttonEvent.buttonMask == GPIO_EXPANDER_BATT_ALRT)
       {
@@ -278,10 +339,85 @@ void controlTask(void *pvParameters)
 
     }
 
+    // ----- ADC capture: started and stopped through the capture control API -----
+    adcSamplingActive = isAdcCaptureRunning();
+
+    // ----- Burst capture: report burst-aligned windows -----
+    BurstCaptureRecord_t burstRecord;
+    while (waitForBurstCapture(&burstRecord, 0))
+    {
+      DEBUG_PRINT(DEBUG_LEVEL_INFO, "Burst window #%lu: %u edges, %u pulses%s%s",
+                  burstRecord.window.windowNumber, burstRecord.window.edgeCount,
+                  burstRecord.tagged ? burstRecord.burst.pulseCount : 0,
+                  burstRecord.tagged ? "" : " (untagged)",
+                  burstRecord.averageReady ? ", average ready" : "");
+    }
+
+    AdcCaptureStats_t adcStats;
+    if (adcSamplingActive && getAdcCaptureStats(&adcStats))
+    {
+      DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC capture: %lu Hz, %lu samples, %lu blocks, %lu dropped, pool %u/%u held, %lu pool overruns",
+                  adcStats.sampleRateHz, adcStats.samplesCaptured,
+                  adcStats.blocksCompleted, adcStats.droppedSamples,
+                  adcStats.poolHeld, adcStats.poolBlocks, adcStats.poolOverruns);
+    }
+
+    AdcMonitorSummary_t adcSummary;
+    if (adcSamplingActive && receiveAdcMonitorSummary(&adcSummary, 0))
+    {
+      DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC stats: min %u, max %u, mean %.2f, rms %.2f, p2p %u (kernel %lu ppm)",
+                  adcSummary.stats.min, adcSummary.stats.max,
+                  adcSummary.stats.meanQ4 / 16.0f, adcSummary.stats.rmsQ4 / 16.0f,
+                  adcSummary.stats.peakToPeak, adcSummary.kernelLoadPpm);
+    }
+
+    AdcFilterStats_t filterStats;
+    if (adcSamplingActive && getAdcFilterStats(&filterStats) && filterStats.enabled)
+    {
+      DEBUG_PRINT(DEBUG_LEVEL_INFO, "ADC filter: %lu in, %lu out, %lu cycles/kS (%s kernel)",
+                  filterStats.inputSamples, filterStats.outputSamples, filterStats.cyclesPerKiloSample,
+                  filterStats.kernel == FIR_KERNEL_VECTOR ? "vector" : "scalar");
+    }
+
+    AdcSpectrumResult_t spectrum;
+    if (adcSamplingActive && receiveAdcSpectrum(&spectrum, 0))
+    {
+      if (spectrum.locked)
+      {
+        DEBUG_PRINT(DEBUG_LEVEL_INFO, "Spectrum: %u Hz expected, %.2f Hz measured (%+.3f%%), H1 %.1f H2 %.1f H3 %.1f codes (%lu us)",
+                    spectrum.expectedHz, spectrum.harmonics[0].frequencyHz, spectrum.errorPct,
+                    spectrum.harmonics[0].amplitude, spectrum.harmonics[1].amplitude,
+                    spectrum.harmonics[2].amplitude, spectrum.analysisUs);
+      }
+      else
+      {
+        DEBUG_PRINT(DEBUG_LEVEL_WARN, "Spectrum: no line near %u Hz, strongest %.2f Hz at %.1f codes",
+                    spectrum.expectedHz, spectrum.strongest.frequencyHz, spectrum.strongest.amplitude);
+      }
+    }
+
+    AdcToneResult_t tones;
+    if (adcSamplingActive && receiveAdcTones(&tones, 0) && tones.count > 0)
+    {
+      DEBUG_PRINT(DEBUG_LEVEL_INFO, "Tones at %u Hz: H1 %.2f codes, phase %.3f rad",
+                  tones.expectedHz, tones.tones[0].amplitude, tones.tones[0].phase);
+    }
+
     // Serial.println();
 
-    // Wait before next cycle - using a shorter delay to be more responsive to switch changes
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Run every second
+    // Wait before next cycle, logging capture completions as they are notified
+    TimeOut_t cycleTimeOut;
+    TickType_t cycleTicks = pdMS_TO_TICKS(1000); // Run every second
+    vTaskSetTimeOutState(&cycleTimeOut);
+    while (xTaskCheckForTimeOut(&cycleTimeOut, &cycleTicks) == pdFALSE)
+    {
+      uint32_t notifications = 0;
+      if (xTaskNotifyWait(0, CONTROL_NOTIFY_CAPTURE, &notifications, cycleTicks) == pdTRUE &&
+          (notifications & CONTROL_NOTIFY_CAPTURE))
+      {
+        logCaptureResult();
+      }
+    }
   }
 }
 
@@ -303,6 +439,18 @@ void setup()
   DEBUG_PRINT(DEBUG_LEVEL_INFO, "SPI initialized (HSPI) - SCLK: %d, MISO: %d, MOSI: %d",
               SCLK_PIN, MISO_PIN, MOSI_PIN);
 
+  // Create the shared SPI bus mutex before any SPI module is initialized
+  sharedSPIMutex = xSemaphoreCreateMutex();
+  if (sharedSPIMutex == NULL)
+  {
+    Serial.println("Failed to create shared SPI mutex! Halting.");
+    DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create shared SPI mutex!");
+    while (1)
+    {
+      vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+  }
+
   // Initialize the shared I2C bus
   sharedI2C.begin(SDA_PIN, SCL_PIN);
   DEBUG_PRINT(DEBUG_LEVEL_INFO, "I2C initialized - SDA: %d, SCL: %d", SDA_PIN, SCL_PIN);
@@ -346,24 +494,37 @@ void setup()
   initBeeper();
   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Beeper initialized on GPIO %d", BEEPER_PIN);
 
-  Serial.println("Initializing Pulse Generator...");
-  DEBUG_PRINT(DEBUG_LEVEL_INFO, "Attempting to initialize Pulse Generator module");
-
-  // We'll try to initialize but won't treat failure as fatal
-  if (!initPulseGenerator(sharedI2C))
+  // Pulse output: the PCA9685, or the RMT pulse train sequencer for patterns beyond it
+  if (pulseBackend == PULSE_BACKEND_RMT)
   {
-    Serial.println("Warning: Failed to initialize Pulse Generator module!");
-    Serial.println("System will continue without pulse generator functionality.");
-    DEBUG_PRINT(DEBUG_LEVEL_WARN, "Pulse Generator module initialization failed - continuing without it");
+    Serial.println("Initializing Pulse Sequencer...");
+    if (!initPulseSequencer() || !createPulseSequencerTask())
+    {
+      Serial.println("Warning: Failed to start Pulse Sequencer!");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Pulse Sequencer initialization failed - continuing without it");
+    }
   }
   else
   {
-    // Only create the task if initialization succeeded
-    Serial.println("Creating Pulse Generator task...");
-    if (!createPulseGeneratorTask())
+    Serial.println("Initializing Pulse Generator...");
+    DEBUG_PRINT(DEBUG_LEVEL_INFO, "Attempting to initialize Pulse Generator module");
+
+    // We'll try to initialize but won't treat failure as fatal
+    if (!initPulseGenerator(sharedI2C))
+    {
+      Serial.println("Warning: Failed to initialize Pulse Generator module!");
+      Serial.println("System will continue without pulse generator functionality.");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Pulse Generator module initialization failed - continuing without it");
+    }
+    else
     {
-      Serial.println("Warning: Failed to create Pulse Generator task!");
-      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Failed to create Pulse Generator task");
+      // Only create the task if initialization succeeded
+      Serial.println("Creating Pulse Generator task...");
+      if (!createPulseGeneratorTask())
+      {
+        Serial.println("Warning: Failed to create Pulse Generator task!");
+        DEBUG_PRINT(DEBUG_LEVEL_WARN, "Failed to create Pulse Generator task");
+      }
     }
   }
 
@@ -387,8 +548,112 @@ void setup()
     }
   }
 
+  Serial.println("Initializing ADC Capture module...");
+  if (!initAdcCaptureModule(sharedSPI))
+  {
+    Serial.println("Warning: Failed to initialize ADC Capture module!");
+    DEBUG_PRINT(DEBUG_LEVEL_WARN, "ADC Capture module initialization failed - continuing without it");
+  }
+  else if (!createAdcCaptureTask())
+  {
+    Serial.println("Warning: Failed to create ADC Capture task!");
+    DEBUG_PRINT(DEBUG_LEVEL_WARN, "Failed to create ADC Capture task");
+  }
+  else
+  {
+    // Binary sample streaming over the USB CDC link (decode with tools/adc_stream_decode);
+    // off until the "stream on" command, as it shares the port with text output
+    Serial.println("Initializing Sample Stream module...");
+    if (!initSampleStreamModule(Serial) || !createSampleStreamTask())
+    {
+      Serial.println("Warning: Failed to start Sample Stream!");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Sample Stream initialization failed - continuing without it");
+    }
+
+    // Triggered capture with pre-trigger history (driven by the capture control)
+    Serial.println("Initializing Scope Capture module...");
+    if (!initScopeCaptureModule())
+    {
+      Serial.println("Warning: Failed to initialize Scope Capture module!");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Scope Capture initialization failed - continuing without it");
+    }
+
+    // Per-interval statistics, also sent as STATS frames on the stream
+    Serial.println("Initializing ADC Monitor module...");
+    if (!initAdcMonitorModule())
+    {
+      Serial.println("Warning: Failed to initialize ADC Monitor module!");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "ADC Monitor initialization failed - continuing without it");
+    }
+    else
+    {
+      setAdcMonitorStreaming(true);
+      setAdcMonitorEnabled(true);
+    }
+
+    // ADC windows aligned to pulse bursts, averaged coherently
+    Serial.println("Initializing Burst Capture module...");
+    if (!initBurstCaptureModule())
+    {
+      Serial.println("Warning: Failed to initialize Burst Capture module!");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Burst Capture initialization failed - continuing without it");
+    }
+    else
+    {
+      setBurstCaptureEnabled(true);
+    }
+
+    // Decimating FIR (optionally CIC) stage; kernels are checked and benchmarked here
+    Serial.println("Initializing ADC Filter module...");
+    if (!initAdcFilterModule())
+    {
+      Serial.println("Warning: Failed to initialize ADC Filter module!");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "ADC Filter initialization failed - continuing without it");
+    }
+    else
+    {
+      setAdcFilterEnabled(true);
+    }
+
+    // FFT and Goertzel check of pFrequency and its harmonics
+    Serial.println("Initializing ADC Spectrum module...");
+    if (!initAdcSpectrumModule() || !createAdcSpectrumTask())
+    {
+      Serial.println("Warning: Failed to initialize ADC Spectrum module!");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "ADC Spectrum initialization failed - continuing without it");
+    }
+    else
+    {
+      setAdcSpectrumEnabled(true);
+    }
+
+    // Command-driven captures: button 2/3 and the serial "capture" command
+    Serial.println("Initializing Capture Control module...");
+    if (!initCaptureControlModule() || !createCaptureControlTask())
+    {
+      Serial.println("Warning: Failed to initialize Capture Control module!");
+      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Capture Control initialization failed - continuing without it");
+    }
+  }
+
+  // Text commands on the USB CDC link (replies are OK/ERR lines)
+  Serial.println("Initializing Serial Command module...");
+  if (!initSerialCommandModule(Serial) || !registerCaptureCommands() || !registerPulseGeneratorCommands() ||
+      !registerPulseSequencerCommands() || !registerSampleStreamCommands() || !createSerialCommandTask())
+  {
+    Serial.println("Warning: Failed to start Serial Command module!");
+    DEBUG_PRINT(DEBUG_LEVEL_WARN, "Serial Command initialization failed - continuing without it");
+  }
+
+  // The confirmed pulse pin; with PULSE_MONITOR_EXTRA_CHANNELS also the second
+  // PCA9685 output and the return path, skew measured between them
   Serial.println("Initializing Pulse Burst Monitoring module...");
-  if (!initPulseBurstModule(PULSE_MONITOR_PIN)) {
+#if PULSE_MONITOR_EXTRA_CHANNELS
+  const uint8_t pulseMonitorPins[] = {PULSE_MONITOR_PIN, PULSE_MONITOR_PIN_2, PULSE_RETURN_PIN};
+#else
+  const uint8_t pulseMonitorPins[] = {PULSE_MONITOR_PIN};
+#endif
+  if (!initPulseBurstChannels(pulseMonitorPins, sizeof(pulseMonitorPins))) {
     Serial.println("Failed to initialize Pulse Burst Monitoring module! Halting.");
     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Pulse Burst Monitoring module initialization failed!");
     while (1) { vTaskDelay(pdMS_TO_TICKS(1000)); }
@@ -424,6 +689,9 @@ void setup()
     }
   }
 
+  // Capture completions wake the control task
+  setCaptureNotify(controlTaskHandle, CONTROL_NOTIFY_CAPTURE);
+
 #ifdef DEBUG_ENABLED
   // Create debug monitor task if debugging is enabled
   xTaskCreate(
@@ -442,7 +710,7 @@ void setup()
   shortBeep();
 
   setElecShutdown(true);
-  pulseEn = false;
+  requestPulseOutputs(true);
   strength = 128;
 
   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Setup complete");
@@ -0,0 +1,168 @@
+/*
+ * PCA9685 Calibration Implementation
+ *
+ * The model is linear in the oscillator: f = osc * x with
+ * x = 1 / (4096 * (prescale + 1)), so the least squares oscillator is
+ * sum(w x f) / sum(w x^2) and its variance 1 / sum(w x^2) for weights
+ * w = 1 / stdErr^2.
+ *
+ * The prescale table is built by expanding an index pack over the prescale
+ * range (C++11 has no std::index_sequence, so the pack is made here). A
+ * frequency is looked up in the nominal oscillator's table after scaling
+ * it by nominal / oscillator: every output scales by the same factor, so
+ * the closest entry is the same prescale.
+ */
+ 
+ #include "pca9685_calibration.h"
+ #include <string.h>
+ #include <math.h>
+ 
+ // Index pack 0..N-1
+ template <size_t... I> struct Pca9685Indices {};
+ template <size_t N, size_t... I> struct Pca9685MakeIndices : Pca9685MakeIndices<N - 1, N - 1, I...> {};
+ template <size_t... I> struct Pca9685MakeIndices<0, I...> { typedef Pca9685Indices<I...> type; };
+ 
+ template <size_t... I>
+ constexpr Pca9685PrescaleTable_t pca9685MakeTable(Pca9685Indices<I...>) {
+   return Pca9685PrescaleTable_t{ { pca9685OutputMilliHz(PCA9685_NOMINAL_OSC_WHOLE_HZ, PCA9685_PRESCALE_MIN + I)... } };
+ }
+ 
+ constexpr Pca9685PrescaleTable_t pca9685PrescaleTable = pca9685MakeTable(Pca9685MakeIndices<PCA9685_PRESCALE_COUNT>::type());
+ 
+ // Every entry gives back its prescale by the datasheet formula,
+ // prescale = round(osc / (4096 * f)) - 1, and the entries descend
+ static constexpr bool tableMatchesFormula(size_t i) {
+   return i >= PCA9685_PRESCALE_COUNT ||
+          ((2ULL * PCA9685_NOMINAL_OSC_WHOLE_HZ * 1000 / (4096ULL * pca9685PrescaleTable.milliHz[i]) + 1) / 2 - 1 ==
+               PCA9685_PRESCALE_MIN + i &&
+           (i == 0 || pca9685PrescaleTable.milliHz[i] < pca9685PrescaleTable.milliHz[i - 1]) &&
+           tableMatchesFormula(i + 1));
+ }
+ 
+ // First index in [lo, hi) whose entry is at or below the target
+ static constexpr size_t firstAtOrBelow(uint32_t target, size_t lo, size_t hi) {
+   return (lo >= hi) ? lo
+        : (pca9685PrescaleTable.milliHz[(lo + hi) / 2] <= target) ? firstAtOrBelow(target, lo, (lo + hi) / 2)
+        : firstAtOrBelow(target, (lo + hi) / 2 + 1, hi);
+ }
+ 
+ // Closer of entry i and the one above it
+ static constexpr uint8_t closerPrescale(uint32_t target, size_t i) {
+   return (i == 0) ? PCA9685_PRESCALE_MIN
+        : (i >= PCA9685_PRESCALE_COUNT) ? PCA9685_PRESCALE_MAX
+        : (pca9685PrescaleTable.milliHz[i - 1] - target <= target - pca9685PrescaleTable.milliHz[i])
+            ? (uint8_t)(PCA9685_PRESCALE_MIN + i - 1) : (uint8_t)(PCA9685_PRESCALE_MIN + i);
+ }
+ 
+ static constexpr uint8_t nominalPrescaleFor(uint32_t frequencyMilliHz) {
+   return closerPrescale(frequencyMilliHz, firstAtOrBelow(frequencyMilliHz, 0, PCA9685_PRESCALE_COUNT));
+ }
+ 
+ static_assert(tableMatchesFormula(0), "prescale table disagrees with the datasheet formula");
+ static_assert(pca9685PrescaleTable.milliHz[0] == 1525879, "prescale 3 gives 1526 Hz (datasheet 7.3.5)");
+ static_assert(pca9685PrescaleTable.milliHz[PCA9685_PRESCALE_COUNT - 1] == 23842, "prescale 255 gives 24 Hz (datasheet 7.3.5)");
+ static_assert(nominalPrescaleFor(200000) == 0x1E, "200 Hz is prescale 0x1E (datasheet example)");
+ static_assert(nominalPrescaleFor(5000000) == PCA9685_PRESCALE_MIN && nominalPrescaleFor(1000) == PCA9685_PRESCALE_MAX,
+               "frequencies out of range clamp to the prescale range");
+ 
+ uint8_t pca9685PrescaleForMilliHz(uint32_t oscillatorHz, uint32_t frequencyMilliHz) {
+   if (oscillatorHz == 0) {
+     return PCA9685_PRESCALE_MAX;
+   }
+   uint64_t nominal = ((uint64_t)frequencyMilliHz * PCA9685_NOMINAL_OSC_WHOLE_HZ + oscillatorHz / 2) / oscillatorHz;
+   return nominalPrescaleFor(nominal > UINT32_MAX ? UINT32_MAX : (uint32_t)nominal);
+ }
+ 
+ float pca9685OutputHz(float oscillatorHz, uint8_t prescale) {
+   return oscillatorHz / (4096.0f * (prescale + 1));
+ }
+ 
+ uint8_t pca9685PrescaleFor(float oscillatorHz, float frequencyHz) {
+   if (frequencyHz <= 0) {
+     return PCA9685_PRESCALE_MAX;
+   }
+ 
+   float prescale = oscillatorHz / (4096.0f * frequencyHz) - 1.0f;
+   if (prescale < PCA9685_PRESCALE_MIN) {
+     return PCA9685_PRESCALE_MIN;
+   }
+   if (prescale > PCA9685_PRESCALE_MAX) {
+     return PCA9685_PRESCALE_MAX;
+   }
+   // Frequency is not linear in the prescale: compare the outputs of both neighbours
+   uint8_t lower = (uint8_t)prescale;
+   if (lower == PCA9685_PRESCALE_MAX) {
+     return lower;
+   }
+   float lowerError = pca9685OutputHz(oscillatorHz, lower) - frequencyHz;
+   float upperError = frequencyHz - pca9685OutputHz(oscillatorHz, lower + 1);
+   return (lowerError <= upperError) ? lower : (uint8_t)(lower + 1);
+ }
+ 
+ bool pca9685FitOscillator(const Pca9685CalPoint_t *points, size_t count, Pca9685CalFit_t *fit) {
+   if (fit == NULL) {
+     return false;
+   }
+   memset(fit, 0, sizeof(Pca9685CalFit_t));
+   if (points == NULL) {
+     return false;
+   }
+ 
+   // Point errors are used only if every point has one
+   bool weighted = true;
+   for (size_t i = 0; i < count; i++) {
+     if (!(points[i].stdErrHz > 0)) {
+       weighted = false;
+     }
+   }
+ 
+   double sumWXF = 0, sumWXX = 0;
+   for (size_t i = 0; i < count; i++) {
+     double x = 1.0 / (4096.0 * (points[i].prescale + 1));
+     double f = points[i].measuredHz;
+     if (!(f > 0) || fabs(f / x / PCA9685_NOMINAL_OSC_HZ - 1.0) > PCA9685_CAL_MAX_DEVIATION) {
+       fit->rejected++;
+       continue;
+     }
+     double w = weighted ? 1.0 / ((double)points[i].stdErrHz * points[i].stdErrHz) : 1.0;
+     sumWXF += w * x * f;
+     sumWXX += w * x * x;
+     fit->points++;
+   }
+   if (fit->points == 0) {
+     return false;
+   }
+ 
+   double oscillator = sumWXF / sumWXX;
+ 
+   // Scatter about the model: chi-square with point errors, plain residuals without
+   double chiSquare = 0, sumSqPpm = 0;
+   for (size_t i = 0; i < count; i++) {
+     double x = 1.0 / (4096.0 * (points[i].prescale + 1));
+     double f = points[i].measuredHz;
+     if (!(f > 0) || fabs(f / x / PCA9685_NOMINAL_OSC_HZ - 1.0) > PCA9685_CAL_MAX_DEVIATION) {
+       continue;
+     }
+     double residual = f - oscillator * x;
+     double w = weighted ? 1.0 / ((double)points[i].stdErrHz * points[i].stdErrHz) : 1.0;
+     chiSquare += w * residual * residual;
+     sumSqPpm += (residual / (oscillator * x) * 1e6) * (residual / (oscillator * x) * 1e6);
+   }
+ 
+   double variance;
+   uint8_t dof = fit->points - 1;
+   if (weighted) {
+     // Widen by the reduced chi-square when the points disagree beyond their errors
+     double scale = (dof > 0) ? chiSquare / dof : 1.0;
+     variance = (scale > 1.0 ? scale : 1.0) / sumWXX;
+   } else {
+     // Scatter alone; a single unweighted point has no error estimate
+     variance = (dof > 0) ? (chiSquare / dof) / sumWXX : 0;
+   }
+ 
+   fit->oscillatorHz = (float)oscillator;
+   fit->oscillatorErrHz = (float)sqrt(variance);
+   fit->offsetPpm = (float)((oscillator / PCA9685_NOMINAL_OSC_HZ - 1.0) * 1e6);
+   fit->residualRmsPpm = (float)sqrt(sumSqPpm / fit->points);
+   return true;
+ }
\ No newline at end of file
@@ -0,0 +1,246 @@
+/*
+ * PCA9685 Driver Implementation
+ *
+ * Auto-increment (MODE1 AI) is kept on, so one write covers any run of
+ * registers. After LED15_OFF_H the pointer rolls over to MODE1, and after
+ * PRESCALE (from the ALL_LED block) to MODE1 as well (datasheet 7.3), which
+ * is what lets the frequency change wake the oscillator in the same write
+ * as the new prescale.
+ *
+ * A write to the ALL_LED registers loads the same four bytes into the LED
+ * registers of every output, which is how the shadow records it.
+ */
+ 
+ #include "pca9685_driver.h"
+ #include "pca9685_calibration.h"
+ #include <string.h>
+ 
+ bool pca9685FrameSet(Pca9685Frame_t *frame, uint8_t channel, uint16_t duty, uint16_t phase) {
+   if (frame == NULL || channel >= PCA9685_CHANNELS || duty > PCA9685_COUNTS || phase >= PCA9685_COUNTS) {
+     return false;
+   }
+ 
+   if (duty == 0) {
+     frame->on[channel] = 0;
+     frame->off[channel] = PCA9685_FULL;
+   } else if (duty == PCA9685_COUNTS) {
+     frame->on[channel] = PCA9685_FULL;
+     frame->off[channel] = 0;
+   } else {
+     // The counter wraps, so a high time past the end of the period continues at its start
+     frame->on[channel] = phase;
+     frame->off[channel] = (phase + duty) & (PCA9685_COUNTS - 1);
+   }
+   frame->mask |= 1 << channel;
+   return true;
+ }
+ 
+ Pca9685Driver::Pca9685Driver() : _bus(NULL), _context(NULL), _address(0), _prescale(0) {
+   memset(_shadow, 0, sizeof(_shadow));
+   memset(_staged, 0, sizeof(_staged));
+   memset(_dirty, 0, sizeof(_dirty));
+   memset(&_stats, 0, sizeof(_stats));
+ }
+ 
+ bool Pca9685Driver::write(const uint8_t *data, size_t length) {
+   _stats.transactions++;
+   _stats.bytes += 1 + length;  // Address byte, register, values
+   return _bus->write(_context, _address, data, length);
+ }
+ 
+ bool Pca9685Driver::read(uint8_t reg, uint8_t *data, size_t length) {
+   _stats.transactions++;
+   _stats.bytes += 2 + 1 + length;  // Address and register, repeated start address, values
+   return _bus->read(_context, _address, reg, data, length);
+ }
+ 
+ bool Pca9685Driver::begin(const Pca9685Bus_t *bus, void *context, uint8_t address, uint8_t mode1, uint8_t mode2) {
+   if (bus == NULL || bus->write == NULL || bus->read == NULL || bus->delayUs == NULL) {
+     return false;
+   }
+   _bus = bus;
+   _context = context;
+   _address = address;
+   memset(_dirty, 0, sizeof(_dirty));
+   memset(&_stats, 0, sizeof(_stats));
+ 
+   // Sleep with auto-increment, so the read-back below is one transaction
+   uint8_t sleep[2] = { PCA9685_MODE1, PCA9685_SLEEP | PCA9685_AI };
+   if (!write(sleep, sizeof(sleep)) ||
+       !read(PCA9685_MODE1, _shadow, PCA9685_SHADOW_SIZE) ||
+       !read(PCA9685_PRESCALE, &_prescale, 1)) {
+     _bus = NULL;
+     return false;
+   }
+   _shadow[PCA9685_MODE1] &= ~PCA9685_RESTART;
+ 
+   // Run modes in one write; the oscillator starts from here
+   mode1 = (mode1 & ~(PCA9685_RESTART | PCA9685_SLEEP)) | PCA9685_AI;
+   stageRegister(PCA9685_MODE1, mode1);
+   stageRegister(PCA9685_MODE2, mode2);
+   if (!flush()) {
+     _bus = NULL;
+     return false;
+   }
+   _bus->delayUs(_context, PCA9685_OSC_STARTUP_US);
+   return true;
+ }
+ 
+ bool Pca9685Driver::setPrescale(uint8_t prescale) {
+   if (_bus == NULL || prescale < PCA9685_PRESCALE_MIN) {
+     return false;
+   }
+   if (prescale == _prescale) {
+     _stats.skippedBytes++;
+     return true;
+   }
+ 
+   // Anything staged goes first, so the mode written below is the current one
+   if (!flush()) {
+     return false;
+   }
+ 
+   // PRESCALE only takes a write while the oscillator sleeps
+   uint8_t mode1 = _shadow[PCA9685_MODE1];
+   uint8_t sleep[2] = { PCA9685_MODE1, (uint8_t)(mode1 | PCA9685_SLEEP) };
+   if (!write(sleep, sizeof(sleep))) {
+     return false;
+   }
+   _shadow[PCA9685_MODE1] = mode1 | PCA9685_SLEEP;
+ 
+   // New prescale, then the pointer rolls over to MODE1 and restores the mode
+   uint8_t update[3] = { PCA9685_PRESCALE, prescale, mode1 };
+   if (!write(update, sizeof(update))) {
+     return false;
+   }
+   _prescale = prescale;
+   _shadow[PCA9685_MODE1] = mode1;
+   if (mode1 & PCA9685_SLEEP) {
+     return true;  // Asleep by choice, nothing to restart
+   }
+ 
+   // Outputs that ran before the sleep resume once RESTART is written after the start-up time
+   _bus->delayUs(_context, PCA9685_OSC_STARTUP_US);
+   uint8_t restart[2] = { PCA9685_MODE1, (uint8_t)(mode1 | PCA9685_RESTART) };
+   return write(restart, sizeof(restart));
+ }
+ 
+ bool Pca9685Driver::stageRegister(uint8_t reg, uint8_t value) {
+   if (reg >= PCA9685_SHADOW_SIZE || (reg > PCA9685_MODE2 && reg < PCA9685_LED0_ON_L)) {
+     return false;
+   }
+   if (reg == PCA9685_MODE1) {
+     value = (value & ~PCA9685_RESTART) | PCA9685_AI;
+   }
+   _staged[reg] = value;
+   _dirty[reg] = true;
+   return true;
+ }
+ 
+ bool Pca9685Driver::stagePWM(uint8_t channel, uint16_t on, uint16_t off) {
+   if (channel >= PCA9685_CHANNELS) {
+     return false;
+   }
+   uint8_t reg = PCA9685_LED0_ON_L + 4 * channel;
+   stageRegister(reg, on & 0xFF);
+   stageRegister(reg + 1, (on >> 8) & 0x1F);
+   stageRegister(reg + 2, off & 0xFF);
+   stageRegister(reg + 3, (off >> 8) & 0x1F);
+   return true;
+ }
+ 
+ bool Pca9685Driver::stageFrame(const Pca9685Frame_t *frame) {
+   if (frame == NULL) {
+     return false;
+   }
+   for (uint8_t channel = 0; channel < PCA9685_CHANNELS; channel++) {
+     if (frame->mask & (1 << channel)) {
+       stagePWM(channel, frame->on[channel], frame->off[channel]);
+     }
+   }
+   return true;
+ }
+ 
+ // Send the LED registers as one ALL_LED write if every output ends up the
+ // same and more than one output changes; true if it was written
+ bool Pca9685Driver::flushAllLed() {
+   uint8_t counts[4];
+   uint16_t changed = 0;
+   for (uint8_t i = 0; i < 4 * PCA9685_CHANNELS; i++) {
+     uint8_t reg = PCA9685_LED0_ON_L + i;
+     uint8_t value = _dirty[reg] ? _staged[reg] : _shadow[reg];
+     if (i < 4) {
+       counts[i] = value;
+     } else if (value != counts[i % 4]) {
+       return false;
+     }
+     if (_dirty[reg]) {
+       changed |= 1 << (i / 4);
+     }
+   }
+   if ((changed & (changed - 1)) == 0) {
+     return false;  // One output or none: its own write is no longer
+   }
+ 
+   uint8_t data[5] = { PCA9685_ALL_LED_ON_L, counts[0], counts[1], counts[2], counts[3] };
+   if (!write(data, sizeof(data))) {
+     return false;
+   }
+   for (uint8_t i = 0; i < 4 * PCA9685_CHANNELS; i++) {
+     _shadow[PCA9685_LED0_ON_L + i] = counts[i % 4];
+     _dirty[PCA9685_LED0_ON_L + i] = false;
+   }
+   _stats.allLedWrites++;
+   return true;
+ }
+ 
+ bool Pca9685Driver::flush() {
+   if (_bus == NULL) {
+     return false;
+   }
+ 
+   // Staged values the device already holds need no write
+   for (uint8_t reg = 0; reg < PCA9685_SHADOW_SIZE; reg++) {
+     if (_dirty[reg] && _staged[reg] == _shadow[reg]) {
+       _dirty[reg] = false;
+       _stats.skippedBytes++;
+     }
+   }
+ 
+   // Outputs all set alike; a failed ALL_LED write leaves them for the runs below
+   flushAllLed();
+ 
+   bool success = true;
+   uint8_t reg = 0;
+   while (reg < PCA9685_SHADOW_SIZE) {
+     if (!_dirty[reg]) {
+       reg++;
+       continue;
+     }
+ 
+     // Extend the run over short gaps of unchanged registers, rewriting them as they are
+     uint8_t first = reg;
+     uint8_t last = reg;
+     for (uint8_t next = reg + 1; next < PCA9685_SHADOW_SIZE && next - last <= PCA9685_MERGE_GAP + 1; next++) {
+       if (_dirty[next]) {
+         last = next;
+       }
+     }
+ 
+     uint8_t data[1 + PCA9685_SHADOW_SIZE];
+     data[0] = first;
+     for (uint8_t i = first; i <= last; i++) {
+       data[1 + i - first] = _dirty[i] ? _staged[i] : _shadow[i];
+     }
+     if (write(data, 2 + last - first)) {
+       for (uint8_t i = first; i <= last; i++) {
+         _shadow[i] = data[1 + i - first];
+         _dirty[i] = false;
+       }
+     } else {
+       success = false;  // Left staged for the next flush
+     }
+     reg = last + 1;
+   }
+   return success;
+ }
\ No newline at end of file
@@ -0,0 +1,201 @@
+/*
+ * Pulse Burst Implementation
+ *
+ * Within a burst, time arithmetic is unsigned differences of wrapping 32-bit
+ * counters, so bursts that straddle the micros() wrap (every 71.6 minutes)
+ * measure the same as any other. Between bursts it is on the 64-bit clock,
+ * so off periods longer than the wrap are not aliased.
+ */
+ 
+ #include "pulse_burst.h"
+ #include <string.h>
+ 
+ PulseBurstMonitor::PulseBurstMonitor() {
+   // micros() timestamps and a ten burst sliding window until configured
+   PulseBurstConfig_t config;
+   memset(&config, 0, sizeof(config));
+   config.tickHz = 1000000;
+   config.windowMode = STREAMING_WINDOW_SLIDING;
+   config.window = 10;
+   configure(&config);
+ }
+ 
+ bool PulseBurstMonitor::configure(const PulseBurstConfig_t *config) {
+   if (config == NULL || pulseNsPerTickQ16(config->tickHz) == 0 || config->window < 2 ||
+       (config->windowMode == STREAMING_WINDOW_SLIDING && config->window > PULSE_STATS_MAX_WINDOW)) {
+     return false;
+   }
+ 
+   _config = *config;
+   _nsPerTickQ16 = pulseNsPerTickQ16(config->tickHz);
+   _pulseCountStats.configure(config->windowMode, config->window);
+   _frequencyStats.configure(config->windowMode, config->window);
+   _firstPeriodStats.configure(config->windowMode, config->window);
+   _burstDurationStats.configure(config->windowMode, config->window);
+   _offPeriodStats.configure(config->windowMode, config->window);
+   reset();
+   return true;
+ }
+ 
+ void PulseBurstMonitor::reset() {
+   memset(&_result, 0, sizeof(_result));
+   _result.channel = _config.channel;
+   _previousBurstEndUs = 0;
+   _havePreviousBurst = false;
+   _active = false;
+   memset(&_firstReading, 0, sizeof(_firstReading));
+   _firstReadingUs = 0;
+   _haveFirstReading = false;
+   resetStats();
+ }
+ 
+ void PulseBurstMonitor::resetStats() {
+   _pulseCountStats.reset();
+   _frequencyStats.reset();
+   _firstPeriodStats.reset();
+   _burstDurationStats.reset();
+   _offPeriodStats.reset();
+ }
+ 
+ bool PulseBurstMonitor::startBurst() {
+   if (_active) {
+     return false;
+   }
+ 
+   // Update result with active status, the rest is still the previous burst
+   _result.burstActive = true;
+   _result.success = true;
+   _active = true;
+   return true;
+ }
+ 
+ PulseBurstEvent_t PulseBurstMonitor::closeBurst(const PulseEdgeTracker_t *burst, uint64_t nowUs) {
+   uint64_t startUs = monotonicExtendUs(burst->burstStartTimeUs, nowUs);
+ 
+   // Off period since the previous burst (none before the first)
+   uint32_t offPeriod = 0;
+   if (_havePreviousBurst) {
+     uint64_t offUs = startUs - _previousBurstEndUs;
+     offPeriod = (offUs > UINT32_MAX) ? UINT32_MAX : (uint32_t)offUs;
+   }
+ 
+   // Integer metrics; frequency and mean period from whole periods (odd edge to odd edge)
+   _result.success = true;
+   _result.burstActive = false;
+   _result.burstDurationUs = pulseTicksToWholeUs(burst->lastEdgeTicks - burst->burstStartTicks, _nsPerTickQ16);
+   _result.meanPeriodNs = pulseMeanPeriodNs(burst, _nsPerTickQ16);
+   _result.firstPulsePeriodNs = pulseTicksToNs(burst->firstPeriodTicks, _nsPerTickQ16);
+   _result.offPeriodUs = offPeriod;
+   _result.pulseCount = burst->edgeCount / 2;  // Each pulse has 2 edges
+   _result.frequencyKHzQ16 = pulseFrequencyKHzQ16(burst, _config.tickHz);
+   _result.firstPulsePeriodUs = pulseTicksToWholeUs(burst->firstPeriodTicks, _nsPerTickQ16);
+   _result.timestampUs = nowUs;
+   _result.burstStartUs = startUs;
+ 
+   _previousBurstEndUs = monotonicExtendUs(burst->lastEdgeTimeUs, nowUs);
+   _havePreviousBurst = true;
+   _active = false;
+ 
+   PulseBurstEvent_t event;
+   if (_result.pulseCount > PULSE_MAX_PULSE_COUNT) {
+     // Too many pulses - don't include in average, restart it
+     resetStats();
+ 
+     // Only drop the first reading once it has been kept long enough
+     if (!_haveFirstReading) {
+       event = PULSE_BURST_OVER_LIMIT;
+     } else if (nowUs - _firstReadingUs > (uint64_t)PULSE_FIRST_READING_MIN_MS * 1000) {
+       _haveFirstReading = false;
+       event = PULSE_BURST_OVER_LIMIT_DROPPED;
+     } else {
+       event = PULSE_BURST_OVER_LIMIT_KEPT;
+     }
+   } else {
+     // Update the rolling statistics (no off period before the first burst). The frequency
+     // mean stays Q16.16; the others are floating point for the variance and quantiles
+     _pulseCountStats.add(_result.pulseCount);
+     _frequencyStats.add(_result.frequencyKHzQ16);
+     _firstPeriodStats.add(_result.firstPulsePeriodUs);
+     _burstDurationStats.add(_result.burstDurationUs);
+     if (_result.offPeriodUs > 0) {
+       _offPeriodStats.add(_result.offPeriodUs);
+     }
+ 
+     // Store first valid reading if we don't have one yet
+     event = PULSE_BURST_RECORDED;
+     if (!_haveFirstReading) {
+       _firstReading = _result;
+       _firstReadingUs = nowUs;
+       _haveFirstReading = true;
+       event = PULSE_BURST_FIRST_READING;
+     }
+   }
+   return event;
+ }
+ 
+ PulseBurstReplay::PulseBurstReplay() : _sink(NULL), _context(NULL) {
+   reset();
+ }
+ 
+ bool PulseBurstReplay::configure(const PulseBurstConfig_t *config, Sink_t sink, void *context) {
+   if (!_monitor.configure(config)) {
+     return false;
+   }
+   _sink = sink;
+   _context = context;
+   reset();
+   return true;
+ }
+ 
+ void PulseBurstReplay::reset() {
+   _monitor.reset();
+   memset(&_tracker, 0, sizeof(_tracker));
+   _clockUs = 0;
+   _lastEdgeUs = 0;
+   _level = false;
+   _haveLevel = false;
+   _edges = 0;
+   _bursts = 0;
+ }
+ 
+ void PulseBurstReplay::publish(PulseBurstEvent_t event) {
+   if (_sink != NULL) {
+     _sink(_monitor.result(), event, _context);
+   }
+ }
+ 
+ bool PulseBurstReplay::edge(uint64_t timeUs, uint32_t ticks, bool level) {
+   // The burst in progress closes as soon as its gap has passed, before this entry
+   if (_tracker.burstActive && timeUs - _lastEdgeUs > PULSE_BURST_TIMEOUT_US) {
+     finish();
+   }
+   _clockUs = timeUs;
+ 
+   if (_haveLevel && level == _level) {
+     return false;
+   }
+   _level = level;
+   _haveLevel = true;
+   _edges++;
+   _lastEdgeUs = timeUs;
+ 
+   if (pulseTrackEdge(&_tracker, (uint32_t)timeUs, ticks)) {
+     _tracker.burstStarted = false;
+     if (_monitor.startBurst()) {
+       publish(PULSE_BURST_STARTED);
+     }
+   }
+   return true;
+ }
+ 
+ void PulseBurstReplay::finish() {
+   if (!_tracker.burstActive) {
+     return;
+   }
+ 
+   _clockUs = _lastEdgeUs + PULSE_BURST_TIMEOUT_US + 1;
+   PulseEdgeTracker_t burst = _tracker;
+   _tracker.burstActive = false;
+   _bursts++;
+   publish(_monitor.closeBurst(&burst, _clockUs));
+ }
\ No newline at end of file
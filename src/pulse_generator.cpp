@@ -4,6 +4,13 @@
 
  #include "pulse_generator.h"
  #include "simplified_debug.h"
+ #include "pulse_tasks.h"
+ #include "serial_command.h"
+ #include "monotonic_time.h"
+ 
+ // Generator task notification bits
+ #define PULSE_GEN_NOTIFY_SETTINGS 0x01  // Settings requested
+ #define PULSE_GEN_NOTIFY_CAL      0x02  // Calibration requested
  
  // Static variables
  static TwoWire *i2cWire = NULL;
@@ -15,26 +22,44 @@
  static bool currentlyEnabled = false;
  static bool pca9685Initialized = false;
  
- // Helper function to read a PCA9685 register with mutex protection
- static bool readPCA9685Register(uint8_t reg, uint8_t *value) {
-     if (i2cWire == NULL || value == NULL) {
-         return false;
-     }
-     
+ // Oscillator the prescale is looked up for (nominal until calibrated), and the frequency set
+ static uint32_t oscillatorHz = PCA9685_NOMINAL_OSC_WHOLE_HZ;
+ static PulseFrequencySetting_t currentSetting = {};
+ 
+ // Calibration request and result, shared with the command task
+ static portMUX_TYPE calMux = portMUX_INITIALIZER_UNLOCKED;
+ static PulseCalibration_t calibration = {};
+ static bool calPending = false;
+ static TaskHandle_t calNotifyTask = NULL;
+ static uint32_t calNotifyBits = 0;
+ static uint32_t serialEventBit = 0;
+ static bool calReport = false;
+ 
+ // Latest requested settings, shared with the requesting tasks: a request
+ // overwrites one the task has not picked up yet
+ static portMUX_TYPE settingsMux = portMUX_INITIALIZER_UNLOCKED;
+ static PulseGeneratorSettings_t requestedSettings = { PULSE_DEFAULT_FREQ, false };
+ static Pca9685Frame_t requestedFrame = {};  // Outputs not yet applied (mask 0 = none)
+ static bool settingsPending = false;
+ static uint64_t pendingSinceUs = 0;  // monotonicUs() of the oldest request not yet applied
+ static uint32_t pendingRequests = 0;
+ static PulseGeneratorStats_t generatorStats = {};
+ static uint64_t latencySumUs = 0;
+ static bool settingsReport = false;  // Report the next update on the command channel
+ static bool settingsReportReady = false;
+ 
+ // PCA9685 registers, through the shadow
+ static Pca9685Driver pca9685;
+ 
+ // Driver bus callbacks: one I2C transaction per call under the mutex
+ static bool pca9685BusWrite(void *context, uint8_t address, const uint8_t *data, size_t length) {
      bool success = false;
      
      // Take the I2C mutex with timeout
      if (xSemaphoreTake(i2cMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-         // Set register pointer
-         i2cWire->beginTransmission(PCA9685_ADDR);
-         i2cWire->write(reg);
-         if (i2cWire->endTransmission() == 0) {
-             // Read 1 byte
-             if (i2cWire->requestFrom(PCA9685_ADDR, 1) == 1) {
-                 *value = i2cWire->read();
-                 success = true;
-             }
-         }
+         i2cWire->beginTransmission(address);
+         i2cWire->write(data, length);
+         success = (i2cWire->endTransmission() == 0);
          
          // Release the mutex
          xSemaphoreGive(i2cMutex);
@@ -43,21 +68,17 @@
      return success;
  }
  
- // Helper function to write a PCA9685 register with mutex protection
- static bool writePCA9685Register(uint8_t reg, uint8_t value) {
-     if (i2cWire == NULL) {
-         return false;
-     }
-     
+ static bool pca9685BusRead(void *context, uint8_t address, uint8_t reg, uint8_t *data, size_t length) {
      bool success = false;
      
      // Take the I2C mutex with timeout
      if (xSemaphoreTake(i2cMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-         // Write register
-         i2cWire->beginTransmission(PCA9685_ADDR);
+         // Set register pointer, then read with a repeated start
+         i2cWire->beginTransmission(address);
          i2cWire->write(reg);
-         i2cWire->write(value);
-         success = (i2cWire->endTransmission() == 0);
+         if (i2cWire->endTransmission(false) == 0 && i2cWire->requestFrom(address, length, true) == length) {
+             success = (i2cWire->readBytes(data, length) == length);
+         }
          
          // Release the mutex
          xSemaphoreGive(i2cMutex);
@@ -66,54 +87,46 @@
      return success;
  }
  
- // Calculate prescale value for desired frequency
- static uint8_t calculatePrescale(uint16_t freq) {
+ static void pca9685BusDelayUs(void *context, uint32_t us) {
+     delayMicroseconds(us);
+ }
+ 
+ static const Pca9685Bus_t pca9685Bus = { pca9685BusWrite, pca9685BusRead, pca9685BusDelayUs };
+ 
+ bool getPulseFrequencySetting(uint16_t freq, PulseFrequencySetting_t *setting) {
+     if (setting == NULL) {
+         return false;
+     }
+     
      // Constrain frequency to valid range
      if (freq < PULSE_MIN_FREQ) freq = PULSE_MIN_FREQ;
      if (freq > PULSE_MAX_FREQ) freq = PULSE_MAX_FREQ;
      
-     // Formula from datasheet: prescale = round(25MHz / (4096 * freq)) - 1
-     float prescaleval = 25000000.0;  // 25MHz
-     prescaleval /= 4096.0;           // 12-bit resolution
-     prescaleval /= freq;
-     prescaleval -= 1.0;
-     
-     return (uint8_t)(prescaleval + 0.5f); // Round to nearest
+     // Closest entry of the prescale table, for the calibrated oscillator
+     uint32_t oscillator = oscillatorHz;
+     setting->requestedHz = freq;
+     setting->prescale = pca9685PrescaleForMilliHz(oscillator, freq * 1000UL);
+     setting->achievedMilliHz = pca9685OutputMilliHz(oscillator, setting->prescale);
+     setting->errorPpm = (int32_t)(((int64_t)setting->achievedMilliHz - freq * 1000LL) * 1000 / freq);
+     return true;
  }
  
- // Set PWM on a specific channel with a 50% duty cycle
- static bool setPWM(uint8_t channel, uint16_t on, uint16_t off) {
-     if (i2cWire == NULL) {
+ // Write the prescaler: sleep, prescale and wake, restart (no writes if unchanged)
+ static bool writePrescale(uint8_t prescale) {
+     if (!pca9685.setPrescale(prescale)) {
+         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set prescale value");
          return false;
      }
-     
-     bool success = false;
-     
-     // Calculate register addresses for this channel
-     uint8_t channelBase = PCA9685_LED0_ON_L + (channel * 4);
-     
-     // Take the I2C mutex with timeout
-     if (xSemaphoreTake(i2cMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-         // Write all four registers
-         i2cWire->beginTransmission(PCA9685_ADDR);
-         i2cWire->write(channelBase);
-         i2cWire->write(on & 0xFF);         // ON_L
-         i2cWire->write(on >> 8);           // ON_H
-         i2cWire->write(off & 0xFF);        // OFF_L
-         i2cWire->write(off >> 8);          // OFF_H
-         success = (i2cWire->endTransmission() == 0);
-         
-         // Release the mutex
-         xSemaphoreGive(i2cMutex);
-     }
-     
-     return success;
+     return true;
  }
  
- // Set 50% duty cycle on a channel (2048 ticks, half of 4096)
- static bool set50PercentDutyCycle(uint8_t channel) {
+ // Set 50% duty cycle on both outputs (2048 ticks, half of 4096); their registers
+ // are adjacent, so a change goes out as one write and no change as none
+ static bool set50PercentDutyCycle() {
      // For 50% duty cycle, we set ON at 0 and OFF at 2048 (half of 4096)
-     return setPWM(channel, 0, 2048);
+     pca9685.stagePWM(PULSE_CHANNEL_1, 0, 2048);
+     pca9685.stagePWM(PULSE_CHANNEL_2, 0, 2048);
+     return pca9685.flush();
  }
  
  // Helper function to check if PCA9685 is present on the I2C bus
@@ -145,42 +158,15 @@
      return deviceFound;
  }
  
- // Reset the PCA9685
+ // Reset the PCA9685 to a known mode and load the register shadow
  static bool resetPCA9685() {
-     bool success = true;
-     
-     // Put to sleep
-     if (!writePCA9685Register(PCA9685_MODE1, PCA9685_SLEEP)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to put PCA9685 to sleep - device may not be connected");
+     // MODE1 with AI (auto-increment), MODE2 with OUTDRV (totem pole output)
+     if (!pca9685.begin(&pca9685Bus, NULL, PCA9685_ADDR, PCA9685_AI, PCA9685_OUTDRV)) {
+         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set up PCA9685 - device may not be connected");
          return false;
      }
      
-     // Wait a bit for the oscillator to stabilize
-     vTaskDelay(pdMS_TO_TICKS(5));
-     
-     // Set Mode1 with AI (auto-increment) enabled and sleep bit cleared
-     if (!writePCA9685Register(PCA9685_MODE1, PCA9685_AI)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set PCA9685 MODE1 register");
-         return false;
-     }
-     
-     // Set Mode2 with OUTDRV (totem pole output) enabled
-     if (!writePCA9685Register(PCA9685_MODE2, PCA9685_OUTDRV)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set PCA9685 MODE2 register");
-         return false;
-     }
-     
-     // Wait for restart
-     vTaskDelay(pdMS_TO_TICKS(5));
-     
-     // Verify that we can read from the device
-     uint8_t mode1Value;
-     if (!readPCA9685Register(PCA9685_MODE1, &mode1Value)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot read from PCA9685 after reset");
-         return false;
-     }
-     
-     //DEBUG_PRINT(DEBUG_LEVEL_INFO, "PCA9685 reset successful, MODE1=%02X", mode1Value);
+     //DEBUG_PRINT(DEBUG_LEVEL_INFO, "PCA9685 reset successful, MODE1=%02X", pca9685.shadow(PCA9685_MODE1));
      return true;
  }
  
@@ -197,6 +183,9 @@
          return false;
      }
      
+     // Nominal oscillator until a calibration has run
+     calibration.fit.oscillatorHz = PCA9685_NOMINAL_OSC_HZ;
+     
      // Configure the enable pin
      pinMode(PULSE_ENABLE_PIN, OUTPUT);
      digitalWrite(PULSE_ENABLE_PIN, LOW);  // Start disabled
@@ -224,7 +213,7 @@
      }
      
      // Set 50% duty cycle on both channels but keep disabled
-     if (!set50PercentDutyCycle(PULSE_CHANNEL_1) || !set50PercentDutyCycle(PULSE_CHANNEL_2)) {
+     if (!set50PercentDutyCycle()) {
          //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set duty cycle");
          pca9685Initialized = false;  // Revert initialization state
          return false;
@@ -234,7 +223,7 @@
      return true;
  }
  
- bool setPulseFrequency(uint16_t freq) {
+ bool setPulseFrequency(uint16_t freq, PulseFrequencySetting_t *setting) {
      // Check if I2C wire is available (even if not fully initialized)
      if (i2cWire == NULL) {
          //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "I2C interface not available");
@@ -247,60 +236,33 @@
          // We'll continue anyway, as this might be called from initPulseGenerator
      }
      
-     // Constrain frequency to valid range
-     if (freq < PULSE_MIN_FREQ) freq = PULSE_MIN_FREQ;
-     if (freq > PULSE_MAX_FREQ) freq = PULSE_MAX_FREQ;
-     
      //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Setting pulse frequency to %u Hz", freq);
      
-     // Calculate the prescale value
-     uint8_t prescale = calculatePrescale(freq);
-     
-     // Read current mode
-     uint8_t oldmode;
-     if (!readPCA9685Register(PCA9685_MODE1, &oldmode)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to read MODE1 register");
-         return false;
-     }
-     
-     // To change the frequency, we need to put the device to sleep
-     uint8_t newmode = (oldmode & ~PCA9685_RESTART) | PCA9685_SLEEP;
-     
-     // Go to sleep
-     if (!writePCA9685Register(PCA9685_MODE1, newmode)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set MODE1 register (sleep)");
+     // Look up the prescale (the frequency is clamped to the valid range there)
+     PulseFrequencySetting_t lookup;
+     getPulseFrequencySetting(freq, &lookup);
+     if (!writePrescale(lookup.prescale)) {
          return false;
      }
      
-     // Set the prescaler
-     if (!writePCA9685Register(PCA9685_PRESCALE, prescale)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set prescale value");
-         return false;
-     }
-     
-     // Restore the original mode value without sleep bit
-     if (!writePCA9685Register(PCA9685_MODE1, oldmode)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to restore MODE1 register");
-         return false;
+     // Output frequency this prescale gives with the oscillator in use, for the calibration report
+     float achievedHz = lookup.achievedMilliHz / 1000.0f;
+     portENTER_CRITICAL(&calMux);
+     calibration.prescale = lookup.prescale;
+     calibration.requestedHz = lookup.requestedHz;
+     calibration.achievedHz = achievedHz;
+     calibration.achievedErrHz = 2.0f * achievedHz * calibration.fit.oscillatorErrHz / calibration.fit.oscillatorHz;
+     portEXIT_CRITICAL(&calMux);
+     
+     // Store the current frequency; the restart kept the duty and phase of every output
+     currentFrequency = lookup.requestedHz;
+     currentSetting = lookup;
+     if (setting != NULL) {
+         *setting = lookup;
      }
      
-     // Wait for oscillator
-     vTaskDelay(pdMS_TO_TICKS(5));
-     
-     // Set the RESTART bit to apply changes
-     if (!writePCA9685Register(PCA9685_MODE1, oldmode | PCA9685_RESTART)) {
-         //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set RESTART bit");
-         return false;
-     }
-     
-     // Store the current frequency
-     currentFrequency = freq;
-     
-     // Reapply 50% duty cycle as frequency change affects the timing
-     bool success = set50PercentDutyCycle(PULSE_CHANNEL_1) && set50PercentDutyCycle(PULSE_CHANNEL_2);
-     
-     //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse frequency set to %u Hz with prescale %u", freq, prescale);
-     return success;
+     //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse frequency set to %u Hz with prescale %u (%ld ppm)", freq, lookup.prescale, lookup.errorPpm);
+     return true;
  }
  
  bool enablePulseGenerator(bool enable) {
@@ -321,34 +283,269 @@
      return true;
  }
  
+ // Count a request into the pending slot (settingsMux held)
+ static void notePendingRequest(uint64_t nowUs) {
+     if (!settingsPending) {
+         pendingSinceUs = nowUs;
+     }
+     settingsPending = true;
+     pendingRequests++;
+     generatorStats.requests++;
+ }
+ 
+ // Wake the task; before it exists the request waits for its first pass
+ static void notifyGeneratorTask() {
+     if (pulseGeneratorTaskHandle != NULL) {
+         xTaskNotify(pulseGeneratorTaskHandle, PULSE_GEN_NOTIFY_SETTINGS, eSetBits);
+     }
+ }
+ 
+ bool requestPulseSettings(const PulseGeneratorSettings_t *settings) {
+     if (!pca9685Initialized || settings == NULL ||
+         settings->frequency < PULSE_MIN_FREQ || settings->frequency > PULSE_MAX_FREQ) {
+         return false;
+     }
+     
+     uint64_t nowUs = monotonicUs();
+     portENTER_CRITICAL(&settingsMux);
+     requestedSettings = *settings;
+     notePendingRequest(nowUs);
+     portEXIT_CRITICAL(&settingsMux);
+     
+     notifyGeneratorTask();
+     return true;
+ }
+ 
+ bool requestPulseFrame(const Pca9685Frame_t *frame) {
+     if (!pca9685Initialized || frame == NULL || frame->mask == 0) {
+         return false;
+     }
+     
+     uint64_t nowUs = monotonicUs();
+     portENTER_CRITICAL(&settingsMux);
+     for (uint8_t channel = 0; channel < PCA9685_CHANNELS; channel++) {
+         if (frame->mask & (1 << channel)) {
+             requestedFrame.on[channel] = frame->on[channel];
+             requestedFrame.off[channel] = frame->off[channel];
+         }
+     }
+     requestedFrame.mask |= frame->mask;
+     notePendingRequest(nowUs);
+     portEXIT_CRITICAL(&settingsMux);
+     
+     notifyGeneratorTask();
+     return true;
+ }
+ 
+ bool requestPulseChannel(uint8_t channel, uint16_t duty, uint16_t phase) {
+     Pca9685Frame_t frame = {};
+     return pca9685FrameSet(&frame, channel, duty, phase) && requestPulseFrame(&frame);
+ }
+ 
+ // Merge the given fields into the latest request, under the lock, so
+ // concurrent requests for different fields do not undo each other
+ static bool requestSettingsFields(const uint16_t *freq, const bool *outputsOn) {
+     if (!pca9685Initialized || (freq != NULL && (*freq < PULSE_MIN_FREQ || *freq > PULSE_MAX_FREQ))) {
+         return false;
+     }
+     
+     uint64_t nowUs = monotonicUs();
+     portENTER_CRITICAL(&settingsMux);
+     if (freq != NULL) {
+         requestedSettings.frequency = *freq;
+     }
+     if (outputsOn != NULL) {
+         requestedSettings.outputsOn = *outputsOn;
+     }
+     notePendingRequest(nowUs);
+     portEXIT_CRITICAL(&settingsMux);
+     
+     notifyGeneratorTask();
+     return true;
+ }
+ 
+ bool requestPulseFrequency(uint16_t freq) {
+     return requestSettingsFields(&freq, NULL);
+ }
+ 
+ bool requestPulseOutputs(bool on) {
+     return requestSettingsFields(NULL, &on);
+ }
+ 
  bool updatePulseGenerator() {
+     PulseGeneratorSettings_t settings;
+     settings.frequency = pFrequency;
+     settings.outputsOn = !pulseEn;
+     return requestPulseSettings(&settings);
+ }
+ 
+ bool getPulseGeneratorStats(PulseGeneratorStats_t *stats) {
+     if (!pca9685Initialized || stats == NULL) {
+         return false;
+     }
+     
+     portENTER_CRITICAL(&settingsMux);
+     *stats = generatorStats;
+     portEXIT_CRITICAL(&settingsMux);
+     return true;
+ }
+ 
+ // Apply the latest requested settings, if any. Outputs are switched off around
+ // a frequency change, so no pulses go out while the oscillator sleeps and
+ // restarts; duty and phase frames go out in one transaction and take effect
+ // together at its STOP, so they are written with the outputs as they are
+ static void applyPendingSettings() {
+     portENTER_CRITICAL(&settingsMux);
+     bool pending = settingsPending;
+     PulseGeneratorSettings_t settings = requestedSettings;
+     Pca9685Frame_t frame = requestedFrame;
+     uint64_t sinceUs = pendingSinceUs;
+     uint32_t merged = pendingRequests;
+     requestedFrame.mask = 0;
+     settingsPending = false;
+     pendingRequests = 0;
+     portEXIT_CRITICAL(&settingsMux);
+     if (!pending) {
+         return;
+     }
+     
+     // The enable pin is active low: HIGH switches the outputs off
+     bool pinHigh = !settings.outputsOn;
+     bool frequencyChange = settings.frequency != currentFrequency;
      bool success = true;
+     if ((pinHigh || frequencyChange) && !currentlyEnabled) {
+         success &= enablePulseGenerator(true);
+     }
+     if (frequencyChange) {
+         success &= setPulseFrequency(settings.frequency);
+     }
+     if (frame.mask != 0) {
+         success &= pca9685.writeFrame(&frame);
+     }
+     if (!pinHigh && currentlyEnabled) {
+         success &= enablePulseGenerator(false);
+     }
+     uint64_t latencyUs = monotonicUs() - sinceUs;
+     
+     // Mirrors for code that reads the globals
+     pFrequency = currentFrequency;
+     pulseEn = currentlyEnabled;
+     
+     portENTER_CRITICAL(&settingsMux);
+     generatorStats.applied.frequency = currentFrequency;
+     generatorStats.applied.outputsOn = !currentlyEnabled;
+     generatorStats.achieved = currentSetting;
+     generatorStats.updates++;
+     generatorStats.busTransactions = pca9685.stats().transactions;
+     generatorStats.busBytes = pca9685.stats().bytes;
+     generatorStats.coalesced += merged - 1;
+     if (!success) {
+         generatorStats.failures++;
+     }
+     generatorStats.lastLatencyUs = (latencyUs > UINT32_MAX) ? UINT32_MAX : (uint32_t)latencyUs;
+     latencySumUs += latencyUs;
+     generatorStats.meanLatencyUs = (uint32_t)(latencySumUs / generatorStats.updates);
+     if (generatorStats.lastLatencyUs > generatorStats.maxLatencyUs) {
+         generatorStats.maxLatencyUs = generatorStats.lastLatencyUs;
+     }
+     bool report = settingsReport;
+     settingsReport = false;
+     settingsReportReady |= report;
+     portEXIT_CRITICAL(&settingsMux);
      
-     // Check if pulseEn has changed
-     if (pulseEn != currentlyEnabled) {
-         success &= enablePulseGenerator(pulseEn);
+     if (report) {
+         xTaskNotify(getSerialCommandTask(), serialEventBit, eSetBits);
+     }
+ }
+ 
+ // Sweep the prescale, measure each output frequency and fit the oscillator
+ static void runPulseCalibration(uint8_t channel) {
+     static const uint16_t sweep[] = PULSE_CAL_FREQUENCIES;
+     Pca9685CalPoint_t points[PULSE_CAL_MAX_POINTS];
+     size_t count = 0;
+     
+     //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Calibrating PCA9685 oscillator on pulse channel %u", channel);
+     
+     // Drive the outputs for the sweep (the enable pin is active low)
+     digitalWrite(PULSE_ENABLE_PIN, LOW);
+     
+     for (size_t i = 0; i < sizeof(sweep) / sizeof(sweep[0]) && count < PULSE_CAL_MAX_POINTS; i++) {
+         // Prescales from the nominal oscillator, so repeated runs sweep the same points
+         uint8_t prescale = pca9685PrescaleForMilliHz(PCA9685_NOMINAL_OSC_WHOLE_HZ, sweep[i] * 1000UL);
+         if (!writePrescale(prescale)) {
+             //DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set calibration prescale %u", prescale);
+             continue;
+         }
+         vTaskDelay(pdMS_TO_TICKS(PULSE_CAL_SETTLE_MS));
+         
+         PulseFrequencyMeasurement_t measurement;
+         if (!measurePulseFrequency(channel, PULSE_CAL_GATE_MS, &measurement)) {
+             //DEBUG_PRINT(DEBUG_LEVEL_WARN, "No pulses measured at prescale %u", prescale);
+             continue;
+         }
+         points[count].prescale = prescale;
+         points[count].measuredHz = measurement.frequencyHz;
+         points[count].stdErrHz = measurement.stdErrHz;
+         count++;
      }
      
-     // Check if pFrequency has changed
-     if (pFrequency != currentFrequency && pFrequency >= PULSE_MIN_FREQ && pFrequency <= PULSE_MAX_FREQ) {
-         success &= setPulseFrequency(pFrequency);
+     Pca9685CalFit_t fit;
+     bool fitted = pca9685FitOscillator(points, count, &fit);
+     if (fitted) {
+         oscillatorHz = (uint32_t)(fit.oscillatorHz + 0.5f);
      }
      
-     return success;
+     portENTER_CRITICAL(&calMux);
+     calibration.state = fitted ? PULSE_CAL_DONE : PULSE_CAL_FAILED;
+     if (fitted) {
+         calibration.fit = fit;
+     }
+     TaskHandle_t notifyTask = calNotifyTask;
+     uint32_t notifyBits = calNotifyBits;
+     portEXIT_CRITICAL(&calMux);
+     
+     // Back to the requested frequency with the corrected prescale, and the previous enable state
+     setPulseFrequency((currentFrequency != 0) ? currentFrequency : PULSE_DEFAULT_FREQ);
+     digitalWrite(PULSE_ENABLE_PIN, currentlyEnabled ? HIGH : LOW);
+     
+     //DEBUG_PRINT(DEBUG_LEVEL_INFO, "PCA9685 oscillator %lu Hz", oscillatorHz);
+     
+     if (notifyTask != NULL) {
+         xTaskNotify(notifyTask, notifyBits, eSetBits);
+     }
  }
  
- // Task function to monitor and update pulse generator
+ // Task function applying settings and calibrations as they are requested
  static void pulseGeneratorTask(void *pvParameters) {
     //  DEBUG_START_TASK("Pulse Generator");
      Serial.println("Pulse Generator Task Started");
      
+     // First pass brings the hardware to the requested settings: the defaults,
+     // merged with anything requested before the task existed
+     uint64_t startUs = monotonicUs();
+     portENTER_CRITICAL(&settingsMux);
+     if (!settingsPending) {
+         notePendingRequest(startUs);
+     }
+     portEXIT_CRITICAL(&settingsMux);
+     
      // Main task loop
      while (1) {
-         // Update pulse generator based on global variables
-         updatePulseGenerator();
+         applyPendingSettings();
          
-         // Sleep for a while before checking again
-         vTaskDelay(pdMS_TO_TICKS(100));  // Check every 100ms
+         // Run a requested calibration here, so no update interleaves with the sweep
+         portENTER_CRITICAL(&calMux);
+         bool calibrate = calPending;
+         calPending = false;
+         uint8_t channel = calibration.channel;
+         portEXIT_CRITICAL(&calMux);
+         if (calibrate) {
+             runPulseCalibration(channel);
+         }
+         
+         // Sleep until the next request; requests made meanwhile are already merged
+         uint32_t notified = 0;
+         xTaskNotifyWait(0, PULSE_GEN_NOTIFY_SETTINGS | PULSE_GEN_NOTIFY_CAL, &notified, portMAX_DELAY);
      }
      
      // Should never reach here
@@ -382,4 +579,204 @@
      
      //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse Generator task created successfully");
      return true;
- }
\ No newline at end of file
+ }
+ 
+ bool requestPulseCalibration(uint8_t channel, TaskHandle_t notifyTask, uint32_t notifyBits) {
+     if (!pca9685Initialized || pulseGeneratorTaskHandle == NULL || channel >= getPulseChannelCount()) {
+         return false;
+     }
+     
+     bool queued = false;
+     portENTER_CRITICAL(&calMux);
+     if (calibration.state != PULSE_CAL_RUNNING) {
+         calibration.state = PULSE_CAL_RUNNING;
+         calibration.channel = channel;
+         calNotifyTask = notifyTask;
+         calNotifyBits = notifyBits;
+         calPending = true;
+         queued = true;
+     }
+     portEXIT_CRITICAL(&calMux);
+     if (queued) {
+         xTaskNotify(pulseGeneratorTaskHandle, PULSE_GEN_NOTIFY_CAL, eSetBits);
+     }
+     return queued;
+ }
+ 
+ bool getPulseCalibration(PulseCalibration_t *calibrationOut) {
+     if (!pca9685Initialized || calibrationOut == NULL) {
+         return false;
+     }
+     
+     portENTER_CRITICAL(&calMux);
+     *calibrationOut = calibration;
+     portEXIT_CRITICAL(&calMux);
+     return true;
+ }
+ 
+ // ----- Serial command channel -----
+ 
+ static const char *calStateName(PulseCalState_t state) {
+     switch (state) {
+         case PULSE_CAL_RUNNING: return "running";
+         case PULSE_CAL_DONE: return "done";
+         case PULSE_CAL_FAILED: return "failed";
+         default: return "none";
+     }
+ }
+ 
+ static void printCalibration(const PulseCalibration_t &cal, Print &out) {
+     out.printf("OK pulse cal state=%s osc=%.0f+-%.0f Hz (%+.0f ppm) points=%u rejected=%u freq=%.0f achieved=%.3f+-%.3f Hz prescale=%u\r\n",
+                calStateName(cal.state), cal.fit.oscillatorHz, 2.0f * cal.fit.oscillatorErrHz, cal.fit.offsetPpm,
+                cal.fit.points, cal.fit.rejected, cal.requestedHz, cal.achievedHz, cal.achievedErrHz, cal.prescale);
+ }
+ 
+ static void printSettings(const char *verb, const PulseGeneratorStats_t &stats, Print &out) {
+     out.printf("OK pulse %s freq=%u achieved=%lu.%03lu Hz (%+ld ppm) prescale=%u out=%u requests=%lu updates=%lu coalesced=%lu failures=%lu latency=%lu/%lu/%lu us (last/mean/max) bus=%lu/%lu (transactions/bytes)\r\n",
+                verb, stats.applied.frequency, stats.achieved.achievedMilliHz / 1000, stats.achieved.achievedMilliHz % 1000,
+                stats.achieved.errorPpm, stats.achieved.prescale, stats.applied.outputsOn ? 1 : 0, stats.requests, stats.updates,
+                stats.coalesced, stats.failures, stats.lastLatencyUs, stats.meanLatencyUs, stats.maxLatencyUs,
+                stats.busTransactions, stats.busBytes);
+ }
+ 
+ // Report the next update on the command channel; set before the request, so
+ // the task cannot apply it first, and cleared again if the request is rejected
+ static void reportNextUpdate(bool report) {
+     portENTER_CRITICAL(&settingsMux);
+     settingsReport = report;
+     portEXIT_CRITICAL(&settingsMux);
+ }
+ 
+ // pulse set [freq=] [out=0|1] | pwm ch=<0-15|all> duty= [phase=] | cal [channel=] | status
+ static bool pulseCommand(int argc, char *argv[], Print &out) {
+     if (argc < 1) {
+         return false;
+     }
+     
+     if (strcmp(argv[0], "set") == 0) {
+         PulseGeneratorStats_t stats;
+         if (!getPulseGeneratorStats(&stats)) {
+             out.printf("ERR pulse not initialized\r\n");
+             return true;
+         }
+         
+         // No arguments reports the applied settings
+         if (argc == 1) {
+             printSettings("set", stats, out);
+             return true;
+         }
+         
+         // Only the named fields are requested; the others keep their latest requested value
+         uint32_t freq = 0;
+         uint32_t outputs = 0;
+         bool haveFreq = serialCommandValue(argc - 1, &argv[1], "freq") != NULL;
+         bool haveOutputs = serialCommandValue(argc - 1, &argv[1], "out") != NULL;
+         if (!serialCommandNumber(argc - 1, &argv[1], "freq", &freq) ||
+             !serialCommandNumber(argc - 1, &argv[1], "out", &outputs) || outputs > 1 || freq > 0xFFFF ||
+             (!haveFreq && !haveOutputs)) {
+             return false;
+         }
+         uint16_t frequency = (uint16_t)freq;
+         bool outputsOn = (outputs != 0);
+         
+         reportNextUpdate(true);
+         if (!requestSettingsFields(haveFreq ? &frequency : NULL, haveOutputs ? &outputsOn : NULL)) {
+             reportNextUpdate(false);
+             out.printf("ERR pulse set rejected\r\n");
+             return true;
+         }
+         out.printf("OK pulse set queued");
+         if (haveFreq) {
+             out.printf(" freq=%lu", freq);
+         }
+         if (haveOutputs) {
+             out.printf(" out=%lu", outputs);
+         }
+         out.printf("\r\n");
+     } else if (strcmp(argv[0], "pwm") == 0) {
+         // Duty and phase in counts of the 4096 count period; "all" sets every output alike (one ALL_LED write)
+         const char *ch = serialCommandValue(argc - 1, &argv[1], "ch");
+         uint32_t duty = PCA9685_COUNTS / 2;
+         uint32_t phase = 0;
+         if (ch == NULL || !serialCommandNumber(argc - 1, &argv[1], "duty", &duty) ||
+             !serialCommandNumber(argc - 1, &argv[1], "phase", &phase) ||
+             duty > PCA9685_COUNTS || phase >= PCA9685_COUNTS) {
+             return false;
+         }
+         
+         Pca9685Frame_t frame = {};
+         if (strcmp(ch, "all") == 0) {
+             for (uint8_t channel = 0; channel < PCA9685_CHANNELS; channel++) {
+                 pca9685FrameSet(&frame, channel, (uint16_t)duty, (uint16_t)phase);
+             }
+         } else {
+             char *end = NULL;
+             unsigned long channel = strtoul(ch, &end, 0);
+             if (end == ch || *end != '\0' || channel >= PCA9685_CHANNELS ||
+                 !pca9685FrameSet(&frame, (uint8_t)channel, (uint16_t)duty, (uint16_t)phase)) {
+                 return false;
+             }
+         }
+         reportNextUpdate(true);
+         if (!requestPulseFrame(&frame)) {
+             reportNextUpdate(false);
+             out.printf("ERR pulse pwm rejected\r\n");
+             return true;
+         }
+         out.printf("OK pulse pwm queued ch=%s duty=%lu phase=%lu\r\n", ch, duty, phase);
+     } else if (strcmp(argv[0], "cal") == 0) {
+         uint32_t channel = 0;
+         if (!serialCommandNumber(argc - 1, &argv[1], "channel", &channel) || channel > 0xFF) {
+             return false;
+         }
+         if (!requestPulseCalibration((uint8_t)channel, getSerialCommandTask(), serialEventBit)) {
+             out.printf("ERR pulse cal rejected\r\n");
+             return true;
+         }
+         
+         // The completion event runs on this task, so it cannot overtake the flag
+         portENTER_CRITICAL(&calMux);
+         calReport = true;
+         portEXIT_CRITICAL(&calMux);
+         out.printf("OK pulse cal channel=%lu\r\n", channel);
+     } else if (strcmp(argv[0], "status") == 0) {
+         PulseCalibration_t cal;
+         if (!getPulseCalibration(&cal)) {
+             out.printf("ERR pulse not initialized\r\n");
+             return true;
+         }
+         printCalibration(cal, out);
+     } else {
+         return false;
+     }
+     return true;
+ }
+ 
+ // Completion reports for settings and calibrations started from the command channel
+ static void pulseCommandEvent(Print &out) {
+     portENTER_CRITICAL(&settingsMux);
+     bool settingsDone = settingsReportReady;
+     settingsReportReady = false;
+     PulseGeneratorStats_t stats = generatorStats;
+     portEXIT_CRITICAL(&settingsMux);
+     if (settingsDone) {
+         printSettings("applied", stats, out);
+     }
+     
+     PulseCalibration_t cal;
+     if (getPulseCalibration(&cal) && cal.state != PULSE_CAL_RUNNING) {
+         portENTER_CRITICAL(&calMux);
+         bool calDone = calReport;
+         calReport = false;
+         portEXIT_CRITICAL(&calMux);
+         if (calDone) {
+             printCalibration(cal, out);
+         }
+     }
+ }
+ 
+ bool registerPulseGeneratorCommands() {
+     return registerSerialCommand("pulse",
+         "pulse set [freq=] [out=0|1] | pwm ch=<0-15|all> duty= [phase=] | cal [channel=] | status",
+         pulseCommand, pulseCommandEvent, &serialEventBit);
+ }
@@ -0,0 +1,289 @@
+/*
+ * Pulse Sequencer Module Implementation
+ *
+ * rmt_write_items() waits for the transmission in progress to end before it
+ * starts the next, and the driver reads the symbols from our buffer while
+ * it plays. So when it returns, the buffer written before the current one is
+ * free: a new pattern is compiled there while the current one plays.
+ */
+ 
+ #include "pulse_sequencer.h"
+ #include "simplified_debug.h"
+ #include "serial_command.h"
+ #include "monotonic_time.h"
+ 
+ static_assert(sizeof(PulseTrainSymbol_t) == sizeof(rmt_item32_t), "symbols are handed to the RMT driver as they are");
+ 
+ // Static variables
+ static TaskHandle_t sequencerTaskHandle = NULL;
+ static bool sequencerInitialized = false;
+ 
+ // Symbol buffers, one playing and one free for the next pattern
+ static PulseTrainSymbol_t symbolBuffers[2][PULSE_SEQUENCER_MAX_SYMBOLS];
+ 
+ // Latest requested pattern, shared with the requesting tasks
+ static portMUX_TYPE sequencerMux = portMUX_INITIALIZER_UNLOCKED;
+ static PulseTrainPattern_t requestedPattern = {};
+ static bool patternPending = false;
+ static uint64_t pendingSinceUs = 0;  // monotonicUs() of the oldest request not yet playing
+ static uint32_t pendingRequests = 0;
+ static PulseSequencerStats_t sequencerStats = {};
+ 
+ // Serial command channel completion report
+ static uint32_t serialEventBit = 0;
+ static bool trainReport = false;
+ static bool trainReportReady = false;
+ 
+ // Transmissions last at least this many ticks
+ static const uint64_t minWriteTicks = (uint64_t)PULSE_SEQUENCER_MIN_WRITE_US * 1000 / PULSE_SEQUENCER_TICK_NS;
+ 
+ bool initPulseSequencer(uint8_t pin) {
+   //DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Pulse Sequencer on GPIO %u", pin);
+ 
+   rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, PULSE_SEQUENCER_RMT_CHANNEL);
+   config.clk_div = PULSE_SEQUENCER_CLK_DIV;
+   config.mem_block_num = PULSE_SEQUENCER_MEM_BLOCKS;
+   config.tx_config.carrier_en = false;
+   config.tx_config.idle_output_en = true;
+   config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+ 
+   if (rmt_config(&config) != ESP_OK || rmt_driver_install(PULSE_SEQUENCER_RMT_CHANNEL, 0, 0) != ESP_OK) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to set up RMT channel %d for the pulse sequencer", PULSE_SEQUENCER_RMT_CHANNEL);
+     return false;
+   }
+ 
+   sequencerInitialized = true;
+   return true;
+ }
+ 
+ bool requestPulseTrain(const PulseTrainPattern_t *pattern) {
+   if (!sequencerInitialized || pattern == NULL) {
+     return false;
+   }
+ 
+   // Rejected here rather than in the task, so the caller learns of it
+   if (pattern->pulsesPerBurst != 0 &&
+       pulseTrainCompile(pattern, PULSE_SEQUENCER_TICK_NS, 0, NULL, PULSE_SEQUENCER_MAX_SYMBOLS, NULL) == 0) {
+     return false;
+   }
+ 
+   uint64_t nowUs = monotonicUs();
+   portENTER_CRITICAL(&sequencerMux);
+   requestedPattern = *pattern;
+   if (!patternPending) {
+     pendingSinceUs = nowUs;
+   }
+   patternPending = true;
+   pendingRequests++;
+   sequencerStats.requests++;
+   portEXIT_CRITICAL(&sequencerMux);
+ 
+   if (sequencerTaskHandle != NULL) {
+     xTaskNotifyGive(sequencerTaskHandle);
+   }
+   return true;
+ }
+ 
+ bool getPulseSequencerStats(PulseSequencerStats_t *stats) {
+   if (!sequencerInitialized || stats == NULL) {
+     return false;
+   }
+ 
+   portENTER_CRITICAL(&sequencerMux);
+   *stats = sequencerStats;
+   portEXIT_CRITICAL(&sequencerMux);
+   return true;
+ }
+ 
+ // Count a pattern reaching the output (or stopping it) and report it if asked
+ static void noteUpdate(uint64_t sinceUs) {
+   uint64_t latencyUs = monotonicUs() - sinceUs;
+   portENTER_CRITICAL(&sequencerMux);
+   sequencerStats.updates++;
+   sequencerStats.lastLatencyUs = (latencyUs > UINT32_MAX) ? UINT32_MAX : (uint32_t)latencyUs;
+   if (sequencerStats.lastLatencyUs > sequencerStats.maxLatencyUs) {
+     sequencerStats.maxLatencyUs = sequencerStats.lastLatencyUs;
+   }
+   bool report = trainReport;
+   trainReport = false;
+   trainReportReady |= report;
+   portEXIT_CRITICAL(&sequencerMux);
+ 
+   if (report) {
+     xTaskNotify(getSerialCommandTask(), serialEventBit, eSetBits);
+   }
+ }
+ 
+ // Task function keeping the RMT transmitting the current pattern
+ static void pulseSequencerTask(void *pvParameters) {
+   DEBUG_START_TASK("Pulse Sequencer");
+ 
+   uint8_t playing = 1;      // Buffer of the transmission in progress
+   uint8_t current = 0;      // Buffer of the current pattern
+   size_t count = 0;         // Its symbols, 0 when stopped
+   bool firstWrite = false;  // The next write is the first of a new pattern
+   uint64_t sinceUs = 0;
+ 
+   while (1) {
+     // Take a new pattern; the buffer not playing is free
+     portENTER_CRITICAL(&sequencerMux);
+     bool update = patternPending;
+     PulseTrainPattern_t pattern = requestedPattern;
+     uint32_t merged = pendingRequests;
+     patternPending = false;
+     pendingRequests = 0;
+     if (update) {
+       sinceUs = pendingSinceUs;
+     }
+     portEXIT_CRITICAL(&sequencerMux);
+ 
+     if (update) {
+       uint8_t next = playing ^ 1;
+       uint16_t bursts = 0;
+       size_t symbols = 0;
+       if (pattern.pulsesPerBurst != 0) {
+         symbols = pulseTrainCompile(&pattern, PULSE_SEQUENCER_TICK_NS, minWriteTicks,
+                                     symbolBuffers[next], PULSE_SEQUENCER_MAX_SYMBOLS, &bursts);
+       }
+       current = next;
+       count = symbols;
+       firstWrite = true;
+ 
+       portENTER_CRITICAL(&sequencerMux);
+       sequencerStats.pattern = pattern;
+       sequencerStats.symbols = symbols;
+       sequencerStats.burstsPerTransmission = bursts;
+       sequencerStats.coalesced += merged - 1;
+       portEXIT_CRITICAL(&sequencerMux);
+     }
+ 
+     if (count == 0) {
+       // Stopped: the last transmission runs out and the output idles low
+       if (firstWrite) {
+         firstWrite = false;
+         noteUpdate(sinceUs);
+       }
+       ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+       continue;
+     }
+ 
+     // Starts as soon as the transmission in progress has ended
+     rmt_write_items(PULSE_SEQUENCER_RMT_CHANNEL, (const rmt_item32_t *)symbolBuffers[current], count, false);
+     playing = current;
+ 
+     portENTER_CRITICAL(&sequencerMux);
+     sequencerStats.transmissions++;
+     portEXIT_CRITICAL(&sequencerMux);
+     if (firstWrite) {
+       firstWrite = false;
+       noteUpdate(sinceUs);
+     }
+   }
+ 
+   // Should never reach here
+   DEBUG_END_TASK("Pulse Sequencer");
+   vTaskDelete(NULL);
+ }
+ 
+ bool createPulseSequencerTask() {
+   if (!sequencerInitialized) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot create Pulse Sequencer task - module not initialized");
+     return false;
+   }
+ 
+   // Above the pulse burst task, so transmissions restart promptly
+   BaseType_t result = xTaskCreate(
+     pulseSequencerTask,
+     "Pulse Sequencer",
+     4096,
+     NULL,
+     4,  // High priority
+     &sequencerTaskHandle
+   );
+ 
+   if (result != pdPASS) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create Pulse Sequencer task");
+     return false;
+   }
+ 
+   // Anything requested before the task existed
+   xTaskNotifyGive(sequencerTaskHandle);
+   return true;
+ }
+ 
+ // ----- Serial command channel -----
+ 
+ static void printTrain(const char *verb, const PulseSequencerStats_t &stats, Print &out) {
+   out.printf("OK train %s pulses=%u width=%lu period=%lu gap=%lu ns symbols=%lu bursts=%u requests=%lu updates=%lu coalesced=%lu transmissions=%lu latency=%lu/%lu us (last/max)\r\n",
+              verb, stats.pattern.pulsesPerBurst, stats.pattern.pulseWidthNs, stats.pattern.pulsePeriodNs,
+              stats.pattern.burstGapNs, stats.symbols, stats.burstsPerTransmission, stats.requests, stats.updates,
+              stats.coalesced, stats.transmissions, stats.lastLatencyUs, stats.maxLatencyUs);
+ }
+ 
+ // Report the next pattern to reach the output; cleared again if the request is rejected
+ static void reportNextUpdate(bool report) {
+   portENTER_CRITICAL(&sequencerMux);
+   trainReport = report;
+   portEXIT_CRITICAL(&sequencerMux);
+ }
+ 
+ // train pulses= width= [period=] gap= | stop | status (times in ns)
+ static bool trainCommand(int argc, char *argv[], Print &out) {
+   if (argc < 1) {
+     return false;
+   }
+ 
+   PulseSequencerStats_t stats;
+   if (!getPulseSequencerStats(&stats)) {
+     out.printf("ERR train not initialized\r\n");
+     return true;
+   }
+ 
+   PulseTrainPattern_t pattern = {};
+   if (strcmp(argv[0], "status") == 0) {
+     printTrain("status", stats, out);
+     return true;
+   } else if (strcmp(argv[0], "stop") != 0) {
+     if (strchr(argv[0], '=') == NULL) {
+       return false;
+     }
+ 
+     // Fields not given keep the values of the pattern in use
+     pattern = stats.pattern;
+     uint32_t pulses = pattern.pulsesPerBurst;
+     if (!serialCommandNumber(argc, argv, "pulses", &pulses) ||
+         !serialCommandNumber(argc, argv, "width", &pattern.pulseWidthNs) ||
+         !serialCommandNumber(argc, argv, "period", &pattern.pulsePeriodNs) ||
+         !serialCommandNumber(argc, argv, "gap", &pattern.burstGapNs) || pulses == 0 || pulses > 0xFFFF) {
+       return false;
+     }
+     pattern.pulsesPerBurst = (uint16_t)pulses;
+   }
+ 
+   reportNextUpdate(true);
+   if (!requestPulseTrain(&pattern)) {
+     reportNextUpdate(false);
+     out.printf("ERR train rejected\r\n");
+     return true;
+   }
+   out.printf("OK train queued pulses=%u\r\n", pattern.pulsesPerBurst);
+   return true;
+ }
+ 
+ // Completion report for patterns requested from the command channel
+ static void trainCommandEvent(Print &out) {
+   portENTER_CRITICAL(&sequencerMux);
+   bool ready = trainReportReady;
+   trainReportReady = false;
+   PulseSequencerStats_t stats = sequencerStats;
+   portEXIT_CRITICAL(&sequencerMux);
+   if (ready) {
+     printTrain("playing", stats, out);
+   }
+ }
+ 
+ bool registerPulseSequencerCommands() {
+   return registerSerialCommand("train",
+     "train pulses= width= [period=] gap= | stop | status (times in ns)",
+     trainCommand, trainCommandEvent, &serialEventBit);
+ }
\ No newline at end of file
@@ -1,388 +1,883 @@
 /*
  * Pulse Burst Monitoring Tasks Module Implementation
+ *
+ * The interrupts keep the running burst summary (edge trackers) for the
+ * published result and push every edge into the ring; the task replays the ring
+ * through a BurstAnalyzer for the per-pulse detail.
+ *
+ * The task sleeps until notified. The first edge of a burst arms a one-shot
+ * gap timer; rather than restarting the timer on every edge, an expiry that
+ * finds newer edges re-arms it for the rest of the gap, so the interrupts
+ * only touch the timer once per burst.
+ *
+ * Each channel's state is split by who touches it: the interrupt side (edge
+ * trackers, counters, timer) is one small cache-line aligned record in
+ * internal RAM, the ring is separate, and everything only the task reads
+ * lives in a second array, so an edge never pulls in task-side state.
  */
-
+ 
  #include "pulse_tasks.h"
  #include "freertos/task.h"
  #include "freertos/queue.h"
+ #include "freertos/semphr.h"
  #include "simplified_debug.h"
+ #include "scope_capture.h"
+ #include "burst_capture.h"
+ #include "hal/cpu_hal.h"
+ #include "spsc_ring.h"
+ #include "seqlock.h"
+ #include "esp_timer.h"
+ 
+ // Pulse task notification bits
+ #define PULSE_NOTIFY_BURST_START 0x01  // First edge of a burst
+ #define PULSE_NOTIFY_BURST_END   0x02  // Gap timer expired with no newer edge
+ #define PULSE_NOTIFY_EDGE_RING   0x04  // Edge ring half full
+ 
+ // Ring entry: the backend's timestamp and polarity, and micros() for the burst gap
+ typedef struct {
+   BurstEdge_t edge;
+   uint32_t timeUs;
+ } PulseRingEdge_t;
+ 
+ // Interrupt side of a channel: everything an edge reads or writes
+ typedef struct __attribute__((aligned(32))) {
+   PulseEdgeTracker_t hwTracker;      // MCPWM capture view (trackers protected by pulseMux)
+   PulseEdgeTracker_t isrTracker;     // GPIO interrupt view
+   volatile uint32_t isrEdges;        // Edge capture cost (single writer each: the backend's interrupt)
+   volatile uint32_t isrCycles;
+   volatile uint32_t hwEdges;
+   volatile uint32_t hwCycles;
+   volatile uint32_t edgesLost;       // Edges dropped on a full ring
+   uint32_t risingEdges;              // Rising edges of the result-driving backend (protected by pulseMux)
+   uint32_t lastRisingTicks;          // ... timestamp of the last one
+   esp_timer_handle_t burstEndTimer;  // One-shot gap timer
+   uint8_t pin;
+   uint8_t index;
+ } PulseChannelEdges_t;
+ 
+ // Task side of a channel
+ typedef struct {
+   Seqlock<PulseBurstResult_t> published;  // Latest result, read by any task without a kernel call
+   QueueHandle_t detailQueue;
+   SemaphoreHandle_t firstResult;     // Given once the first result is published, left given after
+   bool resultPublished;
+   PulseBurstMonitor monitor;         // Burst results, rolling statistics and first reading
+ 
+   // Burst analyzer input
+   BurstAnalyzer analyzer;
+   uint32_t analyzerStartUs;          // micros() of the first edge of the analyzer's burst
+   uint32_t analyzerLastEdgeUs;
+   uint32_t lostReported;             // edgesLost at the last published detail
+   PulseBurstDetail_t detail;
+ 
+   // Last completed burst, for the pair measurements
+   uint32_t burstNumber;
+   uint32_t lastBurstStartTicks;
+   double lastPeriodUs;
+ 
+   // Compare mode accuracy and burst end latency (protected by pulseMux)
+   uint32_t comparedBursts;
+   uint32_t isrMissedEdges;
+   uint32_t firstPeriodErrors;
+   double firstPeriodErrorSumSq;
+   float firstPeriodErrorMax;
+   uint32_t meanPeriodErrors;
+   double meanPeriodErrorSumSq;
+   uint32_t burstEnds;
+   uint64_t burstEndLatencySumUs;
+   uint32_t burstEndLatencyMaxUs;
+   uint64_t burstCycles;              // Spent in the monitor on ended bursts
+   uint32_t analyzedBursts;
+   uint64_t analyzerCycles;           // Spent in the analyzer on the edges that closed a burst
+ } PulseChannelState_t;
+ 
+ // Skew between two channels (pulse task writes, protected by pulseMux)
+ typedef struct {
+   uint32_t pairedBurstA;             // Burst numbers already measured
+   uint32_t pairedBurstB;
+   uint32_t pairedBursts;
+   StreamingStats<PULSE_STATS_MAX_WINDOW> skewUs;
+   StreamingStats<PULSE_STATS_MAX_WINDOW> phaseDeg;
+ } PulsePairState_t;
  
  // Static variables
- static uint8_t pulsePin = PULSE_MONITOR_PIN;
- static QueueHandle_t pulseResultsQueue = NULL;
+ static uint8_t channelCount = 0;
  static TaskHandle_t pulseTaskHandle = NULL;
+ static PulseCaptureMode_t captureMode = PULSE_CAPTURE_GPIO_ISR;
+ static bool mcpwmEnabled = false;
+ static uint32_t captureStartUs = 0;
  
  // ISR-safe critical section for ESP32
  static portMUX_TYPE pulseMux = portMUX_INITIALIZER_UNLOCKED;
  
- // Pulse burst tracking variables
- static volatile uint32_t lastEdgeTimeUs = 0;
- static volatile uint32_t firstPulseTimeUs = 0;
- static volatile uint32_t burstStartTimeUs = 0;
- static volatile uint32_t lastBurstEndTimeUs = 0;
- static volatile uint16_t edgeCount = 0;
- static volatile bool burstActive = false;
- static volatile bool notifyTask = false;
+ // Channel state, interrupt side and task side
+ static PulseChannelEdges_t channelEdges[PULSE_MAX_CHANNELS];
+ static SpscRing<PulseRingEdge_t, PULSE_EDGE_RING_SIZE> edgeRings[PULSE_MAX_CHANNELS];
+ static PulseChannelState_t channels[PULSE_MAX_CHANNELS];
+ static PulsePairState_t pairs[PULSE_MAX_PAIRS];
+ 
+ // Burst end detection, all channels (re-arms written by the timer task, wakeups by the pulse task)
+ static volatile uint32_t timerRearms = 0;
+ static volatile uint32_t taskWakeups = 0;
+ 
+ static void resetTracker(PulseEdgeTracker_t *tracker) {
+   memset(tracker, 0, sizeof(PulseEdgeTracker_t));
+ }
+ 
+ // Tracker that drives the results of a channel
+ static inline PulseEdgeTracker_t *resultTracker(PulseChannelEdges_t *edges) {
+   return (captureMode != PULSE_CAPTURE_GPIO_ISR) ? &edges->hwTracker : &edges->isrTracker;
+ }
+ 
+ // Index of the pair a < b
+ static inline uint8_t pairIndex(uint8_t a, uint8_t b) {
+   return (uint8_t)(a * (2 * PULSE_MAX_CHANNELS - a - 1) / 2 + (b - a - 1));
+ }
+ 
+ // Hand an edge of the result-driving backend to the scope and burst capture (channel 0 only)
+ static void IRAM_ATTR publishEdge(uint32_t timeUs, bool burstStarted) {
+   // Burst start is an external trigger source for the scope
+   if (burstStarted) {
+     scopeExternalEvent(SCOPE_EVENT_BURST_START, timeUs);
+   }
+   burstCaptureEdge(timeUs, burstStarted);
+ }
+ 
+ // Queue an edge for the channel's burst analyzer (single producer: the result-driving backend)
+ // The task is woken when the ring reaches half full, so long bursts drain before they overflow
+ static void IRAM_ATTR pushEdge(PulseChannelEdges_t *edges, uint32_t timeUs, uint32_t ticks, bool rising,
+                                BaseType_t *woken) {
+   SpscRing<PulseRingEdge_t, PULSE_EDGE_RING_SIZE> *ring = &edgeRings[edges->index];
+   PulseRingEdge_t entry;
+   entry.edge.ticks = ticks;
+   entry.edge.rising = rising;
+   entry.timeUs = timeUs;
+   if (!ring->push(entry)) {
+     edges->edgesLost++;
+   } else if (ring->size() == PULSE_EDGE_RING_SIZE / 2 && pulseTaskHandle != NULL) {
+     xTaskNotifyFromISR(pulseTaskHandle, PULSE_NOTIFY_EDGE_RING, eSetBits, woken);
+   }
+ }
+ 
+ // Result-driving edge: scope and burst capture hooks, gap timer, analyzer ring
+ static void IRAM_ATTR dispatchEdge(PulseChannelEdges_t *edges, uint32_t timeUs, uint32_t ticks, bool rising,
+                                    bool burstStarted, BaseType_t *woken) {
+   if (edges->index == 0) {
+     publishEdge(timeUs, burstStarted);
+   }
+   if (burstStarted) {
+     // First edge of a burst: arm the gap timer and wake the task
+     esp_timer_start_once(edges->burstEndTimer, PULSE_BURST_TIMEOUT_US);
+     if (pulseTaskHandle != NULL) {
+       xTaskNotifyFromISR(pulseTaskHandle, PULSE_NOTIFY_BURST_START, eSetBits, woken);
+     }
+   }
+   pushEdge(edges, timeUs, ticks, rising, woken);
+ }
+ 
+ // Gap timer expiry (esp_timer task) - wake the pulse task once the gap after the last edge has passed
+ static void burstEndTimerCallback(void *arg) {
+   PulseChannelEdges_t *edges = (PulseChannelEdges_t *)arg;
+   PulseEdgeTracker_t *tracker = resultTracker(edges);
+ 
+   portENTER_CRITICAL(&pulseMux);
+   bool active = tracker->burstActive;
+   int32_t remainingUs = (int32_t)(tracker->lastEdgeTimeUs + PULSE_BURST_TIMEOUT_US - micros());
+   portEXIT_CRITICAL(&pulseMux);
+ 
+   if (!active) {
+     return;
+   }
+ 
+   // Edges arrived since the timer was armed, wait for the rest of the gap
+   if (remainingUs >= 0) {
+     timerRearms++;
+     esp_timer_start_once(edges->burstEndTimer, (uint64_t)remainingUs + 1);
+     return;
+   }
+ 
+   if (pulseTaskHandle != NULL) {
+     xTaskNotify(pulseTaskHandle, PULSE_NOTIFY_BURST_END, eSetBits);
+   }
+ }
  
  // ISR for handling edge detection - optimized for high-frequency pulse bursts
- static void IRAM_ATTR pulseBurstISR() {
+ static void IRAM_ATTR pulseBurstISR(void *arg) {
+   uint32_t startCycles = cpu_hal_get_cycle_count();
    uint32_t currentTimeUs = micros();
-   
+   PulseChannelEdges_t *edges = (PulseChannelEdges_t *)arg;
+ 
+   bool driving = (captureMode == PULSE_CAPTURE_GPIO_ISR);
+   bool rising = driving && digitalRead(edges->pin) == HIGH;
+ 
    portENTER_CRITICAL_ISR(&pulseMux);
-   
-   // If this is the first edge after a long gap, it's the start of a new burst
-   if (!burstActive && (currentTimeUs - lastEdgeTimeUs > PULSE_BURST_TIMEOUT_US)) {
-     burstStartTimeUs = currentTimeUs;
-     edgeCount = 1;
-     burstActive = true;
-     firstPulseTimeUs = 0;  // Will be set on the next edge
-     notifyTask = true;     // Notify task to start monitoring
-   } 
-   // If we're in an active burst
-   else if (burstActive) {
-     edgeCount++;
-     
-     // If this is the second edge, measure the first pulse period
-     if (edgeCount == 3 && firstPulseTimeUs == 0) {
-       firstPulseTimeUs = currentTimeUs - lastEdgeTimeUs;
-     }
+   bool burstStarted = pulseTrackEdge(&edges->isrTracker, currentTimeUs, currentTimeUs);
+   if (rising) {
+     edges->risingEdges++;
+     edges->lastRisingTicks = currentTimeUs;
+   }
+   portEXIT_CRITICAL_ISR(&pulseMux);
+ 
+   BaseType_t woken = pdFALSE;
+   if (driving) {
+     dispatchEdge(edges, currentTimeUs, currentTimeUs, rising, burstStarted, &woken);
+   }
+ 
+   edges->isrEdges++;
+   edges->isrCycles += cpu_hal_get_cycle_count() - startCycles;
+   if (woken == pdTRUE) {
+     portYIELD_FROM_ISR();
+   }
+ }
+ 
+ // MCPWM capture callback - the edge time was latched by the capture timer
+ static bool IRAM_ATTR pulseCaptureCallback(mcpwm_unit_t unit, mcpwm_capture_channel_id_t channel,
+                                            const cap_event_data_t *edata, void *userData) {
+   uint32_t startCycles = cpu_hal_get_cycle_count();
+   uint32_t currentTimeUs = micros();
+   PulseChannelEdges_t *edges = (PulseChannelEdges_t *)userData;
+ 
+   bool rising = (edata->cap_edge == MCPWM_POS_EDGE);
+ 
+   portENTER_CRITICAL_ISR(&pulseMux);
+   bool burstStarted = pulseTrackEdge(&edges->hwTracker, currentTimeUs, edata->cap_value);
+   if (rising) {
+     edges->risingEdges++;
+     edges->lastRisingTicks = edata->cap_value;
    }
-   
-   // Update last edge time regardless
-   lastEdgeTimeUs = currentTimeUs;
-   
    portEXIT_CRITICAL_ISR(&pulseMux);
+ 
+   BaseType_t woken = pdFALSE;
+   dispatchEdge(edges, currentTimeUs, edata->cap_value, rising, burstStarted, &woken);
+ 
+   edges->hwEdges++;
+   edges->hwCycles += cpu_hal_get_cycle_count() - startCycles;
+   return woken == pdTRUE;  // Yield at the end of the interrupt
+ }
+ 
+ // Timestamp rate of a backend
+ static inline uint32_t tickHz(bool hardware) {
+   return hardware ? PULSE_CAPTURE_MCPWM_TICK_HZ : 1000000;
+ }
+ 
+ static inline double ticksToUs(uint32_t ticks, bool hardware) {
+   return pulseTicksToUs(ticks, tickHz(hardware));
+ }
+ 
+ static inline double meanPeriodUs(const PulseEdgeTracker_t *tracker, bool hardware) {
+   return pulseMeanPeriodUs(tracker, tickHz(hardware));
+ }
+ 
+ // Compare mode: measure the ISR view of a burst against the hardware view
+ static void compareBurst(PulseChannelState_t *state, const PulseEdgeTracker_t *hw, const PulseEdgeTracker_t *isr) {
+   bool haveFirst = hw->firstPeriodTicks != 0 && isr->firstPeriodTicks != 0;
+   double firstErrorNs = (ticksToUs(isr->firstPeriodTicks, false) -
+                          ticksToUs(hw->firstPeriodTicks, true)) * 1000.0;
+   bool haveMean = hw->edgeCount == isr->edgeCount && hw->edgeCount >= 3;
+   double meanErrorNs = (meanPeriodUs(isr, false) - meanPeriodUs(hw, true)) * 1000.0;
+ 
+   portENTER_CRITICAL(&pulseMux);
+   state->comparedBursts++;
+   if (hw->edgeCount > isr->edgeCount) {
+     state->isrMissedEdges += hw->edgeCount - isr->edgeCount;
+   }
+   if (haveFirst) {
+     state->firstPeriodErrors++;
+     state->firstPeriodErrorSumSq += firstErrorNs * firstErrorNs;
+     if (fabs(firstErrorNs) > state->firstPeriodErrorMax) {
+       state->firstPeriodErrorMax = (float)fabs(firstErrorNs);
+     }
+   }
+   if (haveMean) {
+     state->meanPeriodErrors++;
+     state->meanPeriodErrorSumSq += meanErrorNs * meanErrorNs;
+   }
+   portEXIT_CRITICAL(&pulseMux);
+ }
+ 
+ // Pair a channel's new burst with the latest burst of every other channel that started within the gap
+ static void measurePairs(uint8_t ch) {
+   bool hardware = (captureMode != PULSE_CAPTURE_GPIO_ISR);
+ 
+   for (uint8_t other = 0; other < channelCount; other++) {
+     if (other == ch || channels[other].burstNumber == 0) {
+       continue;
+     }
+     uint8_t a = (ch < other) ? ch : other;
+     uint8_t b = (ch < other) ? other : ch;
+     PulsePairState_t *pair = &pairs[pairIndex(a, b)];
+     if (pair->pairedBurstA == channels[a].burstNumber || pair->pairedBurstB == channels[b].burstNumber) {
+       continue;
+     }
+ 
+     // Signed: negative when b started first
+     int32_t skewTicks = (int32_t)(channels[b].lastBurstStartTicks - channels[a].lastBurstStartTicks);
+     double skewUs = (skewTicks < 0) ? -ticksToUs((uint32_t)-skewTicks, hardware) : ticksToUs((uint32_t)skewTicks, hardware);
+     if (fabs(skewUs) > PULSE_BURST_TIMEOUT_US) {
+       continue;  // Not the same burst
+     }
+ 
+     // Phase against the reference channel's pulse period, folded to -180..180
+     double phaseDeg = 0;
+     if (channels[a].lastPeriodUs > 0) {
+       double cycles = skewUs / channels[a].lastPeriodUs;
+       phaseDeg = (cycles - floor(cycles + 0.5)) * 360.0;
+     }
+ 
+     portENTER_CRITICAL(&pulseMux);
+     pair->pairedBurstA = channels[a].burstNumber;
+     pair->pairedBurstB = channels[b].burstNumber;
+     pair->pairedBursts++;
+     pair->skewUs.add((float)skewUs);
+     pair->phaseDeg.add((float)phaseDeg);
+     portEXIT_CRITICAL(&pulseMux);
+   }
+ }
+ 
+ // Publish the analyzer's last closed burst
+ static void publishBurstDetail(uint8_t ch) {
+   PulseChannelState_t *state = &channels[ch];
+   PulseBurstDetail_t *detail = &state->detail;
+ 
+   uint32_t lost = channelEdges[ch].edgesLost;
+   detail->burstStartUs = monotonicExtendUs(state->analyzerStartUs, monotonicUs());
+   detail->edgesLost = lost - state->lostReported;
+   detail->analysis = state->analyzer.result();
+   state->lostReported = lost;
+   xQueueOverwrite(state->detailQueue, detail);
+ 
+   const BurstAnalysis_t *a = &detail->analysis;
+   uint32_t dutyPermille = (uint32_t)(((uint64_t)a->dutyCycleQ16 * 1000 + 0x8000) >> 16);
+   DEBUG_PRINT(DEBUG_LEVEL_INFO,
+              "Burst detail (channel %u): %u pulses, period %lu ns (median %lu), drift %ld ps/pulse, "
+              "jitter %lu ns rms / %lu ns peak, duty %lu.%lu%%",
+              ch, a->pulseCount, a->meanPeriodNs, a->medianPeriodNs, a->driftPsPerPulse,
+              a->jitterRmsNs, a->jitterPeakNs, dutyPermille / 10, dutyPermille % 10);
+   if (a->missingPulses || a->extraPulses || a->polarityErrors || detail->edgesLost) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN,
+                 "Burst detail (channel %u): %u missing, %u extra pulses, %u polarity errors, %lu edges lost",
+                 ch, a->missingPulses, a->extraPulses, a->polarityErrors, detail->edgesLost);
+   }
+ }
+ 
+ // Account the cost of one analyzed burst
+ static inline void countAnalyzerCycles(PulseChannelState_t *state, uint32_t cycles) {
+   portENTER_CRITICAL(&pulseMux);
+   state->analyzedBursts++;
+   state->analyzerCycles += cycles;
+   portEXIT_CRITICAL(&pulseMux);
+ }
+ 
+ // Feed the channel's queued edges to its analyzer and close a burst once its gap has passed
+ static void analyzeEdges(uint8_t ch) {
+   PulseChannelState_t *state = &channels[ch];
+ 
+   // Read the time first so an edge queued while draining is never older than it
+   uint32_t currentTimeUs = micros();
+   PulseRingEdge_t entry;
+   while (edgeRings[ch].pop(&entry)) {
+     bool wasActive = state->analyzer.active();
+     uint32_t startCycles = cpu_hal_get_cycle_count();
+     bool closed = state->analyzer.addEdge(&entry.edge);
+     if (closed) {
+       countAnalyzerCycles(state, cpu_hal_get_cycle_count() - startCycles);
+       publishBurstDetail(ch);
+     }
+     if (closed || !wasActive) {
+       state->analyzerStartUs = entry.timeUs;
+     }
+     state->analyzerLastEdgeUs = entry.timeUs;
+   }
+ 
+   if (state->analyzer.active() && (int32_t)(currentTimeUs - state->analyzerLastEdgeUs) > PULSE_BURST_TIMEOUT_US) {
+     uint32_t startCycles = cpu_hal_get_cycle_count();
+     if (state->analyzer.endBurst()) {
+       countAnalyzerCycles(state, cpu_hal_get_cycle_count() - startCycles);
+       publishBurstDetail(ch);
+     }
+   }
+ }
+ 
+ // Publish a channel's result; the first one also wakes receivers waiting for it
+ static inline void publishResult(PulseChannelState_t *state, const PulseBurstResult_t &result) {
+   state->published.write(result);
+   if (!state->resultPublished) {
+     state->resultPublished = true;
+     xSemaphoreGive(state->firstResult);
+   }
+ }
+ 
+ // End a channel's burst once its gap has passed, or report that one started
+ static void updateChannel(uint8_t ch) {
+   PulseChannelEdges_t *edges = &channelEdges[ch];
+   PulseChannelState_t *state = &channels[ch];
+   bool hardware = (captureMode != PULSE_CAPTURE_GPIO_ISR);
+   PulseEdgeTracker_t *tracker = resultTracker(edges);
+   PulseEdgeTracker_t burst;
+   PulseEdgeTracker_t isrBurst;
+   isrBurst.burstActive = false;
+   bool burstEnded;
+   bool localNotifyTask;
+ 
+   // Critical section to safely read the tracker and end the burst if the
+   // gap has passed, so no edge can slip in between the check and the reset
+   portENTER_CRITICAL(&pulseMux);
+   uint64_t nowUs = monotonicUs();
+   uint32_t currentTimeUs = (uint32_t)nowUs;  // micros()
+   burst = *tracker;
+   localNotifyTask = tracker->burstStarted;
+   tracker->burstStarted = false;
+   burstEnded = pulseBurstEnded(&burst, currentTimeUs);
+   if (burstEnded) {
+     tracker->burstActive = false;
+     if (captureMode == PULSE_CAPTURE_COMPARE) {
+       // The ISR view of the same burst ends with it
+       isrBurst = edges->isrTracker;
+       edges->isrTracker.burstActive = false;
+       edges->isrTracker.burstStarted = false;
+     }
+   }
+   portEXIT_CRITICAL(&pulseMux);
+ 
+   // Check if burst ended (timeout since last edge)
+   if (burstEnded) {
+     // Time from the last edge to the result, the gap timeout plus wakeup delay
+     uint32_t latencyUs = currentTimeUs - burst.lastEdgeTimeUs;
+     portENTER_CRITICAL(&pulseMux);
+     state->burstEnds++;
+     state->burstEndLatencySumUs += latencyUs;
+     if (latencyUs > state->burstEndLatencyMaxUs) {
+       state->burstEndLatencyMaxUs = latencyUs;
+     }
+     portEXIT_CRITICAL(&pulseMux);
+ 
+     if (captureMode == PULSE_CAPTURE_COMPARE && isrBurst.burstActive) {
+       compareBurst(state, &burst, &isrBurst);
+     }
+ 
+     // Results, rolling statistics and first reading
+     uint32_t startCycles = cpu_hal_get_cycle_count();
+     PulseBurstEvent_t event = state->monitor.closeBurst(&burst, nowUs);
+     state->burstCycles += cpu_hal_get_cycle_count() - startCycles;
+     const PulseBurstResult_t &result = state->monitor.result();
+ 
+     // Tag the burst-aligned ADC window of this burst
+     if (ch == 0) {
+       burstCaptureTagResult(&result);
+     }
+ 
+     // Skew and phase against the other channels
+     state->burstNumber++;
+     state->lastBurstStartTicks = burst.burstStartTicks;
+     state->lastPeriodUs = meanPeriodUs(&burst, hardware);
+     measurePairs(ch);
+ 
+     if (event == PULSE_BURST_RECORDED || event == PULSE_BURST_FIRST_READING) {
+       if (event == PULSE_BURST_FIRST_READING) {
+         DEBUG_PRINT(DEBUG_LEVEL_INFO, "Stored first valid reading on channel %u: %u pulses at %.2f kHz",
+                    ch, result.pulseCount, pulseKHz(result.frequencyKHzQ16));
+       }
+       DEBUG_PRINT(DEBUG_LEVEL_INFO, "Valid burst recorded on channel %u: %u pulses", ch, result.pulseCount);
+     } else {
+       // Too many pulses - not in the average, which restarts
+       DEBUG_PRINT(DEBUG_LEVEL_WARN, "Burst with %u pulses exceeds limit on channel %u, ignoring", result.pulseCount, ch);
+       if (event == PULSE_BURST_OVER_LIMIT_DROPPED) {
+         DEBUG_PRINT(DEBUG_LEVEL_INFO, "Resetting first reading after 3+ seconds");
+       } else if (event == PULSE_BURST_OVER_LIMIT_KEPT) {
+         DEBUG_PRINT(DEBUG_LEVEL_INFO, "Preserving first reading (within 3 sec window)");
+       }
+     }
+ 
+     // Publish the results
+     publishResult(state, result);
+   }
+   // Check if a new burst started
+   else if (localNotifyTask && state->monitor.startBurst()) {
+     // New burst detected - just log it without printing
+     DEBUG_PRINT(DEBUG_LEVEL_INFO, "New Pulse Burst started on channel %u", ch);
+ 
+     // Publish the updated status
+     publishResult(state, state->monitor.result());
+   }
+ }
+ 
+ // Print the rolling statistics of one channel
+ static void reportChannel(uint8_t ch) {
+   const PulseBurstMonitor &monitor = channels[ch].monitor;
+ 
+   // Rolling averages, kept up to date burst by burst
+   float avgPulseCount = monitor.pulseCountStats().mean();
+   float avgFrequency = pulseKHz(monitor.frequencyStats().mean());
+   float avgFirstPulsePeriod = monitor.firstPeriodStats().mean();
+   float avgBurstDuration = monitor.burstDurationStats().mean();
+   float avgOffPeriod = monitor.offPeriodStats().mean();
+ 
+   // Print rolling average
+   if (channelCount > 1) {
+     Serial.printf("\n--- Pulse Burst 1-Second Rolling Average (channel %u, GPIO %u) ---\n", ch, channelEdges[ch].pin);
+   } else {
+     Serial.println("\n--- Pulse Burst 1-Second Rolling Average ---");
+   }
+   Serial.print("Current - Pulses: ");
+   Serial.print(avgPulseCount, 1);
+   Serial.print(", Freq: ");
+   Serial.print(avgFrequency, 2);
+   Serial.println(" kHz");
+ 
+   Serial.print("Current - Pulse period: ");
+   Serial.print(avgFirstPulsePeriod, 1);
+   Serial.print(" us, Burst: ");
+   Serial.print(avgBurstDuration, 1);
+   Serial.print(" us, Off: ");
+   Serial.print(avgOffPeriod / 1000, 2);  // Convert to ms for readability
+   Serial.println(" ms");
+ 
+   // Spread of the same window
+   Serial.printf("Spread  - Pulses: +/-%.1f (p50 %.0f, p99 %.0f), Pulse period: +/-%.1f us (p50 %.1f, p99 %.1f), "
+                 "Off: +/-%.2f ms (p50 %.2f, p99 %.2f)\n",
+                 monitor.pulseCountStats().stddev(), monitor.pulseCountStats().p50(), monitor.pulseCountStats().p99(),
+                 monitor.firstPeriodStats().stddev(), monitor.firstPeriodStats().p50(), monitor.firstPeriodStats().p99(),
+                 monitor.offPeriodStats().stddev() / 1000, monitor.offPeriodStats().p50() / 1000,
+                 monitor.offPeriodStats().p99() / 1000);
+ 
+   // Print first reading for comparison if available
+   if (monitor.haveFirstReading()) {
+     const PulseBurstResult_t *first = &monitor.firstReading();
+     Serial.print("First   - Pulses: ");
+     Serial.print(first->pulseCount);
+     Serial.print(", Freq: ");
+     Serial.print(pulseKHz(first->frequencyKHzQ16), 2);
+     Serial.println(" kHz");
+ 
+     Serial.print("First   - Pulse period: ");
+     Serial.print(first->firstPulsePeriodUs);
+     Serial.print(" us, Burst: ");
+     Serial.print(first->burstDurationUs);
+     Serial.print(" us, Off: ");
+     Serial.print(first->offPeriodUs / 1000.0f, 2);  // Convert to ms for readability
+     Serial.println(" ms");
+ 
+     // Print change percentage for key metrics
+     float pulseCountChange = ((avgPulseCount - first->pulseCount) / first->pulseCount) * 100.0f;
+     float firstFrequency = pulseKHz(first->frequencyKHzQ16);
+     float frequencyChange = ((avgFrequency - firstFrequency) / firstFrequency) * 100.0f;
+ 
+     Serial.print("Change  - Pulses: ");
+     Serial.print(pulseCountChange, 1);
+     Serial.print("%, Freq: ");
+     Serial.print(frequencyChange, 1);
+     Serial.println("%");
+   }
+ 
+   Serial.print("Bursts in average: ");
+   Serial.println(monitor.pulseCountStats().count());
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO,
+              "Pulse Avg (channel %u): %.1f +/- %.1f pulses, %.2f kHz, First: %.1f +/- %.1f us (p99 %.1f), "
+              "Burst: %.1f us, Off: %.2f +/- %.2f ms (p99 %.2f)",
+              ch, avgPulseCount, monitor.pulseCountStats().stddev(), avgFrequency,
+              avgFirstPulsePeriod, monitor.firstPeriodStats().stddev(), monitor.firstPeriodStats().p99(),
+              avgBurstDuration, avgOffPeriod / 1000, monitor.offPeriodStats().stddev() / 1000,
+              monitor.offPeriodStats().p99() / 1000);
+ 
+   // Burst end detection cost, edge capture cost, and the ISR error against the hardware timestamps
+   PulseCaptureStats_t captureStats;
+   if (getPulseCaptureStats(&captureStats, ch)) {
+     DEBUG_PRINT(DEBUG_LEVEL_INFO,
+                "Burst end (channel %u): %lu us mean / %lu us max after the last edge, %lu cycles to measure, "
+                "%lu cycles to analyze, %lu task wakeups, %lu timer re-arms",
+                ch, captureStats.burstEndLatencyUs, captureStats.burstEndLatencyMaxUs,
+                captureStats.burstCyclesPerBurst, captureStats.analyzerCyclesPerBurst,
+                captureStats.taskWakeups, captureStats.timerRearms);
+     if (captureMode == PULSE_CAPTURE_COMPARE) {
+       DEBUG_PRINT(DEBUG_LEVEL_INFO,
+                  "Edge capture (channel %u): ISR %lu cycles/edge (%lu ppm), MCPWM %lu cycles/edge (%lu ppm); "
+                  "ISR period error first %.0f ns rms / %.0f ns max, mean %.0f ns rms, %lu edges missed in %lu bursts",
+                  ch, captureStats.isrCyclesPerEdge, captureStats.isrLoadPpm,
+                  captureStats.hwCyclesPerEdge, captureStats.hwLoadPpm,
+                  captureStats.firstPeriodErrorRmsNs, captureStats.firstPeriodErrorMaxNs,
+                  captureStats.meanPeriodErrorRmsNs, captureStats.isrMissedEdges,
+                  captureStats.comparedBursts);
+     }
+   }
  }
  
- // Pulse burst monitoring task - runs continuously
+ // Pulse burst monitoring task - serves every channel
  static void pulseBurstTask(void *pvParameters) {
    DEBUG_START_TASK("Pulse Burst Monitor");
    Serial.println("Pulse Burst Monitoring Task Started");
-   
-   PulseBurstResult_t result;
-   result.burstActive = false;
-   result.success = false;
-   result.burstDurationUs = 0;
-   result.offPeriodUs = 0;
-   result.pulseCount = 0;
-   result.frequencyKHz = 0;
-   result.firstPulsePeriodUs = 0;
-   result.timestamp = 0;
-   
-   // Local variables for tracking burst state
-   uint32_t previousBurstEnd = 0;
-   uint32_t lastCheckTimeUs = 0;
-   bool wasActive = false;
-   
-   // Variables for rolling average
-   const int avgWindow = 10;  // Average over last 10 bursts
-   uint16_t burstCounts[avgWindow] = {0};
-   float frequencies[avgWindow] = {0};
-   uint32_t firstPulsePeriods[avgWindow] = {0};
-   uint32_t burstDurations[avgWindow] = {0};
-   uint32_t offPeriods[avgWindow] = {0};
-   int avgIndex = 0;
-   int validBursts = 0;
-   
-   // Store first valid reading for comparison
-   bool haveFirstReading = false;
-   uint16_t firstPulseCount = 0;
-   float firstFrequency = 0;
-   uint32_t firstPulsePeriod = 0;
-   uint32_t firstBurstDuration = 0;
-   uint32_t firstOffPeriod = 0;
-   uint32_t firstReadingTimestamp = 0;  // Timestamp when first reading was stored
-   const uint32_t FIRST_READING_MIN_DURATION_MS = 3000;  // Keep first reading for at least 3 seconds
-   
-   // Maximum pulses threshold
-   const uint16_t MAX_PULSE_COUNT = 40;
-   
+ 
    // Variables for periodic reporting
    TickType_t lastReportTime = xTaskGetTickCount();
    const TickType_t reportInterval = pdMS_TO_TICKS(PULSE_REPORT_INTERVAL_MS);
-   
+ 
    while (1) {
-     // Short delay to check status frequently but avoid hogging CPU
-     vTaskDelay(pdMS_TO_TICKS(10));
-     
-     uint32_t currentTimeUs = micros();
-     bool localBurstActive;
-     uint32_t localLastEdgeTime;
-     uint32_t localBurstStartTime;
-     uint16_t localEdgeCount;
-     uint32_t localFirstPulseTime;
-     bool localNotifyTask;
-     
-     // Critical section to safely read volatile variables
-     portENTER_CRITICAL(&pulseMux);
-     localBurstActive = burstActive;
-     localLastEdgeTime = lastEdgeTimeUs;
-     localBurstStartTime = burstStartTimeUs;
-     localEdgeCount = edgeCount;
-     localFirstPulseTime = firstPulseTimeUs;
-     localNotifyTask = notifyTask;
-     
-     // Reset notification flag
-     if (localNotifyTask) {
-       notifyTask = false;
+     bool haveBursts = false;
+     for (uint8_t ch = 0; ch < channelCount; ch++) {
+       haveBursts = haveBursts || channels[ch].monitor.pulseCountStats().count() > 0;
      }
-     portEXIT_CRITICAL(&pulseMux);
-     
-     // Check if burst ended (timeout since last edge)
-     if (localBurstActive && (currentTimeUs - localLastEdgeTime > PULSE_BURST_TIMEOUT_US)) {
-       // Burst just ended
-       portENTER_CRITICAL(&pulseMux);
-       burstActive = false;
-       lastBurstEndTimeUs = currentTimeUs;
-       portEXIT_CRITICAL(&pulseMux);
-       
-       // Calculate burst duration
-       uint32_t burstDuration = 0;
-       if (currentTimeUs > localBurstStartTime) {
-         burstDuration = currentTimeUs - localBurstStartTime;
-       }
-       
-       // Calculate off period since previous burst
-       uint32_t offPeriod = 0;
-       if (previousBurstEnd > 0 && localBurstStartTime > previousBurstEnd) {
-         offPeriod = localBurstStartTime - previousBurstEnd;
-       }
-       
-       // Calculate frequency in kHz if we have enough edges
-       float freqKHz = 0;
-       if (localEdgeCount >= 4 && burstDuration > 0) {
-         // We divide by 2 because we count both rising and falling edges
-         freqKHz = ((float)(localEdgeCount / 2) * 1000.0f) / (burstDuration / 1000.0f);
-       }
-       
-       // Store results
-       result.success = true;
-       result.burstActive = false;
-       result.burstDurationUs = burstDuration;
-       result.offPeriodUs = offPeriod;
-       result.pulseCount = localEdgeCount / 2;  // Each pulse has 2 edges
-       result.frequencyKHz = freqKHz;
-       result.firstPulsePeriodUs = localFirstPulseTime;
-       result.timestamp = millis();
-       
-       // Check if pulses per burst is below our max threshold
-       uint16_t pulseCount = result.pulseCount;
-       
-       if (pulseCount > MAX_PULSE_COUNT) {
-         // Too many pulses - log but don't include in average
-         DEBUG_PRINT(DEBUG_LEVEL_WARN, "Burst with %u pulses exceeds limit, ignoring", pulseCount);
-         
-         // Clear the rolling average buffer
-         memset(burstCounts, 0, sizeof(burstCounts));
-         memset(frequencies, 0, sizeof(frequencies));
-         memset(firstPulsePeriods, 0, sizeof(firstPulsePeriods));
-         memset(burstDurations, 0, sizeof(burstDurations));
-         memset(offPeriods, 0, sizeof(offPeriods));
-         validBursts = 0;
-         avgIndex = 0;
-         
-         // Only reset first reading if it's been at least 3 seconds since it was stored
-         uint32_t currentTime = millis();
-         if (haveFirstReading && (currentTime - firstReadingTimestamp > FIRST_READING_MIN_DURATION_MS)) {
-           DEBUG_PRINT(DEBUG_LEVEL_INFO, "Resetting first reading after 3+ seconds");
-           haveFirstReading = false;
-         } else if (haveFirstReading) {
-           DEBUG_PRINT(DEBUG_LEVEL_INFO, "Preserving first reading (within 3 sec window)");
-         }
-       } else {
-         // Update rolling average window with valid data
-         burstCounts[avgIndex] = result.pulseCount;
-         frequencies[avgIndex] = result.frequencyKHz;
-         firstPulsePeriods[avgIndex] = result.firstPulsePeriodUs;
-         burstDurations[avgIndex] = result.burstDurationUs;
-         offPeriods[avgIndex] = result.offPeriodUs;
-         
-         // Store first valid reading if we don't have one yet
-         if (!haveFirstReading) {
-           firstPulseCount = result.pulseCount;
-           firstFrequency = result.frequencyKHz;
-           firstPulsePeriod = result.firstPulsePeriodUs;
-           firstBurstDuration = result.burstDurationUs;
-           firstOffPeriod = result.offPeriodUs;
-           firstReadingTimestamp = millis();  // Store timestamp
-           haveFirstReading = true;
-           
-           DEBUG_PRINT(DEBUG_LEVEL_INFO, "Stored first valid reading: %u pulses at %.2f kHz", 
-                      firstPulseCount, firstFrequency);
-         }
-         
-         
-         // Increment index and valid burst count
-         avgIndex = (avgIndex + 1) % avgWindow;
-         if (validBursts < avgWindow) {
-           validBursts++;
-         }
-         
-         DEBUG_PRINT(DEBUG_LEVEL_INFO, "Valid burst recorded: %u pulses", result.pulseCount);
-       }
-       
-       // Update for next cycle
-       previousBurstEnd = currentTimeUs;
-       
-       // Send results to the queue
-       xQueueOverwrite(pulseResultsQueue, &result);
-       
-       wasActive = false;
+ 
+     // Sleep until an edge interrupt or a gap timer wakes us, or the next report is due
+     TickType_t waitTicks = portMAX_DELAY;
+     if (haveBursts) {
+       TickType_t sinceReport = xTaskGetTickCount() - lastReportTime;
+       waitTicks = (sinceReport >= reportInterval) ? 0 : reportInterval - sinceReport;
      }
-     // Check if a new burst started
-     else if (localNotifyTask && !wasActive) {
-       // New burst detected - just log it without printing
-       DEBUG_PRINT(DEBUG_LEVEL_INFO, "New Pulse Burst started");
-       
-       // Update result with active status
-       result.burstActive = true;
-       result.success = true;
-       
-       // Send updated status to queue
-       xQueueOverwrite(pulseResultsQueue, &result);
-       
-       wasActive = true;
+     xTaskNotifyWait(0, 0xFFFFFFFF, NULL, waitTicks);
+     taskWakeups++;
+ 
+     for (uint8_t ch = 0; ch < channelCount; ch++) {
+       analyzeEdges(ch);
+       updateChannel(ch);
      }
-     
+ 
      // Check if it's time to report the rolling average
      TickType_t currentTicks = xTaskGetTickCount();
-     if ((currentTicks - lastReportTime) >= reportInterval && validBursts > 0) {
+     if ((currentTicks - lastReportTime) >= reportInterval && haveBursts) {
        lastReportTime = currentTicks;
-       
-       // Calculate rolling averages
-       float avgPulseCount = 0;
-       float avgFrequency = 0;
-       float avgFirstPulsePeriod = 0;
-       float avgBurstDuration = 0;
-       float avgOffPeriod = 0;
-       
-       for (int i = 0; i < validBursts; i++) {
-         avgPulseCount += burstCounts[i];
-         avgFrequency += frequencies[i];
-         avgFirstPulsePeriod += firstPulsePeriods[i];
-         avgBurstDuration += burstDurations[i];
-         avgOffPeriod += offPeriods[i];
+ 
+       for (uint8_t ch = 0; ch < channelCount; ch++) {
+         if (channels[ch].monitor.pulseCountStats().count() > 0) {
+           reportChannel(ch);
+         }
        }
-       
-       avgPulseCount /= validBursts;
-       avgFrequency /= validBursts;
-       avgFirstPulsePeriod /= validBursts;
-       avgBurstDuration /= validBursts;
-       avgOffPeriod /= validBursts;
-       
-       // Print rolling average
-       Serial.println("\n--- Pulse Burst 1-Second Rolling Average ---");
-       Serial.print("Current - Pulses: ");
-       Serial.print(avgPulseCount, 1);
-       Serial.print(", Freq: ");
-       Serial.print(avgFrequency, 2);
-       Serial.println(" kHz");
-       
-       Serial.print("Current - Pulse period: ");
-       Serial.print(avgFirstPulsePeriod, 1);
-       Serial.print(" us, Burst: ");
-       Serial.print(avgBurstDuration, 1);
-       Serial.print(" us, Off: ");
-       Serial.print(avgOffPeriod / 1000, 2);  // Convert to ms for readability
-       Serial.println(" ms");
-       
-       // Print first reading for comparison if available
-       if (haveFirstReading) {
-         Serial.print("First   - Pulses: ");
-         Serial.print(firstPulseCount);
-         Serial.print(", Freq: ");
-         Serial.print(firstFrequency, 2);
-         Serial.println(" kHz");
-         
-         Serial.print("First   - Pulse period: ");
-         Serial.print(firstPulsePeriod);
-         Serial.print(" us, Burst: ");
-         Serial.print(firstBurstDuration);
-         Serial.print(" us, Off: ");
-         Serial.print(firstOffPeriod / 1000, 2);  // Convert to ms for readability
-         Serial.println(" ms");
-         
-         // Print change percentage for key metrics
-         float pulseCountChange = ((avgPulseCount - firstPulseCount) / firstPulseCount) * 100.0f;
-         float frequencyChange = ((avgFrequency - firstFrequency) / firstFrequency) * 100.0f;
-         
-         Serial.print("Change  - Pulses: ");
-         Serial.print(pulseCountChange, 1);
-         Serial.print("%, Freq: ");
-         Serial.print(frequencyChange, 1);
-         Serial.println("%");
+ 
+       // Skew and phase between channel pairs
+       for (uint8_t a = 0; a < channelCount; a++) {
+         for (uint8_t b = a + 1; b < channelCount; b++) {
+           PulsePairStats_t pairStats;
+           if (getPulsePairStats(a, b, &pairStats)) {
+             DEBUG_PRINT(DEBUG_LEVEL_INFO,
+                        "Channel %u -> %u: skew %.3f +/- %.3f us (p50 %.3f, p99 %.3f), phase %.1f +/- %.1f deg, "
+                        "%lu bursts paired",
+                        a, b, pairStats.skewUs, pairStats.skewStdUs, pairStats.skewP50Us, pairStats.skewP99Us,
+                        pairStats.phaseDeg, pairStats.phaseStdDeg, pairStats.pairedBursts);
+           }
+         }
        }
-       
-       Serial.print("Bursts in average: ");
-       Serial.println(validBursts);
-       
-       DEBUG_PRINT(DEBUG_LEVEL_INFO, 
-                  "Pulse Avg: %.1f pulses, %.2f kHz, First: %.1f us, Burst: %.1f us, Off: %.2f ms", 
-                  avgPulseCount, avgFrequency, avgFirstPulsePeriod, 
-                  avgBurstDuration, avgOffPeriod / 1000);
      }
-     
-     // Update time for next cycle
-     lastCheckTimeUs = currentTimeUs;
    }
-   
+ 
    // Should never reach here, but just in case
    DEBUG_END_TASK("Pulse Burst Monitor");
    vTaskDelete(NULL);
  }
  
- bool initPulseBurstModule(uint8_t monitorPin) {
-   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Pulse Burst module on pin %d", monitorPin);
-   
-   // Store the pin number
-   pulsePin = monitorPin;
-   
+ // Release the detail queues and timers of the channels set up so far
+ static void releaseChannels(uint8_t count) {
+   for (uint8_t ch = 0; ch < count; ch++) {
+     if (channels[ch].detailQueue != NULL) {
+       vQueueDelete(channels[ch].detailQueue);
+       channels[ch].detailQueue = NULL;
+     }
+     if (channels[ch].firstResult != NULL) {
+       vSemaphoreDelete(channels[ch].firstResult);
+       channels[ch].firstResult = NULL;
+     }
+     if (channelEdges[ch].burstEndTimer != NULL) {
+       esp_timer_stop(channelEdges[ch].burstEndTimer);
+       esp_timer_delete(channelEdges[ch].burstEndTimer);
+       channelEdges[ch].burstEndTimer = NULL;
+     }
+   }
+ }
+ 
+ // Set up the queues, timer and analyzer of one channel
+ static bool initChannel(uint8_t ch, uint8_t pin) {
+   PulseChannelEdges_t *edges = &channelEdges[ch];
+   PulseChannelState_t *state = &channels[ch];
+ 
    // Configure the pin as input
-   pinMode(pulsePin, INPUT);
-   
-   // Create queue for passing results (size 1, we only care about latest result)
-   pulseResultsQueue = xQueueCreate(1, sizeof(PulseBurstResult_t));
-   if (pulseResultsQueue == NULL) {
-     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create pulse results queue - out of memory");
+   pinMode(pin, INPUT);
+ 
+   // Check if pin supports interrupts
+   if (digitalPinToInterrupt(pin) < 0) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Pin %d does not support interrupts", pin);
      return false;
    }
-   
-   // Check if pin supports interrupts
-   if (digitalPinToInterrupt(pulsePin) < 0) {
-     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Pin %d does not support interrupts", pulsePin);
-     vQueueDelete(pulseResultsQueue);
-     pulseResultsQueue = NULL;
+ 
+   // Create the detail queue (size 1, we only care about the latest burst)
+   state->detailQueue = xQueueCreate(1, sizeof(PulseBurstDetail_t));
+   if (state->detailQueue == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create pulse detail queue for channel %u - out of memory", ch);
      return false;
    }
-   
+   state->firstResult = xSemaphoreCreateBinary();
+   if (state->firstResult == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create pulse result signal for channel %u - out of memory", ch);
+     return false;
+   }
+   state->resultPublished = false;
+ 
    // Initialize tracking variables
-   lastEdgeTimeUs = 0;
-   firstPulseTimeUs = 0;
-   burstStartTimeUs = 0;
-   lastBurstEndTimeUs = 0;
-   edgeCount = 0;
-   burstActive = false;
-   notifyTask = false;
-   
-   // Attach interrupt (no return value to check)
-   attachInterrupt(digitalPinToInterrupt(pulsePin), pulseBurstISR, CHANGE);
-   
-   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse Burst module initialized successfully");
+   resetTracker(&edges->hwTracker);
+   resetTracker(&edges->isrTracker);
+   edges->isrEdges = edges->isrCycles = 0;
+   edges->hwEdges = edges->hwCycles = 0;
+   edges->edgesLost = 0;
+   edges->risingEdges = 0;
+   edges->lastRisingTicks = 0;
+   edges->pin = pin;
+   edges->index = ch;
+   edgeRings[ch].clear();
+ 
+   // One-shot gap timer, armed by the first edge of each burst
+   esp_timer_create_args_t timerArgs = {};
+   timerArgs.callback = burstEndTimerCallback;
+   timerArgs.arg = edges;
+   timerArgs.dispatch_method = ESP_TIMER_TASK;
+   timerArgs.name = "pulse_gap";
+   esp_err_t err = esp_timer_create(&timerArgs, &edges->burstEndTimer);
+   if (err != ESP_OK) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create burst gap timer for channel %u (%s)", ch, esp_err_to_name(err));
+     edges->burstEndTimer = NULL;
+     return false;
+   }
+ 
+   // The burst monitor is configured once the capture backend is settled
+   state->analyzerStartUs = 0;
+   state->analyzerLastEdgeUs = 0;
+   state->lostReported = 0;
+   state->burstNumber = 0;
+   state->lastBurstStartTicks = 0;
+   state->lastPeriodUs = 0;
+   state->comparedBursts = 0;
+   state->isrMissedEdges = 0;
+   state->firstPeriodErrors = 0;
+   state->firstPeriodErrorSumSq = 0;
+   state->firstPeriodErrorMax = 0;
+   state->meanPeriodErrors = 0;
+   state->meanPeriodErrorSumSq = 0;
+   state->burstEnds = 0;
+   state->burstEndLatencySumUs = 0;
+   state->burstEndLatencyMaxUs = 0;
+   state->burstCycles = 0;
+   state->analyzedBursts = 0;
+   state->analyzerCycles = 0;
+   return true;
+ }
+ 
+ bool initPulseBurstModule(uint8_t monitorPin, PulseCaptureMode_t mode) {
+   return initPulseBurstChannels(&monitorPin, 1, mode);
+ }
+ 
+ bool initPulseBurstChannels(const uint8_t *pins, uint8_t count, PulseCaptureMode_t mode) {
+   if (pins == NULL || count == 0 || count > PULSE_MAX_CHANNELS) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Invalid pulse channel count %u (max %d)", count, PULSE_MAX_CHANNELS);
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Pulse Burst module on %u channel(s), first on pin %d", count, pins[0]);
+ 
+   for (uint8_t ch = 0; ch < count; ch++) {
+     if (!initChannel(ch, pins[ch])) {
+       releaseChannels(ch + 1);
+       return false;
+     }
+   }
+   for (uint8_t i = 0; i < PULSE_MAX_PAIRS; i++) {
+     pairs[i].pairedBurstA = 0;
+     pairs[i].pairedBurstB = 0;
+     pairs[i].pairedBursts = 0;
+     pairs[i].skewUs.configure(PULSE_STATS_WINDOW_MODE, PULSE_STATS_WINDOW);
+     pairs[i].phaseDeg.configure(PULSE_STATS_WINDOW_MODE, PULSE_STATS_WINDOW);
+   }
+ 
+   channelCount = count;
+   captureStartUs = micros();
+   captureMode = mode;
+   timerRearms = taskWakeups = 0;
+ 
+   // Hardware timestamps: route each pin to its capture channel of the MCPWM unit, both edges
+   if (mode != PULSE_CAPTURE_GPIO_ISR) {
+     esp_err_t err = ESP_OK;
+     uint8_t enabled = 0;
+     while (enabled < count) {
+       mcpwm_capture_config_t captureConfig;
+       captureConfig.cap_edge = MCPWM_BOTH_EDGE;
+       captureConfig.cap_prescale = 1;
+       captureConfig.capture_cb = pulseCaptureCallback;
+       captureConfig.user_data = &channelEdges[enabled];
+ 
+       err = mcpwm_gpio_init(PULSE_CAPTURE_MCPWM_UNIT, (mcpwm_io_signals_t)(PULSE_CAPTURE_MCPWM_SIGNAL + enabled),
+                             pins[enabled]);
+       if (err == ESP_OK) {
+         err = mcpwm_capture_enable_channel(PULSE_CAPTURE_MCPWM_UNIT,
+                                            (mcpwm_capture_channel_id_t)(PULSE_CAPTURE_MCPWM_CHANNEL + enabled),
+                                            &captureConfig);
+       }
+       if (err != ESP_OK) {
+         break;
+       }
+       enabled++;
+     }
+     if (err != ESP_OK) {
+       // All channels share one time base, so all of them fall back together
+       DEBUG_PRINT(DEBUG_LEVEL_WARN, "MCPWM capture unavailable (%s) - using the GPIO interrupt",
+                   esp_err_to_name(err));
+       for (uint8_t ch = 0; ch < enabled; ch++) {
+         mcpwm_capture_disable_channel(PULSE_CAPTURE_MCPWM_UNIT, (mcpwm_capture_channel_id_t)(PULSE_CAPTURE_MCPWM_CHANNEL + ch));
+       }
+       captureMode = PULSE_CAPTURE_GPIO_ISR;
+     } else {
+       mcpwmEnabled = true;
+     }
+   }
+ 
+   // Measure and rebuild bursts in the units of the backend that drives the results,
+   // now that the MCPWM fallback has had its say
+   uint32_t resultTickHz = tickHz(captureMode != PULSE_CAPTURE_GPIO_ISR);
+   BurstAnalyzerConfig_t analyzerConfig;
+   analyzerConfig.tickHz = resultTickHz;
+   analyzerConfig.gapUs = PULSE_BURST_TIMEOUT_US;
+   analyzerConfig.expectedPulses = 0;
+   PulseBurstConfig_t monitorConfig;
+   monitorConfig.tickHz = resultTickHz;
+   monitorConfig.windowMode = PULSE_STATS_WINDOW_MODE;
+   monitorConfig.window = PULSE_STATS_WINDOW;
+   for (uint8_t ch = 0; ch < count; ch++) {
+     channels[ch].analyzer.configure(&analyzerConfig);
+     monitorConfig.channel = ch;
+     if (!channels[ch].monitor.configure(&monitorConfig)) {
+       DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Invalid pulse statistics window %u", PULSE_STATS_WINDOW);
+       if (mcpwmEnabled) {
+         for (uint8_t i = 0; i < count; i++) {
+           mcpwm_capture_disable_channel(PULSE_CAPTURE_MCPWM_UNIT, (mcpwm_capture_channel_id_t)(PULSE_CAPTURE_MCPWM_CHANNEL + i));
+         }
+         mcpwmEnabled = false;
+       }
+       releaseChannels(count);
+       channelCount = 0;
+       return false;
+     }
+   }
+ 
+   // The GPIO interrupt timestamps edges itself, or runs alongside for the comparison
+   if (captureMode != PULSE_CAPTURE_MCPWM) {
+     for (uint8_t ch = 0; ch < count; ch++) {
+       // Attach interrupt (no return value to check)
+       attachInterruptArg(digitalPinToInterrupt(pins[ch]), pulseBurstISR, &channelEdges[ch], CHANGE);
+     }
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse Burst module initialized successfully (%s edge capture)",
+               captureMode == PULSE_CAPTURE_GPIO_ISR ? "GPIO interrupt" :
+               captureMode == PULSE_CAPTURE_MCPWM ? "MCPWM" : "MCPWM vs GPIO interrupt");
    return true;
  }
  
  bool createPulseBurstTask() {
-   if (pulseResultsQueue == NULL) {
+   if (channelCount == 0) {
      DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot create Pulse Burst task - module not initialized");
      return false;
    }
-   
+ 
    // Don't create if already running
    if (pulseTaskHandle != NULL) {
      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Pulse Burst task already running");
      return true;
    }
-   
+ 
    // Create the pulse burst monitoring task with medium priority
    BaseType_t result = xTaskCreate(
      pulseBurstTask,
@@ -392,34 +887,149 @@
      3,  // Medium priority
      &pulseTaskHandle
    );
-   
+ 
    if (result != pdPASS) {
      DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create Pulse Burst task - error code: %d", result);
      return false;
    }
-   
+ 
    DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse Burst task created successfully");
    return true;
  }
  
- bool receivePulseBurstResults(PulseBurstResult_t *result, TickType_t timeout) {
-   if (result == NULL || pulseResultsQueue == NULL) {
+ bool receivePulseBurstResults(PulseBurstResult_t *result, TickType_t timeout, uint8_t channel) {
+   if (result == NULL || channel >= channelCount) {
      DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Invalid Pulse Burst results receive request");
      return false;
    }
-   
-   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Reading Pulse Burst results");
-   
-   // Receive results from the queue (peek doesn't remove the item)
-   BaseType_t received = xQueuePeek(pulseResultsQueue, result, timeout);
-   
-   if (received != pdPASS) {
-     DEBUG_PRINT(DEBUG_LEVEL_WARN, "No Pulse Burst results available");
-   } else {
-     DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse Burst results received successfully");
+ 
+   // Latest published result; only blocks until the first one exists, and
+   // hands the signal on so every other waiter wakes as well
+   PulseChannelState_t *state = &channels[channel];
+   if (state->published.read(result)) {
+     return true;
+   }
+   if (xSemaphoreTake(state->firstResult, timeout) != pdTRUE) {
+     return false;
+   }
+   xSemaphoreGive(state->firstResult);
+   return state->published.read(result);
+ }
+ 
+ bool receivePulseBurstDetail(PulseBurstDetail_t *detail, TickType_t timeout, uint8_t channel) {
+   if (detail == NULL || channel >= channelCount) {
+     return false;
    }
-   
-   return (received == pdPASS);
+ 
+   return xQueueReceive(channels[channel].detailQueue, detail, timeout) == pdPASS;
+ }
+ 
+ bool getPulseCaptureStats(PulseCaptureStats_t *stats, uint8_t channel) {
+   if (stats == NULL || channel >= channelCount) {
+     return false;
+   }
+ 
+   // Body time as a share of one core since the module started
+   PulseChannelEdges_t *edges = &channelEdges[channel];
+   PulseChannelState_t *state = &channels[channel];
+   uint32_t isrEdgeCount = edges->isrEdges;
+   uint32_t isrCycleCount = edges->isrCycles;
+   uint32_t hwEdgeCount = edges->hwEdges;
+   uint32_t hwCycleCount = edges->hwCycles;
+   double elapsedCycles = (double)(micros() - captureStartUs) * getCpuFrequencyMhz();
+ 
+   stats->mode = captureMode;
+   stats->isrEdges = isrEdgeCount;
+   stats->hwEdges = hwEdgeCount;
+   stats->isrCyclesPerEdge = isrEdgeCount ? isrCycleCount / isrEdgeCount : 0;
+   stats->hwCyclesPerEdge = hwEdgeCount ? hwCycleCount / hwEdgeCount : 0;
+   stats->isrLoadPpm = elapsedCycles > 0 ? (uint32_t)(isrCycleCount * 1e6 / elapsedCycles) : 0;
+   stats->hwLoadPpm = elapsedCycles > 0 ? (uint32_t)(hwCycleCount * 1e6 / elapsedCycles) : 0;
+ 
+   portENTER_CRITICAL(&pulseMux);
+   stats->comparedBursts = state->comparedBursts;
+   stats->isrMissedEdges = state->isrMissedEdges;
+   stats->firstPeriodErrorRmsNs = state->firstPeriodErrors ?
+                                  (float)sqrt(state->firstPeriodErrorSumSq / state->firstPeriodErrors) : 0;
+   stats->firstPeriodErrorMaxNs = state->firstPeriodErrorMax;
+   stats->meanPeriodErrorRmsNs = state->meanPeriodErrors ?
+                                 (float)sqrt(state->meanPeriodErrorSumSq / state->meanPeriodErrors) : 0;
+   stats->burstEndLatencyUs = state->burstEnds ? (uint32_t)(state->burstEndLatencySumUs / state->burstEnds) : 0;
+   stats->burstEndLatencyMaxUs = state->burstEndLatencyMaxUs;
+   stats->burstCyclesPerBurst = state->burstEnds ? (uint32_t)(state->burstCycles / state->burstEnds) : 0;
+   stats->analyzerCyclesPerBurst = state->analyzedBursts ?
+                                   (uint32_t)(state->analyzerCycles / state->analyzedBursts) : 0;
+   portEXIT_CRITICAL(&pulseMux);
+   stats->taskWakeups = taskWakeups;
+   stats->timerRearms = timerRearms;
+   return true;
+ }
+ 
+ bool getPulsePairStats(uint8_t a, uint8_t b, PulsePairStats_t *stats) {
+   if (stats == NULL || a == b || a >= channelCount || b >= channelCount) {
+     return false;
+   }
+ 
+   // Pairs are kept with the lower channel as the reference
+   float sign = (a < b) ? 1.0f : -1.0f;
+   PulsePairState_t *pair = &pairs[(a < b) ? pairIndex(a, b) : pairIndex(b, a)];
+ 
+   portENTER_CRITICAL(&pulseMux);
+   stats->pairedBursts = pair->pairedBursts;
+   stats->windowBursts = pair->skewUs.count();
+   stats->skewUs = sign * pair->skewUs.mean();
+   stats->skewStdUs = pair->skewUs.stddev();
+   stats->skewP50Us = sign * pair->skewUs.p50();
+   stats->skewP99Us = sign * pair->skewUs.p99();
+   stats->phaseDeg = sign * pair->phaseDeg.mean();
+   stats->phaseStdDeg = pair->phaseDeg.stddev();
+   portEXIT_CRITICAL(&pulseMux);
+   return stats->pairedBursts > 0;
+ }
+ 
+ bool measurePulseFrequency(uint8_t channel, uint32_t gateMs, PulseFrequencyMeasurement_t *measurement) {
+   if (measurement == NULL || channel >= channelCount || gateMs == 0) {
+     return false;
+   }
+ 
+   // Whole periods between the last rising edge before the gate and the last one in it
+   PulseChannelEdges_t *edges = &channelEdges[channel];
+   portENTER_CRITICAL(&pulseMux);
+   uint32_t startCount = edges->risingEdges;
+   uint32_t startTicks = edges->lastRisingTicks;
+   portEXIT_CRITICAL(&pulseMux);
+ 
+   vTaskDelay(pdMS_TO_TICKS(gateMs));
+ 
+   portENTER_CRITICAL(&pulseMux);
+   uint32_t endCount = edges->risingEdges;
+   uint32_t endTicks = edges->lastRisingTicks;
+   portEXIT_CRITICAL(&pulseMux);
+ 
+   memset(measurement, 0, sizeof(PulseFrequencyMeasurement_t));
+   if (startCount == 0 || endCount == startCount) {
+     return false;  // No edge before the gate, or none in it
+   }
+ 
+   bool hardware = (captureMode != PULSE_CAPTURE_GPIO_ISR);
+   double intervalUs = ticksToUs(endTicks - startTicks, hardware);
+   if (intervalUs <= 0) {
+     return false;
+   }
+ 
+   // One timestamp error at each end: tick quantization, or the interrupt latency spread
+   double timestampErrorUs = hardware ? 1000000.0 / PULSE_CAPTURE_MCPWM_TICK_HZ / sqrt(12.0) :
+                                        PULSE_ISR_TIMESTAMP_ERROR_US;
+   double frequencyHz = (endCount - startCount) * 1000000.0 / intervalUs;
+   measurement->periods = endCount - startCount;
+   measurement->intervalUs = (float)intervalUs;
+   measurement->frequencyHz = (float)frequencyHz;
+   measurement->stdErrHz = (float)(frequencyHz * sqrt(2.0) * timestampErrorUs / intervalUs);
+   return true;
+ }
+ 
+ uint8_t getPulseChannelCount() {
+   return channelCount;
  }
  
  bool stopPulseBurstTask() {
@@ -427,20 +1037,26 @@
      DEBUG_PRINT(DEBUG_LEVEL_WARN, "Pulse Burst task not running");
      return true;
    }
-   
-   // Detach the interrupt
-   detachInterrupt(digitalPinToInterrupt(pulsePin));
-   
+ 
+   // Detach the interrupts and stop the capture unit
+   for (uint8_t ch = 0; ch < channelCount; ch++) {
+     if (captureMode != PULSE_CAPTURE_MCPWM) {
+       detachInterrupt(digitalPinToInterrupt(channelEdges[ch].pin));
+     }
+     if (mcpwmEnabled) {
+       mcpwm_capture_disable_channel(PULSE_CAPTURE_MCPWM_UNIT, (mcpwm_capture_channel_id_t)(PULSE_CAPTURE_MCPWM_CHANNEL + ch));
+     }
+   }
+   mcpwmEnabled = false;
+ 
    // Delete the task
    vTaskDelete(pulseTaskHandle);
    pulseTaskHandle = NULL;
-   
-   // Clean up queue
-   if (pulseResultsQueue != NULL) {
-     vQueueDelete(pulseResultsQueue);
-     pulseResultsQueue = NULL;
-   }
-   
+ 
+   // Clean up detail queues and timers
+   releaseChannels(channelCount);
+   channelCount = 0;
+ 
    DEBUG_PRINT(DEBUG_LEVEL_INFO, "Pulse Burst task stopped");
    return true;
  }
\ No newline at end of file
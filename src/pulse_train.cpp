@@ -0,0 +1,111 @@
+/*
+ * Pulse Train Compiler Implementation
+ *
+ * A burst is a list of level segments: the high time of each pulse, the low
+ * rest of its period, and for the last pulse the gap instead. Each segment
+ * takes as many symbol halves as its 15 bit durations need, split evenly so
+ * no half is empty (an empty half marks the end of a transmission). Segments
+ * are packed into halves back to back, so an odd count leaves the second
+ * half of the last symbol empty, which is the end marker.
+ */
+ 
+ #include "pulse_train.h"
+ 
+ uint32_t pulseTrainTicks(uint32_t ns, uint32_t tickNs) {
+   uint32_t ticks = (uint32_t)(((uint64_t)ns + tickNs / 2) / tickNs);
+   return (ticks == 0) ? 1 : ticks;
+ }
+ 
+ // Halves a segment of this many ticks takes
+ static uint32_t segmentHalves(uint32_t ticks) {
+   return (ticks + PULSE_TRAIN_MAX_HALF_TICKS - 1) / PULSE_TRAIN_MAX_HALF_TICKS;
+ }
+ 
+ // Write one segment from half number *half on, split evenly
+ static void emitSegment(PulseTrainSymbol_t *symbols, size_t *half, bool level, uint32_t ticks) {
+   uint32_t pieces = segmentHalves(ticks);
+   for (uint32_t i = 0; i < pieces; i++) {
+     uint32_t duration = ticks / pieces + ((i < ticks % pieces) ? 1 : 0);
+     PulseTrainSymbol_t *symbol = &symbols[*half / 2];
+     if ((*half & 1) == 0) {
+       symbol->val = 0;
+       symbol->duration0 = duration;
+       symbol->level0 = level;
+     } else {
+       symbol->duration1 = duration;
+       symbol->level1 = level;
+     }
+     (*half)++;
+   }
+ }
+ 
+ size_t pulseTrainCompile(const PulseTrainPattern_t *pattern, uint32_t tickNs, uint64_t minTicks,
+                          PulseTrainSymbol_t *symbols, size_t capacity, uint16_t *bursts) {
+   if (bursts != NULL) {
+     *bursts = 0;
+   }
+   if (pattern == NULL || tickNs == 0 || pattern->pulsesPerBurst == 0 ||
+       pattern->pulseWidthNs == 0 || pattern->burstGapNs == 0) {
+     return 0;
+   }
+ 
+   uint32_t width = pulseTrainTicks(pattern->pulseWidthNs, tickNs);
+   uint32_t gap = pulseTrainTicks(pattern->burstGapNs, tickNs);
+   uint32_t low = 0;
+   if (pattern->pulsesPerBurst > 1) {
+     uint32_t period = pulseTrainTicks(pattern->pulsePeriodNs, tickNs);
+     if (period <= width) {
+       return 0;
+     }
+     low = period - width;
+   }
+ 
+   // One burst: halves and duration
+   uint32_t pulses = pattern->pulsesPerBurst;
+   uint64_t burstHalves = (uint64_t)pulses * segmentHalves(width) + (uint64_t)(pulses - 1) * segmentHalves(low) +
+                          segmentHalves(gap);
+   uint64_t burstTicks = (uint64_t)pulses * width + (uint64_t)(pulses - 1) * low + gap;
+ 
+   // Whole bursts until the minimum time, as far as they fit
+   uint64_t maxRepeat = (2 * (uint64_t)capacity) / burstHalves;
+   if (maxRepeat == 0) {
+     return 0;
+   }
+   uint64_t repeat = (minTicks > burstTicks) ? (minTicks + burstTicks - 1) / burstTicks : 1;
+   if (repeat > maxRepeat) {
+     repeat = maxRepeat;
+   }
+   if (repeat > UINT16_MAX) {
+     repeat = UINT16_MAX;
+   }
+ 
+   size_t count = (size_t)((repeat * burstHalves + 1) / 2);
+   if (bursts != NULL) {
+     *bursts = (uint16_t)repeat;
+   }
+   if (symbols == NULL) {
+     return count;
+   }
+ 
+   size_t half = 0;
+   for (uint64_t b = 0; b < repeat; b++) {
+     for (uint32_t p = 0; p < pulses; p++) {
+       emitSegment(symbols, &half, true, width);
+       emitSegment(symbols, &half, false, (p + 1 < pulses) ? low : gap);
+     }
+   }
+   if (half & 1) {
+     // End marker in the unused second half
+     symbols[half / 2].duration1 = 0;
+     symbols[half / 2].level1 = 0;
+   }
+   return count;
+ }
+ 
+ uint64_t pulseTrainDurationTicks(const PulseTrainSymbol_t *symbols, size_t count) {
+   uint64_t ticks = 0;
+   for (size_t i = 0; i < count; i++) {
+     ticks += symbols[i].duration0 + symbols[i].duration1;
+   }
+   return ticks;
+ }
\ No newline at end of file
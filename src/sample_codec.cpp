@@ -0,0 +1,219 @@
+/*
+ * Sample Codec Implementation
+ */
+ 
+ #include "sample_codec.h"
+ 
+ // MSB-first bit writer over a byte buffer
+ typedef struct {
+   uint8_t *buf;
+   size_t size;
+   size_t pos;        // Bytes flushed
+   uint32_t acc;      // Pending bits, right aligned
+   uint8_t bits;      // Number of pending bits
+   bool overflow;
+ } BitWriter_t;
+ 
+ static inline void putBits(BitWriter_t *w, uint32_t value, uint8_t count) {
+   // count <= 16 so the accumulator never holds more than 23 bits
+   w->acc = (w->acc << count) | (value & ((1u << count) - 1));
+   w->bits += count;
+   while (w->bits >= 8) {
+     w->bits -= 8;
+     if (w->pos < w->size) {
+       w->buf[w->pos++] = (uint8_t)(w->acc >> w->bits);
+     } else {
+       w->overflow = true;
+     }
+   }
+ }
+ 
+ static inline void putUnary(BitWriter_t *w, uint32_t q) {
+   while (q >= 16) {
+     putBits(w, 0, 16);
+     q -= 16;
+   }
+   putBits(w, 1, (uint8_t)(q + 1));
+ }
+ 
+ static size_t flushBits(BitWriter_t *w) {
+   if (w->bits > 0) {
+     putBits(w, 0, (uint8_t)(8 - w->bits));
+   }
+   return w->overflow ? 0 : w->pos;
+ }
+ 
+ // MSB-first bit reader
+ typedef struct {
+   const uint8_t *buf;
+   size_t size;
+   size_t pos;
+   uint32_t acc;
+   uint8_t bits;
+   bool underflow;
+ } BitReader_t;
+ 
+ static inline uint32_t getBits(BitReader_t *r, uint8_t count) {
+   while (r->bits < count) {
+     uint8_t byte = 0;
+     if (r->pos < r->size) {
+       byte = r->buf[r->pos++];
+     } else {
+       r->underflow = true;
+     }
+     r->acc = (r->acc << 8) | byte;
+     r->bits += 8;
+   }
+   r->bits -= count;
+   return (r->acc >> r->bits) & ((1u << count) - 1);
+ }
+ 
+ static inline uint32_t getUnary(BitReader_t *r) {
+   uint32_t q = 0;
+   while (getBits(r, 1) == 0) {
+     if (r->underflow) {
+       break;
+     }
+     q++;
+   }
+   return q;
+ }
+ 
+ static inline uint16_t zigzag(int32_t delta) {
+   return (uint16_t)(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+ }
+ 
+ static inline int32_t unzigzag(uint32_t value) {
+   return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+ }
+ 
+ // Pick the cheapest mode for one partition and return its cost in bits
+ static uint8_t chooseMode(const uint16_t *values, size_t n, uint32_t *costBits) {
+   uint32_t sum = 0;
+   for (size_t i = 0; i < n; i++) {
+     sum += values[i];
+   }
+ 
+   if (sum == 0) {
+     *costBits = 0;
+     return SAMPLE_CODEC_MODE_ZERO_RUN;
+   }
+ 
+   uint8_t bestMode = SAMPLE_CODEC_MODE_VERBATIM;
+   uint32_t bestCost = (uint32_t)n * SAMPLE_CODEC_DELTA_BITS;
+ 
+   // Rice cost is n*(k+1) + sum(v >> k); the optimum sits near log2(mean)
+   uint32_t mean = sum / n;
+   uint8_t estimate = 0;
+   while (estimate < SAMPLE_CODEC_MAX_RICE_K && (1u << (estimate + 1)) <= mean) {
+     estimate++;
+   }
+ 
+   uint8_t first = (estimate > 0) ? estimate - 1 : 0;
+   uint8_t last = (estimate < SAMPLE_CODEC_MAX_RICE_K) ? estimate + 1 : SAMPLE_CODEC_MAX_RICE_K;
+   for (uint8_t k = first; k <= last; k++) {
+     uint32_t cost = (uint32_t)n * (k + 1);
+     for (size_t i = 0; i < n; i++) {
+       cost += values[i] >> k;
+     }
+     if (cost < bestCost) {
+       bestCost = cost;
+       bestMode = k;
+     }
+   }
+ 
+   *costBits = bestCost;
+   return bestMode;
+ }
+ 
+ size_t sampleCodecEncode(const uint16_t *samples, size_t count, uint8_t *out, size_t outSize) {
+   if (samples == NULL || out == NULL || count == 0) {
+     return 0;
+   }
+ 
+   BitWriter_t w = { out, outSize, 0, 0, 0, false };
+ 
+   uint16_t previous = samples[0] & 0x0FFF;
+   putBits(&w, previous, SAMPLE_CODEC_SAMPLE_BITS);
+ 
+   uint16_t values[SAMPLE_CODEC_PARTITION];
+   size_t index = 1;
+ 
+   while (index < count && !w.overflow) {
+     size_t n = count - index;
+     if (n > SAMPLE_CODEC_PARTITION) {
+       n = SAMPLE_CODEC_PARTITION;
+     }
+ 
+     for (size_t i = 0; i < n; i++) {
+       uint16_t sample = samples[index + i] & 0x0FFF;
+       values[i] = zigzag((int32_t)sample - (int32_t)previous);
+       previous = sample;
+     }
+ 
+     uint32_t costBits;
+     uint8_t mode = chooseMode(values, n, &costBits);
+     putBits(&w, mode, 4);
+ 
+     if (mode == SAMPLE_CODEC_MODE_VERBATIM) {
+       for (size_t i = 0; i < n; i++) {
+         putBits(&w, values[i], SAMPLE_CODEC_DELTA_BITS);
+       }
+     } else if (mode != SAMPLE_CODEC_MODE_ZERO_RUN) {
+       for (size_t i = 0; i < n; i++) {
+         putUnary(&w, values[i] >> mode);
+         if (mode > 0) {
+           putBits(&w, values[i], mode);
+         }
+       }
+     }
+ 
+     index += n;
+   }
+ 
+   return flushBits(&w);
+ }
+ 
+ bool sampleCodecDecode(const uint8_t *in, size_t len, uint16_t *samples, size_t count) {
+   if (in == NULL || samples == NULL || count == 0) {
+     return false;
+   }
+ 
+   BitReader_t r = { in, len, 0, 0, 0, false };
+ 
+   uint16_t previous = (uint16_t)getBits(&r, SAMPLE_CODEC_SAMPLE_BITS);
+   samples[0] = previous;
+   size_t index = 1;
+ 
+   while (index < count && !r.underflow) {
+     size_t n = count - index;
+     if (n > SAMPLE_CODEC_PARTITION) {
+       n = SAMPLE_CODEC_PARTITION;
+     }
+ 
+     uint8_t mode = (uint8_t)getBits(&r, 4);
+     if (mode > SAMPLE_CODEC_MAX_RICE_K &&
+         mode != SAMPLE_CODEC_MODE_VERBATIM && mode != SAMPLE_CODEC_MODE_ZERO_RUN) {
+       return false;
+     }
+ 
+     for (size_t i = 0; i < n; i++) {
+       uint32_t value = 0;
+       if (mode == SAMPLE_CODEC_MODE_VERBATIM) {
+         value = getBits(&r, SAMPLE_CODEC_DELTA_BITS);
+       } else if (mode != SAMPLE_CODEC_MODE_ZERO_RUN) {
+         value = getUnary(&r) << mode;
+         if (mode > 0) {
+           value |= getBits(&r, mode);
+         }
+       }
+ 
+       previous = (uint16_t)((previous + unzigzag(value)) & 0x0FFF);
+       samples[index + i] = previous;
+     }
+ 
+     index += n;
+   }
+ 
+   return !r.underflow;
+ }
\ No newline at end of file
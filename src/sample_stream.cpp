@@ -0,0 +1,260 @@
+/*
+ * Sample Stream Module Implementation
+ *
+ * The ADC consumer only retains the block and queues its descriptor; the
+ * writer task encodes straight from the shared pool and releases it.
+ * STATS frames are small and are encoded up front into a message buffer,
+ * with a marker in the same queue so frames leave in sequence order.
+ */
+ 
+ #include "sample_stream.h"
+ #include "adc_capture.h"
+ #include "freertos/task.h"
+ #include "freertos/message_buffer.h"
+ #include "freertos/queue.h"
+ #include "serial_command.h"
+ #include "simplified_debug.h"
+ #include <string.h>
+ 
+ static_assert(ADC_CAPTURE_BLOCK_SAMPLES <= SAMPLE_STREAM_MAX_SAMPLES,
+               "ADC blocks must fit in a single stream frame");
+ 
+ // Writer work item: a retained block to encode, or the next STATS frame
+ typedef struct {
+   bool isBlock;
+   uint32_t sequence;
+   AdcBlock_t block;
+ } SampleStreamItem_t;
+ 
+ // Static variables
+ static Print *streamPort = NULL;
+ static QueueHandle_t itemQueue = NULL;
+ static MessageBufferHandle_t streamBuffer = NULL;
+ static TaskHandle_t streamTaskHandle = NULL;
+ static volatile bool streamEnabled = false;
+ static volatile bool compressionEnabled = true;
+ 
+ // STATS encoder state (only touched from the ADC consumer task)
+ static uint8_t frameScratch[SAMPLE_STREAM_MAX_FRAME];
+ static uint8_t wireBuffer[SAMPLE_STREAM_MAX_WIRE];
+ static uint32_t nextSequence = 0;
+ 
+ // Statistics
+ static volatile uint32_t framesSent = 0;
+ static volatile uint32_t framesDropped = 0;
+ static volatile uint32_t bytesSent = 0;
+ static volatile uint32_t rawBytes = 0;
+ 
+ // ADC block consumer - hands the block to the writer task by reference
+ static void sampleStreamBlockConsumer(const AdcBlock_t *block, void *context) {
+   if (!streamEnabled) {
+     return;
+   }
+ 
+   // The sequence number is consumed either way, so the host can see the gap
+   SampleStreamItem_t item;
+   item.isBlock = true;
+   item.sequence = nextSequence++;
+   item.block = *block;
+ 
+   if (!retainAdcBlock(block)) {
+     framesDropped++;
+     return;
+   }
+   if (xQueueSend(itemQueue, &item, 0) != pdTRUE) {
+     releaseAdcBlock(block);
+     framesDropped++;
+   }
+ }
+ 
+ // Stream writer task - encodes queued blocks and drains frames to the port
+ static void sampleStreamTask(void *pvParameters) {
+   DEBUG_START_TASK("Sample Stream");
+ 
+   static uint8_t txScratch[SAMPLE_STREAM_MAX_FRAME];
+   static uint8_t txBuffer[SAMPLE_STREAM_MAX_WIRE];
+   SampleStreamItem_t item;
+ 
+   while (1) {
+     if (xQueueReceive(itemQueue, &item, portMAX_DELAY) != pdTRUE) {
+       continue;
+     }
+ 
+     size_t len;
+     if (item.isBlock) {
+       SampleStreamHeader_t header;
+       header.sequence = item.sequence;
+       header.sampleRateHz = item.block.sampleRateHz;
+       header.timestampUs = item.block.timestampUs;
+       header.firstSample = item.block.firstSample;
+ 
+       len = compressionEnabled
+         ? sampleStreamEncodeCompressed(&header, item.block.samples, item.block.count, txScratch, txBuffer)
+         : sampleStreamEncodeRaw16(&header, item.block.samples, item.block.count, txScratch, txBuffer);
+       releaseAdcBlock(&item.block);
+       rawBytes += (uint32_t)item.block.count * 2;
+     } else {
+       len = xMessageBufferReceive(streamBuffer, txBuffer, sizeof(txBuffer), 0);
+     }
+ 
+     if (len == 0) {
+       continue;
+     }
+ 
+     streamPort->write(txBuffer, len);
+     framesSent++;
+     bytesSent += len;
+   }
+ 
+   // Should never reach here
+   DEBUG_END_TASK("Sample Stream");
+   vTaskDelete(NULL);
+ }
+ 
+ bool initSampleStreamModule(Print &port) {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Sample Stream module");
+ 
+   streamPort = &port;
+ 
+   streamBuffer = xMessageBufferCreate(SAMPLE_STREAM_BUFFER_BYTES);
+   itemQueue = xQueueCreate(SAMPLE_STREAM_QUEUE_BLOCKS, sizeof(SampleStreamItem_t));
+   if (streamBuffer == NULL || itemQueue == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create sample stream buffers - out of memory");
+     if (streamBuffer != NULL) vMessageBufferDelete(streamBuffer);
+     if (itemQueue != NULL) vQueueDelete(itemQueue);
+     streamBuffer = NULL;
+     itemQueue = NULL;
+     return false;
+   }
+ 
+   if (!registerAdcBlockConsumer(sampleStreamBlockConsumer, NULL)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to register sample stream as ADC consumer");
+     vMessageBufferDelete(streamBuffer);
+     vQueueDelete(itemQueue);
+     streamBuffer = NULL;
+     itemQueue = NULL;
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Sample Stream module initialized successfully");
+   return true;
+ }
+ 
+ bool createSampleStreamTask() {
+   if (streamBuffer == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot create Sample Stream task - module not initialized");
+     return false;
+   }
+ 
+   // Don't create if already running
+   if (streamTaskHandle != NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN, "Sample Stream task already running");
+     return true;
+   }
+ 
+   BaseType_t result = xTaskCreate(
+     sampleStreamTask,
+     "Sample Stream",
+     4096,
+     NULL,
+     2,  // Lower priority - never competes with the capture path
+     &streamTaskHandle
+   );
+ 
+   if (result != pdPASS) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create Sample Stream task - error code: %d", result);
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Sample Stream task created successfully");
+   return true;
+ }
+ 
+ void setSampleStreamEnabled(bool enable) {
+   streamEnabled = enable;
+ }
+ 
+ void setSampleStreamCompression(bool enable) {
+   compressionEnabled = enable;
+ }
+ 
+ bool sampleStreamSendStats(const AdcStatsSummary_t *summary, uint32_t timestampUs,
+                            uint64_t firstSample, uint32_t sampleRateHz) {
+   if (streamBuffer == NULL || summary == NULL) {
+     return false;
+   }
+ 
+   SampleStreamHeader_t header;
+   header.sequence = nextSequence++;
+   header.sampleRateHz = sampleRateHz;
+   header.timestampUs = timestampUs;
+   header.firstSample = firstSample;
+ 
+   size_t wireLen = sampleStreamEncodeStats(&header, summary, frameScratch, wireBuffer);
+   if (wireLen == 0) {
+     return false;
+   }
+ 
+   // This task is the only sender, so free space checked now is still there
+   if (uxQueueSpacesAvailable(itemQueue) == 0 ||
+       xMessageBufferSpaceAvailable(streamBuffer) < wireLen + sizeof(size_t)) {
+     framesDropped++;
+     return false;
+   }
+ 
+   SampleStreamItem_t item;
+   item.isBlock = false;
+   item.sequence = header.sequence;
+   xMessageBufferSend(streamBuffer, wireBuffer, wireLen, 0);
+   xQueueSend(itemQueue, &item, 0);
+   return true;
+ }
+ 
+ bool getSampleStreamStats(SampleStreamStats_t *stats) {
+   if (stats == NULL) {
+     return false;
+   }
+ 
+   stats->enabled = streamEnabled;
+   stats->framesSent = framesSent;
+   stats->framesDropped = framesDropped;
+   stats->bytesSent = bytesSent;
+   stats->rawBytes = rawBytes;
+   return true;
+ }
+ 
+ // stream on [compress=0|1] | off | status
+ static bool streamCommand(int argc, char *argv[], Print &out) {
+   if (argc < 1) {
+     return false;
+   }
+ 
+   if (streamPort == NULL) {
+     out.printf("ERR stream not initialized\r\n");
+     return true;
+   }
+ 
+   if (strcmp(argv[0], "on") == 0) {
+     uint32_t compress = compressionEnabled ? 1 : 0;
+     if (!serialCommandNumber(argc, argv, "compress", &compress) || compress > 1) {
+       return false;
+     }
+     compressionEnabled = (compress != 0);
+     streamEnabled = true;
+   } else if (strcmp(argv[0], "off") == 0) {
+     streamEnabled = false;
+   } else if (strcmp(argv[0], "status") != 0) {
+     return false;
+   }
+ 
+   out.printf("OK stream %s compress=%u frames=%lu dropped=%lu bytes=%lu raw=%lu\r\n",
+              streamEnabled ? "on" : "off", compressionEnabled ? 1 : 0, framesSent, framesDropped,
+              bytesSent, rawBytes);
+   return true;
+ }
+ 
+ bool registerSampleStreamCommands() {
+   return registerSerialCommand("stream",
+     "stream on [compress=0|1] | off | status (binary frames on this port)",
+     streamCommand);
+ }
\ No newline at end of file
@@ -0,0 +1,304 @@
+/*
+ * Sample Stream Format Implementation
+ */
+ 
+ #include "sample_stream_format.h"
+ #include "sample_codec.h"
+ #include <string.h>
+ 
+ // Little-endian field helpers
+ static void putU16(uint8_t *p, uint16_t v) {
+   p[0] = (uint8_t)v;
+   p[1] = (uint8_t)(v >> 8);
+ }
+ 
+ static void putU32(uint8_t *p, uint32_t v) {
+   putU16(p, (uint16_t)v);
+   putU16(p + 2, (uint16_t)(v >> 16));
+ }
+ 
+ static void putU64(uint8_t *p, uint64_t v) {
+   putU32(p, (uint32_t)v);
+   putU32(p + 4, (uint32_t)(v >> 32));
+ }
+ 
+ static uint16_t getU16(const uint8_t *p) {
+   return (uint16_t)(p[0] | (p[1] << 8));
+ }
+ 
+ static uint32_t getU32(const uint8_t *p) {
+   return getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+ }
+ 
+ static uint64_t getU64(const uint8_t *p) {
+   return getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+ }
+ 
+ uint16_t sampleStreamCrc16(const uint8_t *data, size_t len) {
+   uint16_t crc = 0xFFFF;
+ 
+   for (size_t i = 0; i < len; i++) {
+     crc ^= (uint16_t)data[i] << 8;
+     for (int bit = 0; bit < 8; bit++) {
+       crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+     }
+   }
+ 
+   return crc;
+ }
+ 
+ size_t cobsEncode(const uint8_t *in, size_t len, uint8_t *out) {
+   size_t codeIndex = 0;
+   size_t outIndex = 1;
+   uint8_t code = 1;
+ 
+   for (size_t i = 0; i < len; i++) {
+     if (in[i] == 0) {
+       out[codeIndex] = code;
+       codeIndex = outIndex++;
+       code = 1;
+     } else {
+       out[outIndex++] = in[i];
+       code++;
+       // A full 254-byte run closes its block without an implied zero
+       if (code == 0xFF) {
+         out[codeIndex] = code;
+         codeIndex = outIndex++;
+         code = 1;
+       }
+     }
+   }
+ 
+   out[codeIndex] = code;
+   out[outIndex++] = SAMPLE_STREAM_DELIMITER;
+   return outIndex;
+ }
+ 
+ size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+   size_t inIndex = 0;
+   size_t outIndex = 0;
+ 
+   while (inIndex < len) {
+     uint8_t code = in[inIndex++];
+     if (code == 0 || inIndex + code - 1 > len) {
+       return 0;  // Zero byte inside a frame or truncated block
+     }
+ 
+     for (uint8_t i = 1; i < code; i++) {
+       out[outIndex++] = in[inIndex++];
+     }
+ 
+     // Every block except a full one or the last one stands for a zero byte
+     if (code != 0xFF && inIndex < len) {
+       out[outIndex++] = 0;
+     }
+   }
+ 
+   return outIndex;
+ }
+ 
+ size_t sampleStreamBuildFrame(const SampleStreamHeader_t *header,
+                               const uint8_t *payload, size_t payloadLen,
+                               uint8_t *out, size_t outSize) {
+   size_t total = SAMPLE_STREAM_HEADER_SIZE + payloadLen + SAMPLE_STREAM_CRC_SIZE;
+   if (header == NULL || out == NULL || total > outSize || payloadLen > SAMPLE_STREAM_MAX_PAYLOAD) {
+     return 0;
+   }
+ 
+   out[0] = header->version;
+   out[1] = header->type;
+   putU16(&out[2], header->sampleCount);
+   putU32(&out[4], header->sequence);
+   putU32(&out[8], header->sampleRateHz);
+   putU32(&out[12], header->timestampUs);
+   putU64(&out[16], header->firstSample);
+ 
+   if (payloadLen > 0) {
+     memcpy(&out[SAMPLE_STREAM_HEADER_SIZE], payload, payloadLen);
+   }
+ 
+   uint16_t crc = sampleStreamCrc16(out, SAMPLE_STREAM_HEADER_SIZE + payloadLen);
+   putU16(&out[SAMPLE_STREAM_HEADER_SIZE + payloadLen], crc);
+   return total;
+ }
+ 
+ size_t sampleStreamEncodeRaw16(SampleStreamHeader_t *header,
+                                const uint16_t *samples, uint16_t count,
+                                uint8_t *scratch, uint8_t *out) {
+   if (header == NULL || samples == NULL || count > SAMPLE_STREAM_MAX_SAMPLES) {
+     return 0;
+   }
+ 
+   header->version = SAMPLE_STREAM_VERSION;
+   header->type = SAMPLE_STREAM_TYPE_RAW16;
+   header->sampleCount = count;
+ 
+   // Serialize the samples straight into the payload area of the scratch frame
+   uint8_t *payload = &scratch[SAMPLE_STREAM_HEADER_SIZE];
+   for (uint16_t i = 0; i < count; i++) {
+     putU16(&payload[i * 2], samples[i]);
+   }
+ 
+   size_t frameLen = sampleStreamBuildFrame(header, payload, (size_t)count * 2,
+                                            scratch, SAMPLE_STREAM_MAX_FRAME);
+   if (frameLen == 0) {
+     return 0;
+   }
+ 
+   // Leading delimiter terminates anything else written to the port in between
+   out[0] = SAMPLE_STREAM_DELIMITER;
+   return 1 + cobsEncode(scratch, frameLen, &out[1]);
+ }
+ 
+ size_t sampleStreamEncodeCompressed(SampleStreamHeader_t *header,
+                                     const uint16_t *samples, uint16_t count,
+                                     uint8_t *scratch, uint8_t *out) {
+   if (header == NULL || samples == NULL || count == 0 || count > SAMPLE_STREAM_MAX_SAMPLES) {
+     return 0;
+   }
+ 
+   // Only accept the compressed form if it beats the raw payload
+   uint8_t *payload = &scratch[SAMPLE_STREAM_HEADER_SIZE];
+   size_t payloadLen = sampleCodecEncode(samples, count, payload, (size_t)count * 2 - 1);
+   if (payloadLen == 0) {
+     return sampleStreamEncodeRaw16(header, samples, count, scratch, out);
+   }
+ 
+   header->version = SAMPLE_STREAM_VERSION;
+   header->type = SAMPLE_STREAM_TYPE_RICE12;
+   header->sampleCount = count;
+ 
+   size_t frameLen = sampleStreamBuildFrame(header, payload, payloadLen,
+                                            scratch, SAMPLE_STREAM_MAX_FRAME);
+   if (frameLen == 0) {
+     return 0;
+   }
+ 
+   out[0] = SAMPLE_STREAM_DELIMITER;
+   return 1 + cobsEncode(scratch, frameLen, &out[1]);
+ }
+ 
+ size_t sampleStreamEncodeStats(SampleStreamHeader_t *header, const AdcStatsSummary_t *summary,
+                                uint8_t *scratch, uint8_t *out) {
+   if (header == NULL || summary == NULL) {
+     return 0;
+   }
+ 
+   header->version = SAMPLE_STREAM_VERSION;
+   header->type = SAMPLE_STREAM_TYPE_STATS;
+   header->sampleCount = 0;
+ 
+   uint8_t *payload = &scratch[SAMPLE_STREAM_HEADER_SIZE];
+   putU32(&payload[0], summary->sampleCount);
+   putU16(&payload[4], summary->min);
+   putU16(&payload[6], summary->max);
+   putU16(&payload[8], summary->peakToPeak);
+   putU16(&payload[10], summary->meanQ4);
+   putU16(&payload[12], summary->rmsQ4);
+   putU16(&payload[14], summary->acRmsQ4);
+   for (int bin = 0; bin < ADC_STATS_HISTOGRAM_BINS; bin++) {
+     putU32(&payload[16 + bin * 4], summary->histogram[bin]);
+   }
+ 
+   size_t frameLen = sampleStreamBuildFrame(header, payload, SAMPLE_STREAM_STATS_PAYLOAD,
+                                            scratch, SAMPLE_STREAM_MAX_FRAME);
+   if (frameLen == 0) {
+     return 0;
+   }
+ 
+   out[0] = SAMPLE_STREAM_DELIMITER;
+   return 1 + cobsEncode(scratch, frameLen, &out[1]);
+ }
+ 
+ bool sampleStreamParseStats(const uint8_t *payload, size_t len, AdcStatsSummary_t *summary) {
+   if (payload == NULL || summary == NULL || len != SAMPLE_STREAM_STATS_PAYLOAD) {
+     return false;
+   }
+ 
+   summary->sampleCount = getU32(&payload[0]);
+   summary->min = getU16(&payload[4]);
+   summary->max = getU16(&payload[6]);
+   summary->peakToPeak = getU16(&payload[8]);
+   summary->meanQ4 = getU16(&payload[10]);
+   summary->rmsQ4 = getU16(&payload[12]);
+   summary->acRmsQ4 = getU16(&payload[14]);
+   for (int bin = 0; bin < ADC_STATS_HISTOGRAM_BINS; bin++) {
+     summary->histogram[bin] = getU32(&payload[16 + bin * 4]);
+   }
+   return true;
+ }
+ 
+ bool sampleStreamParseFrame(const uint8_t *frame, size_t len, SampleStreamHeader_t *header,
+                             const uint8_t **payload, size_t *payloadLen) {
+   if (frame == NULL || header == NULL || len < SAMPLE_STREAM_HEADER_SIZE + SAMPLE_STREAM_CRC_SIZE) {
+     return false;
+   }
+ 
+   size_t bodyLen = len - SAMPLE_STREAM_CRC_SIZE;
+   if (sampleStreamCrc16(frame, bodyLen) != getU16(&frame[bodyLen])) {
+     return false;
+   }
+ 
+   header->version = frame[0];
+   header->type = frame[1];
+   header->sampleCount = getU16(&frame[2]);
+   header->sequence = getU32(&frame[4]);
+   header->sampleRateHz = getU32(&frame[8]);
+   header->timestampUs = getU32(&frame[12]);
+   header->firstSample = getU64(&frame[16]);
+ 
+   if (header->version != SAMPLE_STREAM_VERSION || header->sampleCount > SAMPLE_STREAM_MAX_SAMPLES) {
+     return false;
+   }
+ 
+   if (payload != NULL) {
+     *payload = &frame[SAMPLE_STREAM_HEADER_SIZE];
+   }
+   if (payloadLen != NULL) {
+     *payloadLen = bodyLen - SAMPLE_STREAM_HEADER_SIZE;
+   }
+   return true;
+ }
+ 
+ SampleStreamDecoder::SampleStreamDecoder()
+   : _encodedLen(0), _overflow(false), _payload(NULL), _payloadLen(0),
+     _haveSequence(false), _nextSequence(0),
+     _framesDecoded(0), _framesRejected(0), _framesLost(0) {
+   memset(&_header, 0, sizeof(_header));
+ }
+ 
+ bool SampleStreamDecoder::feed(uint8_t byte) {
+   if (byte != SAMPLE_STREAM_DELIMITER) {
+     if (_encodedLen < sizeof(_encoded)) {
+       _encoded[_encodedLen++] = byte;
+     } else {
+       _overflow = true;
+     }
+     return false;
+   }
+ 
+   // Delimiter - try to decode what we collected
+   size_t encodedLen = _encodedLen;
+   bool overflow = _overflow;
+   _encodedLen = 0;
+   _overflow = false;
+ 
+   if (encodedLen == 0) {
+     return false;
+   }
+ 
+   size_t decodedLen = overflow ? 0 : cobsDecode(_encoded, encodedLen, _decoded);
+   if (decodedLen == 0 ||
+       !sampleStreamParseFrame(_decoded, decodedLen, &_header, &_payload, &_payloadLen)) {
+     _framesRejected++;
+     return false;
+   }
+ 
+   if (_haveSequence && _header.sequence != _nextSequence) {
+     _framesLost += _header.sequence - _nextSequence;
+   }
+   _haveSequence = true;
+   _nextSequence = _header.sequence + 1;
+   _framesDecoded++;
+   return true;
+ }
\ No newline at end of file
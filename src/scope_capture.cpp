@@ -0,0 +1,330 @@
+/*
+ * Scope Capture Module Implementation
+ *
+ * The trigger state machine only runs in the ADC consumer task. Requests
+ * from other tasks and external events from ISRs are handed over through
+ * a few spinlock-protected fields and applied at the next block.
+ *
+ * With a large enough block pool the trigger runs without storage and the
+ * history is the list of shared blocks the scope still holds references
+ * to, so nothing is copied until readScopeCapture(). Otherwise the trigger
+ * copies into its own internal history buffer.
+ */
+ 
+ #include "scope_capture.h"
+ #include "adc_capture.h"
+ #include "freertos/queue.h"
+ #include "simplified_debug.h"
+ 
+ // Static variables
+ static AdcTrigger scopeTrigger;
+ static uint16_t *historyStorage = NULL;
+ static bool scopeInitialized = false;
+ static bool holdBlocks = false;
+ 
+ // Blocks held as history, oldest first (only touched from the consumer task
+ // while collecting, frozen once the window is complete)
+ static AdcBlock_t heldBlocks[SCOPE_CAPTURE_HELD_BLOCKS];
+ static uint8_t heldFirst = 0;
+ static uint8_t heldCount = 0;
+ static QueueHandle_t scopeResultQueue = NULL;
+ static portMUX_TYPE scopeMux = portMUX_INITIALIZER_UNLOCKED;
+ 
+ // Requests handed to the consumer task (protected by scopeMux)
+ static ScopeCaptureConfig_t pendingConfig;
+ static bool configPending = false;
+ static bool armPending = false;
+ static bool disarmPending = false;
+ 
+ // External event hand-over (protected by scopeMux)
+ static volatile uint8_t eventMask = 0;
+ static volatile bool scopeArmed = false;
+ static bool eventPending = false;
+ static uint8_t eventSource = 0;
+ static uint32_t eventTimeUs = 0;
+ 
+ // Completion notification (protected by scopeMux)
+ static TaskHandle_t notifyTask = NULL;
+ static uint32_t notifyBits = 0;
+ 
+ // Consumer task state
+ static uint8_t activeEvents = 0;
+ static uint8_t firedSource = 0;
+ static uint32_t captureNumber = 0;
+ 
+ static void releaseOldestHeld() {
+   releaseAdcBlock(&heldBlocks[heldFirst]);
+   heldFirst = (heldFirst + 1) % SCOPE_CAPTURE_HELD_BLOCKS;
+   heldCount--;
+ }
+ 
+ static void releaseAllHeld() {
+   while (heldCount > 0) {
+     releaseOldestHeld();
+   }
+   heldFirst = 0;
+ }
+ 
+ // Keep a reference to the block and drop blocks the trigger no longer needs
+ static void holdBlock(const AdcBlock_t *block) {
+   if (heldCount == SCOPE_CAPTURE_HELD_BLOCKS) {
+     releaseOldestHeld();
+   }
+   if (retainAdcBlock(block)) {
+     heldBlocks[(heldFirst + heldCount) % SCOPE_CAPTURE_HELD_BLOCKS] = *block;
+     heldCount++;
+   }
+ 
+   uint64_t oldest = scopeTrigger.historyStart();
+   while (heldCount > 0 &&
+          heldBlocks[heldFirst].firstSample + heldBlocks[heldFirst].count <= oldest) {
+     releaseOldestHeld();
+   }
+ }
+ 
+ // ADC block consumer - runs the trigger over every sample of the block
+ static void scopeBlockConsumer(const AdcBlock_t *block, void *context) {
+   ScopeCaptureConfig_t config;
+   bool applyConfig, applyArm, applyDisarm, haveEvent;
+   uint8_t source = 0;
+   uint32_t timeUs = 0;
+ 
+   portENTER_CRITICAL(&scopeMux);
+   applyConfig = configPending;
+   if (applyConfig) {
+     config = pendingConfig;
+   }
+   applyArm = armPending;
+   applyDisarm = disarmPending;
+   configPending = armPending = disarmPending = false;
+   haveEvent = eventPending;
+   source = eventSource;
+   timeUs = eventTimeUs;
+   eventPending = false;
+   portEXIT_CRITICAL(&scopeMux);
+ 
+   if (applyConfig) {
+     scopeTrigger.configure(&config.trigger);
+     activeEvents = config.externalEvents;
+   }
+   if (applyDisarm) {
+     scopeTrigger.disarm();
+   }
+   if (applyArm) {
+     scopeTrigger.arm();
+     firedSource = 0;
+     haveEvent = false;  // Events from before arming do not count
+   }
+   if (holdBlocks && (applyConfig || applyDisarm || applyArm)) {
+     releaseAllHeld();
+   }
+ 
+   AdcTriggerState_t state = scopeTrigger.state();
+   if (state == TRIGGER_STATE_IDLE || state == TRIGGER_STATE_DONE) {
+     return;
+   }
+ 
+   // Map the event time onto the sample clock of this block
+   if (haveEvent && block->sampleRateHz != 0) {
+     int64_t offsetUs = (int32_t)(timeUs - block->timestampUs);
+     int64_t index = (int64_t)block->firstSample + (offsetUs * block->sampleRateHz) / 1000000;
+     if (index < 0) {
+       index = 0;
+     }
+     scopeTrigger.externalEvent((uint64_t)index);
+     if (firedSource == 0) {
+       firedSource = source;
+     }
+   }
+ 
+   bool complete = scopeTrigger.processBlock(block->samples, block->count, block->firstSample);
+ 
+   if (holdBlocks) {
+     // A gap or a restarted run makes the held blocks useless
+     if (heldCount > 0) {
+       const AdcBlock_t *last = &heldBlocks[(heldFirst + heldCount - 1) % SCOPE_CAPTURE_HELD_BLOCKS];
+       if (last->firstSample + last->count != block->firstSample) {
+         releaseAllHeld();
+       }
+     }
+     holdBlock(block);
+   }
+ 
+   if (!complete) {
+     return;
+   }
+ 
+   scopeArmed = false;
+ 
+   ScopeCaptureInfo_t info;
+   scopeTrigger.getWindow(&info.window);
+   int64_t triggerOffset = (int64_t)(info.window.triggerSample - block->firstSample);
+   info.triggerTimeUs = block->timestampUs +
+     (uint32_t)((triggerOffset * 1000000) / (int64_t)block->sampleRateHz);
+   info.sampleRateHz = block->sampleRateHz;
+   info.eventSource = info.window.external ? firedSource : 0;
+   info.captureNumber = ++captureNumber;
+ 
+   xQueueOverwrite(scopeResultQueue, &info);
+ 
+   portENTER_CRITICAL(&scopeMux);
+   TaskHandle_t task = notifyTask;
+   uint32_t bits = notifyBits;
+   portEXIT_CRITICAL(&scopeMux);
+   if (task != NULL) {
+     xTaskNotify(task, bits, eSetBits);
+   }
+ }
+ 
+ bool initScopeCaptureModule() {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Scope Capture module");
+ 
+   // Hold shared blocks as history if the pool can spare them, else copy
+   holdBlocks = getAdcBlockPoolSize() >= 4 * SCOPE_CAPTURE_HELD_BLOCKS;
+   if (!holdBlocks) {
+     historyStorage = (uint16_t *)heap_caps_malloc(SCOPE_CAPTURE_MAX_SAMPLES * sizeof(uint16_t),
+                                                   MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+     if (historyStorage == NULL) {
+       DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to allocate scope history - out of memory");
+       return false;
+     }
+   }
+   scopeTrigger.begin(historyStorage, SCOPE_CAPTURE_MAX_SAMPLES);
+ 
+   ScopeCaptureConfig_t config;
+   config.trigger.source = TRIGGER_SOURCE_LEVEL;
+   config.trigger.slope = TRIGGER_SLOPE_RISING;
+   config.trigger.level = SCOPE_DEFAULT_LEVEL;
+   config.trigger.hysteresis = SCOPE_DEFAULT_HYSTERESIS;
+   config.trigger.preSamples = SCOPE_DEFAULT_PRE_SAMPLES;
+   config.trigger.postSamples = SCOPE_DEFAULT_POST_SAMPLES;
+   config.trigger.holdoffSamples = 0;
+   config.externalEvents = 0;
+   scopeTrigger.configure(&config.trigger);
+ 
+   scopeResultQueue = xQueueCreate(1, sizeof(ScopeCaptureInfo_t));
+   if (scopeResultQueue == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create scope result queue - out of memory");
+     heap_caps_free(historyStorage);
+     historyStorage = NULL;
+     return false;
+   }
+ 
+   if (!registerAdcBlockConsumer(scopeBlockConsumer, NULL)) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to register scope as ADC consumer");
+     vQueueDelete(scopeResultQueue);
+     scopeResultQueue = NULL;
+     heap_caps_free(historyStorage);
+     historyStorage = NULL;
+     return false;
+   }
+ 
+   scopeInitialized = true;
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Scope Capture module initialized successfully (%s history)",
+               holdBlocks ? "shared block" : "copied");
+   return true;
+ }
+ 
+ bool configureScopeCapture(const ScopeCaptureConfig_t *config) {
+   if (!scopeInitialized || config == NULL || config->trigger.postSamples == 0 ||
+       (uint64_t)config->trigger.preSamples + config->trigger.postSamples > SCOPE_CAPTURE_MAX_SAMPLES) {
+     return false;
+   }
+ 
+   portENTER_CRITICAL(&scopeMux);
+   pendingConfig = *config;
+   configPending = true;
+   armPending = false;
+   eventMask = config->externalEvents;
+   scopeArmed = false;
+   portEXIT_CRITICAL(&scopeMux);
+   return true;
+ }
+ 
+ bool armScopeCapture() {
+   if (!scopeInitialized) {
+     return false;
+   }
+ 
+   xQueueReset(scopeResultQueue);
+ 
+   portENTER_CRITICAL(&scopeMux);
+   armPending = true;
+   disarmPending = false;
+   eventPending = false;
+   scopeArmed = true;
+   portEXIT_CRITICAL(&scopeMux);
+   return true;
+ }
+ 
+ void disarmScopeCapture() {
+   portENTER_CRITICAL(&scopeMux);
+   disarmPending = true;
+   armPending = false;
+   scopeArmed = false;
+   portEXIT_CRITICAL(&scopeMux);
+ }
+ 
+ void IRAM_ATTR scopeExternalEvent(uint8_t source, uint32_t timeUs) {
+   // Cheap early out - this sits in the pulse edge ISR
+   if (!scopeArmed || (eventMask & source) == 0) {
+     return;
+   }
+ 
+   portENTER_CRITICAL_SAFE(&scopeMux);
+   if (!eventPending) {
+     eventPending = true;
+     eventSource = source;
+     eventTimeUs = timeUs;
+   }
+   portEXIT_CRITICAL_SAFE(&scopeMux);
+ }
+ 
+ bool waitForScopeCapture(ScopeCaptureInfo_t *info, TickType_t timeout) {
+   if (scopeResultQueue == NULL || info == NULL) {
+     return false;
+   }
+ 
+   return xQueueReceive(scopeResultQueue, info, timeout) == pdTRUE;
+ }
+ 
+ void setScopeCaptureNotify(TaskHandle_t task, uint32_t bits) {
+   portENTER_CRITICAL(&scopeMux);
+   notifyTask = task;
+   notifyBits = bits;
+   portEXIT_CRITICAL(&scopeMux);
+ }
+ 
+ uint32_t readScopeCapture(uint16_t *out, uint32_t maxSamples) {
+   if (!scopeInitialized || out == NULL) {
+     return 0;
+   }
+ 
+   // Once DONE the consumer leaves the history alone until the next arm
+   if (!holdBlocks) {
+     return scopeTrigger.readWindow(out, maxSamples, NULL);
+   }
+ 
+   AdcTriggerWindow_t window;
+   if (!scopeTrigger.getWindow(&window)) {
+     return 0;
+   }
+ 
+   // Gather the window from the held blocks
+   uint64_t next = window.firstSample;
+   uint64_t end = window.firstSample + ((window.count < maxSamples) ? window.count : maxSamples);
+   uint32_t copied = 0;
+   for (uint8_t i = 0; i < heldCount && next < end; i++) {
+     const AdcBlock_t *block = &heldBlocks[(heldFirst + i) % SCOPE_CAPTURE_HELD_BLOCKS];
+     uint64_t blockEnd = block->firstSample + block->count;
+     if (blockEnd <= next || block->firstSample > next) {
+       continue;
+     }
+     uint32_t offset = (uint32_t)(next - block->firstSample);
+     uint32_t n = (uint32_t)(((blockEnd < end) ? blockEnd : end) - next);
+     memcpy(&out[copied], &block->samples[offset], n * sizeof(uint16_t));
+     copied += n;
+     next += n;
+   }
+   return copied;
+ }
\ No newline at end of file
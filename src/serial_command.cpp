@@ -0,0 +1,213 @@
+/*
+ * Serial Command Module Implementation
+ *
+ * The task reads whatever input is available, splits complete lines into
+ * words in place and calls the matching handler. Each reply is written with
+ * a single printf so it cannot be split by the stream writer's frames.
+ */
+ 
+ #include "serial_command.h"
+ #include <ctype.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "simplified_debug.h"
+ 
+ // Registered command
+ typedef struct {
+   const char *name;
+   const char *help;
+   SerialCommandHandler_t handler;
+   SerialCommandEvent_t onEvent;
+ } SerialCommand_t;
+ 
+ // Static variables
+ static Stream *commandPort = NULL;
+ static TaskHandle_t commandTaskHandle = NULL;
+ static SerialCommand_t commands[SERIAL_COMMAND_MAX_COMMANDS];
+ static uint8_t commandCount = 0;
+ 
+ // Line assembly (only touched from the command task)
+ static char lineBuffer[SERIAL_COMMAND_LINE_LENGTH];
+ static uint16_t lineLength = 0;
+ static bool lineOverflow = false;
+ 
+ static bool helpCommand(int argc, char *argv[], Print &out) {
+   for (uint8_t i = 0; i < commandCount; i++) {
+     out.printf("OK %s\r\n", commands[i].help);
+   }
+   return true;
+ }
+ 
+ // Split the line into words and run the command
+ static void executeLine(char *line) {
+   char *words[SERIAL_COMMAND_MAX_ARGS + 1];
+   int count = 0;
+ 
+   char *p = line;
+   while (*p != '\0') {
+     while (*p != '\0' && isspace((unsigned char)*p)) {
+       *p++ = '\0';
+     }
+     if (*p == '\0') {
+       break;
+     }
+     if (count == SERIAL_COMMAND_MAX_ARGS + 1) {
+       commandPort->printf("ERR too many arguments\r\n");
+       return;
+     }
+     words[count++] = p;
+     while (*p != '\0' && !isspace((unsigned char)*p)) {
+       p++;
+     }
+   }
+ 
+   if (count == 0) {
+     return;
+   }
+ 
+   for (uint8_t i = 0; i < commandCount; i++) {
+     if (strcmp(words[0], commands[i].name) == 0) {
+       if (!commands[i].handler(count - 1, &words[1], *commandPort)) {
+         commandPort->printf("ERR usage: %s\r\n", commands[i].help);
+       }
+       return;
+     }
+   }
+ 
+   commandPort->printf("ERR unknown command '%s' (try help)\r\n", words[0]);
+ }
+ 
+ // Command task - assembles lines and prints command events
+ static void serialCommandTask(void *pvParameters) {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Serial Command task started");
+ 
+   while (1) {
+     uint32_t events = 0;
+     xTaskNotifyWait(0, 0xFFFFFFFF, &events, pdMS_TO_TICKS(SERIAL_COMMAND_POLL_MS));
+ 
+     for (uint8_t i = 0; i < commandCount; i++) {
+       if ((events & (1UL << i)) != 0 && commands[i].onEvent != NULL) {
+         commands[i].onEvent(*commandPort);
+       }
+     }
+ 
+     while (commandPort->available() > 0) {
+       int c = commandPort->read();
+       if (c < 0) {
+         break;
+       }
+ 
+       if (c == '\r' || c == '\n') {
+         if (lineOverflow) {
+           commandPort->printf("ERR line too long\r\n");
+         } else if (lineLength > 0) {
+           lineBuffer[lineLength] = '\0';
+           executeLine(lineBuffer);
+         }
+         lineLength = 0;
+         lineOverflow = false;
+       } else if (lineLength < SERIAL_COMMAND_LINE_LENGTH - 1) {
+         lineBuffer[lineLength++] = (char)c;
+       } else {
+         lineOverflow = true;
+       }
+     }
+   }
+ }
+ 
+ bool initSerialCommandModule(Stream &port) {
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Initializing Serial Command module");
+ 
+   commandPort = &port;
+   commandCount = 0;
+   lineLength = 0;
+   lineOverflow = false;
+ 
+   if (!registerSerialCommand("help", "help", helpCommand)) {
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Serial Command module initialized successfully");
+   return true;
+ }
+ 
+ bool registerSerialCommand(const char *name, const char *help, SerialCommandHandler_t handler,
+                            SerialCommandEvent_t onEvent, uint32_t *eventBit) {
+   if (commandPort == NULL || name == NULL || help == NULL || handler == NULL ||
+       commandTaskHandle != NULL) {
+     return false;
+   }
+ 
+   if (commandCount >= SERIAL_COMMAND_MAX_COMMANDS) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Too many serial commands (max %d)", SERIAL_COMMAND_MAX_COMMANDS);
+     return false;
+   }
+ 
+   commands[commandCount].name = name;
+   commands[commandCount].help = help;
+   commands[commandCount].handler = handler;
+   commands[commandCount].onEvent = onEvent;
+   if (eventBit != NULL) {
+     *eventBit = 1UL << commandCount;
+   }
+   commandCount++;
+   return true;
+ }
+ 
+ bool createSerialCommandTask() {
+   if (commandPort == NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Cannot create Serial Command task - module not initialized");
+     return false;
+   }
+ 
+   if (commandTaskHandle != NULL) {
+     DEBUG_PRINT(DEBUG_LEVEL_WARN, "Serial Command task already running");
+     return true;
+   }
+ 
+   BaseType_t result = xTaskCreate(
+     serialCommandTask,
+     "Serial Command Task",
+     SERIAL_COMMAND_TASK_STACK,
+     NULL,
+     SERIAL_COMMAND_TASK_PRIORITY,
+     &commandTaskHandle
+   );
+ 
+   if (result != pdPASS) {
+     DEBUG_PRINT(DEBUG_LEVEL_ERROR, "Failed to create Serial Command task - error code: %d", result);
+     return false;
+   }
+ 
+   DEBUG_PRINT(DEBUG_LEVEL_INFO, "Serial Command task created successfully");
+   return true;
+ }
+ 
+ TaskHandle_t getSerialCommandTask() {
+   return commandTaskHandle;
+ }
+ 
+ const char *serialCommandValue(int argc, char *argv[], const char *key) {
+   size_t keyLength = strlen(key);
+   for (int i = 0; i < argc; i++) {
+     if (strncmp(argv[i], key, keyLength) == 0 && argv[i][keyLength] == '=') {
+       return &argv[i][keyLength + 1];
+     }
+   }
+   return NULL;
+ }
+ 
+ bool serialCommandNumber(int argc, char *argv[], const char *key, uint32_t *value) {
+   const char *text = serialCommandValue(argc, argv, key);
+   if (text == NULL) {
+     return true;
+   }
+ 
+   char *end = NULL;
+   unsigned long parsed = strtoul(text, &end, 0);
+   if (end == text || *end != '\0') {
+     return false;
+   }
+   *value = (uint32_t)parsed;
+   return true;
+ }
\ No newline at end of file
@@ -6,27 +6,24 @@
  #include "simplified_debug.h"
  #include <stdio.h>
  #include <stdarg.h>
- 
- // Start time for uptime calculation
- static unsigned long startTimeMs = 0;
+ #include "monotonic_time.h"
  
  void debugInit() {
-     startTimeMs = millis();
      Serial.println("\n--- DEBUG INITIALIZED ---");
      debugHeapInfo();
  }
  
  void debugPrint(int level, const char* fmt, ...) {
-     // Get current uptime
-     unsigned long uptimeMs = millis() - startTimeMs;
-     unsigned long seconds = uptimeMs / 1000;
+     // Time since boot on the clock of the event timestamps, to the microsecond
+     uint64_t uptimeUs = monotonicUs();
+     unsigned long seconds = (unsigned long)(uptimeUs / 1000000);
      unsigned long minutes = seconds / 60;
      unsigned long hours = minutes / 60;
      
      // Format timestamp
-     char timestamp[20];
-     sprintf(timestamp, "[%02lu:%02lu:%02lu.%03lu] ", 
-             hours, minutes % 60, seconds % 60, uptimeMs % 1000);
+     char timestamp[28];
+     sprintf(timestamp, "[%02lu:%02lu:%02lu.%06lu] ", 
+             hours, minutes % 60, seconds % 60, (unsigned long)(uptimeUs % 1000000));
      
      // Level prefix
      const char* levelPrefix;
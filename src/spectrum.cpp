@@ -0,0 +1,407 @@
+/*
+ * Spectrum Analysis Implementation
+ */
+ 
+ #include "spectrum.h"
+ #include <math.h>
+ #include <string.h>
+ 
+ // Mid-scale of the 12-bit input, removed before the first block's mean is known
+ #define SPECTRUM_SAMPLE_OFFSET 2048.0f
+ 
+ static const float PI_F = 3.14159265358979f;
+ 
+ // Cosine-sum window coefficients
+ static const float WINDOW_HANN[] = {0.5f, 0.5f};
+ static const float WINDOW_BLACKMAN_HARRIS[] = {0.35875f, 0.48829f, 0.14128f, 0.01168f};
+ static const float WINDOW_FLATTOP[] = {0.21557895f, 0.41663158f, 0.277263158f, 0.083578947f, 0.006947368f};
+ 
+ const char *spectrumWindowName(SpectrumWindow_t window) {
+   switch (window) {
+     case SPECTRUM_WINDOW_RECT: return "rect";
+     case SPECTRUM_WINDOW_HANN: return "hann";
+     case SPECTRUM_WINDOW_BLACKMAN_HARRIS: return "blackman-harris";
+     case SPECTRUM_WINDOW_FLATTOP: return "flattop";
+   }
+   return "unknown";
+ }
+ 
+ // Normalized sinc, sin(pi x) / (pi x)
+ static float sinc(float x) {
+   if (fabsf(x) < 1e-6f) {
+     return 1.0f;
+   }
+   return sinf(PI_F * x) / (PI_F * x);
+ }
+ 
+ SpectrumAnalyzer::SpectrumAnalyzer()
+   : _size(0), _log2Half(0), _window(SPECTRUM_WINDOW_HANN), _scale(0.0f) {
+ }
+ 
+ bool SpectrumAnalyzer::begin(uint16_t size, SpectrumWindow_t window) {
+   if (size < SPECTRUM_MIN_FFT || size > SPECTRUM_MAX_FFT || (size & (size - 1)) != 0) {
+     return false;
+   }
+ 
+   const float *coeffs;
+   int terms;
+   switch (window) {
+     case SPECTRUM_WINDOW_RECT:            coeffs = NULL; terms = 0; break;
+     case SPECTRUM_WINDOW_HANN:            coeffs = WINDOW_HANN; terms = 2; break;
+     case SPECTRUM_WINDOW_BLACKMAN_HARRIS: coeffs = WINDOW_BLACKMAN_HARRIS; terms = 4; break;
+     case SPECTRUM_WINDOW_FLATTOP:         coeffs = WINDOW_FLATTOP; terms = 5; break;
+     default: return false;
+   }
+ 
+   _size = size;
+   _window = window;
+   _log2Half = 0;
+   while ((1u << (_log2Half + 1)) < size) {
+     _log2Half++;
+   }
+ 
+   for (uint32_t k = 0; k < size; k++) {
+     _cos[k] = (float)cos(2.0 * M_PI * k / size);
+   }
+ 
+   // Periodic (DFT-even) window; its sum is size * a0
+   for (uint32_t n = 0; n <= size / 2u; n++) {
+     if (terms == 0) {
+       _windowHalf[n] = 1.0f;
+       continue;
+     }
+     double w = 0.0;
+     for (int t = 0; t < terms; t++) {
+       double c = cos(2.0 * M_PI * t * n / size);
+       w += (t & 1) ? -coeffs[t] * c : coeffs[t] * c;
+     }
+     _windowHalf[n] = (float)w;
+   }
+   _scale = 2.0f / (size * (terms ? coeffs[0] : 1.0f));
+   return true;
+ }
+ 
+ // Decimation-in-frequency radix-4 stages with the middle two outputs of each
+ // butterfly swapped, which leaves the result in binary bit-reversed order
+ void IRAM_ATTR SpectrumAnalyzer::complexTransform(float *data) {
+   const uint32_t half = _size >> 1;
+   uint32_t length = half;
+ 
+   while (length >= 4) {
+     const uint32_t quarter = length >> 2;
+     const uint32_t step = _size / length;
+ 
+     for (uint32_t base = 0; base < half; base += length) {
+       for (uint32_t j = 0; j < quarter; j++) {
+         float *p0 = &data[2 * (base + j)];
+         float *p1 = p0 + 2 * quarter;
+         float *p2 = p1 + 2 * quarter;
+         float *p3 = p2 + 2 * quarter;
+ 
+         float t0r = p0[0] + p2[0], t0i = p0[1] + p2[1];
+         float t1r = p0[0] - p2[0], t1i = p0[1] - p2[1];
+         float t2r = p1[0] + p3[0], t2i = p1[1] + p3[1];
+         float t3r = p1[0] - p3[0], t3i = p1[1] - p3[1];
+ 
+         float y0r = t0r + t2r, y0i = t0i + t2i;
+         float y2r = t0r - t2r, y2i = t0i - t2i;
+         float y1r = t1r + t3i, y1i = t1i - t3r;   // t1 - i t3
+         float y3r = t1r - t3i, y3i = t1i + t3r;   // t1 + i t3
+ 
+         p0[0] = y0r;
+         p0[1] = y0i;
+         if (j == 0) {
+           p1[0] = y2r; p1[1] = y2i;
+           p2[0] = y1r; p2[1] = y1i;
+           p3[0] = y3r; p3[1] = y3i;
+           continue;
+         }
+ 
+         uint32_t k = j * step;
+         float c = twiddleCos(2 * k), s = twiddleSin(2 * k);
+         p1[0] = y2r * c + y2i * s;
+         p1[1] = y2i * c - y2r * s;
+         c = twiddleCos(k); s = twiddleSin(k);
+         p2[0] = y1r * c + y1i * s;
+         p2[1] = y1i * c - y1r * s;
+         c = twiddleCos(3 * k); s = twiddleSin(3 * k);
+         p3[0] = y3r * c + y3i * s;
+         p3[1] = y3i * c - y3r * s;
+       }
+     }
+     length = quarter;
+   }
+ 
+   // Odd log2: finish with a radix-2 stage
+   if (length == 2) {
+     for (uint32_t base = 0; base < half; base += 2) {
+       float *p0 = &data[2 * base];
+       float ar = p0[0], ai = p0[1];
+       p0[0] = ar + p0[2];
+       p0[1] = ai + p0[3];
+       p0[2] = ar - p0[2];
+       p0[3] = ai - p0[3];
+     }
+   }
+ 
+   // Bit-reversal permutation
+   for (uint32_t i = 0, j = 0; i < half; i++) {
+     if (i < j) {
+       float r = data[2 * i], m = data[2 * i + 1];
+       data[2 * i] = data[2 * j];
+       data[2 * i + 1] = data[2 * j + 1];
+       data[2 * j] = r;
+       data[2 * j + 1] = m;
+     }
+     uint32_t bit = half >> 1;
+     while (bit && (j & bit)) {
+       j ^= bit;
+       bit >>= 1;
+     }
+     j |= bit;
+   }
+ }
+ 
+ void IRAM_ATTR SpectrumAnalyzer::transform(float *data) {
+   const uint32_t half = _size >> 1;
+ 
+   // Even samples as the real part, odd samples as the imaginary part
+   complexTransform(data);
+ 
+   // Split into the spectrum of the real sequence:
+   // X[k] = E + W^k O and X[half-k] = conj(E - W^k O)
+   float z0r = data[0], z0i = data[1];
+   data[0] = z0r + z0i;
+   data[1] = 0.0f;
+   data[_size] = z0r - z0i;
+   data[_size + 1] = 0.0f;
+ 
+   for (uint32_t k = 1; k <= half / 2; k++) {
+     float *pk = &data[2 * k];
+     float *pm = &data[2 * (half - k)];
+     float er = 0.5f * (pk[0] + pm[0]), ei = 0.5f * (pk[1] - pm[1]);
+     float orr = 0.5f * (pk[1] + pm[1]), oi = -0.5f * (pk[0] - pm[0]);
+     float c = twiddleCos(k), s = twiddleSin(k);
+     float wr = orr * c + oi * s;
+     float wi = oi * c - orr * s;
+     pk[0] = er + wr;
+     pk[1] = ei + wi;
+     pm[0] = er - wr;
+     pm[1] = -(ei - wi);
+   }
+ }
+ 
+ void SpectrumAnalyzer::analyze(const uint16_t *samples, float *amplitude) {
+   const uint32_t half = _size >> 1;
+ 
+   int32_t sum = 0;
+   for (uint32_t n = 0; n < _size; n++) {
+     sum += samples[n];
+   }
+   // Mean in Q8 so the offset keeps sub-code precision
+   const float mean = (float)(((int64_t)sum << 8) / _size) / 256.0f;
+ 
+   for (uint32_t n = 0; n <= half; n++) {
+     _work[n] = ((float)samples[n] - mean) * _windowHalf[n];
+   }
+   for (uint32_t n = half + 1; n < _size; n++) {
+     _work[n] = ((float)samples[n] - mean) * _windowHalf[_size - n];
+   }
+ 
+   transform(_work);
+ 
+   for (uint32_t k = 0; k <= half; k++) {
+     float re = _work[2 * k], im = _work[2 * k + 1];
+     amplitude[k] = sqrtf(re * re + im * im) * _scale;
+   }
+   amplitude[0] *= 0.5f;
+   amplitude[half] *= 0.5f;
+ }
+ 
+ bool SpectrumAnalyzer::findPeak(const float *amplitude, float binHz, float minHz, float maxHz,
+                                 SpectrumPeak_t *peak) const {
+   if (peak == NULL || binHz <= 0.0f || _size == 0) {
+     return false;
+   }
+   peak->frequencyHz = 0.0f;
+   peak->amplitude = 0.0f;
+   peak->bin = 0;
+ 
+   // Only bins with both neighbours can be interpolated
+   int32_t first = (int32_t)ceilf(minHz / binHz);
+   int32_t last = (int32_t)floorf(maxHz / binHz);
+   if (first < 1) {
+     first = 1;
+   }
+   if (last > (int32_t)_size / 2 - 1) {
+     last = _size / 2 - 1;
+   }
+ 
+   int32_t best = -1;
+   for (int32_t k = first; k <= last; k++) {
+     if (amplitude[k] >= amplitude[k - 1] && amplitude[k] >= amplitude[k + 1] &&
+         (best < 0 || amplitude[k] > amplitude[best])) {
+       best = k;
+     }
+   }
+   if (best < 0 || amplitude[best] <= 0.0f) {
+     return false;
+   }
+ 
+   const float left = amplitude[best - 1], centre = amplitude[best], right = amplitude[best + 1];
+   float delta = 0.0f;
+   float level = centre;
+ 
+   switch (_window) {
+     case SPECTRUM_WINDOW_RECT:
+     case SPECTRUM_WINDOW_HANN: {
+       // Ratio of the larger neighbour to the peak bin fixes the offset exactly
+       // for a single tone (Grandke); the kernel shape then gives the amplitude
+       float side = (right > left) ? 1.0f : -1.0f;
+       float alpha = ((right > left) ? right : left) / centre;
+       if (_window == SPECTRUM_WINDOW_RECT) {
+         delta = side * alpha / (1.0f + alpha);
+         level = centre / fabsf(sinc(delta));
+       } else {
+         delta = side * (2.0f * alpha - 1.0f) / (alpha + 1.0f);
+         if (delta > 0.5f) delta = 0.5f;
+         if (delta < -0.5f) delta = -0.5f;
+         level = centre * (1.0f - delta * delta) / sinc(delta);
+       }
+       break;
+     }
+ 
+     default: {
+       // Gaussian fit on the log magnitudes
+       if (left > 0.0f && right > 0.0f) {
+         float la = logf(left), lb = logf(centre), lc = logf(right);
+         float denom = la - 2.0f * lb + lc;
+         if (denom < 0.0f) {
+           delta = 0.5f * (la - lc) / denom;
+           if (_window == SPECTRUM_WINDOW_BLACKMAN_HARRIS) {
+             level = expf(lb - 0.25f * (la - lc) * delta);
+           }
+         }
+       }
+       break;
+     }
+   }
+ 
+   peak->frequencyHz = (best + delta) * binHz;
+   peak->amplitude = level;
+   peak->bin = (uint16_t)best;
+   return true;
+ }
+ 
+ GoertzelBank::GoertzelBank()
+   : _count(0), _blockLength(0), _filled(0), _sum(0), _offset(SPECTRUM_SAMPLE_OFFSET), _ready(false) {
+ }
+ 
+ bool GoertzelBank::begin(const float *frequenciesHz, uint8_t count, float sampleRateHz, uint32_t blockLength) {
+   if (frequenciesHz == NULL || count == 0 || count > GOERTZEL_MAX_BINS || sampleRateHz <= 0.0f || blockLength < 2) {
+     return false;
+   }
+   for (uint8_t i = 0; i < count; i++) {
+     if (frequenciesHz[i] <= 0.0f || frequenciesHz[i] >= sampleRateHz / 2.0f) {
+       return false;
+     }
+   }
+ 
+   _count = count;
+   _blockLength = blockLength;
+   for (uint8_t i = 0; i < count; i++) {
+     double omega = 2.0 * M_PI * frequenciesHz[i] / sampleRateHz;
+     _frequency[i] = frequenciesHz[i];
+     _omega[i] = (float)omega;
+     _upper[i] = omega > M_PI / 2.0;
+     if (_upper[i]) {
+       double c = cos(omega / 2.0);
+       _lambda[i] = (float)(4.0 * c * c);
+     } else {
+       double s = sin(omega / 2.0);
+       _lambda[i] = (float)(-4.0 * s * s);
+     }
+   }
+   _offset = SPECTRUM_SAMPLE_OFFSET;
+   reset();
+   return true;
+ }
+ 
+ void GoertzelBank::reset() {
+   for (uint8_t i = 0; i < _count; i++) {
+     _state[i] = 0.0f;
+     _delta[i] = 0.0f;
+   }
+   _filled = 0;
+   _sum = 0;
+   _ready = false;
+ }
+ 
+ size_t IRAM_ATTR GoertzelBank::process(const uint16_t *samples, size_t count) {
+   if (_ready || _count == 0) {
+     return 0;
+   }
+ 
+   size_t n = _blockLength - _filled;
+   if (n > count) {
+     n = count;
+   }
+ 
+   for (size_t i = 0; i < n; i++) {
+     _sum += samples[i];
+   }
+ 
+   const float offset = _offset;
+   for (uint8_t b = 0; b < _count; b++) {
+     float s = _state[b], d = _delta[b];
+     const float lambda = _lambda[b];
+     if (_upper[b]) {
+       for (size_t i = 0; i < n; i++) {
+         d = ((float)samples[i] - offset) - d + lambda * s;
+         s = d - s;
+       }
+     } else {
+       for (size_t i = 0; i < n; i++) {
+         d += lambda * s + ((float)samples[i] - offset);
+         s += d;
+       }
+     }
+     _state[b] = s;
+     _delta[b] = d;
+   }
+ 
+   _filled += n;
+   if (_filled == _blockLength) {
+     _ready = true;
+   }
+   return n;
+ }
+ 
+ bool GoertzelBank::read(GoertzelTone_t *tones) {
+   if (!_ready || tones == NULL) {
+     return false;
+   }
+ 
+   const float scale = 2.0f / _blockLength;
+   for (uint8_t b = 0; b < _count; b++) {
+     // y = s[N-1] - e^{-jw} s[N-2], rewritten around the recursion variables
+     float s1 = _state[b];
+     float s2 = _upper[b] ? (_delta[b] - s1) : (s1 - _delta[b]);
+     float re = _delta[b] - 0.5f * _lambda[b] * s2;
+     float im = sinf(_omega[b]) * s2;
+ 
+     // Refer the phase back to the first sample of the block
+     double phase = atan2((double)im, (double)re) - fmod((double)_omega[b] * (_blockLength - 1), 2.0 * M_PI);
+     while (phase > M_PI) phase -= 2.0 * M_PI;
+     while (phase <= -M_PI) phase += 2.0 * M_PI;
+ 
+     tones[b].frequencyHz = _frequency[b];
+     tones[b].amplitude = sqrtf(re * re + im * im) * scale;
+     tones[b].phase = (float)phase;
+   }
+ 
+   // The mean of this block becomes the offset for the next one
+   _offset = (float)_sum / _blockLength;
+   reset();
+   return true;
+ }
\ No newline at end of file
@@ -0,0 +1,265 @@
+/*
+ * ADC Capture Core Benchmark (host tool)
+ * Drives AdcCaptureCore from a fake AD7495 that shifts out a 12-bit ramp,
+ * the way the sampling ISR feeds it on the device, and checks what the
+ * consumer side receives: every sample continues the ramp at its sample
+ * index, sequence numbers and first-sample indices run without gaps, a
+ * consumer that holds its blocks causes one overrun and counted drops
+ * (and the ramp resumes at the right index), and frames with their leading
+ * zero bits set are counted as framing errors. A threaded run pushes
+ * frames from one thread while another consumes, as ISR and task do.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -pthread -Iinclude tools/adc_capture_bench.cpp src/adc_capture_core.cpp -o adc_capture_bench
+ *
+ * Usage:
+ *   adc_capture_bench
+ */
+ 
+ #include <stdio.h>
+ #include <atomic>
+ #include <chrono>
+ #include <thread>
+ #include <vector>
+ #include "adc_capture_core.h"
+ 
+ static const uint16_t BLOCK_SAMPLES = 256;
+ 
+ // Fake AD7495: each conversion returns the next ramp value with the four
+ // leading zeros, or with leading bits set when told to corrupt that frame
+ class FakeAd7495 {
+   public:
+     FakeAd7495() : _index(0) {}
+ 
+     uint16_t transfer(bool corrupt = false) {
+       uint16_t frame = rampValue(_index++);
+       return corrupt ? (uint16_t)(frame | 0xA000) : frame;
+     }
+ 
+     uint64_t index() const { return _index; }
+ 
+     static uint16_t rampValue(uint64_t index) { return (uint16_t)(index & AD7495_DATA_MASK); }
+ 
+   private:
+     uint64_t _index;
+ };
+ 
+ static bool check(bool ok, const char *what) {
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ // Whether a block continues the ramp at its own first sample index
+ static bool blockIsRamp(const AdcBlock_t &block) {
+   for (uint16_t i = 0; i < block.count; i++) {
+     if (block.samples[i] != FakeAd7495::rampValue(block.firstSample + i)) {
+       return false;
+     }
+   }
+   return true;
+ }
+ 
+ static bool checkConfiguration() {
+   static uint16_t storage[BLOCK_SAMPLES * ADC_CAPTURE_CORE_MAX_BLOCKS];
+   AdcCaptureCore core;
+   bool ok = true;
+   ok &= check(!core.begin(NULL, BLOCK_SAMPLES, 2), "config: no storage rejected");
+   ok &= check(!core.begin(storage, 0, 2), "config: empty blocks rejected");
+   ok &= check(!core.begin(storage, BLOCK_SAMPLES, 1), "config: single block rejected");
+   ok &= check(!core.begin(storage, BLOCK_SAMPLES, ADC_CAPTURE_CORE_MAX_BLOCKS + 1), "config: too many blocks rejected");
+   ok &= check(core.begin(storage, BLOCK_SAMPLES, ADC_CAPTURE_CORE_MAX_BLOCKS), "config: largest ring accepted");
+   AdcBlock_t block;
+   ok &= check(!core.acquireBlock(&block), "config: nothing to acquire before the first block");
+   return ok;
+ }
+ 
+ // Consumer keeping up: every sample arrives, in order
+ static bool checkContinuity() {
+   static uint16_t storage[BLOCK_SAMPLES * 2];
+   AdcCaptureCore core;
+   FakeAd7495 adc;
+   core.begin(storage, BLOCK_SAMPLES, 2);
+ 
+   const uint32_t blocks = 1000;
+   uint32_t received = 0;
+   uint32_t completions = 0;
+   bool ramp = true;
+   bool sequence = true;
+   while (adc.index() < (uint64_t)blocks * BLOCK_SAMPLES) {
+     if (core.pushFrame(adc.transfer())) {
+       completions++;
+     }
+     AdcBlock_t block;
+     while (core.acquireBlock(&block)) {
+       ramp &= blockIsRamp(block) && block.count == BLOCK_SAMPLES;
+       sequence &= block.sequence == received && block.firstSample == (uint64_t)received * BLOCK_SAMPLES &&
+                   block.index == received % 2;
+       received++;
+       core.releaseBlock(block.index);
+     }
+   }
+ 
+   AdcCaptureCounters_t counters;
+   core.getCounters(&counters);
+   bool ok = true;
+   ok &= check(received == blocks && completions == blocks, "continuity: every block delivered");
+   ok &= check(ramp, "continuity: samples continue the ramp across blocks");
+   ok &= check(sequence, "continuity: sequence and first-sample indices have no gaps");
+   ok &= check(counters.samplesCaptured == blocks * BLOCK_SAMPLES && counters.blocksCompleted == blocks &&
+               counters.droppedSamples == 0 && counters.overruns == 0 && counters.framingErrors == 0,
+               "continuity: counters show no loss");
+   return ok;
+ }
+ 
+ // Consumer holding its blocks: the producer overruns, drops and resumes
+ static bool checkOverrun() {
+   static uint16_t storage[BLOCK_SAMPLES * 2];
+   AdcCaptureCore core;
+   FakeAd7495 adc;
+   core.begin(storage, BLOCK_SAMPLES, 2);
+ 
+   // Both blocks fill with nobody consuming, then 100 more frames arrive
+   for (uint32_t i = 0; i < 2u * BLOCK_SAMPLES + 100; i++) {
+     core.pushFrame(adc.transfer());
+   }
+   AdcCaptureCounters_t counters;
+   core.getCounters(&counters);
+   bool ok = true;
+   ok &= check(counters.blocksCompleted == 2 && counters.overruns == 1 && counters.droppedSamples == 100,
+               "overrun: full ring counts one overrun and every dropped sample");
+ 
+   // A held block keeps the producer dropping, even with the other one taken
+   AdcBlock_t first, second;
+   bool acquired = core.acquireBlock(&first) && core.acquireBlock(&second);
+   for (uint32_t i = 0; i < 50; i++) {
+     core.pushFrame(adc.transfer());
+   }
+   core.getCounters(&counters);
+   ok &= check(acquired && blockIsRamp(first) && blockIsRamp(second) && second.firstSample == BLOCK_SAMPLES,
+               "overrun: blocks completed before the overrun are intact");
+   ok &= check(counters.droppedSamples == 150 && counters.samplesCaptured == 2u * BLOCK_SAMPLES,
+               "overrun: drops continue while the next block is held");
+ 
+   // Released: capture resumes in that block, its first sample after the drops
+   core.releaseBlock(first.index);
+   core.releaseBlock(second.index);
+   uint64_t resumeAt = adc.index();
+   AdcBlock_t third, fourth;
+   for (uint32_t i = 0; i < BLOCK_SAMPLES; i++) {
+     core.pushFrame(adc.transfer());
+   }
+   acquired = core.acquireBlock(&third);
+   core.releaseBlock(third.index);
+   for (uint32_t i = 0; i < BLOCK_SAMPLES; i++) {
+     core.pushFrame(adc.transfer());
+   }
+   acquired = acquired && core.acquireBlock(&fourth);
+   core.getCounters(&counters);
+   ok &= check(acquired && third.firstSample == resumeAt && third.sequence == 2 && blockIsRamp(third),
+               "overrun: capture resumes with the ramp at the sample index");
+   ok &= check(acquired && fourth.firstSample == resumeAt + BLOCK_SAMPLES && fourth.sequence == 3 &&
+               blockIsRamp(fourth), "overrun: following block continues without a gap");
+   ok &= check(third.firstSample - (second.firstSample + BLOCK_SAMPLES) == counters.droppedSamples &&
+               counters.overruns == 1, "overrun: index gap equals the dropped count");
+ 
+   // Releasing a block twice or one never acquired changes nothing
+   core.releaseBlock(fourth.index);
+   core.releaseBlock(fourth.index);
+   core.releaseBlock(ADC_CAPTURE_CORE_MAX_BLOCKS);
+   AdcBlock_t none;
+   ok &= check(!core.acquireBlock(&none), "overrun: stray releases publish nothing");
+ 
+   // reset() restarts sequencing at zero with clean counters
+   core.reset();
+   core.getCounters(&counters);
+   ok &= check(counters.samplesCaptured == 0 && counters.droppedSamples == 0 && counters.overruns == 0,
+               "overrun: reset clears the counters");
+   return ok;
+ }
+ 
+ // Frames with leading bits set are counted and stored masked
+ static bool checkFraming() {
+   static uint16_t storage[BLOCK_SAMPLES * 2];
+   AdcCaptureCore core;
+   FakeAd7495 adc;
+   core.begin(storage, BLOCK_SAMPLES, 2);
+ 
+   uint32_t corrupted = 0;
+   for (uint32_t i = 0; i < BLOCK_SAMPLES; i++) {
+     bool corrupt = (i % 37) == 5;
+     corrupted += corrupt ? 1 : 0;
+     core.pushFrame(adc.transfer(corrupt));
+   }
+   AdcCaptureCounters_t counters;
+   core.getCounters(&counters);
+   AdcBlock_t block;
+   bool acquired = core.acquireBlock(&block);
+   bool ok = true;
+   ok &= check(counters.framingErrors == corrupted && corrupted > 0, "framing: every frame with leading bits counted");
+   ok &= check(acquired && blockIsRamp(block), "framing: stored samples keep only the 12 data bits");
+   return ok;
+ }
+ 
+ // Producer and consumer on separate threads, as the ISR and the consumer task
+ static bool checkThreaded() {
+   static uint16_t storage[BLOCK_SAMPLES * 4];
+   AdcCaptureCore core;
+   core.begin(storage, BLOCK_SAMPLES, 4);
+ 
+   const uint64_t frames = 2000ULL * BLOCK_SAMPLES;
+   const uint32_t pacing = BLOCK_SAMPLES;  // Frames between yields, so the consumer mostly keeps up
+   std::atomic<bool> done(false);
+   uint64_t received = 0;
+   uint32_t nextSequence = 0;
+   bool ramp = true;
+   bool ordered = true;
+   std::thread consumer([&]() {
+     AdcBlock_t block;
+     while (true) {
+       bool finished = done.load(std::memory_order_acquire);
+       while (core.acquireBlock(&block)) {
+         ramp &= blockIsRamp(block);
+         ordered &= block.sequence == nextSequence++;
+         received += block.count;
+         core.releaseBlock(block.index);
+       }
+       if (finished) {
+         break;
+       }
+     }
+   });
+ 
+   auto start = std::chrono::steady_clock::now();
+   FakeAd7495 adc;
+   while (adc.index() < frames) {
+     core.pushFrame(adc.transfer());
+     if (adc.index() % pacing == 0) {
+       std::this_thread::yield();
+     }
+   }
+   double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   done.store(true, std::memory_order_release);
+   consumer.join();
+ 
+   AdcCaptureCounters_t counters;
+   core.getCounters(&counters);
+   printf("threaded: %llu frames in %.3f s (%.1f M frames/s), %lu dropped, %lu overruns\n",
+          (unsigned long long)frames, sec, frames / sec / 1e6, (unsigned long)counters.droppedSamples,
+          (unsigned long)counters.overruns);
+   bool ok = true;
+   ok &= check(ramp && ordered, "threaded: delivered blocks are intact and in order");
+   ok &= check(received == counters.samplesCaptured && received + counters.droppedSamples == frames,
+               "threaded: delivered plus dropped accounts for every frame");
+   return ok;
+ }
+ 
+ int main() {
+   bool ok = true;
+   ok &= checkConfiguration();
+   ok &= checkContinuity();
+   ok &= checkOverrun();
+   ok &= checkFraming();
+   ok &= checkThreaded();
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*
+ * ADC Codec Benchmark (host tool)
+ * Reports compression ratio and encode/decode throughput of the sample codec
+ * on a serial plotter capture (one sample per line, e.g. logFile.txt) and on
+ * synthetic signals, and checks every block round-trips losslessly
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/adc_codec_bench.cpp src/sample_codec.cpp -o adc_codec_bench
+ *
+ * Usage:
+ *   adc_codec_bench [logFile.txt]
+ */
+ 
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <ctype.h>
+ #include <math.h>
+ #include <string.h>
+ #include <chrono>
+ #include <vector>
+ #include "sample_codec.h"
+ 
+ // Same block size the capture engine hands to its consumers
+ static const size_t BLOCK_SAMPLES = 512;
+ static const int ITERATIONS = 200;
+ 
+ // Read every line that is a bare integer, as printed by the old plotter dump
+ static std::vector<uint16_t> loadPlotterLog(const char *path) {
+   std::vector<uint16_t> samples;
+   FILE *f = fopen(path, "r");
+   if (f == NULL) {
+     return samples;
+   }
+ 
+   char line[128];
+   while (fgets(line, sizeof(line), f) != NULL) {
+     char *p = line;
+     while (isdigit((unsigned char)*p)) {
+       p++;
+     }
+     if (p != line && (*p == '\n' || *p == '\r' || *p == '\0')) {
+       samples.push_back((uint16_t)(atoi(line) & 0x0FFF));
+     }
+   }
+ 
+   fclose(f);
+   return samples;
+ }
+ 
+ static void runBenchmark(const char *name, const std::vector<uint16_t> &samples) {
+   size_t blocks = samples.size() / BLOCK_SAMPLES;
+   if (blocks == 0) {
+     printf("%-28s not enough samples\n", name);
+     return;
+   }
+ 
+   size_t total = blocks * BLOCK_SAMPLES;
+   std::vector<uint8_t> encoded(blocks * SAMPLE_CODEC_MAX_BYTES(BLOCK_SAMPLES));
+   std::vector<size_t> sizes(blocks);
+   std::vector<uint16_t> decoded(BLOCK_SAMPLES);
+ 
+   // Correctness pass
+   size_t encodedBytes = 0;
+   for (size_t b = 0; b < blocks; b++) {
+     uint8_t *out = &encoded[b * SAMPLE_CODEC_MAX_BYTES(BLOCK_SAMPLES)];
+     sizes[b] = sampleCodecEncode(&samples[b * BLOCK_SAMPLES], BLOCK_SAMPLES, out,
+                                  SAMPLE_CODEC_MAX_BYTES(BLOCK_SAMPLES));
+     if (sizes[b] == 0 || !sampleCodecDecode(out, sizes[b], decoded.data(), BLOCK_SAMPLES) ||
+         memcmp(decoded.data(), &samples[b * BLOCK_SAMPLES], BLOCK_SAMPLES * sizeof(uint16_t)) != 0) {
+       printf("%-28s ROUND TRIP FAILED in block %zu\n", name, b);
+       exit(1);
+     }
+     encodedBytes += sizes[b];
+   }
+ 
+   // Timing passes
+   auto start = std::chrono::steady_clock::now();
+   for (int it = 0; it < ITERATIONS; it++) {
+     for (size_t b = 0; b < blocks; b++) {
+       sampleCodecEncode(&samples[b * BLOCK_SAMPLES], BLOCK_SAMPLES,
+                         &encoded[b * SAMPLE_CODEC_MAX_BYTES(BLOCK_SAMPLES)],
+                         SAMPLE_CODEC_MAX_BYTES(BLOCK_SAMPLES));
+     }
+   }
+   double encodeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+ 
+   start = std::chrono::steady_clock::now();
+   for (int it = 0; it < ITERATIONS; it++) {
+     for (size_t b = 0; b < blocks; b++) {
+       sampleCodecDecode(&encoded[b * SAMPLE_CODEC_MAX_BYTES(BLOCK_SAMPLES)], sizes[b],
+                         decoded.data(), BLOCK_SAMPLES);
+     }
+   }
+   double decodeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+ 
+   double rawBytes = (double)total * 2;
+   printf("%-28s %7zu samples  %7zu bytes  ratio %6.2fx  %5.2f bits/sample  encode %7.1f MS/s  decode %7.1f MS/s\n",
+          name, total, encodedBytes, rawBytes / encodedBytes, encodedBytes * 8.0 / total,
+          total * ITERATIONS / encodeSec / 1e6, total * ITERATIONS / decodeSec / 1e6);
+ }
+ 
+ int main(int argc, char **argv) {
+   const size_t n = 64 * BLOCK_SAMPLES;
+ 
+   if (argc > 1) {
+     std::vector<uint16_t> log = loadPlotterLog(argv[1]);
+     runBenchmark(argv[1], log);
+   }
+ 
+   // Flat baseline with short excursions, like the logged captures
+   std::vector<uint16_t> baseline(n);
+   srand(1);
+   for (size_t i = 0; i < n; i++) {
+     baseline[i] = 31;
+     if (i % 2500 < 100) {
+       baseline[i] = (uint16_t)(31 + 400 * fabs(sin(i * 0.06)));
+     }
+   }
+   runBenchmark("baseline + excursions", baseline);
+ 
+   // Slow sine with +/-2 LSB noise
+   std::vector<uint16_t> noisy(n);
+   for (size_t i = 0; i < n; i++) {
+     noisy[i] = (uint16_t)(2048 + 1500 * sin(i * 0.01) + (rand() % 5) - 2);
+   }
+   runBenchmark("sine + 2 LSB noise", noisy);
+ 
+   // Full-scale white noise (worst case)
+   std::vector<uint16_t> white(n);
+   for (size_t i = 0; i < n; i++) {
+     white[i] = (uint16_t)(rand() & 0x0FFF);
+   }
+   runBenchmark("white noise (worst case)", white);
+ 
+   return 0;
+ }
\ No newline at end of file
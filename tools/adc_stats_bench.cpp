@@ -0,0 +1,133 @@
+/*
+ * ADC Statistics Benchmark (host tool)
+ * Compares the integer statistics kernel used on the device with a plain
+ * float kernel: throughput per block, agreement of the results, and the
+ * share of one core each would need at the full capture rate
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/adc_stats_bench.cpp src/adc_stats.cpp -o adc_stats_bench
+ *
+ * Usage:
+ *   adc_stats_bench
+ */
+ 
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <math.h>
+ #include <string.h>
+ #include <chrono>
+ #include <vector>
+ #include "adc_stats.h"
+ 
+ // Same block size and rate the capture engine runs at
+ static const size_t BLOCK_SAMPLES = 512;
+ static const double SAMPLE_RATE_HZ = 50000.0;
+ static const int ITERATIONS = 20000;
+ 
+ // Float reference: the straightforward way to write the same statistics
+ typedef struct {
+   uint32_t count;
+   float min;
+   float max;
+   float sum;
+   float sumSquares;
+   uint32_t histogram[ADC_STATS_HISTOGRAM_BINS];
+ } FloatStats_t;
+ 
+ static void floatStatsAccumulate(FloatStats_t *acc, const uint16_t *samples, size_t count) {
+   for (size_t i = 0; i < count; i++) {
+     float s = (float)samples[i];
+     acc->min = fminf(acc->min, s);
+     acc->max = fmaxf(acc->max, s);
+     acc->sum += s;
+     acc->sumSquares += s * s;
+     int bin = (int)(s * (ADC_STATS_HISTOGRAM_BINS / 4096.0f));
+     acc->histogram[bin]++;
+   }
+   acc->count += (uint32_t)count;
+ }
+ 
+ static std::vector<uint16_t> makeSignal(size_t n) {
+   std::vector<uint16_t> v(n);
+   srand(7);
+   for (size_t i = 0; i < n; i++) {
+     double x = 2048.0 + 1500.0 * sin(2.0 * M_PI * 1000.0 * i / SAMPLE_RATE_HZ) + (rand() % 41 - 20);
+     v[i] = (uint16_t)(x < 0 ? 0 : (x > 4095 ? 4095 : x));
+   }
+   return v;
+ }
+ 
+ int main() {
+   // One second of signal, processed block by block like the ADC consumer does
+   std::vector<uint16_t> signal = makeSignal((size_t)SAMPLE_RATE_HZ);
+   size_t blocks = signal.size() / BLOCK_SAMPLES;
+ 
+   // Integer kernel
+   AdcStatsAccumulator_t acc;
+   AdcStatsSummary_t summary;
+   auto start = std::chrono::steady_clock::now();
+   for (int it = 0; it < ITERATIONS / (int)blocks + 1; it++) {
+     adcStatsReset(&acc);
+     for (size_t b = 0; b < blocks; b++) {
+       adcStatsAccumulate(&acc, &signal[b * BLOCK_SAMPLES], BLOCK_SAMPLES);
+     }
+     adcStatsSummarize(&acc, &summary);
+   }
+   double intSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+ 
+   // Float kernel
+   FloatStats_t facc;
+   start = std::chrono::steady_clock::now();
+   for (int it = 0; it < ITERATIONS / (int)blocks + 1; it++) {
+     memset(&facc, 0, sizeof(facc));
+     facc.min = 1e9f;
+     facc.max = -1e9f;
+     for (size_t b = 0; b < blocks; b++) {
+       floatStatsAccumulate(&facc, &signal[b * BLOCK_SAMPLES], BLOCK_SAMPLES);
+     }
+   }
+   double floatSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   float fMean = facc.sum / facc.count;
+   float fRms = sqrtf(facc.sumSquares / facc.count);
+   float fAcRms = sqrtf(fmaxf(facc.sumSquares / facc.count - fMean * fMean, 0.0f));
+ 
+   // Double precision ground truth
+   double sum = 0, sumSq = 0;
+   for (size_t i = 0; i < blocks * BLOCK_SAMPLES; i++) {
+     sum += signal[i];
+     sumSq += (double)signal[i] * signal[i];
+   }
+   double n = (double)(blocks * BLOCK_SAMPLES);
+   double mean = sum / n;
+   double rms = sqrt(sumSq / n);
+   double acRms = sqrt(sumSq / n - mean * mean);
+ 
+   const double scale = 1 << ADC_STATS_FRACTION_BITS;
+   double totalSamples = (double)(ITERATIONS / (int)blocks + 1) * blocks * BLOCK_SAMPLES;
+ 
+   printf("%-8s %10s %10s %10s %12s %10s\n", "kernel", "mean", "rms", "ac_rms", "Msamples/s", "core@50k");
+   printf("%-8s %10.3f %10.3f %10.3f %12s %10s\n", "double", mean, rms, acRms, "-", "-");
+   printf("%-8s %10.3f %10.3f %10.3f %12.1f %9.3f%%\n", "integer",
+          summary.meanQ4 / scale, summary.rmsQ4 / scale, summary.acRmsQ4 / scale,
+          totalSamples / intSec / 1e6, 100.0 * SAMPLE_RATE_HZ * intSec / totalSamples);
+   printf("%-8s %10.3f %10.3f %10.3f %12.1f %9.3f%%\n", "float", fMean, fRms, fAcRms,
+          totalSamples / floatSec / 1e6, 100.0 * SAMPLE_RATE_HZ * floatSec / totalSamples);
+ 
+   // The integer histogram must match an exact count
+   bool histogramOk = true;
+   for (int bin = 0; bin < ADC_STATS_HISTOGRAM_BINS; bin++) {
+     if (summary.histogram[bin] != facc.histogram[bin]) {
+       histogramOk = false;
+     }
+   }
+   printf("min/max/p2p: %u/%u/%u, histogram %s\n", summary.min, summary.max, summary.peakToPeak,
+          histogramOk ? "matches" : "MISMATCH");
+ 
+   // Accept 1/16 count quantization on the integer results
+   bool ok = histogramOk &&
+             fabs(summary.meanQ4 / scale - mean) <= 1.0 / scale &&
+             fabs(summary.rmsQ4 / scale - rms) <= 1.0 / scale &&
+             fabs(summary.acRmsQ4 / scale - acRms) <= 1.0 / scale;
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
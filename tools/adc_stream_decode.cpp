@@ -0,0 +1,375 @@
+/*
+ * ADC Stream Decoder (host tool)
+ * Converts a recorded binary sample stream (see sample_stream_format.h) to CSV;
+ * STATS frames are summarized on stderr. --check runs a round trip instead:
+ * blocks are encoded the way the device streams them (RAW16, compressed and
+ * STATS frames, COBS-wrapped), damaged on the way (corrupted bytes, dropped
+ * frames, stray text, a frame cut short) and decoded again, and every
+ * surviving sample and every loss count is compared with what was sent.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/adc_stream_decode.cpp src/sample_stream_format.cpp \
+ *       src/sample_codec.cpp -o adc_stream_decode
+ *
+ * Streaming is off at boot: send "stream on" on the port to start the frames.
+ *
+ * Usage:
+ *   adc_stream_decode capture.bin > capture.csv
+ *   cat /dev/ttyACM0 | adc_stream_decode - > capture.csv
+ *   adc_stream_decode --check
+ */
+ 
+ #include <stdio.h>
+ #include <string.h>
+ #include <math.h>
+ #include <vector>
+ #include "sample_stream_format.h"
+ #include "sample_codec.h"
+ 
+ // Samples of a decoded RAW16 or compressed frame; false (with the reason) for anything else
+ static bool frameSamples(const SampleStreamDecoder &decoder, uint16_t *samples, const char **reason) {
+   const SampleStreamHeader_t &header = decoder.header();
+   const uint8_t *payload = decoder.payload();
+ 
+   if (header.type == SAMPLE_STREAM_TYPE_RAW16 &&
+       decoder.payloadLength() == (size_t)header.sampleCount * 2) {
+     for (uint16_t i = 0; i < header.sampleCount; i++) {
+       samples[i] = (uint16_t)(payload[i * 2] | (payload[i * 2 + 1] << 8));
+     }
+     return true;
+   } else if (header.type == SAMPLE_STREAM_TYPE_RICE12 && header.sampleCount > 0) {
+     if (!sampleCodecDecode(payload, decoder.payloadLength(), samples, header.sampleCount)) {
+       *reason = "corrupt compressed payload";
+       return false;
+     }
+     return true;
+   }
+   *reason = "unsupported type";
+   return false;
+ }
+ 
+ // ----- Round trip checks -----
+ 
+ typedef struct {
+   SampleStreamHeader_t header;
+   std::vector<uint16_t> samples;   // Empty for STATS frames
+   std::vector<uint8_t> wire;
+ } SentFrame_t;
+ 
+ // What came out of the decoder
+ typedef struct {
+   std::vector<SampleStreamHeader_t> headers;
+   std::vector<std::vector<uint16_t> > samples;
+   uint32_t statsFrames;
+   uint64_t samplesMissing;         // From gaps in firstSample, as the CSV path counts them
+   uint32_t framesRejected;
+   uint32_t framesLost;
+ } Received_t;
+ 
+ static bool check(bool ok, const char *what) {
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ // Blocks of different character: ramp, sine, noise and a constant level
+ static std::vector<uint16_t> makeBlock(uint32_t n, uint16_t count) {
+   std::vector<uint16_t> v(count);
+   uint32_t seed = 12345 + n;
+   for (uint16_t i = 0; i < count; i++) {
+     seed = seed * 1103515245 + 12345;
+     switch (n % 4) {
+       case 0: v[i] = (uint16_t)((n * 97 + i) & 0x0FFF); break;
+       case 1: v[i] = (uint16_t)(2048 + 1500 * sin((n * count + i) * 0.05)); break;
+       case 2: v[i] = (uint16_t)((seed >> 16) & 0x0FFF); break;
+       default: v[i] = 0; break;  // All zero: the COBS worst case for RAW16
+     }
+   }
+   return v;
+ }
+ 
+ // The device's stream: sample frames, every fourth compressed, a STATS frame after every fifth
+ static std::vector<SentFrame_t> makeStream(uint32_t blocks, uint16_t blockSamples) {
+   static uint8_t scratch[SAMPLE_STREAM_MAX_FRAME];
+   static uint8_t wire[SAMPLE_STREAM_MAX_WIRE];
+   std::vector<SentFrame_t> stream;
+   uint32_t sequence = 0;
+   for (uint32_t n = 0; n < blocks; n++) {
+     SentFrame_t frame;
+     memset(&frame.header, 0, sizeof(frame.header));
+     frame.header.version = SAMPLE_STREAM_VERSION;
+     frame.header.sequence = sequence++;
+     frame.header.sampleRateHz = 50000;
+     frame.header.timestampUs = n * 20000;
+     frame.header.firstSample = (uint64_t)n * blockSamples;
+     frame.samples = makeBlock(n, blockSamples);
+     size_t len = (n % 4 == 1)
+       ? sampleStreamEncodeCompressed(&frame.header, frame.samples.data(), blockSamples, scratch, wire)
+       : sampleStreamEncodeRaw16(&frame.header, frame.samples.data(), blockSamples, scratch, wire);
+     frame.wire.assign(wire, wire + len);
+     stream.push_back(frame);
+ 
+     if (n % 5 == 4) {
+       SentFrame_t stats;
+       memset(&stats.header, 0, sizeof(stats.header));
+       stats.header.version = SAMPLE_STREAM_VERSION;
+       stats.header.sequence = sequence++;
+       stats.header.firstSample = (uint64_t)(n - 4) * blockSamples;
+       AdcStatsSummary_t summary = {};
+       summary.sampleCount = 5u * blockSamples;
+       summary.min = 0;
+       summary.max = 4095;
+       summary.peakToPeak = 4095;
+       summary.meanQ4 = (uint16_t)(n * 16);
+       summary.histogram[ADC_STATS_HISTOGRAM_BINS - 1] = n;
+       len = sampleStreamEncodeStats(&stats.header, &summary, scratch, wire);
+       stats.wire.assign(wire, wire + len);
+       stream.push_back(stats);
+     }
+   }
+   return stream;
+ }
+ 
+ static Received_t decodeStream(const std::vector<uint8_t> &bytes) {
+   static SampleStreamDecoder decoder;
+   static uint16_t samples[SAMPLE_STREAM_MAX_SAMPLES];
+   decoder = SampleStreamDecoder();
+   Received_t received = {};
+   uint64_t expectedSample = 0;
+   bool haveSample = false;
+   for (uint8_t byte : bytes) {
+     if (!decoder.feed(byte)) {
+       continue;
+     }
+     const char *reason = NULL;
+     if (decoder.header().type == SAMPLE_STREAM_TYPE_STATS) {
+       AdcStatsSummary_t summary;
+       if (sampleStreamParseStats(decoder.payload(), decoder.payloadLength(), &summary)) {
+         received.statsFrames++;
+       }
+       continue;
+     }
+     if (!frameSamples(decoder, samples, &reason)) {
+       continue;
+     }
+     const SampleStreamHeader_t &header = decoder.header();
+     if (haveSample && header.firstSample > expectedSample) {
+       received.samplesMissing += header.firstSample - expectedSample;
+     }
+     haveSample = true;
+     expectedSample = header.firstSample + header.sampleCount;
+     received.headers.push_back(header);
+     received.samples.push_back(std::vector<uint16_t>(samples, samples + header.sampleCount));
+   }
+   received.framesRejected = decoder.framesRejected();
+   received.framesLost = decoder.framesLost();
+   return received;
+ }
+ 
+ // Whether the received sample frames are exactly the sent ones, minus those listed
+ static bool matches(const std::vector<SentFrame_t> &sent, const Received_t &received,
+                     const std::vector<uint32_t> &missing) {
+   size_t r = 0;
+   for (const SentFrame_t &frame : sent) {
+     bool isMissing = false;
+     for (uint32_t sequence : missing) {
+       isMissing |= frame.header.sequence == sequence;
+     }
+     if (isMissing || frame.samples.empty()) {
+       continue;
+     }
+     if (r >= received.samples.size()) {
+       return false;
+     }
+     const SampleStreamHeader_t &header = received.headers[r];
+     if (header.sequence != frame.header.sequence || header.firstSample != frame.header.firstSample ||
+         header.timestampUs != frame.header.timestampUs || header.sampleRateHz != frame.header.sampleRateHz ||
+         header.type != frame.header.type || received.samples[r] != frame.samples) {
+       return false;
+     }
+     r++;
+   }
+   return r == received.samples.size();
+ }
+ 
+ static std::vector<uint8_t> join(const std::vector<SentFrame_t> &stream) {
+   std::vector<uint8_t> bytes;
+   for (const SentFrame_t &frame : stream) {
+     bytes.insert(bytes.end(), frame.wire.begin(), frame.wire.end());
+   }
+   return bytes;
+ }
+ 
+ static bool checkCobs() {
+   static uint8_t in[1200], encoded[SAMPLE_STREAM_COBS_SIZE(1200)], decoded[SAMPLE_STREAM_COBS_SIZE(1200)];
+   bool ok = true;
+   const size_t lengths[] = { 1, 253, 254, 255, 508, 509, 1200 };
+   for (int pattern = 0; pattern < 3; pattern++) {
+     for (size_t len : lengths) {
+       for (size_t i = 0; i < len; i++) {
+         in[i] = (pattern == 0) ? 0 : (pattern == 1) ? (uint8_t)(1 + i % 255) : (uint8_t)((i % 7 == 3) ? 0 : i);
+       }
+       size_t n = cobsEncode(in, len, encoded);
+       bool delimiterOnlyAtEnd = n <= SAMPLE_STREAM_COBS_SIZE(len) && encoded[n - 1] == SAMPLE_STREAM_DELIMITER &&
+                                 memchr(encoded, 0, n - 1) == NULL;
+       size_t m = cobsDecode(encoded, n - 1, decoded);
+       ok &= delimiterOnlyAtEnd && m == len && memcmp(in, decoded, len) == 0;
+     }
+   }
+   return check(ok, "cobs: zeros, 254-byte runs and mixed data round trip");
+ }
+ 
+ static bool runChecks() {
+   bool ok = checkCobs();
+   const uint16_t blockSamples = 500;
+   std::vector<SentFrame_t> sent = makeStream(40, blockSamples);
+   uint32_t sampleFrames = 40;
+   uint32_t statsFrames = (uint32_t)sent.size() - sampleFrames;
+ 
+   // Clean stream: everything arrives as sent
+   {
+     Received_t r = decodeStream(join(sent));
+     bool compressed = false;
+     for (const SampleStreamHeader_t &header : r.headers) {
+       compressed |= header.type == SAMPLE_STREAM_TYPE_RICE12;
+     }
+     ok &= check(matches(sent, r, {}) && r.statsFrames == statsFrames, "clean: every frame decodes to what was sent");
+     ok &= check(compressed, "clean: compressed frames in the stream");
+     ok &= check(r.framesRejected == 0 && r.framesLost == 0 && r.samplesMissing == 0, "clean: nothing lost");
+   }
+ 
+   // A corrupted byte inside a frame: that frame is rejected by its CRC and counted lost, the rest survive
+   {
+     std::vector<SentFrame_t> damaged = sent;
+     std::vector<uint8_t> &wire = damaged[3].wire;
+     wire[wire.size() / 2] ^= (wire[wire.size() / 2] == 0x01) ? 0x03 : 0x01;  // Never turns into a delimiter
+     Received_t r = decodeStream(join(damaged));
+     ok &= check(matches(sent, r, { damaged[3].header.sequence }) && r.framesRejected == 1 && r.framesLost == 1,
+                 "corrupt: damaged frame rejected and counted lost");
+     ok &= check(r.samplesMissing == blockSamples, "corrupt: its samples show as missing");
+   }
+ 
+   // A byte turned into a delimiter splits a frame: both halves are rejected, the next frame resyncs
+   {
+     std::vector<SentFrame_t> damaged = sent;
+     damaged[7].wire[40] = SAMPLE_STREAM_DELIMITER;
+     Received_t r = decodeStream(join(damaged));
+     ok &= check(matches(sent, r, { damaged[7].header.sequence }) && r.framesRejected == 2 && r.framesLost == 1,
+                 "corrupt: split frame rejected, stream resyncs");
+   }
+ 
+   // Dropped frames (two sample frames and a STATS frame in a row) show as sequence gaps
+   {
+     std::vector<SentFrame_t> dropped = sent;
+     uint32_t first = dropped[12].header.sequence;   // Blocks 10 and 11
+     uint32_t second = dropped[13].header.sequence;
+     size_t statsIndex = 0;
+     for (size_t i = 14; i < dropped.size() && statsIndex == 0; i++) {
+       statsIndex = dropped[i].samples.empty() ? i : 0;
+     }
+     dropped.erase(dropped.begin() + statsIndex);
+     dropped.erase(dropped.begin() + 12, dropped.begin() + 14);
+     Received_t r = decodeStream(join(dropped));
+     ok &= check(matches(sent, r, { first, second }) && r.framesRejected == 0 && r.framesLost == 3 &&
+                 r.statsFrames == statsFrames - 1, "dropped: sequence gaps count every lost frame");
+     ok &= check(r.samplesMissing == 2u * blockSamples, "dropped: missing samples from the first-sample gap");
+   }
+ 
+   // Stray text on the port and a frame cut short are rejected without losing what follows
+   {
+     std::vector<uint8_t> bytes;
+     const char *text = "boot: ready\r\n";
+     bytes.insert(bytes.end(), text, text + strlen(text));
+     for (size_t i = 0; i < sent.size(); i++) {
+       const std::vector<uint8_t> &wire = sent[i].wire;
+       size_t keep = (i == 5) ? wire.size() / 3 : wire.size();
+       bytes.insert(bytes.end(), wire.begin(), wire.begin() + keep);
+       if (i == 20) {
+         bytes.insert(bytes.end(), text, text + strlen(text));
+       }
+     }
+     Received_t r = decodeStream(bytes);
+     ok &= check(matches(sent, r, { sent[5].header.sequence }) && r.framesLost == 1 && r.framesRejected >= 2,
+                 "noise: stray text and a truncated frame are skipped");
+   }
+ 
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok;
+ }
+ 
+ int main(int argc, char **argv) {
+   if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+     return runChecks() ? 0 : 1;
+   }
+   if (argc != 2) {
+     fprintf(stderr, "Usage: %s <stream.bin | ->\n       %s --check\n", argv[0], argv[0]);
+     return 2;
+   }
+ 
+   FILE *in = (strcmp(argv[1], "-") == 0) ? stdin : fopen(argv[1], "rb");
+   if (in == NULL) {
+     fprintf(stderr, "Cannot open %s\n", argv[1]);
+     return 1;
+   }
+ 
+   static SampleStreamDecoder decoder;
+   static uint16_t samples[SAMPLE_STREAM_MAX_SAMPLES];
+   uint64_t samplesWritten = 0;
+   uint64_t samplesMissing = 0;
+   uint64_t expectedSample = 0;
+   bool haveSample = false;
+ 
+   printf("sequence,sample_index,time_us,value\n");
+ 
+   int c;
+   while ((c = fgetc(in)) != EOF) {
+     if (!decoder.feed((uint8_t)c)) {
+       continue;
+     }
+ 
+     const SampleStreamHeader_t &header = decoder.header();
+     const uint8_t *payload = decoder.payload();
+ 
+     if (header.type == SAMPLE_STREAM_TYPE_STATS) {
+       AdcStatsSummary_t stats;
+       if (sampleStreamParseStats(payload, decoder.payloadLength(), &stats)) {
+         const double scale = 1 << ADC_STATS_FRACTION_BITS;
+         fprintf(stderr, "stats %u @%u us: n=%u min=%u max=%u p2p=%u mean=%.2f rms=%.2f ac_rms=%.2f\n",
+                 header.sequence, header.timestampUs, stats.sampleCount, stats.min, stats.max,
+                 stats.peakToPeak, stats.meanQ4 / scale, stats.rmsQ4 / scale, stats.acRmsQ4 / scale);
+       }
+       continue;
+     }
+ 
+     const char *reason = NULL;
+     if (!frameSamples(decoder, samples, &reason)) {
+       fprintf(stderr, "Skipping frame %u: %s\n", header.sequence, reason);
+       continue;
+     }
+ 
+     // Count samples the device dropped or that were lost with missing frames
+     if (haveSample && header.firstSample > expectedSample) {
+       samplesMissing += header.firstSample - expectedSample;
+     }
+     haveSample = true;
+     expectedSample = header.firstSample + header.sampleCount;
+ 
+     for (uint16_t i = 0; i < header.sampleCount; i++) {
+       double timeUs = header.timestampUs;
+       if (header.sampleRateHz > 0) {
+         timeUs += (double)i * 1e6 / header.sampleRateHz;
+       }
+       printf("%u,%llu,%.2f,%u\n", header.sequence,
+              (unsigned long long)(header.firstSample + i), timeUs, samples[i]);
+     }
+     samplesWritten += header.sampleCount;
+   }
+ 
+   if (in != stdin) {
+     fclose(in);
+   }
+ 
+   fprintf(stderr, "Frames: %u decoded, %u rejected, %u lost; samples: %llu written, %llu missing\n",
+           decoder.framesDecoded(), decoder.framesRejected(), decoder.framesLost(),
+           (unsigned long long)samplesWritten, (unsigned long long)samplesMissing);
+   return 0;
+ }
\ No newline at end of file
@@ -0,0 +1,398 @@
+/*
+ * ADC Trigger Benchmark (host tool)
+ * Runs the AdcTrigger state machine over synthetic signals (sine, square
+ * edges, slow ramps, noise around the level) fed in blocks of several
+ * sizes, and checks every window against a sample-by-sample reference of
+ * the trigger rules: level crossings with rising, falling and either slope,
+ * hysteresis qualification, the holdoff between re-armed triggers, external
+ * events, immediate triggers, pre-trigger and post-trigger counts, and the
+ * restart on dropped samples. Also measures the level scan rate.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/adc_trigger_bench.cpp src/adc_trigger.cpp -o adc_trigger_bench
+ *
+ * Usage:
+ *   adc_trigger_bench
+ */
+ 
+ #include <stdio.h>
+ #include <math.h>
+ #include <chrono>
+ #include <random>
+ #include <vector>
+ #include "adc_trigger.h"
+ 
+ static const uint32_t CAPACITY = 8192;
+ static const uint32_t BLOCK_SIZES[] = { 1, 37, 256, 1000, 65536 };
+ static const uint32_t REARM_BLOCK_SIZES[] = { 1, 37, 256, 1000 };  // Leaving signal for the next capture
+ 
+ static bool check(bool ok, const char *what) {
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ // ----- Synthetic signals -----
+ 
+ static std::vector<uint16_t> sine(uint32_t n, double period, double amplitude, double phase = 0) {
+   std::vector<uint16_t> v(n);
+   for (uint32_t i = 0; i < n; i++) {
+     v[i] = (uint16_t)lround(2048 + amplitude * sin(2 * M_PI * i / period + phase));
+   }
+   return v;
+ }
+ 
+ // Square wave: low for the first half of each period, then high
+ static std::vector<uint16_t> square(uint32_t n, uint32_t period, uint16_t low, uint16_t high) {
+   std::vector<uint16_t> v(n);
+   for (uint32_t i = 0; i < n; i++) {
+     v[i] = ((i % period) < period / 2) ? low : high;
+   }
+   return v;
+ }
+ 
+ // Noise of +/- spread around a centre
+ static std::vector<uint16_t> noise(uint32_t n, uint16_t centre, int spread, uint32_t seed) {
+   std::mt19937 rng(seed);
+   std::uniform_int_distribution<int> d(-spread, spread);
+   std::vector<uint16_t> v(n);
+   for (uint32_t i = 0; i < n; i++) {
+     v[i] = (uint16_t)(centre + d(rng));
+   }
+   return v;
+ }
+ 
+ // ----- Reference: the trigger rules one sample at a time -----
+ 
+ typedef struct {
+   bool fired;
+   uint64_t triggerSample;
+   bool external;
+ } Expected_t;
+ 
+ // Trigger point of a trigger armed at armIndex (history restarting there); previousTrigger
+ // is the trigger point of the capture before (for the holdoff), or -1 if none
+ static Expected_t reference(const std::vector<uint16_t> &signal, const AdcTriggerConfig_t &config, uint64_t armIndex,
+                             int64_t previousTrigger, int64_t externalEvent = -1) {
+   Expected_t e = { false, 0, false };
+   uint64_t armed = armIndex + config.preSamples;
+   uint64_t earliest = armed;
+   if (previousTrigger >= 0 && (uint64_t)previousTrigger + config.holdoffSamples > earliest) {
+     earliest = previousTrigger + config.holdoffSamples;
+   }
+   bool rising = config.slope != TRIGGER_SLOPE_FALLING;
+   bool falling = config.slope != TRIGGER_SLOPE_RISING;
+   int32_t low = (int32_t)config.level - config.hysteresis;
+   int32_t high = (int32_t)config.level + config.hysteresis;
+   bool seenBelow = false, seenAbove = false;
+   uint64_t external = (externalEvent < 0) ? UINT64_MAX : ((uint64_t)externalEvent < earliest ? earliest : externalEvent);
+ 
+   for (uint64_t i = armed; i + config.postSamples <= signal.size(); i++) {
+     if (i == external) {
+       e.fired = true;
+       e.triggerSample = i;
+       e.external = true;
+       return e;
+     }
+     if (config.source == TRIGGER_SOURCE_IMMEDIATE) {
+       if (i >= earliest) {
+         e.fired = true;
+         e.triggerSample = i;
+         return e;
+       }
+       continue;
+     }
+     if (config.source != TRIGGER_SOURCE_LEVEL) {
+       continue;
+     }
+     int32_t s = signal[i];
+     bool hit = false;
+     if (rising) {
+       if (s <= low) {
+         seenBelow = true;
+       } else if (seenBelow && s >= (int32_t)config.level) {
+         hit = i >= earliest;
+         seenBelow = hit;  // A crossing in the holdoff is used up
+       }
+     }
+     if (falling && !hit) {
+       if (s >= high) {
+         seenAbove = true;
+       } else if (seenAbove && s <= (int32_t)config.level) {
+         hit = i >= earliest;
+         seenAbove = hit;
+       }
+     }
+     if (hit) {
+       e.fired = true;
+       e.triggerSample = i;
+       return e;
+     }
+   }
+   return e;
+ }
+ 
+ // ----- Running the trigger -----
+ 
+ typedef struct {
+   bool done;
+   AdcTriggerWindow_t window;
+   std::vector<uint16_t> samples;
+   uint64_t nextIndex;                  // Index of the first sample not fed
+ } Captured_t;
+ 
+ // Feed signal from index start in blocks until a window completes or the signal ends
+ static Captured_t run(AdcTrigger *trigger, const std::vector<uint16_t> &signal, uint64_t start, uint32_t blockSize,
+                       int64_t externalEvent = -1) {
+   Captured_t c;
+   c.done = false;
+   c.nextIndex = start;
+   for (uint64_t i = start; i < signal.size() && !c.done; i += blockSize) {
+     uint32_t n = (uint32_t)((signal.size() - i < blockSize) ? signal.size() - i : blockSize);
+     if (externalEvent >= 0 && (uint64_t)externalEvent < i + n) {
+       trigger->externalEvent((uint64_t)externalEvent);  // Reported once its sample has been captured
+       externalEvent = -1;
+     }
+     c.done = trigger->processBlock(&signal[i], n, i);
+     c.nextIndex = i + n;
+   }
+   if (c.done) {
+     trigger->getWindow(&c.window);
+     c.samples.resize(CAPACITY);
+     c.samples.resize(trigger->readWindow(c.samples.data(), CAPACITY, NULL));
+   }
+   return c;
+ }
+ 
+ // Window as expected: trigger point, pre and post counts and the samples themselves
+ static bool windowMatches(const Captured_t &c, const Expected_t &e, const AdcTriggerConfig_t &config,
+                           const std::vector<uint16_t> &signal, bool storage = true) {
+   if (!e.fired) {
+     return !c.done;
+   }
+   if (!c.done || c.window.triggerSample != e.triggerSample || c.window.external != e.external ||
+       c.window.firstSample != e.triggerSample - config.preSamples ||
+       c.window.count != config.preSamples + config.postSamples) {
+     return false;
+   }
+   if (!storage) {
+     return true;
+   }
+   for (uint32_t i = 0; i < c.samples.size(); i++) {
+     if (c.samples[i] != signal[c.window.firstSample + i]) {
+       return false;
+     }
+   }
+   return c.samples.size() == c.window.count;
+ }
+ 
+ static AdcTriggerConfig_t levelConfig(AdcTriggerSlope_t slope, uint16_t level, uint16_t hysteresis, uint32_t pre,
+                                       uint32_t post, uint32_t holdoff = 0) {
+   AdcTriggerConfig_t config;
+   config.source = TRIGGER_SOURCE_LEVEL;
+   config.slope = slope;
+   config.level = level;
+   config.hysteresis = hysteresis;
+   config.preSamples = pre;
+   config.postSamples = post;
+   config.holdoffSamples = holdoff;
+   return config;
+ }
+ 
+ // One single-shot capture, armed at index 0, for every block size
+ static bool singleShot(const std::vector<uint16_t> &signal, const AdcTriggerConfig_t &config, int64_t externalEvent = -1,
+                        Expected_t *expected = NULL) {
+   static uint16_t storage[CAPACITY];
+   Expected_t e = reference(signal, config, 0, -1, externalEvent);
+   if (expected != NULL) {
+     *expected = e;
+   }
+   bool ok = true;
+   for (uint32_t blockSize : BLOCK_SIZES) {
+     AdcTrigger trigger;
+     trigger.begin(storage, CAPACITY);
+     ok &= trigger.configure(&config);
+     trigger.arm();
+     Captured_t c = run(&trigger, signal, 0, blockSize, externalEvent);
+     ok &= windowMatches(c, e, config, signal);
+   }
+   return ok;
+ }
+ 
+ // Re-armed captures back to back, as a repeating capture request runs them
+ static bool repeated(const std::vector<uint16_t> &signal, const AdcTriggerConfig_t &config, uint32_t captures,
+                      std::vector<uint64_t> *points) {
+   static uint16_t storage[CAPACITY];
+   bool ok = true;
+   for (uint32_t blockSize : REARM_BLOCK_SIZES) {
+     AdcTrigger trigger;
+     trigger.begin(storage, CAPACITY);
+     ok &= trigger.configure(&config);
+     std::vector<uint64_t> found;
+     uint64_t next = 0;
+     int64_t previous = -1;
+     for (uint32_t n = 0; n < captures && ok; n++) {
+       trigger.arm();
+       // Re-armed between blocks: the history restarts at the next block
+       uint64_t armIndex = next;
+       Expected_t e = reference(signal, config, armIndex, previous);
+       Captured_t c = run(&trigger, signal, armIndex, blockSize);
+       ok &= windowMatches(c, e, config, signal);
+       if (!c.done) {
+         break;
+       }
+       found.push_back(c.window.triggerSample);
+       previous = (int64_t)c.window.triggerSample;
+       next = c.nextIndex;
+     }
+     if (points != NULL && blockSize == 37) {
+       *points = found;
+     }
+   }
+   return ok;
+ }
+ 
+ int main() {
+   bool ok = true;
+ 
+   // Level triggers on a sine: each slope, level and the window geometry
+   {
+     std::vector<uint16_t> s = sine(40000, 1000, 1800, 0.3);
+     Expected_t e;
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 500, 1500), -1, &e) && e.fired,
+                 "level: rising crossing of a sine");
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_FALLING, 2048, 32, 500, 1500), -1, &e) && e.fired,
+                 "level: falling crossing of a sine");
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_EITHER, 3000, 32, 100, 300), -1, &e) && e.fired,
+                 "level: either slope, level off centre");
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 0, 1), -1, &e) && e.fired,
+                 "level: no pre-trigger, one post-trigger sample");
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 6000, 2192), -1, &e) && e.fired,
+                 "level: window filling the whole history");
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_RISING, 4000, 32, 100, 100), -1, &e) && !e.fired,
+                 "level: level beyond the signal never fires");
+   }
+ 
+   // Edges: a square wave fires on the edge of the configured slope only
+   {
+     std::vector<uint16_t> s = square(20000, 2000, 500, 3500);
+     Expected_t e;
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 64, 300, 700), -1, &e) && e.fired &&
+                 e.triggerSample % 2000 == 1000, "edge: rising edge of a square wave");
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_FALLING, 2048, 64, 300, 700), -1, &e) && e.fired &&
+                 e.triggerSample % 2000 == 0, "edge: falling edge of a square wave");
+   }
+ 
+   // Pre-trigger history: crossings before it is complete do not fire
+   {
+     std::vector<uint16_t> s = square(20000, 2000, 500, 3500);
+     Expected_t e;
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 64, 2500, 500), -1, &e) && e.fired &&
+                 e.triggerSample == 3000, "pre-trigger: early edges skipped until the history is full");
+   }
+ 
+   // Hysteresis: noise around the level fires only when it exceeds the band
+   {
+     std::vector<uint16_t> s = noise(30000, 2048, 20, 3);
+     Expected_t e;
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 200, 200), -1, &e) && !e.fired,
+                 "hysteresis: noise inside the band never fires");
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_EITHER, 2048, 32, 200, 200), -1, &e) && !e.fired,
+                 "hysteresis: ... on either slope");
+     ok &= check(singleShot(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 8, 200, 200), -1, &e) && e.fired,
+                 "hysteresis: narrower band fires on the noise");
+     std::vector<uint16_t> slow = sine(50000, 20000, 1500);
+     for (uint32_t i = 0; i < slow.size(); i++) {
+       slow[i] = (uint16_t)(slow[i] + ((i % 3) ? 12 : -12));  // Jitter on a slow ramp
+     }
+     std::vector<uint64_t> points;
+     ok &= check(repeated(slow, levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 100, 100), 3, &points) &&
+                 points.size() == 2 && points[1] - points[0] > 19990,
+                 "hysteresis: jitter on a slow ramp fires once per rise");
+   }
+ 
+   // Holdoff: re-armed captures keep their trigger points apart
+   {
+     std::vector<uint16_t> s = sine(60000, 1000, 1800);
+     std::vector<uint64_t> points;
+     ok &= check(repeated(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 100, 400), 8, &points) &&
+                 points.size() == 8 && points[1] - points[0] == 1000,
+                 "holdoff: none, every period triggers");
+     ok &= check(repeated(s, levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 100, 400, 3500), 8, &points) &&
+                 points.size() == 8 && points[1] - points[0] == 4000 && points[7] - points[6] == 4000,
+                 "holdoff: 3.5 periods skips three crossings");
+     AdcTriggerConfig_t immediate = levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 0, 100, 250);
+     immediate.source = TRIGGER_SOURCE_IMMEDIATE;
+     ok &= check(repeated(s, immediate, 5, &points) && points.size() == 5 && points[4] - points[3] == 250,
+                 "holdoff: immediate captures spaced by the holdoff");
+   }
+ 
+   // External events: at their sample, moved to the arm point when early, held off like crossings
+   {
+     std::vector<uint16_t> s = noise(20000, 2048, 20, 5);
+     AdcTriggerConfig_t config = levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 1000, 500);
+     config.source = TRIGGER_SOURCE_EXTERNAL;
+     Expected_t e;
+     ok &= check(singleShot(s, config, 7345, &e) && e.fired && e.external && e.triggerSample == 7345,
+                 "external: fires at the event's sample");
+     ok &= check(singleShot(s, config, 200, &e) && e.fired && e.triggerSample == 1000,
+                 "external: event before the history is full fires at the arm point");
+     config.source = TRIGGER_SOURCE_LEVEL;
+     std::vector<uint16_t> sq = square(20000, 2000, 500, 3500);
+     ok &= check(singleShot(sq, config, 2500, &e) && e.fired && e.external && e.triggerSample == 2500,
+                 "external: earlier than the next level crossing wins");
+   }
+ 
+   // Dropped samples restart the pre-trigger history
+   {
+     static uint16_t storage[CAPACITY];
+     std::vector<uint16_t> s = square(20000, 2000, 500, 3500);
+     AdcTriggerConfig_t config = levelConfig(TRIGGER_SLOPE_RISING, 2048, 64, 1500, 500);
+     AdcTrigger trigger;
+     trigger.begin(storage, CAPACITY);
+     trigger.configure(&config);
+     trigger.arm();
+     trigger.processBlock(&s[0], 800, 0);
+     bool restarted = !trigger.processBlock(&s[900], 600, 900) && trigger.state() == TRIGGER_STATE_PRETRIGGER &&
+                      trigger.historyStart() == 900;
+     Captured_t c = run(&trigger, s, 1500, 256);
+     ok &= check(restarted && c.done && c.window.triggerSample == 3000 && c.window.firstSample == 1500,
+                 "gap: history restarts after the dropped samples");
+   }
+ 
+   // Without storage only the indices are tracked
+   {
+     std::vector<uint16_t> s = sine(20000, 1000, 1800, 0.3);
+     AdcTriggerConfig_t config = levelConfig(TRIGGER_SLOPE_RISING, 2048, 32, 500, 1500);
+     AdcTrigger trigger;
+     trigger.begin(NULL, CAPACITY);
+     trigger.configure(&config);
+     trigger.arm();
+     Captured_t c = run(&trigger, s, 0, 256);
+     uint16_t out[4];
+     ok &= check(windowMatches(c, reference(s, config, 0, -1), config, s, false) &&
+                 trigger.readWindow(out, 4, NULL) == 0, "indices only: window described, nothing to read");
+   }
+ 
+   // Level scan rate with nothing to fire on
+   {
+     std::vector<uint16_t> s = noise(1 << 20, 2048, 20, 9);
+     AdcTriggerConfig_t config = levelConfig(TRIGGER_SLOPE_EITHER, 2048, 32, 1024, 3072);
+     static uint16_t storage[CAPACITY];
+     AdcTrigger trigger;
+     trigger.begin(storage, CAPACITY);
+     trigger.configure(&config);
+     trigger.arm();
+     const int rounds = 50;
+     auto start = std::chrono::steady_clock::now();
+     for (int r = 0; r < rounds; r++) {
+       for (uint32_t i = 0; i < s.size(); i += 256) {
+         trigger.processBlock(&s[i], 256, (uint64_t)r * s.size() + i);
+       }
+     }
+     double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+     printf("scan: %.1f M samples/s (armed, either slope, 256-sample blocks)\n", rounds * (double)s.size() / sec / 1e6);
+   }
+ 
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
@@ -0,0 +1,349 @@
+/*
+ * Burst Sync Benchmark (host tool)
+ * Builds an ADC stream with pulse bursts at known sample indices, reports
+ * their edges with known timestamps the way the burst capture consumer
+ * does (each burst start placed on the sample clock of the block it is
+ * drained with, promptly or a block late, with the microsecond clock
+ * wrapping), and checks what BurstSync extracts: every window starts at
+ * the burst's sample index less the pre-trigger samples, holds the stream
+ * samples there, records the edge offsets, and the coherent average is the
+ * mean of its windows and recovers the burst waveform from the noise.
+ * Dropped samples, too many outstanding bursts and bursts older than the
+ * history are counted as missed windows.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/burst_sync_bench.cpp src/burst_sync.cpp -o burst_sync_bench
+ *
+ * Usage:
+ *   burst_sync_bench
+ */
+ 
+ #include <stdio.h>
+ #include <math.h>
+ #include <random>
+ #include <vector>
+ #include "burst_sync.h"
+ 
+ static const uint32_t BLOCK_SAMPLES = 512;
+ static const uint32_t PRE_SAMPLES = 64;
+ static const uint32_t WINDOW_SAMPLES = 1024;
+ static const uint32_t HISTORY_SAMPLES = WINDOW_SAMPLES + 2 * BLOCK_SAMPLES;
+ 
+ // Burst waveform: 40 pulses of 80 us every 200 us on a 1000-count baseline
+ static const uint32_t PULSES = 40;
+ static const uint32_t PULSE_PERIOD_US = 200;
+ static const uint32_t PULSE_WIDTH_US = 80;
+ static const uint16_t BASELINE = 1000;
+ static const uint16_t PULSE_HEIGHT = 2000;
+ 
+ // Microsecond clock at sample 0, close to wrapping
+ static const uint32_t T0_US = 0xFFFF0000u;
+ 
+ static bool check(bool ok, const char *what) {
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ // Clean burst waveform k samples after the burst start
+ static uint16_t burstWaveform(int64_t k, uint32_t sampleRateHz) {
+   if (k < 0) {
+     return BASELINE;
+   }
+   uint64_t us = (uint64_t)k * 1000000 / sampleRateHz;
+   bool high = us < PULSES * PULSE_PERIOD_US && (us % PULSE_PERIOD_US) < PULSE_WIDTH_US;
+   return high ? BASELINE + PULSE_HEIGHT : BASELINE;
+ }
+ 
+ typedef struct {
+   uint64_t time;                       // Unwrapped microseconds since T0_US
+   bool burstStart;
+ } Event_t;
+ 
+ typedef struct {
+   uint64_t startSample;
+   uint32_t startUs;
+ } Burst_t;
+ 
+ // Synthetic stream: bursts at known sample indices with timestamped edges
+ class Stream {
+   public:
+     Stream(uint32_t sampleRateHz, uint32_t bursts, uint32_t spacing, int noise, int jitterUs, uint32_t seed)
+       : sampleRateHz(sampleRateHz) {
+       std::mt19937 rng(seed);
+       std::uniform_int_distribution<int> jitter(-jitterUs, jitterUs);
+       uint64_t n = (uint64_t)(bursts + 1) * spacing + WINDOW_SAMPLES;
+       n = (n + BLOCK_SAMPLES - 1) / BLOCK_SAMPLES * BLOCK_SAMPLES;
+       samples.resize(n);
+       for (uint32_t b = 0; b < bursts; b++) {
+         Burst_t burst;
+         burst.startSample = (uint64_t)(b + 1) * spacing + b * 7;  // Not block aligned
+         uint64_t startTime = sampleTime(burst.startSample) + jitter(rng);
+         burst.startUs = T0_US + (uint32_t)startTime;
+         list.push_back(burst);
+         for (uint32_t p = 0; p < PULSES; p++) {
+           events.push_back({ startTime + p * PULSE_PERIOD_US, p == 0 });
+           events.push_back({ startTime + p * PULSE_PERIOD_US + PULSE_WIDTH_US, false });
+         }
+       }
+       std::uniform_int_distribution<int> d(-noise, noise);
+       size_t next = 0;
+       for (uint64_t i = 0; i < n; i++) {
+         while (next + 1 < list.size() && i >= list[next + 1].startSample) {
+           next++;
+         }
+         int64_t k = list.empty() ? -1 : (int64_t)(i - list[next].startSample);
+         samples[i] = (uint16_t)(burstWaveform(i < list[0].startSample ? -1 : k, sampleRateHz) + d(rng));
+       }
+     }
+ 
+     // Time of a sample to the nearest microsecond, as micros() stamps a block
+     uint64_t sampleTime(uint64_t index) const { return (index * 1000000 + sampleRateHz / 2) / sampleRateHz; }
+ 
+     uint32_t sampleRateHz;
+     std::vector<uint16_t> samples;
+     std::vector<Burst_t> list;
+     std::vector<Event_t> events;
+ };
+ 
+ class Aligner {
+   public:
+     Aligner() {
+       BurstSyncBuffers_t buffers;
+       buffers.history = history;
+       buffers.historySamples = HISTORY_SAMPLES;
+       buffers.window = window;
+       buffers.sums = sums;
+       buffers.average = average;
+       buffers.maxWindowSamples = WINDOW_SAMPLES;
+       ok = sync.begin(&buffers);
+     }
+ 
+     bool configure(uint16_t averageCount, uint32_t windowSamples = WINDOW_SAMPLES) {
+       BurstSyncConfig_t config;
+       config.preSamples = PRE_SAMPLES;
+       config.windowSamples = windowSamples;
+       config.averageCount = averageCount;
+       return ok && sync.configure(&config);
+     }
+ 
+     BurstSync sync;
+     bool ok;
+ 
+   private:
+     uint16_t history[HISTORY_SAMPLES];
+     uint16_t window[WINDOW_SAMPLES];
+     uint32_t sums[WINDOW_SAMPLES];
+     float average[WINDOW_SAMPLES];
+ };
+ 
+ // What came out of a run
+ typedef struct {
+   std::vector<BurstSyncRecord_t> records;
+   std::vector<std::vector<uint16_t>> windows;
+   std::vector<std::vector<float>> averages;
+   std::vector<uint32_t> averageAfter;  // Windows extracted when each average completed
+ } Run_t;
+ 
+ // Feed the stream block by block as the consumer task does: drain the edges up to the
+ // end of this block (or latency blocks earlier), placing burst starts on this block's
+ // clock, then append the block and extract the windows it completes. skipBlock drops
+ // one block.
+ static Run_t feed(Aligner *a, const Stream &s, uint32_t latency, int64_t skipBlock = -1) {
+   Run_t run;
+   size_t next = 0;
+   uint32_t blocks = (uint32_t)(s.samples.size() / BLOCK_SAMPLES);
+   for (uint32_t b = 0; b < blocks; b++) {
+     uint64_t first = (uint64_t)b * BLOCK_SAMPLES;
+     if ((int64_t)b == skipBlock) {
+       continue;
+     }
+     uint32_t timestampUs = T0_US + (uint32_t)s.sampleTime(first);
+     uint64_t seenBefore = (b + 1 >= latency) ? s.sampleTime((uint64_t)(b + 1 - latency) * BLOCK_SAMPLES) : 0;
+     while (next < s.events.size() && s.events[next].time < seenBefore) {
+       const Event_t &e = s.events[next++];
+       uint32_t timeUs = T0_US + (uint32_t)e.time;
+       uint64_t index;
+       if (e.burstStart && burstSyncSampleIndex(timeUs, timestampUs, first, s.sampleRateHz, &index)) {
+         a->sync.burstStart(index, timeUs);
+       }
+       a->sync.edge(timeUs);
+     }
+     a->sync.processBlock(&s.samples[first], BLOCK_SAMPLES, first);
+     while (a->sync.completeWindow()) {
+       uint32_t n = a->sync.config().windowSamples;
+       run.records.push_back(a->sync.lastRecord());
+       run.windows.push_back(std::vector<uint16_t>(a->sync.window(), a->sync.window() + n));
+       if (a->sync.averageReady()) {
+         run.averages.push_back(std::vector<float>(a->sync.average(), a->sync.average() + n));
+         run.averageAfter.push_back((uint32_t)run.records.size());
+       }
+     }
+   }
+   return run;
+ }
+ 
+ // Every window at its burst's sample index, holding the stream there, with its edges
+ static bool windowsAligned(const Run_t &run, const Stream &s, size_t firstBurst = 0) {
+   bool ok = true;
+   for (size_t w = 0; w < run.records.size() && ok; w++) {
+     const BurstSyncRecord_t &r = run.records[w];
+     const Burst_t &burst = s.list[firstBurst + w];
+     ok &= r.startSample == burst.startSample && r.startUs == burst.startUs && r.windowNumber == w + 1;
+     for (uint32_t i = 0; i < WINDOW_SAMPLES && ok; i++) {
+       ok &= run.windows[w][i] == s.samples[burst.startSample - PRE_SAMPLES + i];
+     }
+     ok &= r.edgeCount == 2 * PULSES;
+     for (uint32_t e = 0; e < r.edgeCount && ok; e++) {
+       ok &= r.edgeOffsetUs[e] == (e / 2) * PULSE_PERIOD_US + ((e % 2) ? PULSE_WIDTH_US : 0);
+     }
+   }
+   return ok;
+ }
+ 
+ // Each average the mean of the windows since the previous one
+ static bool averagesAreMeans(const Run_t &run, uint16_t averageCount) {
+   bool ok = run.averages.size() == run.records.size() / averageCount;
+   for (size_t a = 0; a < run.averages.size() && ok; a++) {
+     ok &= run.averageAfter[a] == (a + 1) * averageCount;
+     for (uint32_t i = 0; i < WINDOW_SAMPLES && ok; i++) {
+       double sum = 0;
+       for (uint32_t w = 0; w < averageCount; w++) {
+         sum += run.windows[a * averageCount + w][i];
+       }
+       ok &= fabs(run.averages[a][i] - sum / averageCount) < 1e-3;
+     }
+   }
+   return ok;
+ }
+ 
+ // RMS difference between an average and the clean burst waveform
+ static double averageError(const std::vector<float> &average, uint32_t sampleRateHz) {
+   double sq = 0;
+   for (uint32_t i = 0; i < WINDOW_SAMPLES; i++) {
+     double d = average[i] - burstWaveform((int64_t)i - PRE_SAMPLES, sampleRateHz);
+     sq += d * d;
+   }
+   return sqrt(sq / WINDOW_SAMPLES);
+ }
+ 
+ int main() {
+   bool ok = true;
+ 
+   // Start times on the sample clock: rounding to the nearest sample, before sample 0, wrapping
+   {
+     uint64_t index = 0;
+     bool mapped = burstSyncSampleIndex(T0_US + 1000 + 9, T0_US + 1000, 50, 50000, &index) && index == 50;
+     mapped &= burstSyncSampleIndex(T0_US + 1000 + 11, T0_US + 1000, 50, 50000, &index) && index == 51;
+     mapped &= burstSyncSampleIndex(T0_US + 1000 - 30, T0_US + 1000, 50, 50000, &index) && index == 48;
+     ok &= check(mapped, "index: nearest sample, either side of the block");
+     ok &= check(!burstSyncSampleIndex(T0_US - 100, T0_US, 2, 50000, &index), "index: before sample 0 rejected");
+     ok &= check(burstSyncSampleIndex(0x10, 0xFFFFFFF0u, 1000, 100000, &index) && index == 1003,
+                 "index: across the microsecond wrap");
+   }
+ 
+   // Alignment with the events drained promptly or a block late, on and off the microsecond grid
+   {
+     const uint32_t rates[] = { 50000, 48000, 100000 };
+     for (uint32_t rate : rates) {
+       for (uint32_t latency = 0; latency <= 1; latency++) {
+         // A window is extracted with the edges drained so far: late edges must still
+         // arrive before its last sample, which a 100 kHz burst (800 samples) does not
+         if (latency > 0 && rate > 50000) {
+           continue;
+         }
+         // Start times jittered by less than half a sample still round to the burst's sample
+         int jitter = (int)(500000 / rate) - 2;
+         Stream s(rate, 24, 1500, 40, jitter, rate + latency);
+         Aligner a;
+         a.configure(1);
+         Run_t run = feed(&a, s, latency);
+         char what[80];
+         snprintf(what, sizeof(what), "align: %lu Hz, edges %s", (unsigned long)rate,
+                  latency == 0 ? "prompt" : "a block late");
+         ok &= check(run.records.size() == s.list.size() && windowsAligned(run, s) &&
+                     a.sync.missedWindows() == 0, what);
+       }
+     }
+   }
+ 
+   // Coherent average: exact without noise, the mean of its windows, and noise reduced by sqrt(n)
+   {
+     Stream clean(50000, 32, 1500, 0, 5, 1);
+     Aligner a;
+     a.configure(16);
+     Run_t run = feed(&a, clean, 0);
+     bool exact = run.averages.size() == 2;
+     for (size_t i = 0; i < run.averages.size(); i++) {
+       exact &= averageError(run.averages[i], 50000) == 0;
+     }
+     ok &= check(exact && a.sync.averagesCompleted() == 2, "average: clean bursts average to the waveform exactly");
+ 
+     const int noise = 200;
+     Stream noisy(50000, 64, 1500, noise, 5, 2);
+     Aligner b;
+     b.configure(16);
+     run = feed(&b, noisy, 1);
+     ok &= check(windowsAligned(run, noisy) && averagesAreMeans(run, 16), "average: each average is the mean of 16 windows");
+     double single = 0, averaged = 0;
+     for (size_t i = 0; i < run.averages.size(); i++) {
+       averaged += averageError(run.averages[i], 50000) / run.averages.size();
+     }
+     std::vector<float> one(run.windows[0].begin(), run.windows[0].end());
+     single = averageError(one, 50000);
+     printf("average: rms error %.1f counts in one window, %.1f in averages of 16\n", single, averaged);
+     ok &= check(averaged < single / 3, "average: noise reduced about four times by 16 windows");
+ 
+     Stream shifted = noisy;
+     for (Burst_t &burst : shifted.list) {
+       burst.startSample++;
+     }
+     ok &= check(!windowsAligned(run, shifted), "average: a one-sample misalignment is detected");
+   }
+ 
+   // Dropped samples lose the windows spanning the gap, later bursts align again
+   {
+     Stream s(50000, 12, 1500, 40, 5, 3);
+     Aligner a;
+     a.configure(4);
+     uint32_t skip = (uint32_t)((s.list[4].startSample + 200) / BLOCK_SAMPLES);
+     Run_t run = feed(&a, s, 0, skip);
+     bool rest = run.records.size() == s.list.size() - 1;
+     for (size_t w = 4; w < run.records.size() && rest; w++) {
+       Run_t tail;
+       tail.records.assign(run.records.begin() + w, run.records.begin() + w + 1);
+       tail.windows.assign(run.windows.begin() + w, run.windows.begin() + w + 1);
+       tail.records[0].windowNumber = 1;
+       rest &= windowsAligned(tail, s, w + 1);
+     }
+     ok &= check(a.sync.missedWindows() == 1 && rest, "gap: window over dropped samples missed, later ones aligned");
+     ok &= check(run.averages.size() == 2 && run.averageAfter[1] == 8, "gap: averaging carries on across the gap");
+   }
+ 
+   // Outstanding bursts beyond the limit, and bursts older than the history, are missed
+   {
+     Aligner a;
+     a.configure(1, 256);
+     bool accepted = true;
+     for (uint32_t b = 0; b < BURST_SYNC_MAX_PENDING; b++) {
+       accepted &= a.sync.burstStart(1000 + b * 10, b);
+     }
+     ok &= check(accepted && !a.sync.burstStart(2000, 99) && a.sync.missedWindows() == 1,
+                 "missed: a burst beyond the outstanding limit refused");
+ 
+     Aligner b;
+     b.configure(1);
+     std::vector<uint16_t> samples(BLOCK_SAMPLES, BASELINE);
+     for (uint32_t i = 0; i < 8; i++) {
+       b.sync.processBlock(samples.data(), BLOCK_SAMPLES, (uint64_t)i * BLOCK_SAMPLES);
+     }
+     b.sync.burstStart(100, 0);
+     b.sync.burstStart(8 * BLOCK_SAMPLES - HISTORY_SAMPLES + PRE_SAMPLES, 1);
+     bool extracted = b.sync.completeWindow();
+     ok &= check(extracted && b.sync.missedWindows() == 1 &&
+                 b.sync.lastRecord().startSample == 8 * BLOCK_SAMPLES - HISTORY_SAMPLES + PRE_SAMPLES,
+                 "missed: a burst older than the history skipped, the next extracted");
+   }
+ 
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
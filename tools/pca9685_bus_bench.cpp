@@ -0,0 +1,393 @@
+/*
+ * PCA9685 Bus Benchmark (host tool)
+ * Runs the pulse generator's PCA9685 sequences against a simulated device
+ * and counts what they cost on the bus: transactions, bytes, and the time a
+ * frequency change takes at 100 kHz. The legacy sequences are the direct
+ * register writes the generator used before Pca9685Driver (read MODE1, four
+ * single-register writes around a 5 ms task delay, both outputs rewritten);
+ * the driver's run from its register shadow. The simulated device enforces
+ * the datasheet rules the sequences depend on (PRESCALE only written while
+ * asleep, auto-increment rollover, RESTART only after the 500 us oscillator
+ * start-up) and checks both end with the outputs running at the new prescale.
+ * Frames of all 16 outputs are then checked to go out in one transaction,
+ * as one ALL_LED write when the outputs are set alike.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/pca9685_bus_bench.cpp src/pca9685_driver.cpp \
+ *       src/pca9685_calibration.cpp -o pca9685_bus_bench
+ *
+ * Usage:
+ *   pca9685_bus_bench
+ */
+ 
+ #include <stdio.h>
+ #include <string.h>
+ #include "pca9685_driver.h"
+ #include "pca9685_calibration.h"
+ 
+ // Bus timing model: 100 kHz (the Wire default), 9 clocks per byte with the
+ // acknowledge, start and stop conditions, and an estimate of the driver
+ // overhead per transaction on the ESP32 (queueing the command link, interrupts)
+ static const double BUS_HZ = 100000.0;
+ static const double START_STOP_US = 20.0;
+ static const double TRANSACTION_OVERHEAD_US = 50.0;
+ static const uint32_t LEGACY_TASK_DELAY_US = 5000;  // vTaskDelay(pdMS_TO_TICKS(5))
+ 
+ static const uint8_t ADDRESS = 0x40;
+ static const uint8_t OUTPUT_1 = 6;
+ static const uint8_t OUTPUT_2 = 7;
+ 
+ // ----- Simulated PCA9685 -----
+ 
+ class SimPca9685 {
+   public:
+     SimPca9685() { powerOn(); }
+ 
+     void powerOn() {
+       memset(_regs, 0, sizeof(_regs));
+       _regs[PCA9685_MODE1] = PCA9685_SLEEP | PCA9685_ALLCALL;
+       _regs[PCA9685_MODE2] = PCA9685_OUTDRV;
+       for (int ch = 0; ch < PCA9685_CHANNELS; ch++) {
+         _regs[PCA9685_LED0_OFF_H + 4 * ch] = 0x10;  // Full off
+       }
+       _regs[PCA9685_PRESCALE] = 0x1E;
+       _pointer = 0;
+       _running = false;
+       _restartPending = false;
+       _wakeUs = 0;
+       _nowUs = 0;
+       _violations = 0;
+       resetCounters();
+     }
+ 
+     void resetCounters() {
+       _transactions = 0;
+       _bytes = 0;
+       _startUs = _nowUs;
+     }
+ 
+     // Write transaction (register pointer first); stop = false leaves it open for a repeated start
+     bool write(uint8_t address, const uint8_t *data, size_t length, bool stop = true) {
+       busTime(1 + length, stop);
+       if (address != ADDRESS || length == 0) {
+         return false;
+       }
+       _pointer = data[0];
+       for (size_t i = 1; i < length; i++) {
+         writeRegister(_pointer, data[i]);
+         advance();
+       }
+       return true;
+     }
+ 
+     // Read transaction from the current pointer
+     bool read(uint8_t address, uint8_t *data, size_t length) {
+       busTime(1 + length, true);
+       if (address != ADDRESS) {
+         return false;
+       }
+       for (size_t i = 0; i < length; i++) {
+         data[i] = _regs[_pointer];
+         if (_pointer == PCA9685_MODE1 && _restartPending) {
+           data[i] |= PCA9685_RESTART;
+         }
+         advance();
+       }
+       return true;
+     }
+ 
+     void delayUs(uint32_t us) { _nowUs += us; }
+ 
+     // Outputs running with the expected prescale and 50% duty on both channels
+     bool check(uint8_t prescale) const {
+       bool ok = _running && _regs[PCA9685_PRESCALE] == prescale && (_regs[PCA9685_MODE1] & PCA9685_AI);
+       static const uint8_t outputs[] = { OUTPUT_1, OUTPUT_2 };
+       for (uint8_t ch : outputs) {
+         const uint8_t *led = &_regs[PCA9685_LED0_ON_L + 4 * ch];
+         ok = ok && led[0] == 0 && led[1] == 0 && led[2] == 0x00 && led[3] == 0x08;
+       }
+       return ok && _violations == 0;
+     }
+ 
+     uint32_t transactions() const { return _transactions; }
+     uint32_t bytes() const { return _bytes; }
+     double elapsedUs() const { return _nowUs - _startUs; }
+     uint32_t violations() const { return _violations; }
+ 
+   private:
+     void busTime(size_t bytes, bool stop) {
+       _bytes += bytes;
+       _nowUs += bytes * 9 * 1e6 / BUS_HZ;
+       if (stop) {
+         _transactions++;
+         _nowUs += START_STOP_US + TRANSACTION_OVERHEAD_US;
+       }
+     }
+ 
+     // Auto-increment: LED15_OFF_H rolls over to MODE1, so does PRESCALE (datasheet 7.3)
+     void advance() {
+       if (!(_regs[PCA9685_MODE1] & PCA9685_AI)) {
+         return;
+       }
+       if (_pointer == PCA9685_SHADOW_SIZE - 1 || _pointer == PCA9685_PRESCALE) {
+         _pointer = 0;
+       } else {
+         _pointer++;
+       }
+     }
+ 
+     void writeRegister(uint8_t reg, uint8_t value) {
+       if (reg == PCA9685_PRESCALE) {
+         if (!(_regs[PCA9685_MODE1] & PCA9685_SLEEP)) {
+           _violations++;  // Ignored by the device while the oscillator runs
+           return;
+         }
+         _regs[reg] = value;
+         return;
+       }
+       if (reg >= PCA9685_ALL_LED_ON_L && reg <= PCA9685_ALL_LED_OFF_H) {
+         for (int ch = 0; ch < PCA9685_CHANNELS; ch++) {
+           _regs[PCA9685_LED0_ON_L + 4 * ch + reg - PCA9685_ALL_LED_ON_L] = value;  // Loads every output
+         }
+         return;
+       }
+       if (reg != PCA9685_MODE1) {
+         _regs[reg] = value;
+         return;
+       }
+ 
+       bool wasAsleep = _regs[PCA9685_MODE1] & PCA9685_SLEEP;
+       bool sleep = value & PCA9685_SLEEP;
+       if (!wasAsleep && sleep && _running) {
+         _running = false;
+         _restartPending = true;  // Outputs stop, to be resumed by RESTART
+       }
+       if (wasAsleep && !sleep) {
+         _wakeUs = _nowUs;
+         if (!_restartPending) {
+           _running = true;  // Never ran before: the outputs start with the oscillator
+         }
+       }
+       if ((value & PCA9685_RESTART) && _restartPending && !sleep) {
+         if (_nowUs - _wakeUs < PCA9685_OSC_STARTUP_US) {
+           _violations++;  // Oscillator not stable yet
+         } else {
+           _restartPending = false;
+           _running = true;
+         }
+       }
+       _regs[PCA9685_MODE1] = value & ~PCA9685_RESTART;
+     }
+ 
+     uint8_t _regs[256];
+     uint8_t _pointer;
+     bool _running;
+     bool _restartPending;
+     double _wakeUs;
+     double _nowUs;
+     double _startUs;
+     uint32_t _transactions;
+     uint32_t _bytes;
+     uint32_t _violations;
+ };
+ 
+ static SimPca9685 sim;
+ 
+ // ----- Legacy sequences (direct register access, as before the driver) -----
+ 
+ static bool legacyRead(uint8_t reg, uint8_t *value) {
+   return sim.write(ADDRESS, &reg, 1) && sim.read(ADDRESS, value, 1);
+ }
+ 
+ static bool legacyWrite(uint8_t reg, uint8_t value) {
+   uint8_t data[2] = { reg, value };
+   return sim.write(ADDRESS, data, 2);
+ }
+ 
+ static bool legacySetPWM(uint8_t channel, uint16_t on, uint16_t off) {
+   uint8_t data[5] = { (uint8_t)(PCA9685_LED0_ON_L + 4 * channel), (uint8_t)(on & 0xFF), (uint8_t)(on >> 8),
+                       (uint8_t)(off & 0xFF), (uint8_t)(off >> 8) };
+   return sim.write(ADDRESS, data, 5);
+ }
+ 
+ static bool legacyInit() {
+   uint8_t mode1;
+   bool ok = legacyWrite(PCA9685_MODE1, PCA9685_SLEEP);
+   sim.delayUs(LEGACY_TASK_DELAY_US);
+   ok = ok && legacyWrite(PCA9685_MODE1, PCA9685_AI) && legacyWrite(PCA9685_MODE2, PCA9685_OUTDRV);
+   sim.delayUs(LEGACY_TASK_DELAY_US);
+   return ok && legacyRead(PCA9685_MODE1, &mode1);
+ }
+ 
+ static bool legacySetFrequency(uint8_t prescale) {
+   uint8_t oldmode;
+   if (!legacyRead(PCA9685_MODE1, &oldmode)) {
+     return false;
+   }
+   uint8_t newmode = (oldmode & ~PCA9685_RESTART) | PCA9685_SLEEP;
+   bool ok = legacyWrite(PCA9685_MODE1, newmode) && legacyWrite(PCA9685_PRESCALE, prescale) &&
+             legacyWrite(PCA9685_MODE1, oldmode);
+   sim.delayUs(LEGACY_TASK_DELAY_US);
+   ok = ok && legacyWrite(PCA9685_MODE1, oldmode | PCA9685_RESTART);
+   return ok && legacySetPWM(OUTPUT_1, 0, 2048) && legacySetPWM(OUTPUT_2, 0, 2048);
+ }
+ 
+ // ----- Driver sequences -----
+ 
+ static bool busWrite(void *context, uint8_t address, const uint8_t *data, size_t length) {
+   (void)context;
+   return sim.write(address, data, length);
+ }
+ 
+ static bool busRead(void *context, uint8_t address, uint8_t reg, uint8_t *data, size_t length) {
+   (void)context;
+   return sim.write(address, &reg, 1, false) && sim.read(address, data, length);
+ }
+ 
+ static void busDelayUs(void *context, uint32_t us) {
+   (void)context;
+   sim.delayUs(us);
+ }
+ 
+ static const Pca9685Bus_t bus = { busWrite, busRead, busDelayUs };
+ static Pca9685Driver driver;
+ 
+ static bool driverInit() {
+   if (!driver.begin(&bus, NULL, ADDRESS, PCA9685_AI, PCA9685_OUTDRV)) {
+     return false;
+   }
+   driver.stagePWM(OUTPUT_1, 0, 2048);
+   driver.stagePWM(OUTPUT_2, 0, 2048);
+   return driver.flush();
+ }
+ 
+ static bool driverSetFrequency(uint8_t prescale) {
+   driver.stagePWM(OUTPUT_1, 0, 2048);
+   driver.stagePWM(OUTPUT_2, 0, 2048);
+   return driver.setPrescale(prescale) && driver.flush();
+ }
+ 
+ // ----- Runs -----
+ 
+ typedef struct {
+   uint32_t transactions;
+   uint32_t bytes;
+   double us;
+   bool ok;
+ } Cost_t;
+ 
+ static Cost_t measure(bool (*step)(uint8_t), uint8_t prescale) {
+   sim.resetCounters();
+   bool ok = step(prescale);
+   return { sim.transactions(), sim.bytes(), sim.elapsedUs(), ok && sim.check(prescale) };
+ }
+ 
+ static bool report(const char *what, const Cost_t &legacy, const Cost_t &shadowed) {
+   bool ok = legacy.ok && shadowed.ok;
+   printf("%-34s legacy %2lu transactions %3lu bytes %8.0f us | driver %2lu transactions %3lu bytes %8.0f us  %s\n",
+          what, (unsigned long)legacy.transactions, (unsigned long)legacy.bytes, legacy.us,
+          (unsigned long)shadowed.transactions, (unsigned long)shadowed.bytes, shadowed.us, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ static bool legacyInitStep(uint8_t prescale) {
+   return legacyInit() && legacySetFrequency(prescale);
+ }
+ 
+ static bool driverInitStep(uint8_t prescale) {
+   return driverInit() && driverSetFrequency(prescale);
+ }
+ 
+ // Shadow matches the device (read back in one transaction)
+ static bool shadowMatches() {
+   uint8_t device[PCA9685_SHADOW_SIZE];
+   uint8_t reg = PCA9685_MODE1;
+   sim.write(ADDRESS, &reg, 1, false);
+   sim.read(ADDRESS, device, sizeof(device));
+   bool same = true;
+   for (uint8_t i = 0; i < PCA9685_SHADOW_SIZE; i++) {
+     same = same && (device[i] & ~PCA9685_RESTART) == driver.shadow(i);
+   }
+   return same;
+ }
+ 
+ // One frame flushed: the transactions it took, against the expected count
+ static bool frameStep(const char *what, const Pca9685Frame_t &frame, uint32_t expected) {
+   sim.resetCounters();
+   bool ok = driver.writeFrame(&frame);
+   uint32_t transactions = sim.transactions();
+   uint32_t bytes = sim.bytes();
+   ok = ok && transactions == expected && shadowMatches();
+   printf("%-34s %lu transactions, %lu bytes  %s\n", what, (unsigned long)transactions, (unsigned long)bytes,
+          ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ int main() {
+   bool ok = true;
+   uint8_t p100 = pca9685PrescaleFor(PCA9685_NOMINAL_OSC_HZ, 100);
+   uint8_t p200 = pca9685PrescaleFor(PCA9685_NOMINAL_OSC_HZ, 200);
+   uint8_t p1500 = pca9685PrescaleFor(PCA9685_NOMINAL_OSC_HZ, 1500);
+ 
+   // Power-on to running at 100 Hz, then frequency changes, on a fresh device for each side
+   Cost_t legacy[4], shadowed[4];
+   sim.powerOn();
+   legacy[0] = measure(legacyInitStep, p100);
+   legacy[1] = measure(legacySetFrequency, p200);
+   legacy[2] = measure(legacySetFrequency, p1500);
+   legacy[3] = measure(legacySetFrequency, p1500);
+   sim.powerOn();
+   shadowed[0] = measure(driverInitStep, p100);
+   shadowed[1] = measure(driverSetFrequency, p200);
+   shadowed[2] = measure(driverSetFrequency, p1500);
+   shadowed[3] = measure(driverSetFrequency, p1500);
+ 
+   ok &= report("init at 100 Hz", legacy[0], shadowed[0]);
+   ok &= report("100 Hz -> 200 Hz", legacy[1], shadowed[1]);
+   ok &= report("200 Hz -> 1500 Hz", legacy[2], shadowed[2]);
+   ok &= report("1500 Hz again (no change)", legacy[3], shadowed[3]);
+   ok &= shadowed[1].bytes < legacy[1].bytes && shadowed[1].us < legacy[1].us && shadowed[3].transactions == 0;
+ 
+   // Shadow matches the device
+   bool same = shadowMatches();
+   printf("%-34s %s\n", "shadow matches the device", same ? "ok" : "FAILED");
+   ok &= same;
+ 
+   // Changes two registers apart go out together, further apart separately
+   sim.resetCounters();
+   driver.stagePWM(0, 0, 100);
+   driver.stagePWM(1, 0, 100);   // Changed OFF registers of 0 and 1 are two apart: one write, the gap rewritten
+   driver.stagePWM(15, 0, 100);
+   bool merged = driver.flush() && sim.transactions() == 2;
+   printf("%-34s %lu transactions, %lu bytes  %s\n", "three outputs staged, one flush", (unsigned long)sim.transactions(),
+          (unsigned long)sim.bytes(), merged ? "ok" : "FAILED");
+   ok &= merged;
+ 
+   // All 16 outputs with their own phase: one auto-increment write
+   Pca9685Frame_t frame = {};
+   for (uint8_t ch = 0; ch < PCA9685_CHANNELS; ch++) {
+     pca9685FrameSet(&frame, ch, 1024, ch * 256);
+   }
+   ok &= frameStep("16 outputs, staggered phases", frame, 1);
+ 
+   // All 16 alike: one ALL_LED write
+   frame.mask = 0;
+   for (uint8_t ch = 0; ch < PCA9685_CHANNELS; ch++) {
+     pca9685FrameSet(&frame, ch, 0, 0);
+   }
+   ok &= frameStep("16 outputs off (ALL_LED)", frame, 1);
+ 
+   // The two outputs interleaved, half a period apart
+   frame.mask = 0;
+   pca9685FrameSet(&frame, OUTPUT_1, 1024, 0);
+   pca9685FrameSet(&frame, OUTPUT_2, 1024, 2048);
+   ok &= frameStep("outputs 6 and 7 interleaved", frame, 1);
+   ok &= frameStep("same frame again", frame, 0);
+   ok &= driver.stats().allLedWrites == 1;
+ 
+   printf("driver totals: %lu transactions, %lu bytes, %lu register writes skipped\n",
+          (unsigned long)driver.stats().transactions, (unsigned long)driver.stats().bytes,
+          (unsigned long)driver.stats().skippedBytes);
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
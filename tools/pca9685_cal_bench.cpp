@@ -0,0 +1,138 @@
+/*
+ * PCA9685 Calibration Check (host tool)
+ * Simulates parts whose oscillator is off nominal, measured at the prescales
+ * the calibration sweeps with the timestamp error of the pulse monitor, and
+ * checks that the fit recovers the oscillator within its stated error and
+ * that the corrected prescale lands closer to the requested frequency.
+ * Also checks the integer prescale lookup against an exhaustive search over
+ * every prescale, for every whole frequency in range at several oscillators.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/pca9685_cal_bench.cpp src/pca9685_calibration.cpp -o pca9685_cal_bench
+ *
+ * Usage:
+ *   pca9685_cal_bench
+ */
+ 
+ #include <stdio.h>
+ #include <math.h>
+ #include <random>
+ #include "pca9685_calibration.h"
+ 
+ static const int TRIALS = 2000;
+ static const float GATE_US = 500000.0f;
+ static const float TIMESTAMP_ERROR_US = 2.0f;  // GPIO interrupt path, the worse backend
+ static const uint16_t SWEEP[] = { 50, 100, 200, 400, 800, 1500 };
+ static const size_t POINTS = sizeof(SWEEP) / sizeof(SWEEP[0]);
+ 
+ // Measure a sweep of a part with the given oscillator
+ static void measureSweep(std::mt19937 &rng, float oscillatorHz, Pca9685CalPoint_t *points) {
+   std::normal_distribution<float> jitter(0.0f, TIMESTAMP_ERROR_US);
+   for (size_t i = 0; i < POINTS; i++) {
+     uint8_t prescale = pca9685PrescaleFor(PCA9685_NOMINAL_OSC_HZ, SWEEP[i]);
+     float trueHz = pca9685OutputHz(oscillatorHz, prescale);
+     // Whole periods in the gate, timed with an error at each end
+     float periods = floorf(GATE_US * trueHz / 1e6f);
+     float intervalUs = periods * 1e6f / trueHz + jitter(rng) - jitter(rng);
+     points[i].prescale = prescale;
+     points[i].measuredHz = periods * 1e6f / intervalUs;
+     points[i].stdErrHz = points[i].measuredHz * sqrtf(2.0f) * TIMESTAMP_ERROR_US / intervalUs;
+   }
+ }
+ 
+ // Integer lookup against the closest prescale found by trying all of them;
+ // returns the lookups that are further off than the millihertz rounding explains
+ static int checkLookup(uint32_t oscillatorHz, double *worstErrorPpm) {
+   int wrong = 0;
+   for (uint32_t hz = 24; hz <= 1526; hz++) {
+     uint8_t best = PCA9685_PRESCALE_MIN;
+     double bestError = 1e30;
+     for (int p = PCA9685_PRESCALE_MIN; p <= PCA9685_PRESCALE_MAX; p++) {
+       double error = fabs(oscillatorHz / (4096.0 * (p + 1)) - hz);
+       if (error < bestError) {
+         bestError = error;
+         best = (uint8_t)p;
+       }
+     }
+     uint8_t prescale = pca9685PrescaleForMilliHz(oscillatorHz, hz * 1000);
+     double error = fabs(oscillatorHz / (4096.0 * (prescale + 1)) - hz);
+     if (prescale != best && error - bestError > 1e-3) {
+       wrong++;
+     }
+     *worstErrorPpm = fmax(*worstErrorPpm, error / hz * 1e6);
+   }
+   return wrong;
+ }
+ 
+ int main() {
+   std::mt19937 rng(11);
+   std::uniform_real_distribution<float> offset(-0.05f, 0.05f);
+   bool ok = true;
+ 
+   // Normalized errors: about 68% of fits should fall within 1 sigma
+   int within1Sigma = 0, improved = 0;
+   double worstPpm = 0;
+   for (int t = 0; t < TRIALS; t++) {
+     float oscillatorHz = PCA9685_NOMINAL_OSC_HZ * (1.0f + offset(rng));
+     Pca9685CalPoint_t points[POINTS];
+     measureSweep(rng, oscillatorHz, points);
+ 
+     Pca9685CalFit_t fit;
+     if (!pca9685FitOscillator(points, POINTS, &fit) || fit.points != POINTS) {
+       ok = false;
+       continue;
+     }
+     double error = fit.oscillatorHz - oscillatorHz;
+     worstPpm = fmax(worstPpm, fabs(error) / oscillatorHz * 1e6);
+     if (fabs(error) <= fit.oscillatorErrHz) {
+       within1Sigma++;
+     }
+ 
+     // Corrected prescale against the nominal one for the default 100 Hz
+     float nominalHz = pca9685OutputHz(oscillatorHz, pca9685PrescaleFor(PCA9685_NOMINAL_OSC_HZ, 100));
+     float correctedHz = pca9685OutputHz(oscillatorHz, pca9685PrescaleFor(fit.oscillatorHz, 100));
+     if (fabsf(correctedHz - 100) <= fabsf(nominalHz - 100)) {
+       improved++;
+     }
+   }
+   double coverage = (double)within1Sigma / TRIALS;
+   printf("%d parts within +-5%%: worst fit error %.1f ppm, %.1f%% within 1 sigma, corrected 100 Hz no worse in %d\n",
+          TRIALS, worstPpm, coverage * 100, improved);
+   ok = ok && worstPpm < 100 && coverage > 0.55 && coverage < 0.80 && improved == TRIALS;
+ 
+   // A point off by more than the deviation limit (wrong pin, missed edges) is dropped
+   Pca9685CalPoint_t points[POINTS];
+   measureSweep(rng, 25600000.0f, points);
+   points[2].measuredHz *= 0.5f;
+   Pca9685CalFit_t fit;
+   bool fitted = pca9685FitOscillator(points, POINTS, &fit);
+   printf("faulty point: fitted %.0f Hz, %u used, %u rejected\n", fit.oscillatorHz, fit.points, fit.rejected);
+   ok = ok && fitted && fit.rejected == 1 && fabs(fit.oscillatorHz - 25600000.0) < 2560;
+ 
+   // Unknown point errors: equal weights, error from the scatter
+   for (size_t i = 0; i < POINTS; i++) {
+     points[i].stdErrHz = 0;
+   }
+   points[2].measuredHz *= 2.0f;
+   fitted = pca9685FitOscillator(points, POINTS, &fit);
+   printf("unweighted: fitted %.0f +- %.0f Hz\n", fit.oscillatorHz, fit.oscillatorErrHz);
+   ok = ok && fitted && fit.oscillatorErrHz > 0 && fabs(fit.oscillatorHz - 25600000.0) < 5 * fit.oscillatorErrHz + 2560;
+ 
+   // Nothing usable
+   ok = ok && !pca9685FitOscillator(points, 0, &fit);
+ 
+   // Integer lookup, nominal and off-nominal parts
+   static const uint32_t OSCILLATORS[] = { 23750000, 24500000, PCA9685_NOMINAL_OSC_WHOLE_HZ, 25321987, 26250000 };
+   int wrong = 0;
+   double worstQuantizationPpm = 0;
+   for (uint32_t oscillatorHz : OSCILLATORS) {
+     wrong += checkLookup(oscillatorHz, &worstQuantizationPpm);
+   }
+   printf("integer lookup: %d of %d not closest, worst quantization %.0f ppm, 1526 Hz gives %.3f Hz\n", wrong,
+          (int)(sizeof(OSCILLATORS) / sizeof(OSCILLATORS[0])) * (1526 - 24 + 1), worstQuantizationPpm,
+          pca9685OutputMilliHz(PCA9685_NOMINAL_OSC_WHOLE_HZ, pca9685PrescaleForMilliHz(PCA9685_NOMINAL_OSC_WHOLE_HZ, 1526000)) / 1000.0);
+   ok = ok && wrong == 0;
+ 
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
@@ -0,0 +1,160 @@
+/*
+ * Pulse Metrics Benchmark (host tool)
+ * Checks the integer burst metrics (Q16.16 kHz frequency, nanosecond
+ * periods, rounded microsecond durations) against an exact floating point
+ * reference over random bursts at both backend tick rates, and compares
+ * their cost per burst with the floating point path the monitor used before
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/pulse_metrics_bench.cpp -o pulse_metrics_bench
+ *
+ * Usage:
+ *   pulse_metrics_bench
+ */
+ 
+ #include <stdio.h>
+ #include <math.h>
+ #include <chrono>
+ #include <random>
+ #include <vector>
+ #include "pulse_burst.h"
+ 
+ static const int BURSTS = 200000;
+ static const int ROUNDS = 20;
+ 
+ // Integer metrics of one burst, as the monitor stores them
+ typedef struct {
+   uint32_t frequencyKHzQ16;
+   uint32_t meanPeriodNs;
+   uint32_t firstPeriodNs;
+   uint32_t firstPeriodUs;
+   uint32_t durationUs;
+ } FixedMetrics_t;
+ 
+ // The floating point path the monitor used before
+ typedef struct {
+   float frequencyKHz;
+   uint32_t firstPeriodUs;
+   uint32_t durationUs;
+ } FloatMetrics_t;
+ 
+ static inline void fixedMetrics(const PulseEdgeTracker_t *t, uint32_t tickHz, uint32_t nsPerTickQ16,
+                                 FixedMetrics_t *m) {
+   m->frequencyKHzQ16 = pulseFrequencyKHzQ16(t, tickHz);
+   m->meanPeriodNs = pulseMeanPeriodNs(t, nsPerTickQ16);
+   m->firstPeriodNs = pulseTicksToNs(t->firstPeriodTicks, nsPerTickQ16);
+   m->firstPeriodUs = pulseTicksToWholeUs(t->firstPeriodTicks, nsPerTickQ16);
+   m->durationUs = pulseTicksToWholeUs(t->lastEdgeTicks - t->burstStartTicks, nsPerTickQ16);
+ }
+ 
+ static inline void floatMetrics(const PulseEdgeTracker_t *t, uint32_t tickHz, FloatMetrics_t *m) {
+   double periodUs = pulseMeanPeriodUs(t, tickHz);
+   m->frequencyKHz = (periodUs > 0) ? (float)(1000.0 / periodUs) : 0;
+   m->firstPeriodUs = (uint32_t)(pulseTicksToUs(t->firstPeriodTicks, tickHz) + 0.5);
+   m->durationUs = (uint32_t)(pulseTicksToUs(t->lastEdgeTicks - t->burstStartTicks, tickHz) + 0.5);
+ }
+ 
+ // Random bursts: 2 to 40 pulses, 1 us to 10 ms periods (log-uniform) with jitter, anywhere in the tick range
+ static std::vector<PulseEdgeTracker_t> makeBursts(uint32_t tickHz, size_t n) {
+   std::mt19937 rng(tickHz);
+   std::uniform_int_distribution<int> pulses(2, PULSE_MAX_PULSE_COUNT);
+   std::uniform_real_distribution<double> logPeriod(log(1e-6), log(1e-2));
+   std::uniform_real_distribution<double> jitter(-0.01, 0.01);
+   std::uniform_int_distribution<uint32_t> start(0, UINT32_MAX);
+   std::vector<PulseEdgeTracker_t> bursts(n);
+   for (size_t i = 0; i < n; i++) {
+     PulseEdgeTracker_t &t = bursts[i];
+     double periodTicks = exp(logPeriod(rng)) * tickHz;
+     int count = pulses(rng);
+     t.burstStartTicks = start(rng);
+     t.edgeCount = (uint16_t)(2 * count);
+     t.firstPeriodTicks = (uint32_t)llround(periodTicks * (1 + jitter(rng)));
+     t.lastOddEdgeTicks = t.burstStartTicks + (uint32_t)llround(periodTicks * (count - 1) * (1 + jitter(rng)));
+     t.lastEdgeTicks = t.lastOddEdgeTicks + (uint32_t)llround(periodTicks / 2);
+   }
+   return bursts;
+ }
+ 
+ static bool checkRate(uint32_t tickHz) {
+   std::vector<PulseEdgeTracker_t> bursts = makeBursts(tickHz, BURSTS);
+   uint32_t nsPerTickQ16 = pulseNsPerTickQ16(tickHz);
+ 
+   double maxFreqLsb = 0, maxFreqPpm = 0, maxFloatPpm = 0, maxPeriodNs = 0, maxFirstNs = 0, maxUs = 0;
+   uint32_t freqFailures = 0;
+   for (const PulseEdgeTracker_t &t : bursts) {
+     FixedMetrics_t fixed;
+     FloatMetrics_t flt;
+     fixedMetrics(&t, tickHz, nsPerTickQ16, &fixed);
+     floatMetrics(&t, tickHz, &flt);
+ 
+     // Exact values
+     double periods = (t.edgeCount - 1) / 2;
+     double spanTicks = (double)(uint32_t)(t.lastOddEdgeTicks - t.burstStartTicks);
+     double freqKHz = periods * tickHz / (spanTicks * 1000.0);
+     double periodNs = spanTicks * 1e9 / tickHz / periods;
+     double firstNs = (double)t.firstPeriodTicks * 1e9 / tickHz;
+     double durationUs = (double)(uint32_t)(t.lastEdgeTicks - t.burstStartTicks) * 1e6 / tickHz;
+ 
+     // Frequency: within 1 ppm, or half a Q16.16 step where that step is coarser (under 7.6 kHz)
+     double freqError = fabs(fixed.frequencyKHzQ16 / 65536.0 - freqKHz);
+     double lsb = freqError * 65536;
+     double ppm = freqError / freqKHz * 1e6;
+     maxFreqLsb = fmax(maxFreqLsb, lsb);
+     if (freqKHz >= 0.5 / 65536 / 1e-6) {
+       maxFreqPpm = fmax(maxFreqPpm, ppm);
+     }
+     maxFloatPpm = fmax(maxFloatPpm, fabs(flt.frequencyKHz - freqKHz) / freqKHz * 1e6);
+     if (ppm > 1.0 && lsb > 0.5 + 1e-6) {
+       freqFailures++;
+     }
+     maxPeriodNs = fmax(maxPeriodNs, fabs(fixed.meanPeriodNs - periodNs));
+     maxFirstNs = fmax(maxFirstNs, fabs(fixed.firstPeriodNs - firstNs));
+     maxUs = fmax(maxUs, fmax(fabs(fixed.durationUs - durationUs), fabs(fixed.firstPeriodUs - firstNs / 1000)));
+   }
+ 
+   bool ok = freqFailures == 0 && maxPeriodNs <= 0.5 + 1e-6 && maxFirstNs <= 0.5 + 1e-6 && maxUs <= 0.5 + 1e-6;
+   printf("%8.3f MHz ticks: frequency %.3f LSB max, %.3f ppm max above 7.6 kHz (float path %.3f ppm); "
+          "period %.3f ns, first period %.3f ns, us values %.3f us max   %s\n",
+          tickHz / 1e6, maxFreqLsb, maxFreqPpm, maxFloatPpm, maxPeriodNs, maxFirstNs, maxUs, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ static void benchRate(uint32_t tickHz) {
+   std::vector<PulseEdgeTracker_t> bursts = makeBursts(tickHz, BURSTS);
+   uint32_t nsPerTickQ16 = pulseNsPerTickQ16(tickHz);
+   volatile uint32_t sink = 0;
+ 
+   auto start = std::chrono::steady_clock::now();
+   for (int round = 0; round < ROUNDS; round++) {
+     for (const PulseEdgeTracker_t &t : bursts) {
+       FloatMetrics_t m;
+       floatMetrics(&t, tickHz, &m);
+       sink = sink + m.durationUs + m.firstPeriodUs + (uint32_t)m.frequencyKHz;
+     }
+   }
+   double floatNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+ 
+   start = std::chrono::steady_clock::now();
+   for (int round = 0; round < ROUNDS; round++) {
+     for (const PulseEdgeTracker_t &t : bursts) {
+       FixedMetrics_t m;
+       fixedMetrics(&t, tickHz, nsPerTickQ16, &m);
+       sink = sink + m.durationUs + m.firstPeriodUs + m.frequencyKHzQ16 + m.meanPeriodNs + m.firstPeriodNs;
+     }
+   }
+   double fixedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+ 
+   double n = (double)BURSTS * ROUNDS;
+   printf("%8.3f MHz ticks: float path %.1f ns/burst, integer path %.1f ns/burst (%.2fx)\n", tickHz / 1e6,
+          floatNs / n, fixedNs / n, floatNs / fixedNs);
+ }
+ 
+ int main() {
+   bool ok = true;
+   ok &= checkRate(1000000);
+   ok &= checkRate(80000000);
+   benchRate(1000000);
+   benchRate(80000000);
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
@@ -0,0 +1,492 @@
+/*
+ * Pulse Burst Replay (host tool)
+ * Replays a recorded edge trace through the pulse monitor's burst state
+ * machine and prints, as CSV, the PulseBurstResult_t sequence the device
+ * would publish for it: a start record when each burst begins and the
+ * result when its gap has passed. Optionally repeats the replay to measure
+ * throughput, or runs built-in regression traces instead of a file; these
+ * also replay traces through the per-pulse BurstAnalyzer.
+ *
+ * Trace format, one entry per line ('#' starts a comment):
+ *   <micros> <level> [<ticks>]
+ * micros is the monotonicUs() of the entry, or a 32-bit micros() that wraps
+ * (each step backwards is taken as one wrap); level is the pin level after
+ * it (0/1; entries that repeat the level are not edges); ticks is the
+ * capture timestamp, at --tick-hz, when it differs from micros.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/pulse_replay.cpp src/pulse_burst.cpp src/burst_analyzer.cpp -o pulse_replay
+ *
+ * Usage:
+ *   pulse_replay [--tick-hz N] [--window N] [--bench N] trace.txt > results.csv
+ *   pulse_replay --check
+ */
+ 
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <math.h>
+ #include <chrono>
+ #include <vector>
+ #include "burst_analyzer.h"
+ #include "pulse_burst.h"
+ 
+ typedef struct {
+   uint64_t timeUs;
+   uint32_t ticks;
+   bool level;
+ } TraceEntry_t;
+ 
+ static const char *eventName(PulseBurstEvent_t event) {
+   switch (event) {
+     case PULSE_BURST_STARTED: return "started";
+     case PULSE_BURST_RECORDED: return "recorded";
+     case PULSE_BURST_FIRST_READING: return "first";
+     case PULSE_BURST_OVER_LIMIT: return "over_limit";
+     case PULSE_BURST_OVER_LIMIT_KEPT: return "over_limit_kept_first";
+     default: return "over_limit_dropped_first";
+   }
+ }
+ 
+ // Whether a closed burst's duration, measured from the ticks, agrees with the
+ // trace times: a monitor configured for the wrong tick rate disagrees
+ static bool ticksMatchTrace(const PulseBurstResult_t &r) {
+   uint64_t spanUs = r.timestampUs - (PULSE_BURST_TIMEOUT_US + 1) - r.burstStartUs;
+   uint64_t durationUs = r.burstDurationUs;
+   return (durationUs > spanUs ? durationUs - spanUs : spanUs - durationUs) <= 1;
+ }
+ 
+ static void printResult(const PulseBurstResult_t &r, PulseBurstEvent_t event, void *context) {
+   uint32_t *mismatched = (uint32_t *)context;
+   if (event != PULSE_BURST_STARTED && !ticksMatchTrace(r)) {
+     (*mismatched)++;
+   }
+   printf("%s,%u,%llu,%llu,%u,%.6f,%lu,%lu,%lu,%lu,%d\n", eventName(event), r.channel,
+          (unsigned long long)r.timestampUs, (unsigned long long)r.burstStartUs, r.pulseCount,
+          r.frequencyKHzQ16 / 65536.0, (unsigned long)r.meanPeriodNs, (unsigned long)r.firstPulsePeriodNs,
+          (unsigned long)r.burstDurationUs, (unsigned long)r.offPeriodUs, r.burstActive ? 1 : 0);
+ }
+ 
+ static bool loadTrace(const char *path, bool haveTicks, std::vector<TraceEntry_t> *trace) {
+   FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+   if (in == NULL) {
+     fprintf(stderr, "Cannot open %s\n", path);
+     return false;
+   }
+ 
+   char line[128];
+   unsigned lineNumber = 0;
+   uint64_t wrapUs = 0;
+   uint64_t previousUs = 0;
+   while (fgets(line, sizeof(line), in) != NULL) {
+     lineNumber++;
+     char *comment = strchr(line, '#');
+     if (comment != NULL) {
+       *comment = '\0';
+     }
+     unsigned long long timeUs;
+     unsigned long level, ticks;
+     int fields = sscanf(line, "%llu %lu %lu", &timeUs, &level, &ticks);
+     if (fields <= 0) {
+       continue;
+     }
+     if (fields < 2 || level > 1 || (haveTicks && fields < 3)) {
+       fprintf(stderr, "%s:%u: expected <micros> <level>%s\n", path, lineNumber, haveTicks ? " <ticks>" : "");
+       return false;
+     }
+     if (timeUs + wrapUs < previousUs) {
+       wrapUs += 1ULL << 32;
+     }
+     TraceEntry_t entry;
+     entry.timeUs = timeUs + wrapUs;
+     entry.ticks = (fields == 3) ? (uint32_t)ticks : (uint32_t)timeUs;
+     previousUs = entry.timeUs;
+     entry.level = level != 0;
+     trace->push_back(entry);
+   }
+   if (in != stdin) {
+     fclose(in);
+   }
+   return true;
+ }
+ 
+ static void replay(PulseBurstReplay *replayer, const std::vector<TraceEntry_t> &trace) {
+   replayer->reset();
+   for (const TraceEntry_t &entry : trace) {
+     replayer->edge(entry.timeUs, entry.ticks, entry.level);
+   }
+   replayer->finish();
+ }
+ 
+ // ----- Regression traces -----
+ 
+ typedef struct {
+   std::vector<PulseBurstResult_t> results;
+   std::vector<PulseBurstEvent_t> events;
+ } Recorded_t;
+ 
+ static void record(const PulseBurstResult_t &r, PulseBurstEvent_t event, void *context) {
+   Recorded_t *recorded = (Recorded_t *)context;
+   if (event != PULSE_BURST_STARTED) {
+     recorded->results.push_back(r);
+     recorded->events.push_back(event);
+   }
+ }
+ 
+ // A burst of square pulses starting at startUs (high first), micros() ticks
+ static uint64_t addBurst(std::vector<TraceEntry_t> *trace, uint64_t startUs, uint16_t pulses, uint32_t periodUs) {
+   uint64_t t = startUs;
+   for (uint16_t i = 0; i < pulses; i++) {
+     trace->push_back({ t, (uint32_t)t, true });
+     trace->push_back({ t + periodUs / 2, (uint32_t)(t + periodUs / 2), false });
+     t += periodUs;
+   }
+   return t - periodUs / 2;  // Last edge
+ }
+ 
+ static Recorded_t replayChecks(const std::vector<TraceEntry_t> &trace) {
+   Recorded_t recorded;
+   PulseBurstConfig_t config = { 0, 1000000, STREAMING_WINDOW_SLIDING, 10 };
+   static PulseBurstReplay replayer;
+   replayer.configure(&config, record, &recorded);
+   replay(&replayer, trace);
+   return recorded;
+ }
+ 
+ // Feed a trace's edges to a BurstAnalyzer at the capture tick rate, as the pulse task
+ // does, collecting every closed burst
+ static std::vector<BurstAnalysis_t> analyzeTrace(const std::vector<TraceEntry_t> &trace, uint32_t tickHz,
+                                                  uint16_t expectedPulses) {
+   std::vector<BurstAnalysis_t> analyses;
+   BurstAnalyzerConfig_t config = { tickHz, PULSE_BURST_TIMEOUT_US, expectedPulses };
+   static BurstAnalyzer analyzer;
+   analyzer.configure(&config);
+   bool level = false;
+   for (const TraceEntry_t &entry : trace) {
+     if (entry.level == level) {
+       continue;
+     }
+     level = entry.level;
+     BurstEdge_t edge = { entry.ticks, entry.level };
+     if (analyzer.addEdge(&edge)) {
+       analyses.push_back(analyzer.result());
+     }
+   }
+   if (analyzer.endBurst()) {
+     analyses.push_back(analyzer.result());
+   }
+   return analyses;
+ }
+ 
+ // Duty cycle in Q16.16 as the analyzer rounds it
+ static uint32_t dutyQ16(uint32_t highNs, uint32_t periodNs) {
+   return (uint32_t)((((uint64_t)highNs << 16) + periodNs / 2) / periodNs);
+ }
+ 
+ // Analysis of a burst without faults: every period and high time as given
+ static bool analysisClean(const BurstAnalysis_t &a, uint16_t pulses, uint32_t periodNs, uint32_t highNs) {
+   bool ok = a.pulseCount == pulses && a.edgeCount == 2 * pulses && a.measuredPulses == pulses &&
+             a.missingPulses == 0 && a.extraPulses == 0 && a.polarityErrors == 0 && a.pulseCountError == 0 &&
+             a.meanPeriodNs == periodNs && a.medianPeriodNs == periodNs && a.driftPsPerPulse == 0 &&
+             a.jitterRmsNs == 0 && a.jitterPeakNs == 0 && a.dutyCycleQ16 == dutyQ16(highNs, periodNs) &&
+             a.durationNs == (pulses - 1) * periodNs + highNs;
+   for (uint16_t i = 0; ok && i < pulses; i++) {
+     ok = a.highNs[i] == highNs && a.periodNs[i] == ((i + 1 < pulses) ? periodNs : 0);
+   }
+   return ok;
+ }
+ 
+ static bool check(bool ok, const char *what) {
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ static bool runChecks() {
+   bool ok = true;
+ 
+   // Bursts straddling the 32-bit micros() wrap measure like any other
+   {
+     std::vector<TraceEntry_t> trace;
+     uint64_t start = 0xFFFFFFFFu - 9000;                       // Burst 2 starts 1 ms before the wrap
+     addBurst(&trace, start - 20000, 10, 100);
+     addBurst(&trace, start + 8000, 20, 100);                   // Wraps mid-burst
+     addBurst(&trace, start + 8000 + 20000, 10, 100);
+     Recorded_t r = replayChecks(trace);
+     ok &= check(r.results.size() == 3, "wrap: three bursts");
+     ok &= check(r.results.size() == 3 && r.results[1].pulseCount == 20 && r.results[1].burstDurationUs == 1950,
+                 "wrap: burst across the wrap keeps its count and duration");
+     ok &= check(r.results.size() == 3 && r.results[1].offPeriodUs == 27050 && r.results[2].offPeriodUs == 18050,
+                 "wrap: off periods across the wrap");
+     ok &= check(r.results.size() == 3 && r.results[2].frequencyKHzQ16 == 10 * 65536 && r.results[2].meanPeriodNs == 100000,
+                 "wrap: frequency after the wrap");
+     ok &= check(r.results.size() == 3 && r.results[2].burstStartUs == start + 28000 &&
+                 r.results[2].timestampUs > r.results[1].timestampUs, "wrap: 64-bit times continue past the wrap");
+   }
+ 
+   // Quiet spells of about a whole wrap neither hide the next burst nor alias its off period
+   {
+     std::vector<TraceEntry_t> trace;
+     uint64_t last = addBurst(&trace, 1000000, 10, 100);
+     addBurst(&trace, last + (1ULL << 32) + 1000, 10, 100);      // micros() comes back 1 ms after the last edge
+     last = addBurst(&trace, last + (1ULL << 32) + 1000 + 50000, 10, 100);
+     addBurst(&trace, last + 60ULL * 60 * 1000000, 10, 100);     // One hour
+     Recorded_t r = replayChecks(trace);
+     ok &= check(r.results.size() == 4, "long gap: burst after a whole wrap is seen");
+     ok &= check(r.results.size() == 4 && r.results[1].offPeriodUs == UINT32_MAX,
+                 "long gap: off period beyond 32 bits saturates");
+     ok &= check(r.results.size() == 4 && r.results[3].offPeriodUs == 3600000000u, "long gap: one hour off period");
+   }
+ 
+   // Extending micros() values to the 64-bit clock, either side of the reference
+   {
+     uint64_t now = 5ULL << 32;
+     ok &= check(monotonicExtendUs((uint32_t)(now - 10), now) == now - 10 &&
+                 monotonicExtendUs((uint32_t)(now + 10), now) == now + 10 &&
+                 monotonicExtendUs(0xFFFFFF00u, now + 5) == now - 256 &&
+                 monotonicExtendUs(0x100u, now - 5) == now + 256, "clock: micros() extended across the wrap");
+   }
+ 
+   // A trace that starts right after boot still sees its first burst
+   {
+     std::vector<TraceEntry_t> trace;
+     addBurst(&trace, 500, 5, 100);
+     Recorded_t r = replayChecks(trace);
+     ok &= check(r.results.size() == 1 && r.results[0].pulseCount == 5, "boot: burst within the gap time of micros() 0");
+   }
+ 
+   // Over-limit bursts restart the statistics; the first reading survives for 3 s
+   {
+     std::vector<TraceEntry_t> trace;
+     uint64_t t = 1000000;
+     addBurst(&trace, t, 10, 100);                                // First reading
+     addBurst(&trace, t + 100000, 10, 100);
+     addBurst(&trace, t + 200000, PULSE_MAX_PULSE_COUNT + 1, 100);  // Within 3 s: kept
+     addBurst(&trace, t + 300000, 12, 100);
+     addBurst(&trace, t + 3500000, PULSE_MAX_PULSE_COUNT + 5, 100);  // After 3 s: dropped
+     addBurst(&trace, t + 3600000, 8, 100);                          // New first reading
+     addBurst(&trace, t + 3700000, PULSE_MAX_PULSE_COUNT, 100);      // At the limit: valid
+     Recorded_t r = replayChecks(trace);
+     bool seven = r.events.size() == 7;
+     ok &= check(seven, "limit: seven bursts");
+     ok &= check(seven && r.events[0] == PULSE_BURST_FIRST_READING && r.events[1] == PULSE_BURST_RECORDED,
+                 "limit: first valid burst stored as the first reading");
+     ok &= check(seven && r.events[2] == PULSE_BURST_OVER_LIMIT_KEPT, "limit: over-limit burst within 3 s keeps it");
+     ok &= check(seven && r.events[3] == PULSE_BURST_RECORDED, "limit: valid burst after that is recorded");
+     ok &= check(seven && r.events[4] == PULSE_BURST_OVER_LIMIT_DROPPED, "limit: over-limit burst after 3 s drops it");
+     ok &= check(seven && r.events[5] == PULSE_BURST_FIRST_READING && r.results[5].pulseCount == 8,
+                 "limit: next valid burst is the new first reading");
+     ok &= check(seven && r.events[6] == PULSE_BURST_RECORDED, "limit: burst at the limit counts as valid");
+   }
+ 
+   // Statistics restart: only bursts after the last over-limit one are in the window
+   {
+     std::vector<TraceEntry_t> trace;
+     addBurst(&trace, 1000000, 10, 100);
+     addBurst(&trace, 1100000, PULSE_MAX_PULSE_COUNT + 1, 100);
+     addBurst(&trace, 1200000, 20, 100);
+     addBurst(&trace, 1300000, 30, 100);
+     Recorded_t recorded;
+     PulseBurstConfig_t config = { 0, 1000000, STREAMING_WINDOW_SLIDING, 10 };
+     static PulseBurstReplay replayer;
+     replayer.configure(&config, record, &recorded);
+     replay(&replayer, trace);
+     const PulseBurstMonitor &m = replayer.monitor();
+     ok &= check(m.pulseCountStats().count() == 2 && m.pulseCountStats().mean() == 25.0f,
+                 "limit: statistics hold only the bursts after the restart");
+     ok &= check(m.haveFirstReading() && m.firstReading().pulseCount == 10, "limit: first reading kept over the restart");
+   }
+ 
+   // Capture ticks at 80 MHz measure the same burst as micros()
+   {
+     std::vector<TraceEntry_t> trace;
+     for (uint16_t i = 0; i < 10; i++) {
+       uint32_t t = 5000 + i * 100;
+       trace.push_back({ t, t * 80 + 3, true });
+       trace.push_back({ (uint64_t)t + 50, (t + 50) * 80 + 3, false });
+     }
+     Recorded_t recorded;
+     PulseBurstConfig_t config = { 1, 80000000, STREAMING_WINDOW_SLIDING, 10 };
+     static PulseBurstReplay replayer;
+     replayer.configure(&config, record, &recorded);
+     replay(&replayer, trace);
+     ok &= check(recorded.results.size() == 1 && recorded.results[0].burstDurationUs == 950 &&
+                 recorded.results[0].firstPulsePeriodUs == 100 && recorded.results[0].firstPulsePeriodNs == 100000 &&
+                 recorded.results[0].channel == 1,
+                 "ticks: hardware timestamps");
+   }
+ 
+   // A trace recorded on the MCPWM backend: 80 MHz ticks, four bursts of 2 kHz pulses.
+   // Replayed at the rate the ticks were taken, every metric matches the trace times; a monitor
+   // left at 1 MHz (as one configured before the capture mode was settled) is 80 times off
+   {
+     std::vector<TraceEntry_t> trace;
+     uint64_t t = 2000000;
+     for (uint16_t burst = 0; burst < 4; burst++) {
+       for (uint16_t i = 0; i < 6; i++, t += 500) {
+         trace.push_back({ t, (uint32_t)(t * 80 + 17), true });
+         trace.push_back({ t + 200, (uint32_t)((t + 200) * 80 + 17), false });
+       }
+       t += 20000;
+     }
+     Recorded_t mcpwm;
+     PulseBurstConfig_t config = { 0, 80000000, STREAMING_WINDOW_SLIDING, 10 };
+     static PulseBurstReplay replayer;
+     replayer.configure(&config, record, &mcpwm);
+     replay(&replayer, trace);
+     bool four = mcpwm.results.size() == 4;
+     bool match = four;
+     for (size_t i = 0; match && i < mcpwm.results.size(); i++) {
+       const PulseBurstResult_t &r = mcpwm.results[i];
+       match = ticksMatchTrace(r) && r.burstDurationUs == 2700 && r.meanPeriodNs == 500000 &&
+               r.firstPulsePeriodNs == 500000 && r.frequencyKHzQ16 == 2 * 65536 && r.pulseCount == 6;
+     }
+     ok &= check(match, "80 MHz: duration, periods and Q16 frequency match the trace");
+     ok &= check(four && mcpwm.results[1].offPeriodUs == 20300 &&
+                 replayer.monitor().frequencyStats().mean() == 2 * 65536, "80 MHz: off period and rolling frequency");
+ 
+     Recorded_t wrongRate;
+     config.tickHz = 1000000;
+     replayer.configure(&config, record, &wrongRate);
+     replay(&replayer, trace);
+     ok &= check(wrongRate.results.size() == 4 && !ticksMatchTrace(wrongRate.results[0]) &&
+                 wrongRate.results[0].burstDurationUs == 80 * 2700,
+                 "80 MHz: monitor left at 1 MHz is caught (80x duration)");
+ 
+     // The per-pulse analyzer fed the same trace agrees with the monitor pulse for pulse
+     std::vector<BurstAnalysis_t> analyses = analyzeTrace(trace, 80000000, 6);
+     bool clean = analyses.size() == 4;
+     for (size_t i = 0; clean && i < analyses.size(); i++) {
+       clean = analysisClean(analyses[i], 6, 500000, 200000) && analyses[i].pulseCount == mcpwm.results[i].pulseCount &&
+               analyses[i].startTicks == (uint32_t)((2000000 + i * 23000) * 80 + 17);
+     }
+     ok &= check(clean, "analyzer: 80 MHz trace, every period, high time and duty cycle");
+     analyses = analyzeTrace(trace, 1000000, 6);
+     bool split = analyses.size() == 4 * 12;
+     for (size_t i = 0; split && i < analyses.size(); i++) {
+       split = analyses[i].edgeCount == 1;
+     }
+     ok &= check(split, "analyzer: left at 1 MHz its gap is 80 times short, each edge a burst");
+   }
+ 
+   // Analyzer on a drifting, jittery burst: the fitted drift and the jitter around it
+   {
+     std::vector<TraceEntry_t> trace;
+     uint64_t t = 1000000;
+     for (uint16_t i = 0; i < 30; i++) {
+       trace.push_back({ t, (uint32_t)t, true });
+       trace.push_back({ t, (uint32_t)t, true });  // Repeated level: not an edge
+       trace.push_back({ t + 40, (uint32_t)(t + 40), false });
+       t += 100 + i + ((i % 2) ? 2 : -2);
+     }
+     std::vector<BurstAnalysis_t> analyses = analyzeTrace(trace, 1000000, 0);
+     bool one = analyses.size() == 1;
+     const BurstAnalysis_t &a = analyses[0];
+     ok &= check(one && a.pulseCount == 30 && a.edgeCount == 60 && a.polarityErrors == 0 && a.missingPulses == 0 &&
+                 a.extraPulses == 0, "analyzer: drifting burst counted without faults");
+     ok &= check(one && a.periodNs[0] == 98000 && a.periodNs[1] == 103000 && a.periodNs[28] == 126000 &&
+                 a.meanPeriodNs == ((t - 1000000 - 131) * 1000 + 14) / 29,
+                 "analyzer: periods follow the trace");
+     ok &= check(one && abs(a.driftPsPerPulse - 1000000) < 10000 && abs((int32_t)a.jitterRmsNs - 2000) < 50 &&
+                 abs((int32_t)a.jitterPeakNs - 2000) < 150, "analyzer: 1 us/pulse drift, 2 us jitter around it");
+   }
+ 
+   // Analyzer on faulty bursts across the micros() wrap: a missing pulse, an extra pulse
+   {
+     std::vector<TraceEntry_t> trace;
+     uint64_t start = (1ULL << 32) - 1500;
+     for (uint16_t i = 0; i < 20; i++) {
+       if (i != 10) {                                             // Pulse 10 missing
+         addBurst(&trace, start + i * 100, 1, 80);
+       }
+     }
+     uint64_t second = start + 30000;
+     for (uint16_t i = 0; i < 20; i++) {
+       addBurst(&trace, second + i * 100, 1, 80);
+       if (i == 12) {
+         addBurst(&trace, second + i * 100 + 50, 1, 20);          // Extra pulse mid-period
+       }
+     }
+     std::vector<BurstAnalysis_t> analyses = analyzeTrace(trace, 1000000, 20);
+     bool two = analyses.size() == 2;
+     ok &= check(two && analyses[0].pulseCount == 19 && analyses[0].missingPulses == 1 && analyses[0].extraPulses == 0 &&
+                 analyses[0].pulseCountError == -1 && analyses[0].periodNs[9] == 200000 &&
+                 analyses[0].medianPeriodNs == 100000 && analyses[0].durationNs == 1940000,
+                 "analyzer: missing pulse found across the wrap");
+     ok &= check(two && analyses[1].pulseCount == 21 && analyses[1].extraPulses == 1 && analyses[1].missingPulses == 0 &&
+                 analyses[1].pulseCountError == 1 && analyses[1].jitterRmsNs == 0 && analyses[1].driftPsPerPulse == 0 &&
+                 analyses[1].dutyCycleQ16 == dutyQ16(40000, 100000), "analyzer: extra pulse found, rhythm unaffected");
+   }
+ 
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok;
+ }
+ 
+ int main(int argc, char **argv) {
+   uint32_t tickHz = 1000000;
+   uint32_t window = 10;
+   uint32_t benchRounds = 0;
+   bool haveTicks = false;
+   const char *path = NULL;
+ 
+   for (int i = 1; i < argc; i++) {
+     if (strcmp(argv[i], "--check") == 0) {
+       return runChecks() ? 0 : 1;
+     } else if (strcmp(argv[i], "--tick-hz") == 0 && i + 1 < argc) {
+       tickHz = (uint32_t)strtoul(argv[++i], NULL, 10);
+       haveTicks = true;
+     } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+       window = (uint32_t)strtoul(argv[++i], NULL, 10);
+     } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+       benchRounds = (uint32_t)strtoul(argv[++i], NULL, 10);
+     } else if (path == NULL) {
+       path = argv[i];
+     } else {
+       path = NULL;
+       break;
+     }
+   }
+   if (path == NULL) {
+     fprintf(stderr, "Usage: %s [--tick-hz N] [--window N] [--bench N] <trace.txt | ->\n       %s --check\n",
+             argv[0], argv[0]);
+     return 2;
+   }
+ 
+   std::vector<TraceEntry_t> trace;
+   if (!loadTrace(path, haveTicks, &trace)) {
+     return 1;
+   }
+ 
+   PulseBurstConfig_t config = { 0, tickHz, STREAMING_WINDOW_SLIDING, (uint16_t)window };
+   static PulseBurstReplay replayer;
+   uint32_t mismatched = 0;
+   if (window > 0xFFFF || !replayer.configure(&config, printResult, &mismatched)) {
+     fprintf(stderr, "Invalid --tick-hz or --window\n");
+     return 2;
+   }
+ 
+   printf("event,channel,timestamp_us,burst_start_us,pulses,frequency_khz,mean_period_ns,first_period_ns,duration_us,"
+          "off_us,active\n");
+   replay(&replayer, trace);
+   const PulseBurstMonitor &m = replayer.monitor();
+   fprintf(stderr, "%zu entries, %lu edges, %lu bursts; window: %.1f pulses, %.3f kHz, off %.2f ms\n", trace.size(),
+           (unsigned long)replayer.edges(), (unsigned long)replayer.bursts(), m.pulseCountStats().mean(),
+           pulseKHz(m.frequencyStats().mean()), m.offPeriodStats().mean() / 1000);
+   if (mismatched > 0) {
+     fprintf(stderr, "warning: %lu burst durations disagree with the trace times - check --tick-hz\n",
+             (unsigned long)mismatched);
+   }
+ 
+   if (benchRounds > 0) {
+     replayer.configure(&config, NULL, NULL);
+     uint64_t edges = 0;
+     auto start = std::chrono::steady_clock::now();
+     for (uint32_t round = 0; round < benchRounds; round++) {
+       replay(&replayer, trace);
+       edges += replayer.edges();
+     }
+     double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+     fprintf(stderr, "bench: %llu edges in %.3f s, %.1f M edges/s\n", (unsigned long long)edges, sec,
+             edges / sec / 1e6);
+   }
+   return 0;
+ }
\ No newline at end of file
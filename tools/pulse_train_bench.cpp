@@ -0,0 +1,105 @@
+/*
+ * Pulse Train Benchmark (host tool)
+ * Compiles pulse train patterns into RMT symbols as the sequencer does and
+ * plays the symbols back the way the RMT reads them (halves in order, an
+ * empty half ends the transmission), checking the output level segments
+ * against the pattern: pulse widths, periods, gaps split over several
+ * halves, bursts repeated to the minimum transmission time, and patterns
+ * that must be rejected.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/pulse_train_bench.cpp src/pulse_train.cpp -o pulse_train_bench
+ *
+ * Usage:
+ *   pulse_train_bench
+ */
+ 
+ #include <stdio.h>
+ #include <vector>
+ #include "pulse_train.h"
+ 
+ // The sequencer's RMT setup: 100 ns ticks, 512 symbols per buffer, 1 ms transmissions
+ static const uint32_t TICK_NS = 100;
+ static const size_t CAPACITY = 512;
+ static const uint64_t MIN_TICKS = 1000000 / TICK_NS;
+ 
+ typedef struct {
+   bool level;
+   uint64_t ticks;
+ } Segment_t;
+ 
+ // Level segments the RMT outputs, adjacent halves at one level joined
+ static std::vector<Segment_t> play(const PulseTrainSymbol_t *symbols, size_t count, bool *halvesOk) {
+   std::vector<Segment_t> segments;
+   *halvesOk = true;
+   for (size_t i = 0; i < 2 * count; i++) {
+     const PulseTrainSymbol_t &symbol = symbols[i / 2];
+     uint32_t duration = (i & 1) ? symbol.duration1 : symbol.duration0;
+     bool level = (i & 1) ? symbol.level1 : symbol.level0;
+     if (duration == 0) {
+       *halvesOk = *halvesOk && (i == 2 * count - 1);  // Only the very last half may end early
+       break;
+     }
+     if (!segments.empty() && segments.back().level == level) {
+       segments.back().ticks += duration;
+     } else {
+       segments.push_back({ level, duration });
+     }
+   }
+   return segments;
+ }
+ 
+ // Compile, play back and compare with the pattern
+ static bool check(const char *what, const PulseTrainPattern_t &pattern, uint64_t minTicks, uint16_t expectedBursts) {
+   static PulseTrainSymbol_t symbols[CAPACITY];
+   uint16_t bursts = 0;
+   size_t count = pulseTrainCompile(&pattern, TICK_NS, minTicks, symbols, CAPACITY, &bursts);
+   size_t counted = pulseTrainCompile(&pattern, TICK_NS, minTicks, NULL, CAPACITY, NULL);
+ 
+   bool halvesOk = false;
+   std::vector<Segment_t> segments = play(symbols, count, &halvesOk);
+ 
+   // Expected: per burst, high width and low rest of period, the last low being the gap
+   uint32_t width = pulseTrainTicks(pattern.pulseWidthNs, TICK_NS);
+   uint32_t period = pulseTrainTicks(pattern.pulsePeriodNs, TICK_NS);
+   uint32_t gap = pulseTrainTicks(pattern.burstGapNs, TICK_NS);
+   bool ok = count > 0 && count == counted && halvesOk && bursts == expectedBursts &&
+             segments.size() == 2u * pattern.pulsesPerBurst * bursts;
+   for (size_t i = 0; ok && i < segments.size(); i++) {
+     bool lastOfBurst = (i / 2) % pattern.pulsesPerBurst == pattern.pulsesPerBurst - 1u;
+     uint64_t expected = (i & 1) ? (lastOfBurst ? gap : period - width) : width;
+     ok = segments[i].level == !(i & 1) && segments[i].ticks == expected;
+   }
+   uint64_t total = pulseTrainDurationTicks(symbols, count);
+   printf("%-40s %4zu symbols %5u bursts %10.3f ms  %s\n", what, count, bursts, total * TICK_NS / 1e6,
+          ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ static bool rejects(const char *what, const PulseTrainPattern_t &pattern) {
+   PulseTrainSymbol_t symbols[CAPACITY];
+   bool ok = pulseTrainCompile(&pattern, TICK_NS, MIN_TICKS, symbols, CAPACITY, NULL) == 0;
+   printf("%-40s rejected  %s\n", what, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ int main() {
+   bool ok = true;
+ 
+   // pulses, width, period, gap (ns)
+   ok &= check("3 x 10 us at 40 kHz, 1 ms gap", { 3, 10000, 25000, 1000000 }, MIN_TICKS, 1);
+   ok &= check("1 x 100 ns, 100 ns gap (5 MHz)", { 1, 100, 0, 100 }, MIN_TICKS, 512);
+   ok &= check("1 x 50 us, 50 us gap (10 kHz)", { 1, 50000, 0, 50000 }, MIN_TICKS, 10);
+   ok &= check("5 x 200 us at 1 kHz, 2 s gap", { 5, 200000, 1000000, 2000000000 }, MIN_TICKS, 1);
+   ok &= check("1 x 1 us, 5 ms gap (odd halves)", { 1, 1000, 0, 5000000 }, MIN_TICKS, 1);
+   ok &= check("2 x 1 us at 250 kHz, 3 us gap, once", { 2, 1000, 4000, 3000 }, 0, 1);
+   ok &= check("rounded to ticks (1049 ns -> 1000)", { 4, 1049, 2951, 10051 }, MIN_TICKS, 50);
+ 
+   ok &= rejects("no pulses", { 0, 1000, 2000, 1000 });
+   ok &= rejects("period not longer than width", { 2, 1000, 1000, 1000 });
+   ok &= rejects("no gap", { 1, 1000, 0, 0 });
+   ok &= rejects("burst larger than the buffer", { 600, 1000, 2000, 1000 });
+ 
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
@@ -0,0 +1,322 @@
+/*
+ * Shared Block Pool Benchmark (host tool)
+ * Exercises SharedBlockPool the way the ADC capture uses it: claim, fill
+ * and commit by the producer, retain and release by any number of holders,
+ * abandon of a claimed block. Checks descriptors and reference counts,
+ * that an exhausted pool makes claim() return NULL, that blocks held out
+ * of order are skipped while the rest keep circulating, and that describe()
+ * and retain() refuse free blocks. A threaded run has holders keep blocks
+ * for random times while the producer refills the free ones, and checks
+ * that no held block is ever overwritten.
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -pthread -Iinclude tools/shared_block_pool_bench.cpp -o shared_block_pool_bench
+ *
+ * Usage:
+ *   shared_block_pool_bench
+ */
+ 
+ #include <stdio.h>
+ #include <atomic>
+ #include <chrono>
+ #include <mutex>
+ #include <random>
+ #include <thread>
+ #include <vector>
+ #include "shared_block_pool.h"
+ 
+ static const uint16_t BLOCK_LENGTH = 64;
+ static const uint16_t NUM_BLOCKS = 8;
+ 
+ typedef SharedBlockPool<uint16_t, 16> Pool;
+ 
+ static bool check(bool ok, const char *what) {
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   return ok;
+ }
+ 
+ // Fill a block with values derived from its stream index
+ static void fill(uint16_t *data, uint16_t count, uint64_t firstIndex) {
+   for (uint16_t i = 0; i < count; i++) {
+     data[i] = (uint16_t)((firstIndex + i) * 7);
+   }
+ }
+ 
+ static bool holdsFill(const Pool::Descriptor &d) {
+   for (uint16_t i = 0; i < d.count; i++) {
+     if (d.data[i] != (uint16_t)((d.firstIndex + i) * 7)) {
+       return false;
+     }
+   }
+   return true;
+ }
+ 
+ // Claim, fill and commit one block
+ static bool produce(Pool *pool, uint64_t firstIndex, Pool::Descriptor *d, uint16_t count = BLOCK_LENGTH) {
+   uint16_t slot;
+   uint16_t *data = pool->claim(&slot);
+   if (data == NULL) {
+     return false;
+   }
+   fill(data, count, firstIndex);
+   return pool->commit(slot, count, firstIndex, d);
+ }
+ 
+ static bool checkConfiguration() {
+   static uint16_t storage[BLOCK_LENGTH * 16];
+   Pool pool;
+   uint16_t slot;
+   bool ok = true;
+   ok &= check(pool.claim(&slot) == NULL, "config: claim before begin returns NULL");
+   ok &= check(!pool.begin(NULL, BLOCK_LENGTH, NUM_BLOCKS), "config: no storage rejected");
+   ok &= check(!pool.begin(storage, 0, NUM_BLOCKS), "config: empty blocks rejected");
+   ok &= check(!pool.begin(storage, BLOCK_LENGTH, 0) && !pool.begin(storage, BLOCK_LENGTH, 17),
+               "config: block count outside 1 - MAX_BLOCKS rejected");
+   ok &= check(pool.begin(storage, BLOCK_LENGTH, 16) && pool.numBlocks() == 16 && pool.blockLength() == BLOCK_LENGTH &&
+               pool.heldBlocks() == 0, "config: largest pool accepted, all blocks free");
+   return ok;
+ }
+ 
+ // Claim, commit, retain, release and abandon of single blocks
+ static bool checkLifecycle() {
+   static uint16_t storage[BLOCK_LENGTH * NUM_BLOCKS];
+   Pool pool;
+   pool.begin(storage, BLOCK_LENGTH, NUM_BLOCKS);
+   bool ok = true;
+ 
+   uint16_t slot = 0xFFFF;
+   uint16_t *data = pool.claim(&slot);
+   ok &= check(data != NULL && slot == 0 && pool.owns(data, slot) && pool.references(slot) == 1,
+               "claim: first free block with the producer's reference");
+   fill(data, 50, 1000);
+   Pool::Descriptor d;
+   ok &= check(!pool.commit(slot, BLOCK_LENGTH + 1, 1000, &d) && !pool.commit(NUM_BLOCKS, 50, 1000, &d),
+               "commit: count over the block length or bad slot refused");
+   ok &= check(pool.commit(slot, 50, 1000, &d) && d.data == data && d.count == 50 && d.slot == slot &&
+               d.sequence == 0 && d.firstIndex == 1000 && holdsFill(d) && pool.references(slot) == 1,
+               "commit: descriptor of the filled block, reference passed on");
+ 
+   ok &= check(pool.retain(slot) && pool.retain(slot) && pool.references(slot) == 3, "retain: each holder adds a reference");
+   ok &= check(!pool.release(slot) && !pool.release(slot) && pool.references(slot) == 1 && pool.heldBlocks() == 1,
+               "release: not the last reference, block stays held");
+   Pool::Descriptor again;
+   ok &= check(pool.describe(slot, &again) && again.data == d.data && again.sequence == d.sequence,
+               "describe: held block described as committed");
+   ok &= check(pool.release(slot) && pool.references(slot) == 0 && pool.heldBlocks() == 0,
+               "release: last reference frees the block");
+   ok &= check(!pool.release(slot) && pool.references(slot) == 0, "release: free block does not underflow");
+ 
+   // Free slots cannot be described or revived
+   ok &= check(!pool.describe(slot, &again), "describe: fails on a free slot");
+   ok &= check(!pool.describe(NUM_BLOCKS, &again) && !pool.describe(1, NULL), "describe: fails on a bad slot or NULL");
+   ok &= check(!pool.retain(slot) && pool.references(slot) == 0, "retain: fails on a free slot");
+ 
+   // Abandon returns the block without using up a sequence number
+   data = pool.claim(&slot);
+   ok &= check(data != NULL && slot == 1 && pool.heldBlocks() == 1, "abandon: block claimed");
+   pool.abandon(slot);
+   ok &= check(pool.references(slot) == 0 && pool.heldBlocks() == 0 && !pool.describe(slot, &again),
+               "abandon: block free again, nothing published");
+   ok &= check(produce(&pool, 2000, &d) && d.sequence == 1 && holdsFill(d), "abandon: next commit continues the sequence");
+   pool.release(d.slot);
+   return ok;
+ }
+ 
+ // Every block held: claim returns NULL until one is released
+ static bool checkExhaustion() {
+   static uint16_t storage[BLOCK_LENGTH * NUM_BLOCKS];
+   Pool pool;
+   pool.begin(storage, BLOCK_LENGTH, NUM_BLOCKS);
+   bool ok = true;
+ 
+   Pool::Descriptor d[NUM_BLOCKS];
+   bool filled = true;
+   for (uint16_t i = 0; i < NUM_BLOCKS; i++) {
+     filled &= produce(&pool, (uint64_t)i * BLOCK_LENGTH, &d[i]) && d[i].slot == i;
+   }
+   uint16_t slot = 0xFFFF;
+   ok &= check(filled && pool.heldBlocks() == NUM_BLOCKS, "exhaustion: every block committed and held");
+   ok &= check(pool.claim(&slot) == NULL && slot == 0xFFFF, "exhaustion: claim returns NULL, slot untouched");
+   ok &= check(pool.claim(NULL) == NULL, "exhaustion: claim without a slot returns NULL");
+ 
+   pool.release(d[5].slot);
+   uint16_t *data = pool.claim(&slot);
+   ok &= check(data != NULL && slot == 5 && pool.claim(&slot) == NULL, "exhaustion: the one released block claimed again");
+   pool.abandon(5);
+ 
+   bool intact = true;
+   for (uint16_t i = 0; i < NUM_BLOCKS; i++) {
+     intact &= (i == 5) || holdsFill(d[i]);
+   }
+   ok &= check(intact, "exhaustion: held blocks untouched");
+   for (uint16_t i = 0; i < NUM_BLOCKS; i++) {
+     if (i != 5) {
+       pool.release(d[i].slot);
+     }
+   }
+   ok &= check(pool.heldBlocks() == 0, "exhaustion: all blocks free after release");
+   return ok;
+ }
+ 
+ // Blocks held for long, released out of order: the producer skips them and reuses the rest
+ static bool checkOutOfOrderReuse() {
+   static uint16_t storage[BLOCK_LENGTH * NUM_BLOCKS];
+   Pool pool;
+   pool.begin(storage, BLOCK_LENGTH, NUM_BLOCKS);
+   bool ok = true;
+ 
+   // Blocks 2 and 6 stay held while 1000 blocks stream through the others
+   std::vector<Pool::Descriptor> kept;
+   uint64_t index = 0;
+   bool skipped = true;
+   bool sequenced = true;
+   uint32_t sequence = 0;
+   for (uint32_t n = 0; n < 1000; n++) {
+     Pool::Descriptor d;
+     if (!produce(&pool, index, &d)) {
+       skipped = false;
+       break;
+     }
+     sequenced &= d.sequence == sequence++;
+     index += BLOCK_LENGTH;
+     if (n < NUM_BLOCKS && (d.slot == 2 || d.slot == 6)) {
+       kept.push_back(d);
+     } else {
+       skipped &= (d.slot != 2 && d.slot != 6) || n < NUM_BLOCKS;
+       pool.release(d.slot);
+     }
+   }
+   ok &= check(skipped && kept.size() == 2, "reuse: long-held blocks skipped, the rest keep circulating");
+   ok &= check(holdsFill(kept[0]) && holdsFill(kept[1]) && kept[0].firstIndex == 2 * BLOCK_LENGTH,
+               "reuse: long-held blocks keep their samples");
+   ok &= check(sequenced, "reuse: sequence numbers follow commit order");
+ 
+   // Hold several at once and release them in a shuffled order; each freed one is reused
+   std::vector<Pool::Descriptor> held;
+   for (uint16_t i = 0; i < NUM_BLOCKS - 2; i++) {
+     Pool::Descriptor d;
+     produce(&pool, index, &d);
+     index += BLOCK_LENGTH;
+     held.push_back(d);
+   }
+   uint16_t slot;
+   ok &= check(pool.heldBlocks() == NUM_BLOCKS && pool.claim(&slot) == NULL, "reuse: pool full with mixed holders");
+   std::mt19937 rng(11);
+   bool reused = true;
+   for (uint32_t round = 0; round < 200; round++) {
+     size_t victim = rng() % held.size();
+     uint16_t freed = held[victim].slot;
+     pool.release(freed);
+     Pool::Descriptor d;
+     reused &= produce(&pool, index, &d) && d.slot == freed;
+     index += BLOCK_LENGTH;
+     held[victim] = d;
+     for (const Pool::Descriptor &h : held) {
+       reused &= holdsFill(h);
+     }
+   }
+   ok &= check(reused, "reuse: the block released out of order is the one claimed");
+   pool.release(kept[0].slot);
+   pool.release(kept[1].slot);
+   for (const Pool::Descriptor &h : held) {
+     pool.release(h.slot);
+   }
+   ok &= check(pool.heldBlocks() == 0, "reuse: all blocks free after release");
+   return ok;
+ }
+ 
+ // Producer refilling free blocks while holder threads keep blocks for random times
+ static bool checkThreaded() {
+   static uint16_t storage[BLOCK_LENGTH * NUM_BLOCKS];
+   Pool pool;
+   pool.begin(storage, BLOCK_LENGTH, NUM_BLOCKS);
+ 
+   const int holders = 3;
+   const uint32_t blocks = 200000;
+   std::mutex handoffMutex;
+   std::vector<std::vector<Pool::Descriptor>> inbox(holders);
+   std::atomic<bool> done(false);
+   std::atomic<uint32_t> corrupted(0);
+   std::atomic<uint32_t> checked(0);
+ 
+   std::vector<std::thread> threads;
+   for (int h = 0; h < holders; h++) {
+     threads.emplace_back([&, h]() {
+       std::mt19937 rng(h + 1);
+       std::vector<Pool::Descriptor> kept;
+       while (true) {
+         bool finished = done.load(std::memory_order_acquire);
+         std::vector<Pool::Descriptor> received;
+         {
+           std::lock_guard<std::mutex> lock(handoffMutex);
+           received.swap(inbox[h]);
+         }
+         kept.insert(kept.end(), received.begin(), received.end());
+         // Release a random held block now and then, checking it first
+         while (!kept.empty() && (finished || rng() % 4 == 0)) {
+           size_t i = rng() % kept.size();
+           if (!holdsFill(kept[i])) {
+             corrupted++;
+           }
+           checked++;
+           pool.release(kept[i].slot);
+           kept[i] = kept.back();
+           kept.pop_back();
+         }
+         if (finished && received.empty() && kept.empty()) {
+           break;
+         }
+         std::this_thread::yield();
+       }
+     });
+   }
+ 
+   auto start = std::chrono::steady_clock::now();
+   uint32_t produced = 0;
+   uint32_t exhausted = 0;
+   uint64_t index = 0;
+   while (produced < blocks) {
+     Pool::Descriptor d;
+     if (!produce(&pool, index, &d)) {
+       exhausted++;
+       std::this_thread::yield();
+       continue;
+     }
+     // Every holder gets a reference; the producer's own goes with the last one
+     for (int h = 1; h < holders; h++) {
+       pool.retain(d.slot);
+     }
+     {
+       std::lock_guard<std::mutex> lock(handoffMutex);
+       for (int h = 0; h < holders; h++) {
+         inbox[h].push_back(d);
+       }
+     }
+     index += BLOCK_LENGTH;
+     produced++;
+   }
+   done.store(true, std::memory_order_release);
+   for (std::thread &t : threads) {
+     t.join();
+   }
+   double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+ 
+   printf("threaded: %lu blocks to %d holders in %.3f s, claim found none %lu times\n", (unsigned long)produced,
+          holders, sec, (unsigned long)exhausted);
+   bool ok = true;
+   ok &= check(corrupted.load() == 0 && checked.load() == (uint32_t)holders * blocks,
+               "threaded: no held block overwritten");
+   ok &= check(pool.heldBlocks() == 0, "threaded: every reference returned");
+   return ok;
+ }
+ 
+ int main() {
+   bool ok = true;
+   ok &= checkConfiguration();
+   ok &= checkLifecycle();
+   ok &= checkExhaustion();
+   ok &= checkOutOfOrderReuse();
+   ok &= checkThreaded();
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file
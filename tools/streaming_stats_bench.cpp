@@ -0,0 +1,196 @@
+/*
+ * Streaming Statistics Benchmark (host tool)
+ * Checks StreamingStats against exact statistics recomputed from the window
+ * (mean, standard deviation, p50/p99 of a stationary series) and compares
+ * its cost per value with re-summing a window array, the way the burst
+ * monitor used to average its last ten bursts
+ *
+ * Build on Linux/macOS from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/streaming_stats_bench.cpp -o streaming_stats_bench
+ *
+ * Usage:
+ *   streaming_stats_bench
+ */
+ 
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <math.h>
+ #include <algorithm>
+ #include <chrono>
+ #include <random>
+ #include <vector>
+ #include "streaming_stats.h"
+ 
+ static const int VALUES = 200000;
+ static const uint16_t SHORT_WINDOW = 10;
+ static const uint16_t LONG_WINDOW = 1000;
+ 
+ // Burst-period-like series: 100 us with gaussian jitter and a rare long tail
+ static std::vector<float> makeSeries(size_t n) {
+   std::mt19937 rng(7);
+   std::normal_distribution<float> jitter(0.0f, 2.0f);
+   std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+   std::vector<float> v(n);
+   for (size_t i = 0; i < n; i++) {
+     v[i] = 100.0f + jitter(rng) + (uniform(rng) < 0.02f ? 20.0f * uniform(rng) : 0.0f);
+   }
+   return v;
+ }
+ 
+ // Exact statistics of values[end - length, end)
+ static void exactWindow(const std::vector<float> &values, size_t end, size_t length,
+                         double *mean, double *stddev, double *p50, double *p99) {
+   std::vector<float> window(values.begin() + (end - length), values.begin() + end);
+   double sum = 0;
+   for (float x : window) {
+     sum += x;
+   }
+   *mean = sum / length;
+   double sumSq = 0;
+   for (float x : window) {
+     sumSq += (x - *mean) * (x - *mean);
+   }
+   *stddev = sqrt(sumSq / (length - 1));
+   std::sort(window.begin(), window.end());
+   *p50 = window[(size_t)lround(0.5 * (length - 1))];
+   *p99 = window[(size_t)lround(0.99 * (length - 1))];
+ }
+ 
+// Time per value of the streaming update, including reading mean, stddev and p99
+ template <uint16_t WINDOW>
+ static double streamingNs(const std::vector<float> &series) {
+   static StreamingStats<WINDOW> stats;
+   stats.configure(STREAMING_WINDOW_SLIDING, WINDOW);
+   volatile float sink = 0;
+   auto start = std::chrono::steady_clock::now();
+   for (float x : series) {
+     stats.add(x);
+     sink = sink + stats.mean() + stats.stddev() + stats.p99();
+   }
+   double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   return sec * 1e9 / series.size();
+ }
+ 
+ // Time per value of the integer Q16.16 mean, reading the mean after each value
+ template <uint16_t WINDOW>
+ static double meanQ16Ns(const std::vector<uint32_t> &series) {
+   static RollingMeanQ16<WINDOW> mean;
+   mean.configure(STREAMING_WINDOW_SLIDING, WINDOW);
+   volatile uint32_t sink = 0;
+   auto start = std::chrono::steady_clock::now();
+   for (uint32_t x : series) {
+     mean.add(x);
+     sink = sink + mean.mean();
+   }
+   double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   return sec * 1e9 / series.size();
+ }
+ 
+ // Time per value of re-summing the window for mean and stddev after each value
+ template <uint16_t WINDOW>
+ static double resumNs(const std::vector<float> &series) {
+   static float window[WINDOW];
+   int index = 0;
+   volatile float sink = 0;
+   auto start = std::chrono::steady_clock::now();
+   for (float x : series) {
+     window[index] = x;
+     index = (index + 1) % WINDOW;
+     float sum = 0, sumSq = 0;
+     for (int j = 0; j < WINDOW; j++) {
+       sum += window[j];
+     }
+     float m = sum / WINDOW;
+     for (int j = 0; j < WINDOW; j++) {
+       sumSq += (window[j] - m) * (window[j] - m);
+     }
+     sink = sink + m + sqrtf(sumSq / (WINDOW - 1));
+   }
+   double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   return sec * 1e9 / series.size();
+ }
+ 
+ int main() {
+   std::vector<float> series = makeSeries(VALUES);
+   bool ok = true;
+ 
+   // Sliding window mean and stddev are exact at every step
+   StreamingStats<SHORT_WINDOW> shortStats;
+   shortStats.configure(STREAMING_WINDOW_SLIDING, SHORT_WINDOW);
+   double worstMean = 0, worstStd = 0;
+   for (size_t i = 0; i < series.size(); i++) {
+     shortStats.add(series[i]);
+     if (i + 1 >= SHORT_WINDOW && i % 97 == 0) {
+       double mean, stddev, p50, p99;
+       exactWindow(series, i + 1, SHORT_WINDOW, &mean, &stddev, &p50, &p99);
+       worstMean = fmax(worstMean, fabs(shortStats.mean() - mean));
+       worstStd = fmax(worstStd, fabs(shortStats.stddev() - stddev));
+     }
+   }
+   printf("sliding %u: worst mean error %.2e, stddev error %.2e\n", SHORT_WINDOW, worstMean, worstStd);
+   ok = ok && worstMean < 1e-3 && worstStd < 1e-3;
+ 
+   // Quantile estimates on a long window of a stationary series
+   StreamingStats<LONG_WINDOW> longStats;
+   longStats.configure(STREAMING_WINDOW_SLIDING, LONG_WINDOW);
+   for (float x : series) {
+     longStats.add(x);
+   }
+   double mean, stddev, p50, p99;
+   exactWindow(series, series.size(), LONG_WINDOW, &mean, &stddev, &p50, &p99);
+   printf("sliding %u: mean %.3f/%.3f stddev %.3f/%.3f p50 %.3f/%.3f p99 %.3f/%.3f (streaming/exact)\n",
+          LONG_WINDOW, longStats.mean(), mean, longStats.stddev(), stddev,
+          longStats.p50(), p50, longStats.p99(), p99);
+   ok = ok && fabs(longStats.p50() - p50) < 0.5 && fabs(longStats.p99() - p99) < 3.0;
+ 
+   // Exponential window against a direct evaluation of the weighted mean
+   StreamingStats<SHORT_WINDOW> expStats;
+   expStats.configure(STREAMING_WINDOW_EXPONENTIAL, SHORT_WINDOW);
+   double alpha = 2.0 / (SHORT_WINDOW + 1), ewma = series[0];
+   expStats.add(series[0]);
+   for (size_t i = 1; i < 1000; i++) {
+     ewma += alpha * (series[i] - ewma);
+     expStats.add(series[i]);
+   }
+   printf("exponential %u: mean %.4f/%.4f stddev %.3f\n", SHORT_WINDOW, expStats.mean(), ewma, expStats.stddev());
+   ok = ok && fabs(expStats.mean() - ewma) < 1e-3;
+ 
+   // Integer Q16.16 mean: sliding window bit-exact, exponential within one step of the weighted mean
+   std::vector<uint32_t> q16(series.size());
+   for (size_t i = 0; i < series.size(); i++) {
+     q16[i] = (uint32_t)lround(series[i] * 655.36);  // Around 6.5 kHz in Q16.16
+   }
+   RollingMeanQ16<SHORT_WINDOW> slidingQ16;
+   slidingQ16.configure(STREAMING_WINDOW_SLIDING, SHORT_WINDOW);
+   bool exact = true;
+   for (size_t i = 0; i < q16.size(); i++) {
+     slidingQ16.add(q16[i]);
+     size_t n = (i + 1 < SHORT_WINDOW) ? i + 1 : SHORT_WINDOW;
+     uint64_t sum = 0;
+     for (size_t j = i + 1 - n; j <= i; j++) {
+       sum += q16[j];
+     }
+     exact &= slidingQ16.mean() == (uint32_t)((sum + n / 2) / n) && slidingQ16.count() == n;
+   }
+   RollingMeanQ16<SHORT_WINDOW> expQ16;
+   expQ16.configure(STREAMING_WINDOW_EXPONENTIAL, SHORT_WINDOW);
+   double ewmaQ16 = q16[0], worstQ16 = 0;
+   expQ16.add(q16[0]);
+   for (size_t i = 1; i < q16.size(); i++) {
+     ewmaQ16 += alpha * (q16[i] - ewmaQ16);
+     expQ16.add(q16[i]);
+     worstQ16 = fmax(worstQ16, fabs(expQ16.mean() - ewmaQ16));
+   }
+   printf("q16 mean: sliding %u %s, exponential %u worst error %.2f steps\n", SHORT_WINDOW,
+          exact ? "bit-exact" : "MISMATCH", SHORT_WINDOW, worstQ16);
+   ok = ok && exact && worstQ16 <= 1.0;
+ 
+   // Cost per value: streaming update against re-summing a window array
+   printf("%-8s %22s %22s\n", "window", "streaming ns/value", "re-sum array ns/value");
+   printf("%-8u %22.1f %22.1f\n", SHORT_WINDOW, streamingNs<SHORT_WINDOW>(series), resumNs<SHORT_WINDOW>(series));
+   printf("%-8u %22.1f %22.1f\n", LONG_WINDOW, streamingNs<LONG_WINDOW>(series), resumNs<LONG_WINDOW>(series));
+   printf("q16 mean only, window %u: %.1f ns/value\n", SHORT_WINDOW, meanQ16Ns<SHORT_WINDOW>(q16));
+ 
+   printf("%s\n", ok ? "PASS" : "FAIL");
+   return ok ? 0 : 1;
+ }
\ No newline at end of file